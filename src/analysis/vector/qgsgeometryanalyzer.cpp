@@ -25,6 +25,7 @@
 #include "qgsvectorfilewriter.h"
 #include "qgsvectordataprovider.h"
 #include "qgsdistancearea.h"
+#include "qgsgeometryunionengine.h"
 #include "qgis.h"
 
 #include <QProgressDialog>
@@ -374,15 +375,6 @@ bool QgsGeometryAnalyzer::convexHull( QgsVectorLayer* layer, const QString& shap
   {
     return false;
   }
-  bool useField = false;
-  if ( uniqueIdField == -1 )
-  {
-    uniqueIdField = 0;
-  }
-  else
-  {
-    useField = true;
-  }
   QgsFields fields;
   fields.append( QgsField( QString( "UID" ), QVariant::String ) );
   fields.append( QgsField( QString( "AREA" ), QVariant::Double ) );
@@ -392,184 +384,42 @@ bool QgsGeometryAnalyzer::convexHull( QgsVectorLayer* layer, const QString& shap
   QgsCoordinateReferenceSystem crs = layer->crs();
 
   QgsVectorFileWriter vWriter( shapefileName, dp->encoding(), fields, outputType, &crs );
-  QgsFeature currentFeature;
-  QgsGeometry* dissolveGeometry = nullptr; //dissolve geometry
-  QMultiMap<QString, QgsFeatureId> map;
 
-  if ( onlySelectedFeatures )
+  //the convex hull of a group is the convex hull of all its vertices, so no union is needed
+  QgsGeometryUnionEngine hullEngine( QgsGeometryUnionEngine::ConvexHull );
+  QMap<QString, QgsAttributes> attributes;
+  if ( !collectDissolveGeometries( layer, onlySelectedFeatures, uniqueIdField, hullEngine, &attributes, p ) )
   {
-    //use QgsVectorLayer::featureAtId
-    const QgsFeatureIds selection = layer->selectedFeaturesIds();
-    QgsFeatureIds::const_iterator it = selection.constBegin();
-    for ( ; it != selection.constEnd(); ++it )
-    {
-#if 0
-      if ( p )
-      {
-        p->setValue( processedFeatures );
-      }
-      if ( p && p->wasCanceled() )
-      {
-        // break; // it may be better to do something else here?
-        return false;
-      }
-#endif
-      if ( !layer->getFeatures( QgsFeatureRequest().setFilterFid( *it ) ).nextFeature( currentFeature ) )
-      {
-        continue;
-      }
-      map.insert( currentFeature.attribute( uniqueIdField ).toString(), currentFeature.id() );
-    }
+    return false;
   }
-  else
+
+  QString errorMsg;
+  bool ok = hullEngine.run( &errorMsg );
+  if ( !ok )
   {
-    QgsFeatureIterator fit = layer->getFeatures();
-    while ( fit.nextFeature( currentFeature ) )
-    {
-#if 0
-      if ( p )
-      {
-        p->setValue( processedFeatures );
-      }
-      if ( p && p->wasCanceled() )
-      {
-        // break; // it may be better to do something else here?
-        return false;
-      }
-#endif
-      map.insert( currentFeature.attribute( uniqueIdField ).toString(), currentFeature.id() );
-    }
+    QgsDebugMsg( QString( "convex hull failed: %1" ).arg( errorMsg ) );
   }
 
-  QMultiMap<QString, QgsFeatureId>::const_iterator jt = map.constBegin();
-  while ( jt != map.constEnd() )
+  Q_FOREACH ( const QString& key, hullEngine.keys() )
   {
-    QString currentKey = jt.key();
-    int processedFeatures = 0;
-    //take only selection
-    if ( onlySelectedFeatures )
-    {
-      //use QgsVectorLayer::featureAtId
-      const QgsFeatureIds selection = layer->selectedFeaturesIds();
-      if ( p )
-      {
-        p->setMaximum( selection.size() );
-      }
-      processedFeatures = 0;
-      while ( jt != map.constEnd() && ( jt.key() == currentKey || !useField ) )
-      {
-        if ( p && p->wasCanceled() )
-        {
-          break;
-        }
-        if ( selection.contains( jt.value() ) )
-        {
-          if ( p )
-          {
-            p->setValue( processedFeatures );
-          }
-          if ( !layer->getFeatures( QgsFeatureRequest().setFilterFid( jt.value() ) ).nextFeature( currentFeature ) )
-          {
-            continue;
-          }
-          convexFeature( currentFeature, processedFeatures, &dissolveGeometry );
-          ++processedFeatures;
-        }
-        ++jt;
-      }
-      QList<double> values;
-      if ( !dissolveGeometry )
-      {
-        QgsDebugMsg( "no dissolved geometry - should not happen" );
-        return false;
-      }
-      dissolveGeometry = dissolveGeometry->convexHull();
-      values = simpleMeasure( dissolveGeometry );
-      QgsAttributes attributes( 3 );
-      attributes[0] = QVariant( currentKey );
-      attributes[1] = values.at( 0 );
-      attributes[2] = values.at( 1 );
-      QgsFeature dissolveFeature;
-      dissolveFeature.setAttributes( attributes );
-      dissolveFeature.setGeometry( dissolveGeometry );
-      vWriter.addFeature( dissolveFeature );
-    }
-    //take all features
-    else
+    QgsAbstractGeometryV2* hull = hullEngine.takeResult( key );
+    if ( !hull )
     {
-      int featureCount = layer->featureCount();
-      if ( p )
-      {
-        p->setMaximum( featureCount );
-      }
-      processedFeatures = 0;
-      while ( jt != map.constEnd() && ( jt.key() == currentKey || !useField ) )
-      {
-        if ( p )
-        {
-          p->setValue( processedFeatures );
-        }
-
-        if ( p && p->wasCanceled() )
-        {
-          break;
-        }
-        if ( !layer->getFeatures( QgsFeatureRequest().setFilterFid( jt.value() ) ).nextFeature( currentFeature ) )
-        {
-          continue;
-        }
-        convexFeature( currentFeature, processedFeatures, &dissolveGeometry );
-        ++processedFeatures;
-        ++jt;
-      }
-      QList<double> values;
-      // QgsGeometry* tmpGeometry = 0;
-      if ( !dissolveGeometry )
-      {
-        QgsDebugMsg( "no dissolved geometry - should not happen" );
-        return false;
-      }
-      dissolveGeometry = dissolveGeometry->convexHull();
-      // values = simpleMeasure( tmpGeometry );
-      values = simpleMeasure( dissolveGeometry );
-      QgsAttributes attributes;
-      attributes[0] = QVariant( currentKey );
-      attributes[1] = QVariant( values[ 0 ] );
-      attributes[2] = QVariant( values[ 1 ] );
-      QgsFeature dissolveFeature;
-      dissolveFeature.setAttributes( attributes );
-      dissolveFeature.setGeometry( dissolveGeometry );
-      vWriter.addFeature( dissolveFeature );
+      continue;
     }
+    QgsGeometry* hullGeometry = new QgsGeometry( hull );
+    QList<double> values = simpleMeasure( hullGeometry );
+    QgsAttributes hullAttributes( 3 );
+    //without a dissolve field, the UID is the first value of the first field, as before
+    hullAttributes[0] = uniqueIdField == -1 ? attributes.value( key ).value( 0 ).toString() : key;
+    hullAttributes[1] = values.at( 0 );
+    hullAttributes[2] = values.at( 1 );
+    QgsFeature dissolveFeature;
+    dissolveFeature.setAttributes( hullAttributes );
+    dissolveFeature.setGeometry( hullGeometry );
+    vWriter.addFeature( dissolveFeature );
   }
-  return true;
-}
-
-
-void QgsGeometryAnalyzer::convexFeature( QgsFeature& f, int nProcessedFeatures, QgsGeometry** dissolveGeometry )
-{
-  if ( !f.constGeometry() )
-  {
-    return;
-  }
-
-  const QgsGeometry* featureGeometry = f.constGeometry();
-  QgsGeometry* tmpGeometry = nullptr;
-  QgsGeometry* convexGeometry = nullptr;
-
-  convexGeometry = featureGeometry->convexHull();
-
-  if ( nProcessedFeatures == 0 )
-  {
-    *dissolveGeometry = convexGeometry;
-  }
-  else
-  {
-    tmpGeometry = *dissolveGeometry;
-    *dissolveGeometry = ( *dissolveGeometry )->combine( convexGeometry );
-    delete tmpGeometry;
-    delete convexGeometry;
-  }
+  return ok;
 }
 
 bool QgsGeometryAnalyzer::dissolve( QgsVectorLayer* layer, const QString& shapefileName,
@@ -584,149 +434,105 @@ bool QgsGeometryAnalyzer::dissolve( QgsVectorLayer* layer, const QString& shapef
   {
     return false;
   }
-  bool useField = false;
-  if ( uniqueIdField == -1 )
-  {
-    uniqueIdField = 0;
-  }
-  else
-  {
-    useField = true;
-  }
 
   QGis::WkbType outputType = dp->geometryType();
   QgsCoordinateReferenceSystem crs = layer->crs();
 
   QgsVectorFileWriter vWriter( shapefileName, dp->encoding(), layer->fields(), outputType, &crs );
-  QgsFeature currentFeature;
-  QMultiMap<QString, QgsFeatureId> map;
 
-  if ( onlySelectedFeatures )
+  QgsGeometryUnionEngine unionEngine;
+  QMap<QString, QgsAttributes> attributes;
+  if ( !collectDissolveGeometries( layer, onlySelectedFeatures, uniqueIdField, unionEngine, &attributes, p ) )
   {
-    //use QgsVectorLayer::featureAtId
-    const QgsFeatureIds selection = layer->selectedFeaturesIds();
-    QgsFeatureIds::const_iterator it = selection.constBegin();
-    for ( ; it != selection.constEnd(); ++it )
-    {
-      if ( !layer->getFeatures( QgsFeatureRequest().setFilterFid( *it ) ).nextFeature( currentFeature ) )
-      {
-        continue;
-      }
-      map.insert( currentFeature.attribute( uniqueIdField ).toString(), currentFeature.id() );
-    }
+    return false;
   }
-  else
+
+  QString errorMsg;
+  bool ok = unionEngine.run( &errorMsg );
+  if ( !ok )
   {
-    QgsFeatureIterator fit = layer->getFeatures();
-    while ( fit.nextFeature( currentFeature ) )
+    QgsDebugMsg( QString( "dissolve failed: %1" ).arg( errorMsg ) );
+  }
+
+  Q_FOREACH ( const QString& key, unionEngine.keys() )
+  {
+    QgsAbstractGeometryV2* dissolved = unionEngine.takeResult( key );
+    if ( !dissolved )
     {
-      map.insert( currentFeature.attribute( uniqueIdField ).toString(), currentFeature.id() );
+      continue;
     }
+    QgsFeature outputFeature;
+    outputFeature.setAttributes( attributes.value( key ) );
+    outputFeature.setGeometry( new QgsGeometry( dissolved ) );
+    vWriter.addFeature( outputFeature );
   }
+  return ok;
+}
 
-  QgsGeometry *dissolveGeometry = nullptr; //dissolve geometry
-  QMultiMap<QString, QgsFeatureId>::const_iterator jt = map.constBegin();
-  QgsFeature outputFeature;
-  while ( jt != map.constEnd() )
+bool QgsGeometryAnalyzer::collectDissolveGeometries( QgsVectorLayer* layer, bool onlySelectedFeatures, int uniqueIdField,
+    QgsGeometryUnionEngine& engine, QMap<QString, QgsAttributes>* attributes, QProgressDialog* p )
+{
+  QgsFeatureRequest request;
+  int featureCount = layer->featureCount();
+  if ( onlySelectedFeatures )
   {
-    QString currentKey = jt.key();
-    int processedFeatures = 0;
-    bool first = true;
-    //take only selection
-    if ( onlySelectedFeatures )
+    request.setFilterFids( layer->selectedFeaturesIds() );
+    featureCount = layer->selectedFeatureCount();
+  }
+  if ( !attributes )
+  {
+    request.setSubsetOfAttributes( uniqueIdField == -1 ? QgsAttributeList() : QgsAttributeList() << uniqueIdField );
+  }
+
+  if ( p )
+  {
+    p->setMaximum( featureCount );
+  }
+
+  int processedFeatures = 0;
+  QgsFeature currentFeature;
+  QgsFeatureIterator fit = layer->getFeatures( request );
+  while ( fit.nextFeature( currentFeature ) )
+  {
+    if ( p )
     {
-      //use QgsVectorLayer::featureAtId
-      const QgsFeatureIds selection = layer->selectedFeaturesIds();
-      if ( p )
-      {
-        p->setMaximum( selection.size() );
-      }
-      while ( jt != map.constEnd() && ( jt.key() == currentKey || !useField ) )
+      p->setValue( processedFeatures );
+      if ( p->wasCanceled() )
       {
-        if ( p && p->wasCanceled() )
-        {
-          break;
-        }
-        if ( selection.contains( jt.value() ) )
-        {
-          if ( p )
-          {
-            p->setValue( processedFeatures );
-          }
-          if ( !layer->getFeatures( QgsFeatureRequest().setFilterFid( jt.value() ) ).nextFeature( currentFeature ) )
-          {
-            continue;
-          }
-          if ( first )
-          {
-            outputFeature.setAttributes( currentFeature.attributes() );
-            first = false;
-          }
-          dissolveFeature( currentFeature, processedFeatures, &dissolveGeometry );
-          ++processedFeatures;
-        }
-        ++jt;
+        return false;
       }
     }
-    //take all features
-    else
+    ++processedFeatures;
+
+    if ( !currentFeature.constGeometry() )
     {
-      int featureCount = layer->featureCount();
-      if ( p )
+      continue;
+    }
+
+    //without a dissolve field, all features are merged together
+    QString key = uniqueIdField == -1 ? QString() : currentFeature.attribute( uniqueIdField ).toString();
+    if ( attributes )
+    {
+      QMap<QString, QgsAttributes>::iterator attributesIt = attributes->find( key );
+      if ( attributesIt == attributes->end() )
       {
-        p->setMaximum( featureCount );
+        attributes->insert( key, currentFeature.attributes() );
       }
-      while ( jt != map.constEnd() && ( jt.key() == currentKey || !useField ) )
+      else if ( uniqueIdField == -1 && currentFeature.attribute( 0 ).toString() < attributesIt->value( 0 ).toString() )
       {
-        if ( p )
-        {
-          p->setValue( processedFeatures );
-        }
-
-        if ( p && p->wasCanceled() )
-        {
-          break;
-        }
-        if ( !layer->getFeatures( QgsFeatureRequest().setFilterFid( jt.value() ) ).nextFeature( currentFeature ) )
-        {
-          continue;
-        }
-        {
-          outputFeature.setAttributes( currentFeature.attributes() );
-          first = false;
-        }
-        dissolveFeature( currentFeature, processedFeatures, &dissolveGeometry );
-        ++processedFeatures;
-        ++jt;
+        //the features used to be ordered by their first field, keep the attributes of the first one
+        *attributesIt = currentFeature.attributes();
       }
     }
-    outputFeature.setGeometry( dissolveGeometry );
-    vWriter.addFeature( outputFeature );
+    engine.addGeometry( key, *currentFeature.constGeometry() );
   }
-  return true;
-}
 
-void QgsGeometryAnalyzer::dissolveFeature( QgsFeature& f, int nProcessedFeatures, QgsGeometry** dissolveGeometry )
-{
-  if ( !f.constGeometry() )
-  {
-    return;
-  }
-
-  const QgsGeometry* featureGeometry = f.constGeometry();
-
-  if ( nProcessedFeatures == 0 )
-  {
-    int geomSize = featureGeometry->wkbSize();
-    *dissolveGeometry = new QgsGeometry();
-    unsigned char* wkb = new unsigned char[geomSize];
-    memcpy( wkb, featureGeometry->asWkb(), geomSize );
-    ( *dissolveGeometry )->fromWkb( wkb, geomSize );
-  }
-  else
+  if ( p )
   {
-    *dissolveGeometry = ( *dissolveGeometry )->combine( featureGeometry );
+    //the union has no meaningful progress, show a busy indicator
+    p->setMaximum( 0 );
   }
+  return true;
 }
 
 bool QgsGeometryAnalyzer::buffer( QgsVectorLayer* layer, const QString& shapefileName, double bufferDistance,
@@ -752,7 +558,7 @@ bool QgsGeometryAnalyzer::buffer( QgsVectorLayer* layer, const QString& shapefil
 
   QgsVectorFileWriter vWriter( shapefileName, dp->encoding(), layer->fields(), outputType, &crs );
   QgsFeature currentFeature;
-  QgsGeometry *dissolveGeometry = nullptr; //dissolve geometry (if dissolve enabled)
+  QgsGeometryUnionEngine dissolveEngine; //collects the buffers (if dissolve enabled)
 
   //take only selection
   if ( onlySelectedFeatures )
@@ -781,7 +587,7 @@ bool QgsGeometryAnalyzer::buffer( QgsVectorLayer* layer, const QString& shapefil
       {
         continue;
       }
-      bufferFeature( currentFeature, processedFeatures, &vWriter, dissolve, &dissolveGeometry, bufferDistance, bufferDistanceField );
+      bufferFeature( currentFeature, &vWriter, dissolve, &dissolveEngine, bufferDistance, bufferDistanceField );
       ++processedFeatures;
     }
 
@@ -812,7 +618,7 @@ bool QgsGeometryAnalyzer::buffer( QgsVectorLayer* layer, const QString& shapefil
       {
         break;
       }
-      bufferFeature( currentFeature, processedFeatures, &vWriter, dissolve, &dissolveGeometry, bufferDistance, bufferDistanceField );
+      bufferFeature( currentFeature, &vWriter, dissolve, &dissolveEngine, bufferDistance, bufferDistanceField );
       ++processedFeatures;
     }
     if ( p )
@@ -823,20 +629,30 @@ bool QgsGeometryAnalyzer::buffer( QgsVectorLayer* layer, const QString& shapefil
 
   if ( dissolve )
   {
-    QgsFeature dissolveFeature;
+    if ( p )
+    {
+      p->setMaximum( 0 );
+    }
+    QString errorMsg;
+    if ( !dissolveEngine.run( &errorMsg ) )
+    {
+      QgsDebugMsg( QString( "buffer dissolve failed: %1" ).arg( errorMsg ) );
+    }
+    QgsAbstractGeometryV2* dissolveGeometry = dissolveEngine.takeResult( QString() );
     if ( !dissolveGeometry )
     {
       QgsDebugMsg( "no dissolved geometry - should not happen" );
       return false;
     }
-    dissolveFeature.setGeometry( dissolveGeometry );
+    QgsFeature dissolveFeature;
+    dissolveFeature.setGeometry( new QgsGeometry( dissolveGeometry ) );
     vWriter.addFeature( dissolveFeature );
   }
   return true;
 }
 
-void QgsGeometryAnalyzer::bufferFeature( QgsFeature& f, int nProcessedFeatures, QgsVectorFileWriter* vfw, bool dissolve,
-    QgsGeometry** dissolveGeometry, double bufferDistance, int bufferDistanceField )
+void QgsGeometryAnalyzer::bufferFeature( QgsFeature& f, QgsVectorFileWriter* vfw, bool dissolve,
+    QgsGeometryUnionEngine* dissolveEngine, double bufferDistance, int bufferDistanceField )
 {
   if ( !f.constGeometry() )
   {
@@ -845,7 +661,6 @@ void QgsGeometryAnalyzer::bufferFeature( QgsFeature& f, int nProcessedFeatures,
 
   double currentBufferDistance;
   const QgsGeometry* featureGeometry = f.constGeometry();
-  QgsGeometry* tmpGeometry = nullptr;
   QgsGeometry* bufferGeometry = nullptr;
 
   //create buffer
@@ -861,17 +676,11 @@ void QgsGeometryAnalyzer::bufferFeature( QgsFeature& f, int nProcessedFeatures,
 
   if ( dissolve )
   {
-    if ( nProcessedFeatures == 0 )
-    {
-      *dissolveGeometry = bufferGeometry;
-    }
-    else
+    if ( bufferGeometry && dissolveEngine )
     {
-      tmpGeometry = *dissolveGeometry;
-      *dissolveGeometry = ( *dissolveGeometry )->combine( bufferGeometry );
-      delete tmpGeometry;
-      delete bufferGeometry;
+      dissolveEngine->addGeometry( QString(), *bufferGeometry );
     }
+    delete bufferGeometry;
   }
   else //dissolve
   {
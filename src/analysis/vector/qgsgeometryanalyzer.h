@@ -25,6 +25,7 @@
 #include "qgsdistancearea.h"
 
 class QgsVectorFileWriter;
+class QgsGeometryUnionEngine;
 class QProgressDialog;
 
 
@@ -136,12 +137,16 @@ class ANALYSIS_EXPORT QgsGeometryAnalyzer
     /** Helper function to get the cetroid of an individual feature*/
     void centroidFeature( QgsFeature& f, QgsVectorFileWriter* vfw );
     /** Helper function to buffer an individual feature*/
-    void bufferFeature( QgsFeature& f, int nProcessedFeatures, QgsVectorFileWriter* vfw, bool dissolve, QgsGeometry** dissolveGeometry,
+    void bufferFeature( QgsFeature& f, QgsVectorFileWriter* vfw, bool dissolve, QgsGeometryUnionEngine* dissolveEngine,
                         double bufferDistance, int bufferDistanceField );
-    /** Helper function to get the convex hull of feature(s)*/
-    void convexFeature( QgsFeature& f, int nProcessedFeatures, QgsGeometry** dissolveGeometry );
-    /** Helper function to dissolve feature(s)*/
-    void dissolveFeature( QgsFeature& f, int nProcessedFeatures, QgsGeometry** dissolveGeometry );
+    /** Helper function to collect the geometries of (selected) features per dissolve key.
+     * @param uniqueIdField index of the dissolve field, or -1 to merge all features
+     * @param attributes if not null, receives the attributes of the first feature of every key. Without
+     * a dissolve field, this is the feature with the lowest value in the first field.
+     * @returns false if the operation was canceled
+     */
+    bool collectDissolveGeometries( QgsVectorLayer* layer, bool onlySelectedFeatures, int uniqueIdField, QgsGeometryUnionEngine& engine,
+                                    QMap<QString, QgsAttributes>* attributes, QProgressDialog* p );
 
     //helper functions for event layer
     void addEventLayerFeature( QgsFeature& feature, QgsGeometry* geom, QgsGeometry* lineGeom, QgsVectorFileWriter* fileWriter, QgsFeatureList& memoryFeatures, int offsetField = -1, double offsetScale = 1.0,
@@ -25,11 +25,218 @@
 #include "qgsvectorfilewriter.h"
 #include "qgsvectordataprovider.h"
 #include "qgsdistancearea.h"
+#include "qgsgeos.h"
+
 #include <QProgressDialog>
+#include <QThread>
+#include <QtConcurrentMap>
+
+#include <cmath>
+
+//average number of features of the input layer processed per tile
+#define FEATURES_PER_TILE 1024
+
+/// @cond PRIVATE
+
+struct QgsOverlayItem
+{
+  QgsFeature feature;
+  //! indices of the overlay features whose bounding box intersects the feature in the tile's overlay feature list
+  QList<int> candidates;
+  QgsFeatureList results;
+};
+
+//! Consecutive items of a tile, processed by one thread
+struct QgsOverlayChunk
+{
+  QgsOverlayItem* items;
+  int count;
+};
+
+class QgsOverlayWorker
+{
+  public:
+    typedef void result_type;
+
+    QgsOverlayWorker( const QgsFeatureList& overlayFeatures, bool intersections, bool differences, bool swapped, int attributeCount, int overlayAttributeCount )
+        : mOverlayFeatures( overlayFeatures )
+        , mIntersections( intersections )
+        , mDifferences( differences )
+        , mSwapped( swapped )
+        , mAttributeCount( attributeCount )
+        , mOverlayAttributeCount( overlayAttributeCount )
+    {}
+
+    void operator()( const QgsOverlayChunk& chunk )
+    {
+      // the shared GEOS handle must not be used from several threads, every geometry of the
+      // chunk is created, processed and destroyed with a handle of its own. The overlay
+      // geometries are converted once and used for all the items of the chunk
+      GEOSContextHandle_t ctxt = QgsGeos::createGEOSHandler();
+      QHash<int, GEOSGeometry*> overlayGeometries;
+
+      for ( int i = 0; i < chunk.count; ++i )
+        process( ctxt, chunk.items[i], overlayGeometries );
+
+      Q_FOREACH ( GEOSGeometry* g, overlayGeometries )
+      {
+        if ( g )
+          GEOSGeom_destroy_r( ctxt, g );
+      }
+      QgsGeos::destroyGEOSHandler( ctxt );
+    }
+
+  private:
+    const QgsFeatureList& mOverlayFeatures;
+    bool mIntersections;
+    bool mDifferences;
+    bool mSwapped;
+    int mAttributeCount;
+    int mOverlayAttributeCount;
+
+    //! Returns the GEOS geometry of an overlay feature, converting it the first time it is used
+    GEOSGeometry* overlayGeometry( GEOSContextHandle_t ctxt, int index, QHash<int, GEOSGeometry*>& overlayGeometries )
+    {
+      QHash<int, GEOSGeometry*>::const_iterator it = overlayGeometries.constFind( index );
+      if ( it != overlayGeometries.constEnd() )
+        return it.value();
+
+      const QgsGeometry* geometry = mOverlayFeatures.at( index ).constGeometry();
+      GEOSGeometry* geos = geometry && geometry->geometry() ? QgsGeos::asGeos( ctxt, geometry->geometry() ) : nullptr;
+      overlayGeometries.insert( index, geos );
+      return geos;
+    }
+
+    void process( GEOSContextHandle_t ctxt, QgsOverlayItem& item, QHash<int, GEOSGeometry*>& overlayGeometries )
+    {
+      const QgsGeometry* geometry = item.feature.constGeometry();
+      if ( !geometry || !geometry->geometry() )
+        return;
+
+      GEOSGeometry* geos = QgsGeos::asGeos( ctxt, geometry->geometry() );
+      if ( !geos )
+        return;
+
+      const GEOSPreparedGeometry* prepared = nullptr;
+      QVector<GEOSGeometry*> covering;
+      try
+      {
+        prepared = GEOSPrepare_r( ctxt, geos );
+
+        Q_FOREACH ( int index, item.candidates )
+        {
+          GEOSGeometry* overlayGeos = overlayGeometry( ctxt, index, overlayGeometries );
+          if ( !overlayGeos )
+            continue;
+
+          // only the bounding boxes of the candidates are known to intersect the feature
+          char intersects = prepared ? GEOSPreparedIntersects_r( ctxt, prepared, overlayGeos ) : GEOSIntersects_r( ctxt, geos, overlayGeos );
+          if ( intersects != 1 )
+            continue;
+
+          if ( mIntersections )
+          {
+            GEOSGeometry* intersection = GEOSIntersection_r( ctxt, geos, overlayGeos );
+            addResult( ctxt, item, intersection, &mOverlayFeatures.at( index ) );
+          }
+
+          if ( mDifferences )
+            covering << GEOSGeom_clone_r( ctxt, overlayGeos );
+        }
+
+        if ( mDifferences )
+        {
+          GEOSGeometry* difference = nullptr;
+          if ( covering.isEmpty() )
+          {
+            difference = GEOSGeom_clone_r( ctxt, geos );
+          }
+          else
+          {
+            // the collection takes ownership of the covering geometries
+            GEOSGeometry* collection = GEOSGeom_createCollection_r( ctxt, GEOS_GEOMETRYCOLLECTION, covering.data(), covering.size() );
+            covering.clear();
+            GEOSGeometry* coverage = GEOSUnaryUnion_r( ctxt, collection );
+            GEOSGeom_destroy_r( ctxt, collection );
+            difference = GEOSDifference_r( ctxt, geos, coverage );
+            GEOSGeom_destroy_r( ctxt, coverage );
+          }
+          addResult( ctxt, item, difference, nullptr );
+        }
+      }
+      catch ( GEOSException &e )
+      {
+        QgsDebugMsg( QString( "Overlay of feature %1 failed: %2" ).arg( item.feature.id() ).arg( e.what() ) );
+      }
+
+      Q_FOREACH ( GEOSGeometry* g, covering )
+      {
+        if ( g )
+          GEOSGeom_destroy_r( ctxt, g );
+      }
+      if ( prepared )
+        GEOSPreparedGeom_destroy_r( ctxt, prepared );
+      GEOSGeom_destroy_r( ctxt, geos );
+    }
+
+    //! Adds an output feature, taking ownership of the GEOS geometry
+    void addResult( GEOSContextHandle_t ctxt, QgsOverlayItem& item, GEOSGeometry* geos, const QgsFeature* overlayFeature )
+    {
+      if ( !geos )
+        return;
+
+      if ( GEOSisEmpty_r( ctxt, geos ) )
+      {
+        GEOSGeom_destroy_r( ctxt, geos );
+        return;
+      }
+
+      QgsAttributes attributes = item.feature.attributes();
+      attributes.resize( mAttributeCount );
+      QgsAttributes overlayAttributes = overlayFeature ? overlayFeature->attributes() : QgsAttributes();
+      overlayAttributes.resize( mOverlayAttributeCount );
+
+      QgsFeature result;
+      result.setGeometry( new QgsGeometry( QgsGeos::fromGeos( ctxt, geos ) ) );
+      GEOSGeom_destroy_r( ctxt, geos );
+      //the attributes of the first input layer always come first
+      result.setAttributes( mSwapped ? overlayAttributes + attributes : attributes + overlayAttributes );
+      item.results << result;
+    }
+};
+
+///@endcond
 
 bool QgsOverlayAnalyzer::intersection( QgsVectorLayer* layerA, QgsVectorLayer* layerB,
                                        const QString& shapefileName, bool onlySelectedFeatures,
                                        QProgressDialog* p )
+{
+  return overlay( layerA, layerB, shapefileName, onlySelectedFeatures, IntersectionPart, false, p );
+}
+
+bool QgsOverlayAnalyzer::difference( QgsVectorLayer* layerA, QgsVectorLayer* layerB,
+                                     const QString& shapefileName, bool onlySelectedFeatures,
+                                     QProgressDialog* p )
+{
+  return overlay( layerA, layerB, shapefileName, onlySelectedFeatures, DifferencePart, false, p );
+}
+
+bool QgsOverlayAnalyzer::symDifference( QgsVectorLayer* layerA, QgsVectorLayer* layerB,
+                                        const QString& shapefileName, bool onlySelectedFeatures,
+                                        QProgressDialog* p )
+{
+  return overlay( layerA, layerB, shapefileName, onlySelectedFeatures, DifferencePart, true, p );
+}
+
+bool QgsOverlayAnalyzer::unionLayers( QgsVectorLayer* layerA, QgsVectorLayer* layerB,
+                                      const QString& shapefileName, bool onlySelectedFeatures,
+                                      QProgressDialog* p )
+{
+  return overlay( layerA, layerB, shapefileName, onlySelectedFeatures, IntersectionPart | DifferencePart, true, p );
+}
+
+bool QgsOverlayAnalyzer::overlay( QgsVectorLayer* layerA, QgsVectorLayer* layerB, const QString& shapefileName, bool onlySelectedFeatures,
+                                  int parts, bool symmetric, QProgressDialog* p )
 {
   if ( !layerA || !layerB )
   {
@@ -50,135 +257,188 @@ bool QgsOverlayAnalyzer::intersection( QgsVectorLayer* layerA, QgsVectorLayer* l
   combineFieldLists( fieldsA, fieldsB );
 
   QgsVectorFileWriter vWriter( shapefileName, dpA->encoding(), fieldsA, outputType, &crs );
-  QgsFeature currentFeature;
-  QgsSpatialIndex index;
 
-  //take only selection
-  if ( onlySelectedFeatures )
+  if ( p )
   {
-    const QgsFeatureIds selectionB = layerB->selectedFeaturesIds();
-    QgsFeatureIds::const_iterator it = selectionB.constBegin();
-    for ( ; it != selectionB.constEnd(); ++it )
+    int featureCount = onlySelectedFeatures ? layerA->selectedFeatureCount() : layerA->featureCount();
+    if ( symmetric )
     {
-      if ( !layerB->getFeatures( QgsFeatureRequest().setFilterFid( *it ) ).nextFeature( currentFeature ) )
-      {
-        continue;
-      }
-      index.insertFeature( currentFeature );
+      featureCount += onlySelectedFeatures ? layerB->selectedFeatureCount() : layerB->featureCount();
     }
-    //use QgsVectorLayer::featureAtId
-    const QgsFeatureIds selectionA = layerA->selectedFeaturesIds();
-    if ( p )
-    {
-      p->setMaximum( selectionA.size() );
-    }
-    QgsFeature currentFeature;
-    int processedFeatures = 0;
-    it = selectionA.constBegin();
-    for ( ; it != selectionA.constEnd(); ++it )
-    {
-      if ( p )
-      {
-        p->setValue( processedFeatures );
-      }
+    p->setMaximum( featureCount );
+  }
 
-      if ( p && p->wasCanceled() )
-      {
-        break;
-      }
-      if ( !layerA->getFeatures( QgsFeatureRequest().setFilterFid( *it ) ).nextFeature( currentFeature ) )
-      {
-        continue;
-      }
-      intersectFeature( currentFeature, &vWriter, layerB, &index );
-      ++processedFeatures;
-    }
+  int processedFeatures = 0;
+  if ( !overlayPass( layerA, layerB, onlySelectedFeatures, parts, false, &vWriter, p, processedFeatures ) )
+  {
+    return true;
+  }
 
-    if ( p )
+  //parts of layer B outside of layer A. Intersections have been written by the first pass.
+  if ( symmetric && !overlayPass( layerB, layerA, onlySelectedFeatures, DifferencePart, true, &vWriter, p, processedFeatures ) )
+  {
+    return true;
+  }
+
+  if ( p )
+  {
+    p->setValue( p->maximum() );
+  }
+  return true;
+}
+
+bool QgsOverlayAnalyzer::overlayPass( QgsVectorLayer* layer, QgsVectorLayer* overlayLayer, bool onlySelectedFeatures, int parts, bool swapped,
+                                      QgsVectorFileWriter* vfw, QProgressDialog* p, int& processedFeatures )
+{
+  //index the overlay layer
+  QgsFeatureRequest overlayRequest;
+  overlayRequest.setSubsetOfAttributes( QgsAttributeList() );
+  if ( onlySelectedFeatures )
+  {
+    overlayRequest.setFilterFids( overlayLayer->selectedFeaturesIds() );
+  }
+  QgsSpatialIndex index( overlayLayer->getFeatures( overlayRequest ) );
+
+  //collect the bounding box centers of the input features to assign them to tiles
+  QgsFeatureRequest request;
+  request.setSubsetOfAttributes( QgsAttributeList() );
+  if ( onlySelectedFeatures )
+  {
+    request.setFilterFids( layer->selectedFeaturesIds() );
+  }
+
+  QList< QPair<QgsFeatureId, QgsPoint> > centers;
+  QgsRectangle extent;
+  extent.setMinimal();
+  QgsFeature currentFeature;
+  QgsFeatureIterator fit = layer->getFeatures( request );
+  while ( fit.nextFeature( currentFeature ) )
+  {
+    if ( !currentFeature.constGeometry() )
     {
-      p->setValue( selectionA.size() );
+      continue;
     }
+    QgsRectangle box = currentFeature.constGeometry()->boundingBox();
+    centers << qMakePair( currentFeature.id(), box.center() );
+    extent.combineExtentWith( box );
   }
-  //take all features
-  else
+  fit.close();
+
+  if ( centers.isEmpty() )
   {
-    QgsFeatureIterator fit = layerB->getFeatures();
-    while ( fit.nextFeature( currentFeature ) )
+    return true;
+  }
+
+  //partition the extent into a grid of tiles, which are processed one after the other
+  int tilesPerSide = qMax( 1, static_cast< int >( std::ceil( std::sqrt( static_cast< double >( centers.size() ) / FEATURES_PER_TILE ) ) ) );
+  double tileWidth = extent.width() / tilesPerSide;
+  double tileHeight = extent.height() / tilesPerSide;
+  QVector< QList<QgsFeatureId> > tiles( tilesPerSide * tilesPerSide );
+  QList< QPair<QgsFeatureId, QgsPoint> >::const_iterator centerIt = centers.constBegin();
+  for ( ; centerIt != centers.constEnd(); ++centerIt )
+  {
+    int col = tileWidth > 0 ? qBound( 0, static_cast< int >( ( centerIt->second.x() - extent.xMinimum() ) / tileWidth ), tilesPerSide - 1 ) : 0;
+    int row = tileHeight > 0 ? qBound( 0, static_cast< int >( ( centerIt->second.y() - extent.yMinimum() ) / tileHeight ), tilesPerSide - 1 ) : 0;
+    tiles[ row * tilesPerSide + col ] << centerIt->first;
+  }
+  centers.clear();
+
+  int attributeCount = layer->fields().count();
+  int overlayAttributeCount = overlayLayer->fields().count();
+  bool parallel = QThread::idealThreadCount() > 1;
+
+  Q_FOREACH ( const QList<QgsFeatureId>& tile, tiles )
+  {
+    if ( tile.isEmpty() )
     {
-      index.insertFeature( currentFeature );
+      continue;
     }
-
-    int featureCount = layerA->featureCount();
     if ( p )
     {
-      p->setMaximum( featureCount );
+      p->setValue( processedFeatures );
+      if ( p->wasCanceled() )
+      {
+        return false;
+      }
     }
-    int processedFeatures = 0;
 
-    fit = layerA->getFeatures();
-
-    QgsFeature currentFeature;
+    //fetch the input features of the tile and the overlay candidates of all of them at once
+    QVector<QgsOverlayItem> items;
+    QSet<QgsFeatureId> candidateIds;
+    fit = layer->getFeatures( QgsFeatureRequest().setFilterFids( tile.toSet() ) );
     while ( fit.nextFeature( currentFeature ) )
     {
-      if ( p )
+      if ( !currentFeature.constGeometry() )
       {
-        p->setValue( processedFeatures );
+        continue;
       }
-      if ( p && p->wasCanceled() )
+      QgsOverlayItem item;
+      item.feature = currentFeature;
+      items << item;
+      Q_FOREACH ( QgsFeatureId id, index.intersects( currentFeature.constGeometry()->boundingBox() ) )
       {
-        break;
+        candidateIds.insert( id );
       }
-      intersectFeature( currentFeature, &vWriter, layerB, &index );
-      ++processedFeatures;
     }
-    if ( p )
+
+    QgsFeatureList overlayFeatures;
+    QHash<QgsFeatureId, int> overlayIndex;
+    if ( !candidateIds.isEmpty() )
     {
-      p->setValue( featureCount );
+      QgsFeatureIterator overlayIt = overlayLayer->getFeatures( QgsFeatureRequest().setFilterFids( candidateIds ) );
+      while ( overlayIt.nextFeature( currentFeature ) )
+      {
+        overlayIndex.insert( currentFeature.id(), overlayFeatures.size() );
+        overlayFeatures << currentFeature;
+      }
     }
-  }
-  return true;
-}
-
-void QgsOverlayAnalyzer::intersectFeature( QgsFeature& f, QgsVectorFileWriter* vfw,
-    QgsVectorLayer* vl, QgsSpatialIndex* index )
-{
-  if ( !f.constGeometry() )
-  {
-    return;
-  }
-
-  const QgsGeometry* featureGeometry = f.constGeometry();
-  QgsGeometry* intersectGeometry = nullptr;
-  QgsFeature overlayFeature;
 
-  QList<QgsFeatureId> intersects;
-  intersects = index->intersects( featureGeometry->boundingBox() );
-  QList<QgsFeatureId>::const_iterator it = intersects.constBegin();
-  QgsFeature outFeature;
-  for ( ; it != intersects.constEnd(); ++it )
-  {
-    if ( !vl->getFeatures( QgsFeatureRequest().setFilterFid( *it ) ).nextFeature( overlayFeature ) )
+    //the candidates are the overlay features whose bounding box intersects the feature,
+    //the workers test their geometries
+    for ( int i = 0; i < items.size(); ++i )
     {
-      continue;
+      QgsOverlayItem& item = items[i];
+      Q_FOREACH ( QgsFeatureId id, index.intersects( item.feature.constGeometry()->boundingBox() ) )
+      {
+        QHash<QgsFeatureId, int>::const_iterator idx = overlayIndex.constFind( id );
+        if ( idx != overlayIndex.constEnd() )
+          item.candidates << idx.value();
+      }
     }
 
-    if ( featureGeometry->intersects( overlayFeature.constGeometry() ) )
+    //one chunk of consecutive items per thread, so that every thread converts the overlay
+    //geometries it needs only once
+    int threads = parallel ? qBound( 1, items.size(), QThread::idealThreadCount() ) : 1;
+    int chunkSize = ( items.size() + threads - 1 ) / threads;
+    QVector<QgsOverlayChunk> chunks;
+    for ( int first = 0; first < items.size(); first += chunkSize )
     {
-      intersectGeometry = featureGeometry->intersection( overlayFeature.constGeometry() );
+      QgsOverlayChunk chunk = { items.data() + first, qMin( chunkSize, items.size() - first ) };
+      chunks << chunk;
+    }
 
-      outFeature.setGeometry( intersectGeometry );
-      QgsAttributes attributesA = f.attributes();
-      QgsAttributes attributesB = overlayFeature.attributes();
-      combineAttributeMaps( attributesA, attributesB );
-      outFeature.setAttributes( attributesA );
+    QgsOverlayWorker worker( overlayFeatures, parts & IntersectionPart, parts & DifferencePart, swapped, attributeCount, overlayAttributeCount );
+    if ( chunks.size() > 1 )
+    {
+      QtConcurrent::blockingMap( chunks, worker );
+    }
+    else
+    {
+      Q_FOREACH ( const QgsOverlayChunk& chunk, chunks )
+        worker( chunk );
+    }
 
-      //add it to vector file writer
-      if ( vfw )
+    //write the results in the order of the input features
+    Q_FOREACH ( const QgsOverlayItem& item, items )
+    {
+      Q_FOREACH ( QgsFeature result, item.results )
       {
-        vfw->addFeature( outFeature );
+        vfw->addFeature( result );
       }
     }
+    processedFeatures += tile.size();
   }
+  return true;
 }
 
 void QgsOverlayAnalyzer::combineFieldLists( QgsFields& fieldListA, const QgsFields& fieldListB )
@@ -201,9 +461,3 @@ void QgsOverlayAnalyzer::combineFieldLists( QgsFields& fieldListA, const QgsFiel
     names.append( field.name() );
   }
 }
-
-void QgsOverlayAnalyzer::combineAttributeMaps( QgsAttributes& attributesA, const QgsAttributes& attributesB )
-{
-  attributesA += attributesB;
-}
-
@@ -48,11 +48,65 @@ class ANALYSIS_EXPORT QgsOverlayAnalyzer
                        const QString& shapefileName, bool onlySelectedFeatures = false,
                        QProgressDialog* p = nullptr );
 
+    /** Write the parts of the features of layer A which are not covered by layer B to a new shape file.
+      The output features carry the attributes of layer A, the attributes of layer B are null.
+      @param layerA input vector layer
+      @param layerB input vector layer
+      @param shapefileName path to the output shp
+      @param onlySelectedFeatures if true, only selected features are considered, else all the features
+      @param p progress dialog (or 0 if no progress dialog is to be shown)
+      @note added in QGIS 2.18
+      */
+    bool difference( QgsVectorLayer* layerA, QgsVectorLayer* layerB,
+                     const QString& shapefileName, bool onlySelectedFeatures = false,
+                     QProgressDialog* p = nullptr );
+
+    /** Write the parts of both input layers which are not covered by the other layer to a new shape file
+      @param layerA input vector layer
+      @param layerB input vector layer
+      @param shapefileName path to the output shp
+      @param onlySelectedFeatures if true, only selected features are considered, else all the features
+      @param p progress dialog (or 0 if no progress dialog is to be shown)
+      @note added in QGIS 2.18
+      */
+    bool symDifference( QgsVectorLayer* layerA, QgsVectorLayer* layerB,
+                        const QString& shapefileName, bool onlySelectedFeatures = false,
+                        QProgressDialog* p = nullptr );
+
+    /** Perform a union on two input vector layers and write output to a new shape file. The output
+      contains the intersections of both layers with the attributes of both features and the
+      parts which are only covered by one of the layers with the attributes of that layer.
+      @param layerA input vector layer
+      @param layerB input vector layer
+      @param shapefileName path to the output shp
+      @param onlySelectedFeatures if true, only selected features are considered, else all the features
+      @param p progress dialog (or 0 if no progress dialog is to be shown)
+      @note added in QGIS 2.18
+      */
+    bool unionLayers( QgsVectorLayer* layerA, QgsVectorLayer* layerB,
+                      const QString& shapefileName, bool onlySelectedFeatures = false,
+                      QProgressDialog* p = nullptr );
+
   private:
 
+    //! Parts of the features which are written by an overlay pass
+    enum OverlayPart
+    {
+      IntersectionPart = 1, //!< Intersections with the overlay features
+      DifferencePart = 2, //!< Parts not covered by any overlay feature
+    };
+
+    bool overlay( QgsVectorLayer* layerA, QgsVectorLayer* layerB, const QString& shapefileName, bool onlySelectedFeatures,
+                  int parts, bool symmetric, QProgressDialog* p );
+
+    /** Overlays the features of a layer with the features of an overlay layer, tile by tile.
+     * @param swapped true if layer is the second input layer, so that its attributes are placed after the first layer's
+     * @returns false if the operation was canceled
+     */
+    bool overlayPass( QgsVectorLayer* layer, QgsVectorLayer* overlayLayer, bool onlySelectedFeatures, int parts, bool swapped,
+                      QgsVectorFileWriter* vfw, QProgressDialog* p, int& processedFeatures );
+
     void combineFieldLists( QgsFields& fieldListA, const QgsFields& fieldListB );
-    void intersectFeature( QgsFeature& f, QgsVectorFileWriter* vfw, QgsVectorLayer* dp, QgsSpatialIndex* index );
-    void combineAttributeMaps( QgsAttributes& attributesA, const QgsAttributes& attributesB );
 };
 
 #endif //QGSVECTORANALYZER
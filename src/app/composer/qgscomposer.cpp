@@ -42,6 +42,7 @@
 #include "qgscomposerlegend.h"
 #include "qgscomposerlegendwidget.h"
 #include "qgscomposermap.h"
+#include "qgscomposermaprendercache.h"
 #include "qgsatlascomposition.h"
 #include "qgscomposermapwidget.h"
 #include "qgscomposerpicture.h"
@@ -1765,6 +1766,9 @@ void QgsComposer::exportCompositionAsPDF( QgsComposer::OutputMode mode )
     progress.setWindowTitle( tr( "Exporting atlas" ) );
     QApplication::setOverrideCursor( Qt::BusyCursor );
 
+    // when printing as raster, render the maps of the following pages in background threads
+    QScopedPointer< QgsComposerMapRenderCache > renderCache( mComposition->printAsRaster() ? new QgsComposerMapRenderCache( mComposition ) : nullptr );
+
     for ( int featureI = 0; featureI < atlasMap->numFeatures(); ++featureI )
     {
       progress.setValue( featureI );
@@ -1775,6 +1779,10 @@ void QgsComposer::exportCompositionAsPDF( QgsComposer::OutputMode mode )
         atlasMap->endRender();
         break;
       }
+      if ( renderCache )
+      {
+        renderCache->prepareAtlasFeatures( featureI, mComposition->printResolution() );
+      }
       if ( !atlasMap->prepareForFeature( featureI ) )
       {
         QMessageBox::warning( this, tr( "Atlas processing error" ),
@@ -1931,6 +1939,9 @@ void QgsComposer::printComposition( QgsComposer::OutputMode mode )
     QProgressDialog progress( tr( "Rendering maps..." ), tr( "Abort" ), 0, atlasMap->numFeatures(), this );
     progress.setWindowTitle( tr( "Exporting atlas" ) );
 
+    // when printing as raster, render the maps of the following pages in background threads
+    QScopedPointer< QgsComposerMapRenderCache > renderCache( mComposition->printAsRaster() ? new QgsComposerMapRenderCache( mComposition ) : nullptr );
+
     for ( int i = 0; i < atlasMap->numFeatures(); ++i )
     {
       progress.setValue( i );
@@ -1942,6 +1953,10 @@ void QgsComposer::printComposition( QgsComposer::OutputMode mode )
         atlasMap->endRender();
         break;
       }
+      if ( renderCache )
+      {
+        renderCache->prepareAtlasFeatures( i, mComposition->printResolution() );
+      }
       if ( !atlasMap->prepareForFeature( i ) )
       {
         QMessageBox::warning( this, tr( "Atlas processing error" ),
@@ -2288,6 +2303,9 @@ void QgsComposer::exportCompositionAsImage( QgsComposer::OutputMode mode )
     QProgressDialog progress( tr( "Rendering maps..." ), tr( "Abort" ), 0, atlasMap->numFeatures(), this );
     progress.setWindowTitle( tr( "Exporting atlas" ) );
 
+    // render the maps of the following pages in background threads
+    QgsComposerMapRenderCache renderCache( mComposition );
+
     for ( int feature = 0; feature < atlasMap->numFeatures(); ++feature )
     {
       progress.setValue( feature );
@@ -2299,6 +2317,7 @@ void QgsComposer::exportCompositionAsImage( QgsComposer::OutputMode mode )
         atlasMap->endRender();
         break;
       }
+      renderCache.prepareAtlasFeatures( feature, imageDlg.resolution() );
       if ( ! atlasMap->prepareForFeature( feature ) )
       {
         QMessageBox::warning( this, tr( "Atlas processing error" ),
@@ -947,9 +947,8 @@ void QgsComposerMapWidget::on_mUpdatePreviewButton_clicked()
 
   mUpdatePreviewButton->setEnabled( false ); //prevent crashes because of many button clicks
 
-  mComposerMap->setCacheUpdated( false );
-  mComposerMap->cache();
-  mComposerMap->update();
+  // render the layers again instead of composing their cached images
+  mComposerMap->updateCachedImage();
 
   mUpdatePreviewButton->setEnabled( true );
 }
@@ -217,6 +217,7 @@
 #include "qgssnappingdialog.h"
 #include "qgssourceselectdialog.h"
 #include "qgsstatisticalsummarydockwidget.h"
+#include "qgsrenderprofilerdock.h"
 #include "qgsstatusbarcoordinateswidget.h"
 #include "qgsstatusbarmagnifierwidget.h"
 #include "qgsstatusbarscalewidget.h"
@@ -742,6 +743,12 @@ QgisApp::QgisApp( QSplashScreen *splash, bool restorePlugins, bool skipVersionCh
   mStatisticalSummaryDockWidget->setObjectName( "StatistalSummaryDockWidget" );
   endProfile();
 
+  // Rendering profiler dock
+  startProfile( "Rendering profiler dock" );
+  mRenderProfilerDock = new QgsRenderProfilerDock( mMapCanvas, this );
+  mRenderProfilerDock->setObjectName( "RenderProfilerDock" );
+  endProfile();
+
   // Bookmarks dock
   startProfile( "Bookmarks widget" );
   mBookMarksDockWidget = new QgsBookmarks( this );
@@ -822,6 +829,9 @@ QgisApp::QgisApp( QSplashScreen *splash, bool restorePlugins, bool skipVersionCh
   addDockWidget( Qt::LeftDockWidgetArea, mStatisticalSummaryDockWidget );
   mStatisticalSummaryDockWidget->hide();
 
+  addDockWidget( Qt::BottomDockWidgetArea, mRenderProfilerDock );
+  mRenderProfilerDock->hide();
+
   addDockWidget( Qt::LeftDockWidgetArea, mBookMarksDockWidget );
   mBookMarksDockWidget->hide();
 
@@ -1155,6 +1165,7 @@ QgisApp::QgisApp()
     , mBrowserWidget2( nullptr )
     , mAdvancedDigitizingDockWidget( nullptr )
     , mStatisticalSummaryDockWidget( nullptr )
+    , mRenderProfilerDock( nullptr )
     , mBookMarksDockWidget( nullptr )
     , mSnappingDialog( nullptr )
     , mPluginManager( nullptr )
@@ -6116,6 +6127,8 @@ void QgisApp::saveAsRasterFile()
   fileWriter.setPyramidsResampling( d.pyramidsResamplingMethod() );
   fileWriter.setPyramidsFormat( d.pyramidsFormat() );
   fileWriter.setPyramidsConfigOptions( d.pyramidsConfigOptions() );
+  // read the parts through copies of the pipe in parallel, e.g. to reproject them
+  fileWriter.setMaxThreadCount( QThread::idealThreadCount() );
 
   QgsRasterFileWriter::WriterError err = fileWriter.writeRaster( pipe.data(), d.nColumns(), d.nRows(), d.outputRectangle(), d.outputCrs(), &pd );
   if ( err != QgsRasterFileWriter::NoError )
@@ -87,6 +87,7 @@ class QgsAdvancedDigitizingDockWidget;
 class QgsSnappingDialog;
 class QgsGPSInformationWidget;
 class QgsStatisticalSummaryDockWidget;
+class QgsRenderProfilerDock;
 class QgsMapCanvasTracer;
 
 class QgsDecorationItem;
@@ -1775,6 +1776,7 @@ signals:
 
     QgsAdvancedDigitizingDockWidget *mAdvancedDigitizingDockWidget;
     QgsStatisticalSummaryDockWidget* mStatisticalSummaryDockWidget;
+    QgsRenderProfilerDock* mRenderProfilerDock;
     QgsBookmarks* mBookMarksDockWidget;
 
     QgsSnappingDialog *mSnappingDialog;
@@ -43,6 +43,7 @@
 #include "qgsrasterlayer.h"
 #include "qgsrasterlayerproperties.h"
 #include "qgsrasterpyramid.h"
+#include "qgsrasterpyramidbuilder.h"
 #include "qgsrasterrange.h"
 #include "qgsrasterrenderer.h"
 #include "qgsrasterrendererregistry.h"
@@ -82,6 +83,7 @@ QgsRasterLayerProperties::QgsRasterLayerProperties( QgsMapLayer* lyr, QgsMapCanv
     , mGradientWidth( 0.0 )
     , mMapCanvas( theCanvas )
     , mHistogramWidget( nullptr )
+    , mPyramidBuilder( nullptr )
 {
   mGrayMinimumMaximumEstimated = true;
   mRGBMinimumMaximumEstimated = true;
@@ -441,6 +443,9 @@ QgsRasterLayerProperties::~QgsRasterLayerProperties()
   {
     delete mPixelSelectorTool;
   }
+
+  // cancels a running build
+  delete mPyramidBuilder;
 }
 
 void QgsRasterLayerProperties::setupTransparencyTable( int nBands )
@@ -996,9 +1001,16 @@ void QgsRasterLayerProperties::on_mLayerOrigNameLineEd_textEdited( const QString
 
 void QgsRasterLayerProperties::on_buttonBuildPyramids_clicked()
 {
+  if ( mPyramidBuilder && mPyramidBuilder->isActive() )
+  {
+    // the button cancels the build while it is running
+    mPyramidBuilder->cancel();
+    buttonBuildPyramids->setEnabled( false );
+    return;
+  }
+
   QgsRasterDataProvider* provider = mRasterLayer->dataProvider();
 
-  connect( provider, SIGNAL( progressUpdate( int ) ), mPyramidProgress, SLOT( setValue( int ) ) );
   //
   // Go through the list marking any files that are selected in the listview
   // as true so that we can generate pyramids for them.
@@ -1018,19 +1030,35 @@ void QgsRasterLayerProperties::on_buttonBuildPyramids_clicked()
   mySettings.setValue( prefix + "resampling", resamplingMethod );
 
   //
-  // Ask raster layer to build the pyramids
+  // Ask raster layer to build the pyramids, in the background so that the dialog stays responsive
   //
+  delete mPyramidBuilder;
+  mPyramidBuilder = new QgsRasterPyramidBuilder();
+  connect( mPyramidBuilder, SIGNAL( progressChanged( int, double ) ), this, SLOT( pyramidsProgressChanged( int, double ) ) );
+  connect( mPyramidBuilder, SIGNAL( layerFinished( int, const QString& ) ), this, SLOT( pyramidsBuilt( int, const QString& ) ) );
+  mPyramidBuilder->addLayer( mRasterLayer, myPyramidList, resamplingMethod,
+                             ( QgsRaster::RasterPyramidsFormat ) cbxPyramidsFormat->currentIndex() );
+  mPyramidBuilder->start();
+
+  buttonBuildPyramids->setText( tr( "Cancel" ) );
+  lbxPyramidResolutions->setEnabled( false );
+}
+
+void QgsRasterLayerProperties::pyramidsProgressChanged( int index, double progress )
+{
+  Q_UNUSED( index );
+  mPyramidProgress->setValue( static_cast< int >( progress ) );
+}
+
+void QgsRasterLayerProperties::pyramidsBuilt( int index, const QString& error )
+{
+  Q_UNUSED( index );
+  QString res = error;
 
-  // let the user know we're going to possibly be taking a while
-  QApplication::setOverrideCursor( Qt::WaitCursor );
-  QString res = provider->buildPyramids(
-                  myPyramidList,
-                  resamplingMethod,
-                  ( QgsRaster::RasterPyramidsFormat ) cbxPyramidsFormat->currentIndex() );
-  QApplication::restoreOverrideCursor();
   mPyramidProgress->setValue( 0 );
+  buttonBuildPyramids->setText( tr( "Build pyramids" ) );
   buttonBuildPyramids->setEnabled( false );
-  disconnect( provider, SIGNAL( progressUpdate( int ) ), mPyramidProgress, SLOT( setValue( int ) ) );
+  lbxPyramidResolutions->setEnabled( true );
   if ( !res.isNull() )
   {
     if ( res == "ERROR_WRITE_ACCESS" )
@@ -1065,9 +1093,10 @@ void QgsRasterLayerProperties::on_buttonBuildPyramids_clicked()
   //
   // repopulate the pyramids list
   //
+  QgsRasterDataProvider* provider = mRasterLayer->dataProvider();
   lbxPyramidResolutions->clear();
   // Need to rebuild list as some or all pyramids may have failed to build
-  myPyramidList = provider->buildPyramidList();
+  QList< QgsRasterPyramid > myPyramidList = provider->buildPyramidList();
   QIcon myPyramidPixmap( QgsApplication::getThemeIcon( "/mIconPyramid.png" ) );
   QIcon myNoPyramidPixmap( QgsApplication::getThemeIcon( "/mIconNoPyramid.png" ) );
 
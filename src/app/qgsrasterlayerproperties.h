@@ -34,6 +34,7 @@ class QgsMapToolEmitPoint;
 class QgsRasterRenderer;
 class QgsRasterRendererWidget;
 class QgsRasterHistogramWidget;
+class QgsRasterPyramidBuilder;
 
 /** Property sheet for a raster map layer
   *@author Tim Sutton
@@ -107,6 +108,12 @@ class APP_EXPORT QgsRasterLayerProperties : public QgsOptionsDialogBase, private
     /** Enable or disable Build pyramids button depending on selection in pyramids list*/
     void toggleBuildPyramidsButton();
 
+    /** Shows the progress of the pyramids being built */
+    void pyramidsProgressChanged( int index, double progress );
+
+    /** Reports errors and updates the pyramids list when the pyramids are built */
+    void pyramidsBuilt( int index, const QString& error );
+
     /** Enable or disable saturation controls depending on choice of grayscale mode */
     void toggleSaturationControls( int grayscaleMode );
 
@@ -188,6 +195,9 @@ class APP_EXPORT QgsRasterLayerProperties : public QgsOptionsDialogBase, private
 
     QgsRasterHistogramWidget* mHistogramWidget;
 
+    /** Builds the pyramids of the layer in the background */
+    QgsRasterPyramidBuilder* mPyramidBuilder;
+
     QVector<bool> mTransparencyToEdited;
 
     /** Previous layer style. Used to reset style to previous state if new style
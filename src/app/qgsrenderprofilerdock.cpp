@@ -0,0 +1,155 @@
+/***************************************************************************
+    qgsrenderprofilerdock.cpp
+    -------------------------
+    begin                : October 2018
+    copyright            : (C) 2018 by NextGIS
+    email                : info at nextgis dot com
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#include "qgsrenderprofilerdock.h"
+#include "qgsmapcanvas.h"
+#include "qgsmaplayer.h"
+#include "qgsmaplayerregistry.h"
+
+#include <QApplication>
+#include <QClipboard>
+#include <QHeaderView>
+#include <QMap>
+
+static bool entryTimeGreaterThan( const QgsRenderProfiler::Entry& e1, const QgsRenderProfiler::Entry& e2 )
+{
+  return e1.time > e2.time;
+}
+
+static bool itemTimeGreaterThan( const QTreeWidgetItem* i1, const QTreeWidgetItem* i2 )
+{
+  return i1->data( 1, Qt::UserRole ).toDouble() > i2->data( 1, Qt::UserRole ).toDouble();
+}
+
+QgsRenderProfilerDock::QgsRenderProfilerDock( QgsMapCanvas* canvas, QWidget *parent )
+    : QgsDockWidget( parent )
+    , mCanvas( canvas )
+{
+  setupUi( this );
+
+  mTreeWidget->header()->setResizeMode( 0, QHeaderView::Stretch );
+  mTreeWidget->header()->setStretchLastSection( false );
+
+  connect( mEnableCheckBox, SIGNAL( toggled( bool ) ), this, SLOT( setProfilingEnabled( bool ) ) );
+  connect( mCopyButton, SIGNAL( clicked() ), this, SLOT( copyReport() ) );
+  connect( mCanvas, SIGNAL( mapCanvasRefreshed() ), this, SLOT( refreshResults() ) );
+}
+
+QgsRenderProfilerDock::~QgsRenderProfilerDock()
+{
+  if ( mCanvas && mCanvas->renderProfiler() == &mProfiler )
+    mCanvas->setRenderProfiler( nullptr );
+}
+
+void QgsRenderProfilerDock::refreshResults()
+{
+  mTreeWidget->clear();
+  if ( !mEnableCheckBox->isChecked() )
+    return;
+
+  QList<QgsRenderProfiler::Entry> entries = mProfiler.entries();
+  qSort( entries.begin(), entries.end(), entryTimeGreaterThan );
+
+  // group the entries by layer and stage, so that stage totals can be shown above the details
+  QMap< QString, QMap< int, QList<QgsRenderProfiler::Entry> > > grouped;
+  Q_FOREACH ( const QgsRenderProfiler::Entry& entry, entries )
+  {
+    grouped[ entry.layerId ][ entry.stage ] << entry;
+  }
+
+  QList<QTreeWidgetItem*> layerItems;
+  QMap< QString, QMap< int, QList<QgsRenderProfiler::Entry> > >::const_iterator layerIt = grouped.constBegin();
+  for ( ; layerIt != grouped.constEnd(); ++layerIt )
+  {
+    QString name;
+    if ( layerIt.key().isEmpty() )
+      name = tr( "Labeling (all layers)" );
+    else if ( QgsMapLayer* layer = QgsMapLayerRegistry::instance()->mapLayer( layerIt.key() ) )
+      name = layer->name();
+    else
+      name = layerIt.key();
+
+    // layers without a total (i.e. the shared labeling stages) show the sum of their stages
+    double layerTime = mProfiler.totalTime( layerIt.key(), QgsRenderProfiler::LayerTotal );
+    bool hasTotal = layerIt.value().contains( QgsRenderProfiler::LayerTotal );
+    QTreeWidgetItem* layerItem = createItem( name, 0, -1 );
+    layerItems << layerItem;
+
+    QMap< int, QList<QgsRenderProfiler::Entry> >::const_iterator stageIt = layerIt.value().constBegin();
+    for ( ; stageIt != layerIt.value().constEnd(); ++stageIt )
+    {
+      if ( stageIt.key() == QgsRenderProfiler::LayerTotal )
+        continue;
+
+      double stageTime = 0;
+      int stageCount = 0;
+      Q_FOREACH ( const QgsRenderProfiler::Entry& entry, stageIt.value() )
+      {
+        stageTime += entry.time;
+        stageCount += entry.count;
+      }
+      if ( !hasTotal )
+        layerTime += stageTime;
+
+      QTreeWidgetItem* stageItem = createItem( QgsRenderProfiler::stageName( static_cast< QgsRenderProfiler::Stage >( stageIt.key() ) ), stageTime, stageCount );
+      layerItem->addChild( stageItem );
+
+      Q_FOREACH ( const QgsRenderProfiler::Entry& entry, stageIt.value() )
+      {
+        if ( !entry.detail.isEmpty() )
+          stageItem->addChild( createItem( entry.detail, entry.time, entry.count ) );
+      }
+    }
+
+    layerItem->setText( 1, QString::number( layerTime, 'f', 1 ) );
+    layerItem->setData( 1, Qt::UserRole, layerTime );
+  }
+
+  // slowest layers first
+  qSort( layerItems.begin(), layerItems.end(), itemTimeGreaterThan );
+  mTreeWidget->addTopLevelItems( layerItems );
+}
+
+void QgsRenderProfilerDock::setProfilingEnabled( bool enabled )
+{
+  if ( !mCanvas )
+    return;
+
+  mProfiler.clear();
+  mCanvas->setRenderProfiler( enabled ? &mProfiler : nullptr );
+  if ( enabled )
+    mCanvas->refresh();
+  else
+    mTreeWidget->clear();
+}
+
+void QgsRenderProfilerDock::copyReport()
+{
+  QApplication::clipboard()->setText( mProfiler.report() );
+}
+
+QTreeWidgetItem* QgsRenderProfilerDock::createItem( const QString& name, double time, int count ) const
+{
+  QTreeWidgetItem* item = new QTreeWidgetItem();
+  item->setText( 0, name );
+  item->setText( 1, QString::number( time, 'f', 1 ) );
+  item->setData( 1, Qt::UserRole, time );
+  item->setTextAlignment( 1, Qt::AlignRight );
+  if ( count >= 0 )
+  {
+    item->setText( 2, QString::number( count ) );
+    item->setTextAlignment( 2, Qt::AlignRight );
+  }
+  return item;
+}
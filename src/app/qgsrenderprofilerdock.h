@@ -0,0 +1,56 @@
+/***************************************************************************
+    qgsrenderprofilerdock.h
+    -----------------------
+    begin                : October 2018
+    copyright            : (C) 2018 by NextGIS
+    email                : info at nextgis dot com
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#ifndef QGSRENDERPROFILERDOCK_H
+#define QGSRENDERPROFILERDOCK_H
+
+#include "ui_qgsrenderprofilerdockbase.h"
+
+#include "qgsdockwidget.h"
+#include "qgsrenderprofiler.h"
+
+#include <QPointer>
+
+class QgsMapCanvas;
+
+/** A dock widget which profiles map canvas rendering and shows where the time
+ * was spent for each layer, rendering stage and symbol layer
+ */
+class APP_EXPORT QgsRenderProfilerDock : public QgsDockWidget, private Ui::QgsRenderProfilerDockBase
+{
+    Q_OBJECT
+
+  public:
+    QgsRenderProfilerDock( QgsMapCanvas* canvas, QWidget *parent = nullptr );
+    ~QgsRenderProfilerDock();
+
+  public slots:
+
+    //! Refreshes the tree from the times collected during the last canvas render
+    void refreshResults();
+
+  private slots:
+
+    void setProfilingEnabled( bool enabled );
+    void copyReport();
+
+  private:
+
+    QPointer<QgsMapCanvas> mCanvas;
+    QgsRenderProfiler mProfiler;
+
+    QTreeWidgetItem* createItem( const QString& name, double time, int count ) const;
+};
+
+#endif // QGSRENDERPROFILERDOCK_H
@@ -491,6 +491,43 @@ bool QgsAtlasComposition::prepareForFeature( const int featureI, const bool upda
   return true;
 }
 
+bool QgsAtlasComposition::prepareMapsForFeature( const int featureI )
+{
+  if ( !mCoverageLayer || featureI < 0 || featureI >= mFeatureIds.size() )
+  {
+    return false;
+  }
+
+  mCurrentFeatureNo = featureI;
+  mCoverageLayer->getFeatures( QgsFeatureRequest().setFilterFid( mFeatureIds[ featureI ].first ) ).nextFeature( mCurrentFeature );
+  mGeometryCache.clear();
+
+  if ( !mCurrentFeature.isValid() )
+  {
+    return true;
+  }
+
+  QList<QgsComposerMap*> maps;
+  mComposition->composerItems( maps );
+  mTransformedFeatureBounds = QgsRectangle();
+
+  Q_FOREACH ( QgsComposerMap* map, maps )
+  {
+    // block the signals of the map, so that items depending on its extent are not refreshed,
+    // and its updates, so that moving the map does not start a preview render for this page
+    bool blocked = map->blockSignals( true );
+    bool updatesEnabled = map->updatesEnabled();
+    map->setUpdatesEnabled( false );
+    // refresh data defined properties, as featureChanged() does for a prepared feature
+    map->refreshDataDefinedProperty();
+    prepareMap( map );
+    map->setUpdatesEnabled( updatesEnabled );
+    map->blockSignals( blocked );
+  }
+
+  return true;
+}
+
 void QgsAtlasComposition::computeExtent( QgsComposerMap* map )
 {
   // QgsGeometry::boundingBox is expressed in the geometry"s native CRS
@@ -208,6 +208,16 @@ class CORE_EXPORT QgsAtlasComposition : public QObject
      */
     bool prepareForFeature( const QgsFeature *feat );
 
+    /** Prepares the maps of the composition for the given feature, without notifying the other
+     * items of the composition. This is used to render the maps of the following pages ahead of
+     * time while exporting. The current filename is not updated and the composition has to be
+     * prepared with prepareForFeature() before it is rendered again.
+     * @param i feature number
+     * @returns true if feature was successfully prepared
+     * @note added in QGIS 2.18
+     */
+    bool prepareMapsForFeature( const int i );
+
     /** Returns the current filename. Must be called after prepareForFeature() */
     QString currentFilename() const;
 
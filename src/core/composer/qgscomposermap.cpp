@@ -18,11 +18,14 @@
 #include "qgscomposermap.h"
 #include "qgscomposermapgrid.h"
 #include "qgscomposermapoverview.h"
+#include "qgscomposermaprendercache.h"
 #include "qgscomposition.h"
 #include "qgscomposerutils.h"
 #include "qgslogger.h"
 #include "qgsmaprenderer.h"
+#include "qgsmaprenderercache.h"
 #include "qgsmaprenderercustompainterjob.h"
+#include "qgsmaprendererparalleljob.h"
 #include "qgsmaplayerregistry.h"
 #include "qgsmaplayerstylemanager.h"
 #include "qgsmaptopixel.h"
@@ -51,6 +54,9 @@ QgsComposerMap::QgsComposerMap( QgsComposition *composition, int x, int y, int w
     : QgsComposerItem( x, y, width, height, composition )
     , mGridStack( nullptr )
     , mOverviewStack( nullptr )
+    , mCacheRotation( 0 )
+    , mPreviewJob( nullptr )
+    , mPreviewJobRotation( 0 )
     , mMapRotation( 0 )
     , mEvaluatedMapRotation( 0 )
     , mKeepLayerSet( false )
@@ -98,6 +104,9 @@ QgsComposerMap::QgsComposerMap( QgsComposition *composition )
     : QgsComposerItem( 0, 0, 10, 10, composition )
     , mGridStack( nullptr )
     , mOverviewStack( nullptr )
+    , mCacheRotation( 0 )
+    , mPreviewJob( nullptr )
+    , mPreviewJobRotation( 0 )
     , mMapRotation( 0 )
     , mEvaluatedMapRotation( 0 )
     , mKeepLayerSet( false )
@@ -171,6 +180,13 @@ void QgsComposerMap::adjustExtentToItemShape( double itemWidth, double itemHeigh
 
 QgsComposerMap::~QgsComposerMap()
 {
+  // deleting the jobs waits for them to stop
+  delete mPreviewJob;
+  Q_FOREACH ( QgsMapRendererParallelJob* job, mCanceledPreviewJobs.keys() )
+  {
+    delete job;
+  }
+
   delete mOverviewStack;
   delete mGridStack;
 }
@@ -191,8 +207,23 @@ void QgsComposerMap::draw( QPainter *painter, const QgsRectangle& extent, QSizeF
     return;
   }
 
+  QgsMapSettings ms = mapSettings( extent, size, dpi );
+
+  // when printing to a raster, use the image rendered ahead of time if there is one
+  QgsComposerMapRenderCache* renderCache = mComposition->mapRenderCache();
+  if ( renderCache && mComposition->plotStyle() != QgsComposition::Preview &&
+       painter->device() && painter->device()->devType() == QInternal::Image )
+  {
+    QImage image = renderCache->renderedImage( this, ms );
+    if ( !image.isNull() )
+    {
+      painter->drawImage( 0, 0, image );
+      return;
+    }
+  }
+
   // render
-  QgsMapRendererCustomPainterJob job( mapSettings( extent, size, dpi ), painter );
+  QgsMapRendererCustomPainterJob job( ms, painter );
   // Render the map in this thread. This is done because of problems
   // with printing to printer on Windows (printing to PDF is fine though).
   // Raster images were not displayed - see #10599
@@ -255,6 +286,15 @@ QgsMapSettings QgsComposerMap::mapSettings( const QgsRectangle& extent, QSizeF s
   return jobMapSettings;
 }
 
+///@cond PRIVATE
+
+/** Layer images of the preview renders, by the settings and variables of the maps which share them.
+ * Only accessed from the GUI thread. */
+typedef QHash<QString, QWeakPointer<QgsMapRendererCache> > QgsComposerMapPreviewCaches;
+Q_GLOBAL_STATIC( QgsComposerMapPreviewCaches, sPreviewCaches )
+
+///@endcond
+
 void QgsComposerMap::cache()
 {
   if ( mPreviewMode == Rectangle )
@@ -267,8 +307,6 @@ void QgsComposerMap::cache()
     return;
   }
 
-  mDrawing = true;
-
   double horizontalVScaleFactor = horizontalViewScaleFactor();
   if ( horizontalVScaleFactor < 0 )
   {
@@ -298,31 +336,97 @@ void QgsComposerMap::cache()
     }
   }
 
-  mCacheImage = QImage( w, h, QImage::Format_ARGB32 );
+  if ( w <= 0 || h <= 0 )
+  {
+    return;
+  }
+
+  QgsMapSettings settings = mapSettings( ext, QSizeF( w, h ), qRound( 25.4 * w / widthMM ) );
 
-  // set DPI of the image
-  mCacheImage.setDotsPerMeterX( 1000 * w / widthMM );
-  mCacheImage.setDotsPerMeterY( 1000 * h / heightMM );
+  //Fill image with specified background color. This ensures that layers with blend modes will
+  //preview correctly. With no background, start with empty fill to avoid artifacts
+  settings.setBackgroundColor( hasBackground() ? backgroundColor() : QColor( 255, 255, 255, 0 ) );
 
-  if ( hasBackground() )
+  // maps which are rendered with the same settings share the images of their layers. The key
+  // covers the values of the variables the layer styles refer to, e.g. @map_id, as they
+  // do not trigger a repaint of the layers
+  QString cacheKey = QgsComposerMapRenderCache::layerKey( this, settings );
+  if ( mComposition->atlasComposition().enabled() )
   {
-    //Initially fill image with specified background color. This ensures that layers with blend modes will
-    //preview correctly
-    mCacheImage.fill( backgroundColor().rgba() );
+    cacheKey += QString( "|atlas=%1" ).arg( mComposition->atlasComposition().currentFeatureNumber() );
   }
-  else
+  cacheKey += '|' + QgsComposerMapRenderCache::variablesKey( settings );
+
+  if ( mPreviewJob && mPreviewCache && mPreviewCacheKey == cacheKey )
   {
-    //no background, but start with empty fill to avoid artifacts
-    mCacheImage.fill( QColor( 255, 255, 255, 0 ).rgba() );
+    // the running render already renders this map, e.g. if the map is updated repeatedly while it is moved
+    mCacheUpdated = true;
+    return;
   }
 
-  QPainter p( &mCacheImage );
+  cancelPreviewRender();
+
+  QgsComposerMapPreviewCaches* caches = sPreviewCaches();
+  QSharedPointer<QgsMapRendererCache> cache = caches->value( cacheKey ).toStrongRef();
+  if ( !cache )
+  {
+    QgsComposerMapPreviewCaches::iterator it = caches->begin();
+    while ( it != caches->end() )
+    {
+      if ( it.value().isNull() )
+        it = caches->erase( it );
+      else
+        ++it;
+    }
+
+    cache = QSharedPointer<QgsMapRendererCache>( new QgsMapRendererCache() );
+    caches->insert( cacheKey, cache.toWeakRef() );
+  }
+  mPreviewCache = cache;
+  mPreviewCacheKey = cacheKey;
+  mPreviewJobExtent = ext;
+  mPreviewJobRotation = mEvaluatedMapRotation;
+  mPreviewJob = new QgsMapRendererParallelJob( settings );
+  mPreviewJob->setCache( mPreviewCache.data() );
+  connect( mPreviewJob, SIGNAL( finished() ), this, SLOT( previewRenderFinished() ) );
+  mPreviewJob->start();
 
-  draw( &p, ext, QSizeF( w, h ), mCacheImage.logicalDpiX() );
-  p.end();
   mCacheUpdated = true;
+}
 
-  mDrawing = false;
+void QgsComposerMap::cancelPreviewRender()
+{
+  if ( !mPreviewJob )
+    return;
+
+  // the canceled job still uses its layer images until it has stopped
+  mPreviewJob->cancelWithoutBlocking();
+  mCanceledPreviewJobs.insert( mPreviewJob, mPreviewCache );
+  mPreviewJob = nullptr;
+}
+
+void QgsComposerMap::previewRenderFinished()
+{
+  QgsMapRendererParallelJob* job = qobject_cast< QgsMapRendererParallelJob* >( sender() );
+  if ( !job )
+  {
+    return;
+  }
+
+  if ( job == mPreviewJob )
+  {
+    mCacheImage = job->renderedImage();
+    mCacheExtent = mPreviewJobExtent;
+    mCacheRotation = mPreviewJobRotation;
+    mPreviewJob = nullptr;
+    QGraphicsRectItem::update();
+  }
+  else
+  {
+    mCanceledPreviewJobs.remove( job );
+  }
+
+  job->deleteLater();
 }
 
 void QgsComposerMap::paint( QPainter* painter, const QStyleOptionGraphicsItem* itemStyle, QWidget* pWidget )
@@ -360,17 +464,43 @@ void QgsComposerMap::paint( QPainter* painter, const QStyleOptionGraphicsItem* i
 
     //Background color is already included in cached image, so no need to draw
 
-    double imagePixelWidth = mCacheImage.width(); //how many pixels of the image are for the map extent?
-    double scale = rect().width() / imagePixelWidth;
+    //The image may have been rendered for a previous map extent while the new image is rendered
+    //in the background. Draw it where its extent is in the current extent if the map was only
+    //moved or zoomed, otherwise scale it to the item
 
-    painter->save();
+    const QgsRectangle &ext = *currentMapExtent();
+    if ( mCacheImage.isNull() )
+    {
+      drawBackground( painter );
+    }
+    else if ( !mCacheExtent.isEmpty() && !ext.isEmpty() && mCacheExtent != ext &&
+              qgsDoubleNear( mCacheRotation, mEvaluatedMapRotation ) )
+    {
+      double scaleX = rect().width() / ext.width();
+      double scaleY = rect().height() / ext.height();
+      QRectF target( ( mCacheExtent.xMinimum() - ext.xMinimum() ) * scaleX, ( ext.yMaximum() - mCacheExtent.yMaximum() ) * scaleY,
+                     mCacheExtent.width() * scaleX, mCacheExtent.height() * scaleY );
 
-    painter->translate( mXOffset, mYOffset );
-    painter->scale( scale, scale );
-    painter->drawImage( 0, 0, mCacheImage );
+      drawBackground( painter );
+      painter->save();
+      painter->translate( mXOffset, mYOffset );
+      painter->drawImage( target, mCacheImage );
+      painter->restore();
+    }
+    else
+    {
+      double imagePixelWidth = mCacheImage.width(); //how many pixels of the image are for the map extent?
+      double scale = rect().width() / imagePixelWidth;
 
-    //restore rotation
-    painter->restore();
+      painter->save();
+
+      painter->translate( mXOffset, mYOffset );
+      painter->scale( scale, scale );
+      painter->drawImage( 0, 0, mCacheImage );
+
+      //restore rotation
+      painter->restore();
+    }
 
     //draw canvas items
     drawCanvasItems( painter, itemStyle );
@@ -501,6 +631,16 @@ bool QgsComposerMap::shouldDrawPart( PartType part ) const
 
 void QgsComposerMap::updateCachedImage()
 {
+  // render all the layers again, their data or the variables used by their styles may have changed
+  cancelPreviewRender();
+  if ( mPreviewCache )
+  {
+    // maps sharing the images render their layers again as well
+    mPreviewCache->clear();
+    if ( sPreviewCaches()->value( mPreviewCacheKey ).toStrongRef() == mPreviewCache )
+      sPreviewCaches()->remove( mPreviewCacheKey );
+  }
+  mPreviewCache.clear();
   mCacheUpdated = false;
   cache();
   QGraphicsRectItem::update();
@@ -22,6 +22,8 @@
 #include "qgsrectangle.h"
 #include <QFont>
 #include <QGraphicsRectItem>
+#include <QHash>
+#include <QSharedPointer>
 
 class QgsComposition;
 class QgsComposerMapOverviewStack;
@@ -29,6 +31,8 @@ class QgsComposerMapOverview;
 class QgsComposerMapGridStack;
 class QgsComposerMapGrid;
 class QgsMapRenderer;
+class QgsMapRendererCache;
+class QgsMapRendererParallelJob;
 class QgsMapToPixel;
 class QDomNode;
 class QDomDocument;
@@ -150,7 +154,13 @@ class CORE_EXPORT QgsComposerMap : public QgsComposerItem
     /** \brief Reimplementation of QCanvasItem::paint - draw on canvas */
     void paint( QPainter* painter, const QStyleOptionGraphicsItem* itemStyle, QWidget* pWidget ) override;
 
-    /** \brief Create cache image */
+    /** \brief Starts rendering the cache image in the background. The previous image is
+     * drawn, scaled to the current map extent, until the new one has been rendered. A render
+     * which is still running for other settings is canceled. Maps which are rendered with the
+     * same settings, and the same values of the variables their layer styles refer to, share the
+     * images of their layers, so that only the layers which changed are rendered again.
+     * updateCachedImage() renders all the layers again.
+     */
     void cache();
 
     /** Return map settings that would be used for drawing of the map
@@ -866,6 +876,11 @@ class CORE_EXPORT QgsComposerMap : public QgsComposerItem
      */
     void layersChanged();
 
+  private slots:
+
+    //! Takes the image of a finished preview render
+    void previewRenderFinished();
+
   private:
 
     /** Unique identifier*/
@@ -891,6 +906,25 @@ class CORE_EXPORT QgsComposerMap : public QgsComposerItem
     // Is cache up to date
     bool mCacheUpdated;
 
+    // Map extent and rotation the cache image was rendered for
+    QgsRectangle mCacheExtent;
+    double mCacheRotation;
+
+    // Preview render running in the background, with the extent and rotation it renders
+    QgsMapRendererParallelJob* mPreviewJob;
+    QgsRectangle mPreviewJobExtent;
+    double mPreviewJobRotation;
+
+    // Layer images of the preview renders, shared by the maps with the same key, and the key of the settings they were rendered with
+    QSharedPointer<QgsMapRendererCache> mPreviewCache;
+    QString mPreviewCacheKey;
+
+    // Canceled preview renders which have not stopped yet, with the layer images they use
+    QHash<QgsMapRendererParallelJob*, QSharedPointer<QgsMapRendererCache> > mCanceledPreviewJobs;
+
+    //! Cancels the running preview render, without waiting for it to stop
+    void cancelPreviewRender();
+
     /** \brief Preview style  */
     PreviewMode mPreviewMode;
 
@@ -0,0 +1,672 @@
+/***************************************************************************
+                         qgscomposermaprendercache.cpp
+                         -----------------------------
+    begin                : October 2018
+    copyright            : (C) 2018 by NextGIS
+    email                : info at nextgis dot com
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "qgscomposermaprendercache.h"
+#include "qgsatlascomposition.h"
+#include "qgscategorizedsymbolrendererv2.h"
+#include "qgscomposermap.h"
+#include "qgscomposition.h"
+#include "qgsdatadefined.h"
+#include "qgsdiagramrendererv2.h"
+#include "qgsexpression.h"
+#include "qgsexpressioncontext.h"
+#include "qgsgraduatedsymbolrendererv2.h"
+#include "qgslogger.h"
+#include "qgsmaplayer.h"
+#include "qgsmaplayerregistry.h"
+#include "qgsmaplayerstylemanager.h"
+#include "qgsmaprenderercache.h"
+#include "qgsmaprendererparalleljob.h"
+#include "qgsmapsettings.h"
+#include "qgspallabeling.h"
+#include "qgsrendercontext.h"
+#include "qgsrendererv2.h"
+#include "qgsrulebasedlabeling.h"
+#include "qgsrulebasedrendererv2.h"
+#include "qgssymbollayerv2.h"
+#include "qgssymbolv2.h"
+#include "qgsvectorlayer.h"
+#include "qgsvectorlayerlabeling.h"
+
+#include <QSet>
+#include <QThread>
+
+///@cond PRIVATE
+
+static void expressionVariables( const QString& expression, QSet<QString>& variables );
+
+static void nodeVariables( const QgsExpression::Node* node, QSet<QString>& variables );
+
+static void nodeListVariables( QgsExpression::NodeList* list, QSet<QString>& variables )
+{
+  if ( !list )
+    return;
+
+  Q_FOREACH ( const QgsExpression::Node* node, list->list() )
+  {
+    nodeVariables( node, variables );
+  }
+}
+
+//! Returns the variable which a deprecated function like $atlasfeature returns, or an empty string
+static QString functionVariable( const QString& name )
+{
+  if ( name == "$rownum" )
+    return "row_number";
+  if ( name == "$map" )
+    return "map_id";
+  if ( name == "$numpages" )
+    return "layout_numpages";
+  if ( name == "$page" )
+    return "layout_page";
+  if ( name == "$feature" )
+    return "atlas_featurenumber";
+  if ( name == "$atlasfeatureid" )
+    return "atlas_featureid";
+  if ( name == "$atlasfeature" )
+    return "atlas_feature";
+  if ( name == "$atlasgeometry" )
+    return "atlas_geometry";
+  if ( name == "$numfeatures" )
+    return "atlas_totalfeatures";
+  return QString();
+}
+
+static void nodeVariables( const QgsExpression::Node* node, QSet<QString>& variables )
+{
+  if ( !node )
+    return;
+
+  switch ( node->nodeType() )
+  {
+    case QgsExpression::ntUnaryOperator:
+      nodeVariables( static_cast<const QgsExpression::NodeUnaryOperator*>( node )->operand(), variables );
+      break;
+
+    case QgsExpression::ntBinaryOperator:
+    {
+      const QgsExpression::NodeBinaryOperator* op = static_cast<const QgsExpression::NodeBinaryOperator*>( node );
+      nodeVariables( op->opLeft(), variables );
+      nodeVariables( op->opRight(), variables );
+      break;
+    }
+
+    case QgsExpression::ntInOperator:
+    {
+      const QgsExpression::NodeInOperator* op = static_cast<const QgsExpression::NodeInOperator*>( node );
+      nodeVariables( op->node(), variables );
+      nodeListVariables( op->list(), variables );
+      break;
+    }
+
+    case QgsExpression::ntFunction:
+    {
+      const QgsExpression::NodeFunction* function = static_cast<const QgsExpression::NodeFunction*>( node );
+      QString name = QgsExpression::Functions().at( function->fnIndex() )->name();
+
+      QString variable = functionVariable( name );
+      if ( !variable.isEmpty() )
+      {
+        variables.insert( variable );
+        break;
+      }
+
+      // @atlas_feature and the other variables are parsed as var( 'atlas_feature' )
+      if ( name == "var" || name == "eval" )
+      {
+        QList<QgsExpression::Node*> args = function->args() ? function->args()->list() : QList<QgsExpression::Node*>();
+        if ( args.isEmpty() || args.at( 0 )->nodeType() != QgsExpression::ntLiteral )
+        {
+          // only known when the expression is evaluated
+          variables.insert( "*" );
+          break;
+        }
+
+        QString value = static_cast<const QgsExpression::NodeLiteral*>( args.at( 0 ) )->value().toString();
+        if ( name == "var" )
+          variables.insert( value );
+        else
+          expressionVariables( value, variables );
+        break;
+      }
+
+      nodeListVariables( function->args(), variables );
+      break;
+    }
+
+    case QgsExpression::ntCondition:
+    {
+      const QgsExpression::NodeCondition* condition = static_cast<const QgsExpression::NodeCondition*>( node );
+      Q_FOREACH ( const QgsExpression::WhenThen* whenThen, condition->conditions() )
+      {
+        nodeVariables( whenThen->mWhenExp, variables );
+        nodeVariables( whenThen->mThenExp, variables );
+      }
+      nodeVariables( condition->elseExp(), variables );
+      break;
+    }
+
+    case QgsExpression::ntLiteral:
+    case QgsExpression::ntColumnRef:
+      break;
+  }
+}
+
+static void expressionVariables( const QString& expression, QSet<QString>& variables )
+{
+  if ( expression.isEmpty() )
+    return;
+
+  QgsExpression exp( expression );
+  if ( !exp.hasParserError() )
+    nodeVariables( exp.rootNode(), variables );
+}
+
+static void dataDefinedVariables( const QgsDataDefined* dataDefined, QSet<QString>& variables )
+{
+  if ( dataDefined && dataDefined->isActive() && dataDefined->useExpression() )
+    expressionVariables( dataDefined->expressionString(), variables );
+}
+
+static void symbolVariables( QgsSymbolV2* symbol, QSet<QString>& variables )
+{
+  if ( !symbol )
+    return;
+
+  for ( int i = 0; i < symbol->symbolLayerCount(); ++i )
+  {
+    QgsSymbolLayerV2* symbolLayer = symbol->symbolLayer( i );
+
+    // data defined properties are saved with the properties of the symbol layer
+    QgsStringMap properties = symbolLayer->properties();
+    for ( QgsStringMap::const_iterator it = properties.constBegin(); it != properties.constEnd(); ++it )
+    {
+      if ( it.key().endsWith( "_dd_expression" ) )
+        dataDefinedVariables( symbolLayer->getDataDefinedProperty( it.key().left( it.key().length() - 14 ) ), variables );
+    }
+
+    symbolVariables( symbolLayer->subSymbol(), variables );
+  }
+}
+
+static void rendererVariables( QgsFeatureRendererV2* renderer, QgsRenderContext& context, QSet<QString>& variables )
+{
+  if ( !renderer )
+    return;
+
+  Q_FOREACH ( QgsSymbolV2* symbol, renderer->symbols( context ) )
+  {
+    symbolVariables( symbol, variables );
+  }
+
+  if ( renderer->orderByEnabled() )
+  {
+    Q_FOREACH ( const QgsFeatureRequest::OrderByClause& clause, renderer->orderBy() )
+    {
+      expressionVariables( clause.expression().expression(), variables );
+    }
+  }
+
+  if ( QgsRuleBasedRendererV2* ruleRenderer = dynamic_cast<QgsRuleBasedRendererV2*>( renderer ) )
+  {
+    Q_FOREACH ( const QgsRuleBasedRendererV2::Rule* rule, ruleRenderer->rootRule()->descendants() )
+    {
+      expressionVariables( rule->filterExpression(), variables );
+    }
+  }
+  else if ( QgsCategorizedSymbolRendererV2* categorized = dynamic_cast<QgsCategorizedSymbolRendererV2*>( renderer ) )
+  {
+    expressionVariables( categorized->classAttribute(), variables );
+  }
+  else if ( QgsGraduatedSymbolRendererV2* graduated = dynamic_cast<QgsGraduatedSymbolRendererV2*>( renderer ) )
+  {
+    expressionVariables( graduated->classAttribute(), variables );
+  }
+
+  rendererVariables( const_cast<QgsFeatureRendererV2*>( renderer->embeddedRenderer() ), context, variables );
+}
+
+static void labelSettingsVariables( const QgsPalLayerSettings& settings, QSet<QString>& variables )
+{
+  if ( settings.isExpression )
+    expressionVariables( settings.fieldName, variables );
+
+  Q_FOREACH ( const QgsDataDefined* dataDefined, settings.dataDefinedProperties )
+  {
+    dataDefinedVariables( dataDefined, variables );
+  }
+}
+
+static void labelingVariables( QgsVectorLayer* layer, QSet<QString>& variables )
+{
+  const QgsAbstractVectorLayerLabeling* labeling = layer->labeling();
+  if ( !labeling )
+    return;
+
+  if ( const QgsRuleBasedLabeling* ruleLabeling = dynamic_cast<const QgsRuleBasedLabeling*>( labeling ) )
+  {
+    Q_FOREACH ( const QgsRuleBasedLabeling::Rule* rule, ruleLabeling->rootRule()->descendants() )
+    {
+      expressionVariables( rule->filterExpression(), variables );
+      if ( rule->settings() )
+        labelSettingsVariables( *rule->settings(), variables );
+    }
+    return;
+  }
+
+  if ( layer->customProperty( "labeling/enabled" ).toBool() )
+    labelSettingsVariables( labeling->settings( layer ), variables );
+}
+
+static void diagramVariables( QgsVectorLayer* layer, QSet<QString>& variables )
+{
+  const QgsDiagramRendererV2* renderer = layer->diagramRenderer();
+  if ( !renderer )
+    return;
+
+  Q_FOREACH ( const QString& attribute, renderer->diagramAttributes() )
+  {
+    expressionVariables( attribute, variables );
+  }
+
+  const QgsLinearlyInterpolatedDiagramRenderer* interpolated = dynamic_cast<const QgsLinearlyInterpolatedDiagramRenderer*>( renderer );
+  if ( interpolated && interpolated->classificationAttributeIsExpression() )
+    expressionVariables( interpolated->classificationAttributeExpression(), variables );
+}
+
+/** Returns the variables which the current style of a layer refers to. Names ending with "*"
+ * stand for all variables starting with the text before it.
+ */
+static QSet<QString> layerVariables( QgsMapLayer* layer )
+{
+  QSet<QString> variables;
+  QgsVectorLayer* vectorLayer = qobject_cast<QgsVectorLayer*>( layer );
+  if ( !vectorLayer )
+    return variables;
+
+  QgsRenderContext context;
+  expressionVariables( vectorLayer->subsetString(), variables );
+  rendererVariables( vectorLayer->rendererV2(), context, variables );
+  labelingVariables( vectorLayer, variables );
+  diagramVariables( vectorLayer, variables );
+  return variables;
+}
+
+//! Returns the variables which the style of a layer refers to, with a style override applied
+static QSet<QString> layerVariables( QgsMapLayer* layer, const QString& styleOverride )
+{
+  // the layer is rendered with the overridden style, look at the same style as the renderer job
+  if ( !styleOverride.isEmpty() )
+    layer->styleManager()->setOverrideStyle( styleOverride );
+
+  QSet<QString> variables = layerVariables( layer );
+
+  if ( !styleOverride.isEmpty() )
+    layer->styleManager()->restoreOverrideStyle();
+
+  return variables;
+}
+
+static bool variablesInclude( const QSet<QString>& variables, const QString& name )
+{
+  Q_FOREACH ( const QString& variable, variables )
+  {
+    if ( variable.endsWith( '*' ) ? name.startsWith( variable.left( variable.length() - 1 ) ) : name == variable )
+      return true;
+  }
+  return false;
+}
+
+static bool variablesUseAtlas( const QSet<QString>& variables )
+{
+  Q_FOREACH ( const QString& variable, variables )
+  {
+    if ( variable == "*" || variable.startsWith( "atlas_" ) )
+      return true;
+  }
+  return false;
+}
+
+///@endcond
+
+QgsComposerMapRenderCache::QgsComposerMapRenderCache( QgsComposition* composition )
+    : mComposition( composition )
+    , mPagesAhead( qMax( 1, QThread::idealThreadCount() ) )
+    , mMemoryBudget( Q_INT64_C( 512 ) * 1024 * 1024 )
+    , mNextAtlasFeature( 0 )
+{
+  mComposition->setMapRenderCache( this );
+}
+
+QgsComposerMapRenderCache::~QgsComposerMapRenderCache()
+{
+  clear();
+
+  if ( mComposition->mapRenderCache() == this )
+    mComposition->setMapRenderCache( nullptr );
+}
+
+int QgsComposerMapRenderCache::prepareMaps( int dpi )
+{
+  QList<QgsComposerMap*> maps;
+  mComposition->composerItems( maps );
+
+  int started = 0;
+  Q_FOREACH ( QgsComposerMap* map, maps )
+  {
+    if ( !canPrepare( map ) )
+      continue;
+
+    QgsMapSettings settings = printSettings( map, dpi );
+    if ( settings.outputSize().isEmpty() )
+      continue;
+
+    QString mapLayerKey = layerKey( map, settings );
+    QString key = renderKey( settings, mapLayerKey );
+
+    MapState& state = mMapStates[map];
+    if ( state.lastKey == key )
+    {
+      // the map did not change since the image was taken last time
+      continue;
+    }
+
+    bool pending = false;
+    Q_FOREACH ( const Render& render, mRenders )
+    {
+      if ( render.map == map && render.key == key )
+      {
+        pending = true;
+        break;
+      }
+    }
+    if ( pending )
+      continue;
+
+    if ( !state.layerCache || state.layerKey != mapLayerKey )
+    {
+      // renders which are still running keep the previous cache alive
+      state.layerKey = mapLayerKey;
+      state.layerCache = QSharedPointer<QgsMapRendererCache>( new QgsMapRendererCache() );
+    }
+
+    // layers referring to the atlas are rendered again for every feature
+    Q_FOREACH ( const QString& layerId, atlasLayers( settings ) )
+    {
+      state.layerCache->clearCacheImage( layerId );
+    }
+
+    // the map background is drawn under the image by the map item, fill the image with it
+    // so that blending modes of the layers work on the same background
+    QgsMapSettings jobSettings( settings );
+    if ( map->hasBackground() )
+      jobSettings.setBackgroundColor( map->backgroundColor() );
+
+    Render render;
+    render.map = map;
+    render.key = key;
+    render.layerCache = state.layerCache;
+    // the parallel job renders every layer to its own image before composing them
+    render.bytes = static_cast<qint64>( settings.outputSize().width() ) * settings.outputSize().height() * 4 * ( settings.layers().count() + 1 );
+    render.job = new QgsMapRendererParallelJob( jobSettings );
+    render.job->setCache( render.layerCache.data() );
+    render.job->start();
+    mRenders << render;
+    ++started;
+  }
+
+  return started;
+}
+
+int QgsComposerMapRenderCache::prepareAtlasFeatures( int feature, int dpi )
+{
+  QgsAtlasComposition& atlas = mComposition->atlasComposition();
+  int lastFeature = qMin( atlas.numFeatures() - 1, feature + mPagesAhead );
+
+  int started = 0;
+  for ( mNextAtlasFeature = qMax( mNextAtlasFeature, feature ); mNextAtlasFeature <= lastFeature; ++mNextAtlasFeature )
+  {
+    // the page exported next is always prepared, following pages only while their images fit in memory
+    if ( mNextAtlasFeature > feature && pendingBytes() >= mMemoryBudget )
+      break;
+
+    if ( atlas.prepareMapsForFeature( mNextAtlasFeature ) )
+      started += prepareMaps( dpi );
+  }
+
+  QgsDebugMsgLevel( QString( "%1 map renders started, %2 pending" ).arg( started ).arg( mRenders.count() ), 3 );
+  return started;
+}
+
+QImage QgsComposerMapRenderCache::renderedImage( const QgsComposerMap* map, const QgsMapSettings& settings )
+{
+  QHash<const QgsComposerMap*, MapState>::iterator stateIt = mMapStates.find( map );
+  if ( stateIt == mMapStates.end() || !canPrepare( map ) )
+    return QImage();
+
+  QString key = renderKey( settings, layerKey( map, settings ) );
+  if ( stateIt->lastKey == key )
+    return stateIt->lastImage;
+
+  int index = -1;
+  for ( int i = 0; i < mRenders.count(); ++i )
+  {
+    if ( mRenders.at( i ).map == map && mRenders.at( i ).key == key )
+    {
+      index = i;
+      break;
+    }
+  }
+  if ( index < 0 )
+    return QImage();
+
+  // renders of this map queued before the matching one were prepared for pages which have been skipped
+  for ( int i = index - 1; i >= 0; --i )
+  {
+    if ( mRenders.at( i ).map == map )
+    {
+      delete mRenders.at( i ).job;
+      mRenders.removeAt( i );
+      --index;
+    }
+  }
+
+  Render render = mRenders.takeAt( index );
+  render.job->waitForFinished();
+  QImage image = render.job->renderedImage();
+  delete render.job;
+
+  stateIt->lastKey = key;
+  stateIt->lastImage = image;
+  return image;
+}
+
+void QgsComposerMapRenderCache::clear()
+{
+  Q_FOREACH ( const Render& render, mRenders )
+  {
+    delete render.job;
+  }
+  mRenders.clear();
+  mMapStates.clear();
+
+  Q_FOREACH ( const QString& layerId, mAtlasLayers.keys() )
+  {
+    if ( QgsMapLayer* layer = QgsMapLayerRegistry::instance()->mapLayer( layerId ) )
+      disconnect( layer, nullptr, this, nullptr );
+  }
+  mAtlasLayers.clear();
+  mNextAtlasFeature = 0;
+}
+
+qint64 QgsComposerMapRenderCache::pendingBytes() const
+{
+  qint64 bytes = 0;
+  Q_FOREACH ( const Render& render, mRenders )
+  {
+    bytes += render.bytes;
+  }
+  return bytes;
+}
+
+void QgsComposerMapRenderCache::layerStyleChanged()
+{
+  QgsMapLayer* layer = qobject_cast<QgsMapLayer*>( sender() );
+  if ( !layer )
+    return;
+
+  mAtlasLayers.remove( layer->id() );
+
+  // the layer key does not cover the style, images rendered with the previous one are stale
+  Q_FOREACH ( const Render& render, mRenders )
+  {
+    delete render.job;
+  }
+  mRenders.clear();
+  mNextAtlasFeature = 0;
+
+  for ( QHash<const QgsComposerMap*, MapState>::iterator it = mMapStates.begin(); it != mMapStates.end(); ++it )
+  {
+    if ( it->layerCache )
+      it->layerCache->clearCacheImage( layer->id() );
+    it->lastKey.clear();
+    it->lastImage = QImage();
+  }
+}
+
+bool QgsComposerMapRenderCache::canPrepare( const QgsComposerMap* map ) const
+{
+  if ( !map->isVisible() )
+    return false;
+
+  // without advanced effects layers are composed with the source over mode only, so the result
+  // does not depend on whether they are drawn over the items below the map or over an image
+  if ( !mComposition->useAdvancedEffects() )
+    return true;
+
+  return map->hasBackground() && map->backgroundColor().alpha() == 255;
+}
+
+QgsMapSettings QgsComposerMapRenderCache::printSettings( QgsComposerMap* map, int dpi ) const
+{
+  // same extent and size as QgsComposerMap::paint() uses when printing
+  QgsRectangle extent = *map->currentMapExtent();
+  QSizeF size( extent.width() * map->mapUnitsToMM(), extent.height() * map->mapUnitsToMM() );
+  double dotsPerMM = dpi / 25.4;
+  size *= dotsPerMM;
+
+  QgsComposition::PlotStyle plotStyle = mComposition->plotStyle();
+  mComposition->setPlotStyle( QgsComposition::Print );
+  QgsMapSettings settings = map->mapSettings( extent, size, dpi );
+  mComposition->setPlotStyle( plotStyle );
+  return settings;
+}
+
+QString QgsComposerMapRenderCache::layerKey( const QgsComposerMap* map, const QgsMapSettings& settings )
+{
+  const QgsRectangle& extent = settings.extent();
+
+  QStringList parts;
+  parts << QString::number( extent.xMinimum(), 'g', 17 )
+  << QString::number( extent.yMinimum(), 'g', 17 )
+  << QString::number( extent.xMaximum(), 'g', 17 )
+  << QString::number( extent.yMaximum(), 'g', 17 )
+  << QString::number( settings.outputSize().width() )
+  << QString::number( settings.outputSize().height() )
+  << QString::number( settings.outputDpi(), 'g', 17 )
+  << QString::number( settings.rotation(), 'g', 17 )
+  << settings.layers().join( "," )
+  << settings.destinationCrs().toProj4()
+  << QString::number( settings.hasCrsTransformEnabled() )
+  << QString::number( static_cast< int >( settings.flags() ) )
+  << settings.selectionColor().name()
+  << QString::number( map->hasBackground() ? map->backgroundColor().rgba() : 0 );
+
+  QMap<QString, QString> overrides = settings.layerStyleOverrides();
+  for ( QMap<QString, QString>::const_iterator it = overrides.constBegin(); it != overrides.constEnd(); ++it )
+  {
+    parts << it.key() + '=' + it.value();
+  }
+
+  return parts.join( "|" );
+}
+
+QString QgsComposerMapRenderCache::variablesKey( const QgsMapSettings& settings )
+{
+  QSet<QString> variables;
+  Q_FOREACH ( const QString& layerId, settings.layers() )
+  {
+    if ( QgsMapLayer* layer = QgsMapLayerRegistry::instance()->mapLayer( layerId ) )
+      variables.unite( layerVariables( layer, settings.layerStyleOverrides().value( layerId ) ) );
+  }
+
+  const QgsExpressionContext& context = settings.expressionContext();
+  QStringList names = context.variableNames();
+  names.sort();
+
+  QStringList parts;
+  Q_FOREACH ( const QString& name, names )
+  {
+    if ( variablesInclude( variables, name ) )
+      parts << name + '=' + context.variable( name ).toString();
+  }
+  return parts.join( "|" );
+}
+
+QString QgsComposerMapRenderCache::renderKey( const QgsMapSettings& settings, const QString& settingsKey )
+{
+  if ( atlasLayers( settings ).isEmpty() )
+    return settingsKey;
+
+  return settingsKey + QString( "|atlas=%1" ).arg( mComposition->atlasComposition().currentFeatureNumber() );
+}
+
+QStringList QgsComposerMapRenderCache::atlasLayers( const QgsMapSettings& settings )
+{
+  QStringList layers;
+  Q_FOREACH ( const QString& layerId, settings.layers() )
+  {
+    QString styleOverride = settings.layerStyleOverrides().value( layerId );
+    QHash<QString, QHash<QString, bool> >::iterator layerIt = mAtlasLayers.find( layerId );
+    if ( layerIt == mAtlasLayers.end() )
+    {
+      QgsMapLayer* layer = QgsMapLayerRegistry::instance()->mapLayer( layerId );
+      if ( !layer )
+        continue;
+
+      connect( layer, SIGNAL( styleChanged() ), this, SLOT( layerStyleChanged() ) );
+      connect( layer, SIGNAL( repaintRequested() ), this, SLOT( layerStyleChanged() ) );
+      layerIt = mAtlasLayers.insert( layerId, QHash<QString, bool>() );
+    }
+
+    QHash<QString, bool>::const_iterator styleIt = layerIt->constFind( styleOverride );
+    bool usesAtlas = false;
+    if ( styleIt != layerIt->constEnd() )
+    {
+      usesAtlas = styleIt.value();
+    }
+    else if ( QgsMapLayer* layer = QgsMapLayerRegistry::instance()->mapLayer( layerId ) )
+    {
+      usesAtlas = variablesUseAtlas( layerVariables( layer, styleOverride ) );
+      layerIt->insert( styleOverride, usesAtlas );
+    }
+
+    if ( usesAtlas )
+      layers << layerId;
+  }
+  return layers;
+}
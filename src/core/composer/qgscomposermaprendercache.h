@@ -0,0 +1,195 @@
+/***************************************************************************
+                         qgscomposermaprendercache.h
+                         ---------------------------
+    begin                : October 2018
+    copyright            : (C) 2018 by NextGIS
+    email                : info at nextgis dot com
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#ifndef QGSCOMPOSERMAPRENDERCACHE_H
+#define QGSCOMPOSERMAPRENDERCACHE_H
+
+#include <QHash>
+#include <QImage>
+#include <QList>
+#include <QObject>
+#include <QSharedPointer>
+#include <QString>
+#include <QStringList>
+
+class QgsComposerMap;
+class QgsComposition;
+class QgsMapRendererCache;
+class QgsMapRendererParallelJob;
+class QgsMapSettings;
+
+/** \ingroup core
+ * \class QgsComposerMapRenderCache
+ * \brief Renders the maps of upcoming composition pages ahead of time, e.g. while exporting an atlas.
+ *
+ * prepareMaps() starts rendering every map item of the composition, in its current state, with
+ * a parallel map renderer job. Several pages can be prepared before the first one is composed,
+ * so the maps of these pages are rendered concurrently on the global thread pool while the
+ * composition itself is rendered page by page. When a map item is drawn to a raster, it draws
+ * the image rendered for its map settings instead of rendering the map again.
+ *
+ * A map whose settings do not change between pages is rendered only once. If it only uses
+ * atlas dependent symbology in some of its layers, the images of the other layers are kept
+ * and only these layers are rendered again for every page.
+ *
+ * A layer depends on the atlas if an expression of its renderer, labeling, diagrams or subset
+ * string refers to an atlas variable or function. Changing the style of a layer while the cache
+ * exists discards its cached images.
+ *
+ * Maps are prepared only if the image can be drawn without changing the output, i.e. if the
+ * map has an opaque background or advanced effects are disabled. Other maps, vector outputs
+ * and maps for which no image was prepared are rendered as usual.
+ *
+ * While the cache exists, it is set as the map render cache of the composition.
+ *
+ * \note added in QGIS 2.18
+ */
+class CORE_EXPORT QgsComposerMapRenderCache : public QObject
+{
+    Q_OBJECT
+
+  public:
+
+    /** Constructor for QgsComposerMapRenderCache.
+     * @param composition composition whose maps are rendered. The cache is set as the map
+     * render cache of the composition until it is destroyed.
+     */
+    explicit QgsComposerMapRenderCache( QgsComposition* composition );
+
+    ~QgsComposerMapRenderCache();
+
+    /** Sets the maximum number of atlas pages which are prepared ahead of the current page.
+     * @see pagesAhead()
+     */
+    void setPagesAhead( int pages ) { mPagesAhead = qMax( 0, pages ); }
+
+    /** Returns the maximum number of atlas pages which are prepared ahead of the current page.
+     * Defaults to the number of processor cores.
+     * @see setPagesAhead()
+     */
+    int pagesAhead() const { return mPagesAhead; }
+
+    /** Sets the approximate memory in bytes which the images of pending renders may use. No
+     * further atlas pages are prepared ahead while the renders started already exceed it.
+     * @see memoryBudget()
+     */
+    void setMemoryBudget( qint64 bytes ) { mMemoryBudget = qMax( Q_INT64_C( 0 ), bytes ); }
+
+    /** Returns the approximate memory in bytes which the images of pending renders may use.
+     * Defaults to 512 MB.
+     * @see setMemoryBudget()
+     */
+    qint64 memoryBudget() const { return mMemoryBudget; }
+
+    /** Starts rendering the maps of the composition in its current state in the background.
+     * @param dpi resolution of the raster the composition will be rendered to
+     * @returns number of map renders started
+     */
+    int prepareMaps( int dpi );
+
+    /** Starts rendering the maps of the atlas pages following a feature, up to pagesAhead()
+     * pages ahead and as long as the pending renders fit in memoryBudget(). Pages which have
+     * been prepared already are skipped.
+     * The atlas is moved to the prepared features with QgsAtlasComposition::prepareMapsForFeature(),
+     * so the composition must be prepared with QgsAtlasComposition::prepareForFeature() before
+     * it is rendered again.
+     * @param feature index of the atlas feature which is exported next
+     * @param dpi resolution of the raster the composition will be rendered to
+     * @returns number of map renders started
+     */
+    int prepareAtlasFeatures( int feature, int dpi );
+
+    /** Returns the image rendered for a map item with the specified map settings, waiting for
+     * the render to finish if necessary. Returns a null image if no image was prepared for
+     * these settings.
+     */
+    QImage renderedImage( const QgsComposerMap* map, const QgsMapSettings& settings );
+
+    //! Returns the number of map renders which have been started and not taken yet
+    int pendingRenderCount() const { return mRenders.count(); }
+
+    //! Cancels all renders and discards all rendered images
+    void clear();
+
+    /** Returns a key identifying the settings a map item is rendered with, except of the atlas
+     * feature. Renders of maps with the same key produce the same layer images.
+     */
+    static QString layerKey( const QgsComposerMap* map, const QgsMapSettings& settings );
+
+    /** Returns a key identifying the values of the expression context variables of map settings
+     * which the styles of its layers refer to. Renders of maps with the same layerKey() and
+     * variables key produce the same layer images, even if the maps are different items.
+     */
+    static QString variablesKey( const QgsMapSettings& settings );
+
+  private slots:
+
+    //! Discards what is known about the style of the layer which emitted the signal
+    void layerStyleChanged();
+
+  private:
+
+    struct Render
+    {
+      const QgsComposerMap* map;
+      QString key;
+      QgsMapRendererParallelJob* job;
+      QSharedPointer<QgsMapRendererCache> layerCache;
+      //! Approximate size of the images held by the job
+      qint64 bytes;
+    };
+
+    struct MapState
+    {
+      //! Settings of the map except of the atlas feature
+      QString layerKey;
+      //! Images of the layers which do not depend on the atlas feature, for renders with the same layer key
+      QSharedPointer<QgsMapRendererCache> layerCache;
+      //! Key and image of the last rendered image taken
+      QString lastKey;
+      QImage lastImage;
+    };
+
+    QgsComposition* mComposition;
+    int mPagesAhead;
+    qint64 mMemoryBudget;
+    int mNextAtlasFeature;
+    QList<Render> mRenders;
+    QHash<const QgsComposerMap*, MapState> mMapStates;
+    //! Whether the style of a layer refers to the atlas, by layer ID and style override
+    QHash<QString, QHash<QString, bool> > mAtlasLayers;
+
+    //! Returns whether the image of a map can be prepared and drawn instead of the map
+    bool canPrepare( const QgsComposerMap* map ) const;
+
+    //! Returns the settings a map is rendered with when the composition is printed at a resolution
+    QgsMapSettings printSettings( QgsComposerMap* map, int dpi ) const;
+
+    //! Returns the key identifying the image rendered for map settings
+    QString renderKey( const QgsMapSettings& settings, const QString& settingsKey );
+
+    //! Returns the layers of map settings which refer to the atlas in their style
+    QStringList atlasLayers( const QgsMapSettings& settings );
+
+    //! Returns the approximate size of the images held by the renders which have not been taken
+    qint64 pendingBytes() const;
+
+    QgsComposerMapRenderCache( const QgsComposerMapRenderCache& rh );
+    QgsComposerMapRenderCache& operator=( const QgsComposerMapRenderCache& rh );
+};
+
+#endif // QGSCOMPOSERMAPRENDERCACHE_H
@@ -105,6 +105,7 @@ void QgsComposition::init()
   mActiveItemCommand = nullptr;
   mActiveMultiFrameCommand = nullptr;
   mAtlasMode = QgsComposition::AtlasOff;
+  mMapRenderCache = nullptr;
   mPreventCursorChange = false;
   mItemsModel = nullptr;
   mUndoStack = new QUndoStack();
@@ -234,14 +235,13 @@ void QgsComposition::updateBounds()
 void QgsComposition::refreshItems()
 {
   emit refreshItemsTriggered();
-  //force a redraw on all maps
+  //force a redraw on all maps, rendering all their layers again
   QList<QgsComposerMap*> maps;
   composerItems( maps );
   QList<QgsComposerMap*>::iterator mapIt = maps.begin();
   for ( ; mapIt != maps.end(); ++mapIt )
   {
-    ( *mapIt )->cache();
-    ( *mapIt )->update();
+    ( *mapIt )->updateCachedImage();
   }
 }
 
@@ -40,6 +40,7 @@
 class QgisApp;
 class QgsComposerFrame;
 class QgsComposerMap;
+class QgsComposerMapRenderCache;
 class QGraphicsRectItem;
 class QgsMapRenderer;
 class QDomElement;
@@ -797,6 +798,20 @@ class CORE_EXPORT QgsComposition : public QGraphicsScene
      */
     bool setAtlasMode( const QgsComposition::AtlasMode mode );
 
+    /** Sets the cache with the images of the composer maps rendered ahead of time. While a cache
+     * is set, composer maps which are printed to a raster draw the matching images from the cache
+     * instead of rendering the map. The cache is not owned by the composition.
+     * @see mapRenderCache()
+     * @note added in QGIS 2.18
+     */
+    void setMapRenderCache( QgsComposerMapRenderCache* cache ) { mMapRenderCache = cache; }
+
+    /** Returns the cache with the images of the composer maps rendered ahead of time, if any.
+     * @see setMapRenderCache()
+     * @note added in QGIS 2.18
+     */
+    QgsComposerMapRenderCache* mapRenderCache() const { return mMapRenderCache; }
+
     /** Return pages in the correct order
      * @note composerItems(QList< QgsPaperItem* > &) may not return pages in the correct order
      * @note added in version 2.4
@@ -992,6 +1007,9 @@ class CORE_EXPORT QgsComposition : public QGraphicsScene
 
     QgsComposition::AtlasMode mAtlasMode;
 
+    /** Images of the composer maps rendered ahead of time, not owned */
+    QgsComposerMapRenderCache* mMapRenderCache;
+
     bool mPreventCursorChange;
 
     QgsComposerModel * mItemsModel;
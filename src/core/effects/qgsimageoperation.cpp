@@ -22,6 +22,7 @@
 #include <QtConcurrentMap>
 #include <QColor>
 #include <QPainter>
+#include <QVector>
 #include <qmath.h>
 
 //determined via trial-and-error. Could possibly be optimised, or varied
@@ -174,6 +175,25 @@ void QgsImageOperation::runBlockOperationInThreads( QImage &image, BlockOperatio
   QtConcurrent::blockingMap( blocks, operation );
 }
 
+template <typename BlockOperation>
+void QgsImageOperation::runBlockOperation( QImage &image, BlockOperation &operation, LineOperationDirection direction )
+{
+  if ( image.height() * image.width() < 100000 )
+  {
+    //small image, don't multithread
+    ImageBlock fullImage;
+    fullImage.beginLine = 0;
+    fullImage.endLine = ( direction == QgsImageOperation::ByRow ) ? image.height() : image.width();
+    fullImage.lineLength = ( direction == QgsImageOperation::ByRow ) ? image.width() : image.height();
+    fullImage.image = &image;
+    operation( fullImage );
+  }
+  else
+  {
+    runBlockOperationInThreads( image, operation, direction );
+  }
+}
+
 
 ///@endcond
 
@@ -382,8 +402,11 @@ void QgsImageOperation::distanceTransform( QImage &image, const DistanceTransfor
   ConvertToArrayPixelOperation convertToArray( image.width(), array, properties.shadeExterior );
   runPixelOperation( image, convertToArray );
 
-  //calculate distance transform (single threaded only)
-  distanceTransform2d( array, image.width(), image.height() );
+  //calculate distance transform, first along columns and then along rows
+  DistanceTransformBlockOperation columnTransform( array, image.width(), QgsImageOperation::ByColumn );
+  runBlockOperation( image, columnTransform, QgsImageOperation::ByColumn );
+  DistanceTransformBlockOperation rowTransform( array, image.width(), QgsImageOperation::ByRow );
+  runBlockOperation( image, rowTransform, QgsImageOperation::ByRow );
 
   double spread;
   if ( properties.useMaxDistance )
@@ -476,41 +499,32 @@ double QgsImageOperation::maxValueInDistanceTransformArray( const double *array,
   return dtMaxValue;
 }
 
-/* distance transform of 2d function using squared distance */
-void QgsImageOperation::distanceTransform2d( double * im, int width, int height )
+/* distance transform of 2d function using squared distance, for the rows or columns of a block */
+void QgsImageOperation::DistanceTransformBlockOperation::operator()( QgsImageOperation::ImageBlock &block )
 {
-  int maxDimension = qMax( width, height );
+  int n = block.lineLength;
 
-  double *f = new double[ maxDimension ];
-  int *v = new int[ maxDimension ];
-  double *z = new double[ maxDimension + 1 ];
-  double *d = new double[ maxDimension ];
+  //scratch buffers are per block, so that blocks can be transformed concurrently
+  double *f = new double[ n ];
+  int *v = new int[ n ];
+  double *z = new double[ n + 1 ];
+  double *d = new double[ n ];
 
-  // transform along columns
-  for ( int x = 0; x < width; x++ )
-  {
-    for ( int y = 0; y < height; y++ )
-    {
-      f[y] = im[ x + y * width ];
-    }
-    distanceTransform1d( f, height, v, z, d );
-    for ( int y = 0; y < height; y++ )
-    {
-      im[ x + y * width ] = d[y];
-    }
-  }
+  //step between consecutive values of a line, and between the first values of consecutive lines
+  int step = ( mDirection == QgsImageOperation::ByRow ) ? 1 : mWidth;
+  int lineStep = ( mDirection == QgsImageOperation::ByRow ) ? mWidth : 1;
 
-  // transform along rows
-  for ( int y = 0; y < height; y++ )
+  for ( unsigned int line = block.beginLine; line < block.endLine; ++line )
   {
-    for ( int x = 0; x < width; x++ )
+    double* im = mArray + line * lineStep;
+    for ( int i = 0; i < n; i++ )
     {
-      f[x] = im[  x + y*width ];
+      f[i] = im[ i * step ];
     }
-    distanceTransform1d( f, width, v, z, d );
-    for ( int x = 0; x < width; x++ )
+    distanceTransform1d( f, n, v, z, d );
+    for ( int i = 0; i < n; i++ )
     {
-      im[  x + y*width ] = d[x];
+      im[ i * step ] = d[i];
     }
   }
 
@@ -580,14 +594,14 @@ void QgsImageOperation::stackBlur( QImage &image, const int radius, const bool a
   if ( alphaOnly )
     i1 = i2 = ( QSysInfo::ByteOrder == QSysInfo::BigEndian ? 0 : 3 );
 
-  StackBlurLineOperation topToBottomBlur( alpha, QgsImageOperation::ByColumn, true, i1, i2 );
-  runLineOperation( *pImage, topToBottomBlur );
+  StackBlurColumnOperation topToBottomBlur( alpha, true, i1, i2 );
+  runBlockOperation( *pImage, topToBottomBlur, QgsImageOperation::ByColumn );
 
   StackBlurLineOperation leftToRightBlur( alpha, QgsImageOperation::ByRow, true, i1, i2 );
   runLineOperation( *pImage, leftToRightBlur );
 
-  StackBlurLineOperation bottomToTopBlur( alpha, QgsImageOperation::ByColumn, false, i1, i2 );
-  runLineOperation( *pImage, bottomToTopBlur );
+  StackBlurColumnOperation bottomToTopBlur( alpha, false, i1, i2 );
+  runBlockOperation( *pImage, bottomToTopBlur, QgsImageOperation::ByColumn );
 
   StackBlurLineOperation rightToLeftBlur( alpha, QgsImageOperation::ByRow, false, i1, i2 );
   runLineOperation( *pImage, rightToLeftBlur );
@@ -625,6 +639,49 @@ void QgsImageOperation::StackBlurLineOperation::operator()( QRgb* startRef, cons
   }
 }
 
+void QgsImageOperation::StackBlurColumnOperation::operator()( QgsImageOperation::ImageBlock &block )
+{
+  //all columns of the block are blurred together, one row at a time, so that the image
+  //is read sequentially instead of striding through it once for every column
+  int columns = block.endLine - block.beginLine;
+  int height = block.lineLength;
+  if ( columns <= 0 || height <= 0 )
+    return;
+
+  int bpl = block.image->bytesPerLine();
+  unsigned char* p = block.image->scanLine( 0 ) + 4 * block.beginLine;
+  int increment = bpl;
+  if ( !mForwardDirection )
+  {
+    p += ( height - 1 ) * bpl;
+    increment = -increment;
+  }
+
+  QVector<int> rgba( columns * 4 );
+  int* state = rgba.data();
+  for ( int x = 0; x < columns; ++x )
+  {
+    for ( int i = mi1; i <= mi2; ++i )
+    {
+      state[x * 4 + i] = p[x * 4 + i] << 4;
+    }
+  }
+
+  p += increment;
+  for ( int j = 1; j < height; ++j, p += increment )
+  {
+    for ( int x = 0; x < columns; ++x )
+    {
+      unsigned char* pixel = p + x * 4;
+      int* pixelState = state + x * 4;
+      for ( int i = mi1; i <= mi2; ++i )
+      {
+        pixel[i] = ( pixelState[i] += (( pixel[i] << 4 ) - pixelState[i] ) * mAlpha / 16 ) >> 4;
+      }
+    }
+  }
+}
+
 //gaussian blur
 
 QImage *QgsImageOperation::gaussianBlur( QImage &image, const int radius )
@@ -676,89 +733,77 @@ void QgsImageOperation::GaussianBlurOperation::operator()( QgsImageOperation::Im
 {
   int width = block.image->width();
   int height = block.image->height();
-  int sourceBpl = block.image->bytesPerLine();
+  int kernelSize = mRadius * 2 + 1;
+  int lineBytes = width * 4;
+
+  //all four channels are blurred the same way, so lines are processed as flat arrays of channel
+  //values. This keeps the inner loops free of branches and lets the compiler vectorize them
+  QVector<float> kernel( kernelSize );
+  for ( int i = 0; i < kernelSize; ++i )
+  {
+    kernel[i] = mKernel[i];
+  }
+  QVector<float> sums( lineBytes );
+  float* sum = sums.data();
 
   unsigned char* outputLineRef = mDestImage->scanLine( block.beginLine );
-  QRgb* destRef = nullptr;
-  if ( mDirection == ByRow )
+  for ( unsigned int y = block.beginLine; y < block.endLine; ++y, outputLineRef += mDestImageBpl )
   {
-    unsigned char* sourceFirstLine = block.image->scanLine( 0 );
-    unsigned char* sourceRef;
+    for ( int j = 0; j < lineBytes; ++j )
+    {
+      sum[j] = 0.0;
+    }
 
-    //blur along rows
-    for ( unsigned int y = block.beginLine; y < block.endLine; ++y, outputLineRef += mDestImageBpl )
+    if ( mDirection == ByRow )
     {
-      sourceRef = sourceFirstLine;
-      destRef = reinterpret_cast< QRgb* >( outputLineRef );
-      for ( int x = 0; x < width; ++x, ++destRef, sourceRef += 4 )
+      //blur across lines, weighting whole source lines
+      for ( int i = 0; i < kernelSize; ++i )
       {
-        *destRef = gaussianBlurVertical( y, sourceRef, sourceBpl, height );
+        int sourceY = qBound( 0, static_cast< int >( y ) + i - mRadius, height - 1 );
+        const unsigned char* sourceRef = block.image->constScanLine( sourceY );
+        float k = kernel[i];
+        for ( int j = 0; j < lineBytes; ++j )
+        {
+          sum[j] += k * sourceRef[j];
+        }
       }
     }
-  }
-  else
-  {
-    unsigned char* sourceRef = block.image->scanLine( block.beginLine );
-    for ( unsigned int y = block.beginLine; y < block.endLine; ++y, outputLineRef += mDestImageBpl, sourceRef += sourceBpl )
+    else
     {
-      destRef = reinterpret_cast< QRgb* >( outputLineRef );
-      for ( int x = 0; x < width; ++x, ++destRef )
+      //blur along the line, weighting the line shifted by every kernel offset. Pixels beyond the
+      //edges repeat the edge pixels
+      const unsigned char* sourceRef = block.image->constScanLine( y );
+      const unsigned char* lastPixel = sourceRef + ( width - 1 ) * 4;
+      for ( int i = 0; i < kernelSize; ++i )
       {
-        *destRef = gaussianBlurHorizontal( x, sourceRef, width );
+        int offset = i - mRadius;
+        float k = kernel[i];
+        int firstX = qBound( 0, -offset, width );
+        int lastX = qBound( 0, width - offset, width );
+
+        for ( int j = 0; j < firstX * 4; ++j )
+        {
+          sum[j] += k * sourceRef[j % 4];
+        }
+        int shift = offset * 4;
+        for ( int j = firstX * 4; j < lastX * 4; ++j )
+        {
+          sum[j] += k * sourceRef[j + shift];
+        }
+        for ( int j = qMax( firstX, lastX ) * 4; j < lineBytes; ++j )
+        {
+          sum[j] += k * lastPixel[j % 4];
+        }
       }
     }
-  }
-}
 
-inline QRgb QgsImageOperation::GaussianBlurOperation::gaussianBlurVertical( const int posy, unsigned char *sourceFirstLine, const int sourceBpl, const int height )
-{
-  double r = 0;
-  double b = 0;
-  double g = 0;
-  double a = 0;
-  int y;
-  unsigned char *ref;
-
-  for ( int i = 0; i <= mRadius*2; ++i )
-  {
-    y = qBound( 0, posy + ( i - mRadius ), height - 1 );
-    ref = sourceFirstLine + sourceBpl * y;
-
-    QRgb* refRgb = reinterpret_cast< QRgb* >( ref );
-    r += mKernel[i] * qRed( *refRgb );
-    g += mKernel[i] * qGreen( *refRgb );
-    b += mKernel[i] * qBlue( *refRgb );
-    a += mKernel[i] * qAlpha( *refRgb );
-  }
-
-  return qRgba( r, g, b, a );
-}
-
-inline QRgb QgsImageOperation::GaussianBlurOperation::gaussianBlurHorizontal( const int posx, unsigned char *sourceFirstLine, const int width )
-{
-  double r = 0;
-  double b = 0;
-  double g = 0;
-  double a = 0;
-  int x;
-  unsigned char *ref;
-
-  for ( int i = 0; i <= mRadius*2; ++i )
-  {
-    x = qBound( 0, posx + ( i - mRadius ), width - 1 );
-    ref = sourceFirstLine + x * 4;
-
-    QRgb* refRgb = reinterpret_cast< QRgb* >( ref );
-    r += mKernel[i] * qRed( *refRgb );
-    g += mKernel[i] * qGreen( *refRgb );
-    b += mKernel[i] * qBlue( *refRgb );
-    a += mKernel[i] * qAlpha( *refRgb );
+    for ( int j = 0; j < lineBytes; ++j )
+    {
+      outputLineRef[j] = static_cast< unsigned char >( qMin( sum[j] + 0.5f, 255.0f ) );
+    }
   }
-
-  return qRgba( r, g, b, a );
 }
 
-
 double* QgsImageOperation::createGaussianKernel( const int radius )
 {
   double* kernel = new double[ radius*2+1 ];
@@ -192,6 +192,7 @@ class CORE_EXPORT QgsImageOperation
       ByColumn
     };
     template <class BlockOperation> static void runBlockOperationInThreads( QImage &image, BlockOperation& operation, LineOperationDirection direction );
+    template <class BlockOperation> static void runBlockOperation( QImage &image, BlockOperation& operation, LineOperationDirection direction );
     struct ImageBlock
     {
       unsigned int beginLine;
@@ -381,7 +382,25 @@ class CORE_EXPORT QgsImageOperation
         double mSpreadSquared;
         const DistanceTransformProperties& mProperties;
     };
-    static void distanceTransform2d( double *im, int width, int height );
+
+    class DistanceTransformBlockOperation
+    {
+      public:
+        DistanceTransformBlockOperation( double* array, const int width, LineOperationDirection direction )
+            : mArray( array )
+            , mWidth( width )
+            , mDirection( direction )
+        {}
+
+        typedef void result_type;
+
+        void operator()( ImageBlock& block );
+
+      private:
+        double* mArray;
+        int mWidth;
+        LineOperationDirection mDirection;
+    };
     static void distanceTransform1d( double *f, int n, int *v, double *z, double *d );
     static double maxValueInDistanceTransformArray( const double *array, const unsigned int size );
 
@@ -411,6 +430,27 @@ class CORE_EXPORT QgsImageOperation
         int mi2;
     };
 
+    class StackBlurColumnOperation
+    {
+      public:
+        StackBlurColumnOperation( int alpha, bool forwardDirection, int i1, int i2 )
+            : mAlpha( alpha )
+            , mForwardDirection( forwardDirection )
+            , mi1( i1 )
+            , mi2( i2 )
+        { }
+
+        typedef void result_type;
+
+        void operator()( ImageBlock& block );
+
+      private:
+        int mAlpha;
+        bool mForwardDirection;
+        int mi1;
+        int mi2;
+    };
+
     static double *createGaussianKernel( const int radius );
 
     class GaussianBlurOperation
@@ -434,9 +474,6 @@ class CORE_EXPORT QgsImageOperation
         QImage* mDestImage;
         int mDestImageBpl;
         double* mKernel;
-
-        inline QRgb gaussianBlurVertical( const int posy, unsigned char *sourceFirstLine, const int sourceBpl, const int height );
-        inline QRgb gaussianBlurHorizontal( const int posx, unsigned char *sourceFirstLine, const int width );
     };
 
     //flip
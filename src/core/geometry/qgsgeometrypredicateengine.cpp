@@ -0,0 +1,350 @@
+/***************************************************************************
+                         qgsgeometrypredicateengine.cpp
+                         ------------------------------
+    begin                : October 2018
+    copyright            : (C) 2018 by NextGIS
+    email                : info at nextgis dot com
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "qgsgeometrypredicateengine.h"
+#include "qgsgeometry.h"
+#include "qgsgeos.h"
+#include "qgslogger.h"
+
+#include <QThread>
+#include <QtConcurrentMap>
+
+//below this number of candidates per thread, spreading the work is not worth it
+#define MIN_CANDIDATES_PER_CHUNK 64
+
+/// @cond PRIVATE
+
+struct QgsGeometryPredicateChunk
+{
+  int first;
+  int count;
+};
+
+class QgsGeometryPredicateChunkEvaluator
+{
+  public:
+    typedef void result_type;
+
+    /** Constructor for QgsGeometryPredicateChunkEvaluator. The candidates must have been converted
+     * to GEOS, so that the chunks only read them.
+     */
+    QgsGeometryPredicateChunkEvaluator( const GEOSGeometry* reference,
+                                        QgsGeometryPredicateEngine::Predicate predicate,
+                                        QVector<QgsGeometryPredicateEngine::Candidate>& candidates )
+        : mReference( reference )
+        , mPredicate( predicate )
+        , mCandidates( candidates )
+    {}
+
+    void operator()( const QgsGeometryPredicateChunk& chunk )
+    {
+      // the shared GEOS handle must not be used from several threads
+      GEOSContextHandle_t ctxt = QgsGeos::createGEOSHandler();
+
+      // GEOS builds the indexes of a prepared geometry lazily while evaluating predicates,
+      // so every chunk prepares its own copy of the reference geometry
+      GEOSGeometry* reference = nullptr;
+      const GEOSPreparedGeometry* prepared = nullptr;
+      try
+      {
+        reference = GEOSGeom_clone_r( ctxt, mReference );
+        if ( reference )
+          prepared = GEOSPrepare_r( ctxt, reference );
+      }
+      catch ( GEOSException &e )
+      {
+        QgsDebugMsg( QString( "Could not prepare geometry: %1" ).arg( e.what() ) );
+      }
+
+      if ( prepared )
+      {
+        QgsGeometryPredicateEngine::Candidate* c = mCandidates.data() + chunk.first;
+        for ( int i = 0; i < chunk.count; ++i, ++c )
+        {
+          c->result = QgsGeometryPredicateEngine::evaluateGeos( ctxt, reference, prepared, mPredicate, c->geos );
+        }
+      }
+
+      GEOSPreparedGeom_destroy_r( ctxt, prepared );
+      GEOSGeom_destroy_r( ctxt, reference );
+      QgsGeos::destroyGEOSHandler( ctxt );
+    }
+
+  private:
+    const GEOSGeometry* mReference;
+    QgsGeometryPredicateEngine::Predicate mPredicate;
+    QVector<QgsGeometryPredicateEngine::Candidate>& mCandidates;
+};
+
+///@endcond
+
+QgsGeometryPredicateEngine::CachedGeometry::~CachedGeometry()
+{
+  GEOSGeom_destroy_r( QgsGeos::getGEOSHandler(), geos );
+}
+
+QgsGeometryPredicateEngine::QgsGeometryPredicateEngine( const QgsGeometry* reference, double precision )
+    : mGeos( nullptr )
+    , mGeosPrepared( nullptr )
+    , mPrecision( precision )
+    , mParallelThreshold( 1000 )
+    , mCache( 10000 )
+{
+  setReferenceGeometry( reference );
+}
+
+QgsGeometryPredicateEngine::~QgsGeometryPredicateEngine()
+{
+  GEOSPreparedGeom_destroy_r( QgsGeos::getGEOSHandler(), mGeosPrepared );
+  GEOSGeom_destroy_r( QgsGeos::getGEOSHandler(), mGeos );
+}
+
+void QgsGeometryPredicateEngine::setReferenceGeometry( const QgsGeometry* reference )
+{
+  GEOSContextHandle_t ctxt = QgsGeos::getGEOSHandler();
+  GEOSPreparedGeom_destroy_r( ctxt, mGeosPrepared );
+  mGeosPrepared = nullptr;
+  GEOSGeom_destroy_r( ctxt, mGeos );
+  mGeos = nullptr;
+  mReferenceBox = QgsRectangle();
+
+  if ( !reference || !reference->geometry() )
+    return;
+
+  mGeos = QgsGeos::asGeos( reference->geometry(), mPrecision );
+  if ( !mGeos )
+    return;
+
+  try
+  {
+    mGeosPrepared = GEOSPrepare_r( ctxt, mGeos );
+  }
+  catch ( GEOSException &e )
+  {
+    QgsDebugMsg( QString( "Could not prepare geometry: %1" ).arg( e.what() ) );
+  }
+  mReferenceBox = reference->boundingBox();
+  if ( mPrecision > 0 )
+    mReferenceBox.grow( mPrecision );
+}
+
+bool QgsGeometryPredicateEngine::evaluate( Predicate predicate, const QgsGeometry* candidate ) const
+{
+  if ( !mGeosPrepared || !candidate || !candidate->geometry() )
+    return false;
+
+  bool result = false;
+  if ( boundingBoxTest( predicate, candidate, result ) )
+    return result;
+
+  GEOSContextHandle_t ctxt = QgsGeos::getGEOSHandler();
+  GEOSGeometry* geos = QgsGeos::asGeos( candidate->geometry(), mPrecision );
+  if ( !geos )
+    return false;
+
+  result = evaluateGeos( ctxt, mGeos, mGeosPrepared, predicate, geos );
+  GEOSGeom_destroy_r( ctxt, geos );
+  return result;
+}
+
+bool QgsGeometryPredicateEngine::evaluate( Predicate predicate, QgsFeatureId fid, const QgsGeometry* candidate )
+{
+  if ( !mGeosPrepared || !candidate || !candidate->geometry() )
+    return false;
+
+  bool result = false;
+  if ( boundingBoxTest( predicate, candidate, result ) )
+    return result;
+
+  CachedGeometry* cached = mCache.object( fid );
+  if ( cached )
+    return evaluateGeos( QgsGeos::getGEOSHandler(), mGeos, mGeosPrepared, predicate, cached->geos );
+
+  GEOSGeometry* geos = QgsGeos::asGeos( candidate->geometry(), mPrecision );
+  if ( !geos )
+    return false;
+
+  result = evaluateGeos( QgsGeos::getGEOSHandler(), mGeos, mGeosPrepared, predicate, geos );
+  // QCache takes ownership and may delete the object right away if caching is disabled
+  mCache.insert( fid, new CachedGeometry( geos ) );
+  return result;
+}
+
+QgsFeatureIds QgsGeometryPredicateEngine::evaluate( Predicate predicate, const QgsFeatureList& candidates )
+{
+  QVector<Candidate> batch;
+  batch.reserve( candidates.size() );
+  Q_FOREACH ( const QgsFeature& f, candidates )
+  {
+    Candidate c = { f.id(), f.constGeometry(), nullptr, nullptr, -1, false };
+    batch << c;
+  }
+  evaluateCandidates( predicate, batch );
+  return collectResults( batch );
+}
+
+QgsFeatureIds QgsGeometryPredicateEngine::evaluate( Predicate predicate, const QHash<QgsFeatureId, QgsGeometry*>& candidates )
+{
+  QVector<Candidate> batch;
+  batch.reserve( candidates.size() );
+  QHash<QgsFeatureId, QgsGeometry*>::const_iterator it = candidates.constBegin();
+  for ( ; it != candidates.constEnd(); ++it )
+  {
+    Candidate c = { it.key(), it.value(), nullptr, nullptr, -1, false };
+    batch << c;
+  }
+  evaluateCandidates( predicate, batch );
+  return collectResults( batch );
+}
+
+void QgsGeometryPredicateEngine::setMaxCachedGeometries( int count )
+{
+  mCache.setMaxCost( qMax( 0, count ) );
+}
+
+void QgsGeometryPredicateEngine::invalidateGeometry( QgsFeatureId fid )
+{
+  mCache.remove( fid );
+}
+
+void QgsGeometryPredicateEngine::clearCache()
+{
+  mCache.clear();
+}
+
+bool QgsGeometryPredicateEngine::boundingBoxTest( Predicate predicate, const QgsGeometry* candidate, bool& result ) const
+{
+  if ( candidate->boundingBox().intersects( mReferenceBox ) )
+    return false;
+
+  // the bounding boxes do not touch, so only disjoint can be true
+  result = ( predicate == Disjoint );
+  return true;
+}
+
+void QgsGeometryPredicateEngine::evaluateCandidates( Predicate predicate, QVector<Candidate>& candidates )
+{
+  if ( !mGeosPrepared )
+    return;
+
+  GEOSContextHandle_t ctxt = QgsGeos::getGEOSHandler();
+
+  // drop candidates which can be decided from their bounding box alone and convert
+  // the others here, so that workers never touch the cache or the shared GEOS handle
+  QVector<Candidate> pending;
+  pending.reserve( candidates.size() );
+  for ( int i = 0; i < candidates.size(); ++i )
+  {
+    Candidate& c = candidates[i];
+    if ( !c.geometry || !c.geometry->geometry() )
+      continue;
+
+    if ( boundingBoxTest( predicate, c.geometry, c.result ) )
+      continue;
+
+    CachedGeometry* cached = mCache.object( c.fid );
+    if ( cached )
+    {
+      c.geos = cached->geos;
+    }
+    else
+    {
+      c.converted = QgsGeos::asGeos( c.geometry->geometry(), mPrecision );
+      c.geos = c.converted;
+    }
+    if ( !c.geos )
+      continue;
+
+    pending << c;
+    pending.last().index = i;
+  }
+
+  int threads = QThread::idealThreadCount();
+  if ( mParallelThreshold > 0 && pending.size() >= mParallelThreshold && threads > 1 )
+  {
+    // every chunk prepares the reference geometry again, so use one chunk per thread
+    int chunkSize = qMax( MIN_CANDIDATES_PER_CHUNK, ( pending.size() + threads - 1 ) / threads );
+    QList<QgsGeometryPredicateChunk> chunks;
+    for ( int first = 0; first < pending.size(); first += chunkSize )
+    {
+      QgsGeometryPredicateChunk chunk = { first, qMin( chunkSize, pending.size() - first ) };
+      chunks << chunk;
+    }
+    QgsGeometryPredicateChunkEvaluator evaluator( mGeos, predicate, pending );
+    QtConcurrent::blockingMap( chunks, evaluator );
+  }
+  else
+  {
+    for ( int i = 0; i < pending.size(); ++i )
+    {
+      Candidate& c = pending[i];
+      c.result = evaluateGeos( ctxt, mGeos, mGeosPrepared, predicate, c.geos );
+    }
+  }
+
+  // hand the new conversions over to the cache and copy back the results
+  for ( int i = 0; i < pending.size(); ++i )
+  {
+    const Candidate& p = pending.at( i );
+    Candidate& c = candidates[ p.index ];
+    c.result = p.result;
+    if ( p.converted )
+      mCache.insert( c.fid, new CachedGeometry( p.converted ) );
+  }
+}
+
+QgsFeatureIds QgsGeometryPredicateEngine::collectResults( QVector<Candidate>& candidates )
+{
+  QgsFeatureIds ids;
+  for ( int i = 0; i < candidates.size(); ++i )
+  {
+    if ( candidates.at( i ).result )
+      ids.insert( candidates.at( i ).fid );
+  }
+  return ids;
+}
+
+bool QgsGeometryPredicateEngine::evaluateGeos( GEOSContextHandle_t ctxt, const GEOSGeometry* reference, const GEOSPreparedGeometry* prepared, Predicate predicate, const GEOSGeometry* candidate )
+{
+  try
+  {
+    switch ( predicate )
+    {
+      case Intersects:
+        return GEOSPreparedIntersects_r( ctxt, prepared, candidate ) == 1;
+      case Touches:
+        return GEOSPreparedTouches_r( ctxt, prepared, candidate ) == 1;
+      case Crosses:
+        return GEOSPreparedCrosses_r( ctxt, prepared, candidate ) == 1;
+      case Within:
+        return GEOSPreparedWithin_r( ctxt, prepared, candidate ) == 1;
+      case Overlaps:
+        return GEOSPreparedOverlaps_r( ctxt, prepared, candidate ) == 1;
+      case Contains:
+        return GEOSPreparedContains_r( ctxt, prepared, candidate ) == 1;
+      case Disjoint:
+        return GEOSPreparedDisjoint_r( ctxt, prepared, candidate ) == 1;
+      case Equals:
+        return GEOSEquals_r( ctxt, reference, candidate ) == 1;
+    }
+  }
+  catch ( GEOSException &e )
+  {
+    QgsDebugMsg( QString( "GEOS predicate failed: %1" ).arg( e.what() ) );
+  }
+  return false;
+}
@@ -0,0 +1,178 @@
+/***************************************************************************
+                         qgsgeometrypredicateengine.h
+                         ----------------------------
+    begin                : October 2018
+    copyright            : (C) 2018 by NextGIS
+    email                : info at nextgis dot com
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#ifndef QGSGEOMETRYPREDICATEENGINE_H
+#define QGSGEOMETRYPREDICATEENGINE_H
+
+#include "qgsfeature.h"
+#include "qgsrectangle.h"
+
+#include <QCache>
+#include <QHash>
+
+#include <geos_c.h>
+
+class QgsGeometry;
+
+/** \ingroup core
+ * \class QgsGeometryPredicateEngine
+ * \brief Evaluates spatial predicates of one prepared reference geometry against
+ * batches of candidate geometries.
+ *
+ * The reference geometry is converted to GEOS and prepared once. Candidates which are
+ * identified by a feature id keep their GEOS representation in a bounded cache, so that
+ * a spatial join which tests the same candidates against many reference geometries
+ * (see setReferenceGeometry()) converts every candidate only once. Candidates whose
+ * bounding box does not touch the reference bounding box are rejected without any
+ * conversion.
+ *
+ * Large batches are split into one chunk per thread, which are evaluated on the global
+ * thread pool. The candidates are converted to GEOS in the calling thread. As GEOS builds
+ * the indexes of a prepared geometry lazily, every chunk prepares its own copy of the
+ * reference geometry with a GEOS context handle of its own.
+ *
+ * If the geometries of cached candidates change, call invalidateGeometry() or clearCache().
+ *
+ * \note added in QGIS 2.18
+ */
+class CORE_EXPORT QgsGeometryPredicateEngine
+{
+  public:
+
+    //! Spatial predicates which can be evaluated against the reference geometry
+    enum Predicate
+    {
+      Intersects, //!< Reference geometry intersects the candidate
+      Touches, //!< Reference geometry touches the candidate
+      Crosses, //!< Reference geometry crosses the candidate
+      Within, //!< Reference geometry is within the candidate
+      Overlaps, //!< Reference geometry overlaps the candidate
+      Contains, //!< Reference geometry contains the candidate
+      Disjoint, //!< Reference geometry is disjoint from the candidate
+      Equals, //!< Reference geometry is spatially equal to the candidate (not accelerated by preparation)
+    };
+
+    /** Constructor for QgsGeometryPredicateEngine.
+     * @param reference reference geometry. The geometry is copied to GEOS, so it does not
+     * need to outlive the engine.
+     * @param precision precision of the grid to which vertices are snapped. If 0, no snapping is performed.
+     */
+    explicit QgsGeometryPredicateEngine( const QgsGeometry* reference = nullptr, double precision = 0.0 );
+
+    ~QgsGeometryPredicateEngine();
+
+    /** Replaces the reference geometry and prepares it. Cached candidate geometries are kept.
+     * @see hasReferenceGeometry()
+     */
+    void setReferenceGeometry( const QgsGeometry* reference );
+
+    /** Returns true if a valid reference geometry has been set.
+     * @see setReferenceGeometry()
+     */
+    bool hasReferenceGeometry() const { return nullptr != mGeosPrepared; }
+
+    /** Evaluates a predicate between the reference geometry and a candidate geometry.
+     * The candidate conversion is not cached.
+     */
+    bool evaluate( Predicate predicate, const QgsGeometry* candidate ) const;
+
+    /** Evaluates a predicate between the reference geometry and the geometry of the
+     * candidate feature with id fid. The candidate conversion is cached under fid.
+     */
+    bool evaluate( Predicate predicate, QgsFeatureId fid, const QgsGeometry* candidate );
+
+    /** Evaluates a predicate over a batch of candidate features.
+     * @returns ids of the features which satisfy the predicate
+     */
+    QgsFeatureIds evaluate( Predicate predicate, const QgsFeatureList& candidates );
+
+    /** Evaluates a predicate over a batch of candidate geometries keyed by feature id.
+     * @returns ids of the geometries which satisfy the predicate
+     * @note not available in Python bindings
+     */
+    QgsFeatureIds evaluate( Predicate predicate, const QHash<QgsFeatureId, QgsGeometry*>& candidates );
+
+    /** Sets the maximum number of candidate geometries kept in GEOS form. A value of 0
+     * disables caching.
+     * @see maxCachedGeometries()
+     */
+    void setMaxCachedGeometries( int count );
+
+    /** Returns the maximum number of candidate geometries kept in GEOS form.
+     * @see setMaxCachedGeometries()
+     */
+    int maxCachedGeometries() const { return mCache.maxCost(); }
+
+    //! Returns the number of candidate geometries currently cached
+    int cachedGeometryCount() const { return mCache.count(); }
+
+    //! Removes the cached GEOS geometry for a candidate feature
+    void invalidateGeometry( QgsFeatureId fid );
+
+    //! Removes all cached candidate geometries
+    void clearCache();
+
+    /** Sets the minimum batch size for which the evaluation is spread over several threads.
+     * A value of 0 disables multi-threaded evaluation.
+     * @see parallelThreshold()
+     */
+    void setParallelThreshold( int count ) { mParallelThreshold = count; }
+
+    /** Returns the minimum batch size for which the evaluation is spread over several threads.
+     * @see setParallelThreshold()
+     */
+    int parallelThreshold() const { return mParallelThreshold; }
+
+  private:
+
+    struct CachedGeometry
+    {
+      explicit CachedGeometry( GEOSGeometry* g ) : geos( g ) {}
+      ~CachedGeometry();
+      GEOSGeometry* geos;
+    };
+
+    struct Candidate
+    {
+      QgsFeatureId fid;
+      const QgsGeometry* geometry;
+      const GEOSGeometry* geos;
+      GEOSGeometry* converted;
+      int index;
+      bool result;
+    };
+
+    GEOSGeometry* mGeos;
+    const GEOSPreparedGeometry* mGeosPrepared;
+    QgsRectangle mReferenceBox;
+    double mPrecision;
+    int mParallelThreshold;
+    QCache<QgsFeatureId, CachedGeometry> mCache;
+
+    bool boundingBoxTest( Predicate predicate, const QgsGeometry* candidate, bool& result ) const;
+    void evaluateCandidates( Predicate predicate, QVector<Candidate>& candidates );
+    QgsFeatureIds collectResults( QVector<Candidate>& candidates );
+
+    static bool evaluateGeos( GEOSContextHandle_t ctxt, const GEOSGeometry* reference, const GEOSPreparedGeometry* prepared, Predicate predicate, const GEOSGeometry* candidate );
+
+    friend class QgsGeometryPredicateChunkEvaluator;
+
+    QgsGeometryPredicateEngine( const QgsGeometryPredicateEngine& rh );
+    QgsGeometryPredicateEngine& operator=( const QgsGeometryPredicateEngine& rh );
+};
+
+#endif // QGSGEOMETRYPREDICATEENGINE_H
@@ -0,0 +1,395 @@
+/***************************************************************************
+                         qgsgeometryunionengine.cpp
+                         --------------------------
+    begin                : October 2018
+    copyright            : (C) 2018 by NextGIS
+    email                : info at nextgis dot com
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "qgsgeometryunionengine.h"
+#include "qgsabstractgeometryv2.h"
+#include "qgsgeometry.h"
+#include "qgsgeos.h"
+#include "qgslogger.h"
+
+#include <QObject>
+#include <QThread>
+#include <QtConcurrentMap>
+
+//number of partial results merged at once above the lowest level of the union tree
+#define MERGE_FAN_IN 4
+
+/// @cond PRIVATE
+
+//! Transient state of a group while the union tree is reduced
+struct QgsGeometryUnionGroupState
+{
+  //! input geometries, sorted along a space filling curve
+  QVector<const QgsAbstractGeometryV2*> ordered;
+  //! partial results of the current tree level
+  QVector<QgsAbstractGeometryV2*> pieces;
+  //! partial results of the next tree level
+  QVector<QgsAbstractGeometryV2*> next;
+  QString error;
+};
+
+struct QgsGeometryUnionTask
+{
+  QgsGeometryUnionGroupState* state;
+  //! true to merge input geometries, false to merge partial results
+  bool leaf;
+  int first;
+  int count;
+  //! index of the partial result in the next tree level
+  int slot;
+  QString error;
+};
+
+class QgsGeometryUnionWorker
+{
+  public:
+    typedef void result_type;
+
+    QgsGeometryUnionWorker( QgsGeometryUnionEngine::Operation operation, double precision )
+        : mOperation( operation )
+        , mPrecision( precision )
+    {}
+
+    void operator()( QgsGeometryUnionTask& task )
+    {
+      QgsGeometryUnionGroupState* state = task.state;
+
+      // a single partial result is already merged
+      if ( !task.leaf && task.count == 1 )
+      {
+        state->next[ task.slot ] = state->pieces[ task.first ];
+        state->pieces[ task.first ] = nullptr;
+        return;
+      }
+
+      // GEOS geometries never leave the task: they are created, merged and destroyed with
+      // the handle of this task, partial results are handed on as QGIS geometries
+      GEOSContextHandle_t ctxt = QgsGeos::createGEOSHandler();
+
+      QVector<GEOSGeometry*> parts;
+      parts.reserve( task.count );
+      for ( int i = task.first; i < task.first + task.count; ++i )
+      {
+        const QgsAbstractGeometryV2* geometry = task.leaf ? state->ordered.at( i ) : state->pieces.at( i );
+        if ( !geometry )
+          continue;
+
+        GEOSGeometry* g = QgsGeos::asGeos( ctxt, geometry, mPrecision );
+        if ( g )
+          parts << g;
+        else if ( task.error.isEmpty() )
+          task.error = QObject::tr( "Could not convert a geometry to GEOS" );
+      }
+
+      if ( !task.leaf )
+      {
+        for ( int i = task.first; i < task.first + task.count; ++i )
+        {
+          delete state->pieces[i];
+          state->pieces[i] = nullptr;
+        }
+      }
+
+      if ( !parts.isEmpty() )
+      {
+        GEOSGeometry* collection = nullptr;
+        GEOSGeometry* merged = nullptr;
+        try
+        {
+          // the collection takes ownership of the parts
+          collection = GEOSGeom_createCollection_r( ctxt, GEOS_GEOMETRYCOLLECTION, parts.data(), parts.size() );
+          if ( mOperation == QgsGeometryUnionEngine::ConvexHull )
+            merged = GEOSConvexHull_r( ctxt, collection );
+          else
+            merged = GEOSUnaryUnion_r( ctxt, collection );
+
+          if ( merged )
+            state->next[ task.slot ] = QgsGeos::fromGeos( ctxt, merged );
+        }
+        catch ( GEOSException &e )
+        {
+          task.error = e.what();
+        }
+
+        GEOSGeom_destroy_r( ctxt, merged );
+        if ( collection )
+        {
+          GEOSGeom_destroy_r( ctxt, collection );
+        }
+        else
+        {
+          // the parts were not taken over by a collection
+          Q_FOREACH ( GEOSGeometry* part, parts )
+            GEOSGeom_destroy_r( ctxt, part );
+        }
+      }
+
+      QgsGeos::destroyGEOSHandler( ctxt );
+    }
+
+  private:
+    QgsGeometryUnionEngine::Operation mOperation;
+    double mPrecision;
+};
+
+//! Interleaves the bits of two 16 bit values
+static quint32 mortonCode( quint32 x, quint32 y )
+{
+  x = ( x | ( x << 8 ) ) & 0x00FF00FF;
+  x = ( x | ( x << 4 ) ) & 0x0F0F0F0F;
+  x = ( x | ( x << 2 ) ) & 0x33333333;
+  x = ( x | ( x << 1 ) ) & 0x55555555;
+  y = ( y | ( y << 8 ) ) & 0x00FF00FF;
+  y = ( y | ( y << 4 ) ) & 0x0F0F0F0F;
+  y = ( y | ( y << 2 ) ) & 0x33333333;
+  y = ( y | ( y << 1 ) ) & 0x55555555;
+  return x | ( y << 1 );
+}
+
+struct QgsGeometryUnionSortItem
+{
+  quint32 code;
+  const QgsAbstractGeometryV2* geometry;
+
+  bool operator<( const QgsGeometryUnionSortItem& other ) const { return code < other.code; }
+};
+
+//! Orders geometries along a Z-order curve through their bounding box centers
+static QVector<const QgsAbstractGeometryV2*> spatiallySorted( const QList<const QgsAbstractGeometryV2*>& geometries )
+{
+  QVector<QgsRectangle> boxes;
+  boxes.reserve( geometries.size() );
+  QgsRectangle extent;
+  extent.setMinimal();
+  Q_FOREACH ( const QgsAbstractGeometryV2* g, geometries )
+  {
+    boxes << g->boundingBox();
+    extent.combineExtentWith( boxes.last() );
+  }
+
+  double scaleX = extent.width() > 0 ? 65535.0 / extent.width() : 0.0;
+  double scaleY = extent.height() > 0 ? 65535.0 / extent.height() : 0.0;
+
+  QVector<QgsGeometryUnionSortItem> items;
+  items.reserve( geometries.size() );
+  for ( int i = 0; i < geometries.size(); ++i )
+  {
+    QgsPoint center = boxes.at( i ).center();
+    quint32 x = static_cast< quint32 >( qBound( 0.0, ( center.x() - extent.xMinimum() ) * scaleX, 65535.0 ) );
+    quint32 y = static_cast< quint32 >( qBound( 0.0, ( center.y() - extent.yMinimum() ) * scaleY, 65535.0 ) );
+    QgsGeometryUnionSortItem item = { mortonCode( x, y ), geometries.at( i ) };
+    items << item;
+  }
+  qStableSort( items.begin(), items.end() );
+
+  QVector<const QgsAbstractGeometryV2*> ordered;
+  ordered.reserve( items.size() );
+  Q_FOREACH ( const QgsGeometryUnionSortItem& item, items )
+    ordered << item.geometry;
+  return ordered;
+}
+
+///@endcond
+
+QgsGeometryUnionEngine::QgsGeometryUnionEngine( Operation operation, double precision )
+    : mOperation( operation )
+    , mPrecision( precision )
+    , mBatchSize( 32 )
+    , mParallel( true )
+{
+}
+
+QgsGeometryUnionEngine::~QgsGeometryUnionEngine()
+{
+  clear();
+}
+
+void QgsGeometryUnionEngine::addGeometry( const QString& key, QgsAbstractGeometryV2* geometry )
+{
+  if ( !geometry )
+    return;
+
+  mGroups[ key ].geometries << geometry;
+}
+
+void QgsGeometryUnionEngine::addGeometry( const QString& key, const QgsGeometry& geometry )
+{
+  if ( !geometry.geometry() || geometry.geometry()->isEmpty() )
+    return;
+
+  addGeometry( key, geometry.geometry()->clone() );
+}
+
+int QgsGeometryUnionEngine::geometryCount( const QString& key ) const
+{
+  QMap<QString, Group>::const_iterator it = mGroups.constFind( key );
+  return it == mGroups.constEnd() ? 0 : it->geometries.size();
+}
+
+bool QgsGeometryUnionEngine::run( QString* errorMsg )
+{
+  QList<Group*> groups;
+  QMap<QString, Group>::iterator it = mGroups.begin();
+  for ( ; it != mGroups.end(); ++it )
+    groups << &it.value();
+
+  bool ok = runGroups( groups );
+
+  if ( !ok && errorMsg )
+  {
+    QStringList errors;
+    for ( it = mGroups.begin(); it != mGroups.end(); ++it )
+    {
+      if ( !it->error.isEmpty() )
+        errors << QString( "%1: %2" ).arg( it.key(), it->error );
+    }
+    *errorMsg = errors.join( "\n" );
+  }
+  return ok;
+}
+
+const QgsAbstractGeometryV2* QgsGeometryUnionEngine::result( const QString& key ) const
+{
+  QMap<QString, Group>::const_iterator it = mGroups.constFind( key );
+  return it == mGroups.constEnd() ? nullptr : it->result;
+}
+
+QgsAbstractGeometryV2* QgsGeometryUnionEngine::takeResult( const QString& key )
+{
+  QMap<QString, Group>::iterator it = mGroups.find( key );
+  if ( it == mGroups.end() )
+    return nullptr;
+
+  QgsAbstractGeometryV2* geometry = it->result;
+  it->result = nullptr;
+  return geometry;
+}
+
+void QgsGeometryUnionEngine::clear()
+{
+  QMap<QString, Group>::iterator it = mGroups.begin();
+  for ( ; it != mGroups.end(); ++it )
+  {
+    qDeleteAll( it->geometries );
+    delete it->result;
+  }
+  mGroups.clear();
+}
+
+QgsAbstractGeometryV2* QgsGeometryUnionEngine::unionGeometries( const QList<QgsAbstractGeometryV2*>& geometries, double precision, QString* errorMsg )
+{
+  Group group;
+  Q_FOREACH ( const QgsAbstractGeometryV2* g, geometries )
+  {
+    if ( g )
+      group.geometries << g;
+  }
+
+  QgsGeometryUnionEngine engine( Union, precision );
+  QList<Group*> groups;
+  groups << &group;
+  if ( !engine.runGroups( groups ) && errorMsg )
+    *errorMsg = group.error;
+
+  // the input geometries are not owned by the group
+  return group.result;
+}
+
+bool QgsGeometryUnionEngine::runGroups( const QList<Group*>& groups ) const
+{
+  QVector<QgsGeometryUnionGroupState> states( groups.size() );
+  QList<QgsGeometryUnionTask> tasks;
+
+  // lowest level: batches of spatially adjacent input geometries
+  for ( int i = 0; i < groups.size(); ++i )
+  {
+    Group* group = groups.at( i );
+    delete group->result;
+    group->result = nullptr;
+    group->error.clear();
+
+    QgsGeometryUnionGroupState& state = states[i];
+    state.ordered = spatiallySorted( group->geometries );
+    int batches = ( state.ordered.size() + mBatchSize - 1 ) / mBatchSize;
+    state.next.fill( nullptr, batches );
+    for ( int b = 0; b < batches; ++b )
+    {
+      QgsGeometryUnionTask task = { &state, true, b * mBatchSize, qMin( mBatchSize, state.ordered.size() - b * mBatchSize ), b, QString() };
+      tasks << task;
+    }
+  }
+
+  QgsGeometryUnionWorker worker( mOperation, mPrecision );
+  bool parallel = mParallel && QThread::idealThreadCount() > 1;
+  while ( !tasks.isEmpty() )
+  {
+    if ( parallel && tasks.size() > 1 )
+    {
+      QtConcurrent::blockingMap( tasks, worker );
+    }
+    else
+    {
+      for ( int i = 0; i < tasks.size(); ++i )
+        worker( tasks[i] );
+    }
+
+    Q_FOREACH ( const QgsGeometryUnionTask& task, tasks )
+    {
+      if ( !task.error.isEmpty() && task.state->error.isEmpty() )
+        task.state->error = task.error;
+    }
+
+    // next level: merge the partial results in groups of MERGE_FAN_IN
+    tasks.clear();
+    for ( int i = 0; i < states.size(); ++i )
+    {
+      QgsGeometryUnionGroupState& state = states[i];
+      state.pieces = state.next;
+      if ( state.pieces.size() < 2 )
+        continue;
+
+      int merges = ( state.pieces.size() + MERGE_FAN_IN - 1 ) / MERGE_FAN_IN;
+      state.next.fill( nullptr, merges );
+      for ( int m = 0; m < merges; ++m )
+      {
+        QgsGeometryUnionTask task = { &state, false, m * MERGE_FAN_IN, qMin( MERGE_FAN_IN, state.pieces.size() - m * MERGE_FAN_IN ), m, QString() };
+        tasks << task;
+      }
+    }
+  }
+
+  bool ok = true;
+  for ( int i = 0; i < groups.size(); ++i )
+  {
+    Group* group = groups.at( i );
+    QgsGeometryUnionGroupState& state = states[i];
+    group->result = state.pieces.isEmpty() ? nullptr : state.pieces.at( 0 );
+
+    // a failed merge drops a part of the group, so the result is not complete
+    group->error = state.error;
+    if ( !group->result && group->error.isEmpty() && !group->geometries.isEmpty() )
+      group->error = QObject::tr( "Could not merge geometries" );
+    if ( !group->error.isEmpty() )
+    {
+      QgsDebugMsg( QString( "Union failed: %1" ).arg( group->error ) );
+      delete group->result;
+      group->result = nullptr;
+      ok = false;
+    }
+  }
+  return ok;
+}
@@ -0,0 +1,162 @@
+/***************************************************************************
+                         qgsgeometryunionengine.h
+                         ------------------------
+    begin                : October 2018
+    copyright            : (C) 2018 by NextGIS
+    email                : info at nextgis dot com
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#ifndef QGSGEOMETRYUNIONENGINE_H
+#define QGSGEOMETRYUNIONENGINE_H
+
+#include <QList>
+#include <QMap>
+#include <QString>
+#include <QStringList>
+
+class QgsAbstractGeometryV2;
+class QgsGeometry;
+
+/** \ingroup core
+ * \class QgsGeometryUnionEngine
+ * \brief Merges groups of geometries with a cascaded union.
+ *
+ * Geometries are collected per dissolve key with addGeometry(). run() then computes
+ * the union (or the convex hull) of every group. Instead of folding the geometries
+ * one by one into a growing result, which is quadratic in the number of geometries,
+ * each group is sorted along a space filling curve, split into batches of
+ * neighbouring geometries and reduced as a tree: the batches are merged first and the
+ * partial results are merged level by level until one geometry is left.
+ *
+ * All merges of one tree level, of all groups, are independent and are run on the
+ * global thread pool, so both a single large group and many small groups make use of
+ * all cores. Every merge creates and destroys its GEOS geometries with a GEOS context handle
+ * of its own, partial results are passed between merges as QGIS geometries.
+ *
+ * \note added in QGIS 2.18
+ */
+class CORE_EXPORT QgsGeometryUnionEngine
+{
+  public:
+
+    //! Operation performed on every group of geometries
+    enum Operation
+    {
+      Union, //!< Union of the geometries
+      ConvexHull, //!< Convex hull of the geometries
+    };
+
+    /** Constructor for QgsGeometryUnionEngine.
+     * @param operation operation performed on every group
+     * @param precision precision of the grid to which vertices are snapped. If 0, no snapping is performed.
+     */
+    explicit QgsGeometryUnionEngine( Operation operation = Union, double precision = 0.0 );
+
+    ~QgsGeometryUnionEngine();
+
+    //! Returns the operation performed on every group
+    Operation operation() const { return mOperation; }
+
+    /** Adds a geometry to the group of a dissolve key. Ownership of the geometry is transferred
+     * to the engine. Null geometries are ignored.
+     */
+    void addGeometry( const QString& key, QgsAbstractGeometryV2* geometry );
+
+    /** Adds a copy of a geometry to the group of a dissolve key. Empty geometries are ignored.
+     */
+    void addGeometry( const QString& key, const QgsGeometry& geometry );
+
+    //! Returns the dissolve keys of all groups, in ascending order
+    QStringList keys() const { return mGroups.keys(); }
+
+    //! Returns the number of geometries collected for a dissolve key
+    int geometryCount( const QString& key ) const;
+
+    //! Returns true if no geometries have been collected
+    bool isEmpty() const { return mGroups.isEmpty(); }
+
+    /** Sets the number of spatially adjacent geometries which are merged at once at the
+     * lowest level of the union tree.
+     * @see batchSize()
+     */
+    void setBatchSize( int size ) { mBatchSize = qMax( 2, size ); }
+
+    /** Returns the number of spatially adjacent geometries which are merged at once at the
+     * lowest level of the union tree.
+     * @see setBatchSize()
+     */
+    int batchSize() const { return mBatchSize; }
+
+    /** Sets whether the merges are run on several threads.
+     * @see isParallelEnabled()
+     */
+    void setParallelEnabled( bool enabled ) { mParallel = enabled; }
+
+    /** Returns whether the merges are run on several threads.
+     * @see setParallelEnabled()
+     */
+    bool isParallelEnabled() const { return mParallel; }
+
+    /** Computes the result of every group. The collected input geometries are kept, so the
+     * engine can be run again, e.g. after adding more geometries.
+     * @param errorMsg if specified, receives the errors of the groups which failed
+     * @returns true if the result of every group could be computed
+     */
+    bool run( QString* errorMsg = nullptr );
+
+    /** Returns the result computed by run() for a dissolve key, or null if there is no
+     * result. The engine keeps ownership.
+     * @see takeResult()
+     */
+    const QgsAbstractGeometryV2* result( const QString& key ) const;
+
+    /** Removes the result computed by run() for a dissolve key and returns it, or null if
+     * there is no result. Ownership is transferred to the caller.
+     * @see result()
+     */
+    QgsAbstractGeometryV2* takeResult( const QString& key );
+
+    //! Removes all collected geometries and results
+    void clear();
+
+    /** Computes the cascaded union of a list of geometries.
+     * @param geometries geometries to merge. Ownership is not transferred.
+     * @param precision precision of the grid to which vertices are snapped. If 0, no snapping is performed.
+     * @param errorMsg if specified, receives an error message if the union failed
+     * @returns union of the geometries, or null if the union failed. Ownership is transferred to the caller.
+     */
+    static QgsAbstractGeometryV2* unionGeometries( const QList<QgsAbstractGeometryV2*>& geometries, double precision = 0.0, QString* errorMsg = nullptr );
+
+  private:
+
+    struct Group
+    {
+      Group() : result( nullptr ) {}
+      QList<const QgsAbstractGeometryV2*> geometries;
+      QgsAbstractGeometryV2* result;
+      QString error;
+    };
+
+    Operation mOperation;
+    double mPrecision;
+    int mBatchSize;
+    bool mParallel;
+    QMap<QString, Group> mGroups;
+
+    //! Computes the results of groups, returns false if any group failed
+    bool runGroups( const QList<Group*>& groups ) const;
+
+    QgsGeometryUnionEngine( const QgsGeometryUnionEngine& rh );
+    QgsGeometryUnionEngine& operator=( const QgsGeometryUnionEngine& rh );
+};
+
+#endif // QGSGEOMETRYUNIONENGINE_H
@@ -206,7 +206,7 @@ QgsAbstractGeometryV2* QgsGeos::combine( const QList<QgsAbstractGeometryV2*>& ge
   GEOSGeometry* geomUnion = nullptr;
   try
   {
-    GEOSGeometry* geomCollection =  createGeosCollection( GEOS_GEOMETRYCOLLECTION, geosGeometries );
+    GEOSGeometry* geomCollection =  createGeosCollection( geosinit.ctxt, GEOS_GEOMETRYCOLLECTION, geosGeometries );
     geomUnion = GEOSUnaryUnion_r( geosinit.ctxt, geomCollection );
     GEOSGeom_destroy_r( geosinit.ctxt, geomCollection );
   }
@@ -412,12 +412,12 @@ int QgsGeos::splitGeometry( const QgsLineStringV2& splitLine,
   {
     if ( splitLine.numPoints() > 1 )
     {
-      splitLineGeos = createGeosLinestring( &splitLine, mPrecision );
+      splitLineGeos = createGeosLinestring( geosinit.ctxt, &splitLine, mPrecision );
     }
     else if ( splitLine.numPoints() == 1 )
     {
       QgsPointV2  pt = splitLine.pointN( 0 );
-      splitLineGeos = createGeosPoint( &pt, 2, mPrecision );
+      splitLineGeos = createGeosPoint( geosinit.ctxt, &pt, 2, mPrecision );
     }
     else
     {
@@ -801,9 +801,9 @@ int QgsGeos::mergeGeometriesMultiTypeSplit( QVector<GEOSGeometry*>& splitResult
       geomVector << copyList[i];
 
       if ( type == GEOS_MULTILINESTRING )
-        splitResult << createGeosCollection( GEOS_MULTILINESTRING, geomVector );
+        splitResult << createGeosCollection( geosinit.ctxt, GEOS_MULTILINESTRING, geomVector );
       else if ( type == GEOS_MULTIPOLYGON )
-        splitResult << createGeosCollection( GEOS_MULTIPOLYGON, geomVector );
+        splitResult << createGeosCollection( geosinit.ctxt, GEOS_MULTIPOLYGON, geomVector );
       else
         GEOSGeom_destroy_r( geosinit.ctxt, copyList[i] );
     }
@@ -813,9 +813,9 @@ int QgsGeos::mergeGeometriesMultiTypeSplit( QVector<GEOSGeometry*>& splitResult
   if ( !unionGeom.isEmpty() )
   {
     if ( type == GEOS_MULTILINESTRING )
-      splitResult << createGeosCollection( GEOS_MULTILINESTRING, unionGeom );
+      splitResult << createGeosCollection( geosinit.ctxt, GEOS_MULTILINESTRING, unionGeom );
     else if ( type == GEOS_MULTIPOLYGON )
-      splitResult << createGeosCollection( GEOS_MULTIPOLYGON, unionGeom );
+      splitResult << createGeosCollection( geosinit.ctxt, GEOS_MULTIPOLYGON, unionGeom );
   }
   else
   {
@@ -825,7 +825,7 @@ int QgsGeos::mergeGeometriesMultiTypeSplit( QVector<GEOSGeometry*>& splitResult
   return 0;
 }
 
-GEOSGeometry* QgsGeos::createGeosCollection( int typeId, const QVector<GEOSGeometry*>& geoms )
+GEOSGeometry* QgsGeos::createGeosCollection( GEOSContextHandle_t ctxt, int typeId, const QVector<GEOSGeometry*>& geoms )
 {
   int nNullGeoms = geoms.count( nullptr );
   int nNotNullGeoms = geoms.size() - nNullGeoms;
@@ -850,7 +850,7 @@ GEOSGeometry* QgsGeos::createGeosCollection( int typeId, const QVector<GEOSGeome
 
   try
   {
-    geom = GEOSGeom_createCollection_r( geosinit.ctxt, typeId, geomarr, nNotNullGeoms );
+    geom = GEOSGeom_createCollection_r( ctxt, typeId, geomarr, nNotNullGeoms );
   }
   catch ( GEOSException &e )
   {
@@ -863,42 +863,47 @@ GEOSGeometry* QgsGeos::createGeosCollection( int typeId, const QVector<GEOSGeome
 }
 
 QgsAbstractGeometryV2* QgsGeos::fromGeos( const GEOSGeometry* geos )
+{
+  return fromGeos( geosinit.ctxt, geos );
+}
+
+QgsAbstractGeometryV2* QgsGeos::fromGeos( GEOSContextHandle_t ctxt, const GEOSGeometry* geos )
 {
   if ( !geos )
   {
     return nullptr;
   }
 
-  int nCoordDims = GEOSGeom_getCoordinateDimension_r( geosinit.ctxt, geos );
-  int nDims = GEOSGeom_getDimensions_r( geosinit.ctxt, geos );
+  int nCoordDims = GEOSGeom_getCoordinateDimension_r( ctxt, geos );
+  int nDims = GEOSGeom_getDimensions_r( ctxt, geos );
   bool hasZ = ( nCoordDims == 3 );
   bool hasM = (( nDims - nCoordDims ) == 1 );
 
-  switch ( GEOSGeomTypeId_r( geosinit.ctxt, geos ) )
+  switch ( GEOSGeomTypeId_r( ctxt, geos ) )
   {
     case GEOS_POINT:                 // a point
     {
-      const GEOSCoordSequence* cs = GEOSGeom_getCoordSeq_r( geosinit.ctxt, geos );
-      return ( coordSeqPoint( cs, 0, hasZ, hasM ).clone() );
+      const GEOSCoordSequence* cs = GEOSGeom_getCoordSeq_r( ctxt, geos );
+      return ( coordSeqPoint( ctxt, cs, 0, hasZ, hasM ).clone() );
     }
     case GEOS_LINESTRING:
     {
-      return sequenceToLinestring( geos, hasZ, hasM );
+      return sequenceToLinestring( ctxt, geos, hasZ, hasM );
     }
     case GEOS_POLYGON:
     {
-      return fromGeosPolygon( geos );
+      return fromGeosPolygon( ctxt, geos );
     }
     case GEOS_MULTIPOINT:
     {
       QgsMultiPointV2* multiPoint = new QgsMultiPointV2();
-      int nParts = GEOSGetNumGeometries_r( geosinit.ctxt, geos );
+      int nParts = GEOSGetNumGeometries_r( ctxt, geos );
       for ( int i = 0; i < nParts; ++i )
       {
-        const GEOSCoordSequence* cs = GEOSGeom_getCoordSeq_r( geosinit.ctxt, GEOSGetGeometryN_r( geosinit.ctxt, geos, i ) );
+        const GEOSCoordSequence* cs = GEOSGeom_getCoordSeq_r( ctxt, GEOSGetGeometryN_r( ctxt, geos, i ) );
         if ( cs )
         {
-          multiPoint->addGeometry( coordSeqPoint( cs, 0, hasZ, hasM ).clone() );
+          multiPoint->addGeometry( coordSeqPoint( ctxt, cs, 0, hasZ, hasM ).clone() );
         }
       }
       return multiPoint;
@@ -906,10 +911,10 @@ QgsAbstractGeometryV2* QgsGeos::fromGeos( const GEOSGeometry* geos )
     case GEOS_MULTILINESTRING:
     {
       QgsMultiLineStringV2* multiLineString = new QgsMultiLineStringV2();
-      int nParts = GEOSGetNumGeometries_r( geosinit.ctxt, geos );
+      int nParts = GEOSGetNumGeometries_r( ctxt, geos );
       for ( int i = 0; i < nParts; ++i )
       {
-        QgsLineStringV2* line = sequenceToLinestring( GEOSGetGeometryN_r( geosinit.ctxt, geos, i ), hasZ, hasM );
+        QgsLineStringV2* line = sequenceToLinestring( ctxt, GEOSGetGeometryN_r( ctxt, geos, i ), hasZ, hasM );
         if ( line )
         {
           multiLineString->addGeometry( line );
@@ -921,10 +926,10 @@ QgsAbstractGeometryV2* QgsGeos::fromGeos( const GEOSGeometry* geos )
     {
       QgsMultiPolygonV2* multiPolygon = new QgsMultiPolygonV2();
 
-      int nParts = GEOSGetNumGeometries_r( geosinit.ctxt, geos );
+      int nParts = GEOSGetNumGeometries_r( ctxt, geos );
       for ( int i = 0; i < nParts; ++i )
       {
-        QgsPolygonV2* poly = fromGeosPolygon( GEOSGetGeometryN_r( geosinit.ctxt, geos, i ) );
+        QgsPolygonV2* poly = fromGeosPolygon( ctxt, GEOSGetGeometryN_r( ctxt, geos, i ) );
         if ( poly )
         {
           multiPolygon->addGeometry( poly );
@@ -935,10 +940,10 @@ QgsAbstractGeometryV2* QgsGeos::fromGeos( const GEOSGeometry* geos )
     case GEOS_GEOMETRYCOLLECTION:
     {
       QgsGeometryCollectionV2* geomCollection = new QgsGeometryCollectionV2();
-      int nParts = GEOSGetNumGeometries_r( geosinit.ctxt, geos );
+      int nParts = GEOSGetNumGeometries_r( ctxt, geos );
       for ( int i = 0; i < nParts; ++i )
       {
-        QgsAbstractGeometryV2* geom = fromGeos( GEOSGetGeometryN_r( geosinit.ctxt, geos, i ) );
+        QgsAbstractGeometryV2* geom = fromGeos( ctxt, GEOSGetGeometryN_r( ctxt, geos, i ) );
         if ( geom )
         {
           geomCollection->addGeometry( geom );
@@ -952,31 +957,36 @@ QgsAbstractGeometryV2* QgsGeos::fromGeos( const GEOSGeometry* geos )
 
 QgsPolygonV2* QgsGeos::fromGeosPolygon( const GEOSGeometry* geos )
 {
-  if ( GEOSGeomTypeId_r( geosinit.ctxt, geos ) != GEOS_POLYGON )
+  return fromGeosPolygon( geosinit.ctxt, geos );
+}
+
+QgsPolygonV2* QgsGeos::fromGeosPolygon( GEOSContextHandle_t ctxt, const GEOSGeometry* geos )
+{
+  if ( GEOSGeomTypeId_r( ctxt, geos ) != GEOS_POLYGON )
   {
     return nullptr;
   }
 
-  int nCoordDims = GEOSGeom_getCoordinateDimension_r( geosinit.ctxt, geos );
-  int nDims = GEOSGeom_getDimensions_r( geosinit.ctxt, geos );
+  int nCoordDims = GEOSGeom_getCoordinateDimension_r( ctxt, geos );
+  int nDims = GEOSGeom_getDimensions_r( ctxt, geos );
   bool hasZ = ( nCoordDims == 3 );
   bool hasM = (( nDims - nCoordDims ) == 1 );
 
   QgsPolygonV2* polygon = new QgsPolygonV2();
 
-  const GEOSGeometry* ring = GEOSGetExteriorRing_r( geosinit.ctxt, geos );
+  const GEOSGeometry* ring = GEOSGetExteriorRing_r( ctxt, geos );
   if ( ring )
   {
-    polygon->setExteriorRing( sequenceToLinestring( ring, hasZ, hasM ) );
+    polygon->setExteriorRing( sequenceToLinestring( ctxt, ring, hasZ, hasM ) );
   }
 
   QList<QgsCurveV2*> interiorRings;
-  for ( int i = 0; i < GEOSGetNumInteriorRings_r( geosinit.ctxt, geos ); ++i )
+  for ( int i = 0; i < GEOSGetNumInteriorRings_r( ctxt, geos ); ++i )
   {
-    ring = GEOSGetInteriorRingN_r( geosinit.ctxt, geos, i );
+    ring = GEOSGetInteriorRingN_r( ctxt, geos, i );
     if ( ring )
     {
-      interiorRings.push_back( sequenceToLinestring( ring, hasZ, hasM ) );
+      interiorRings.push_back( sequenceToLinestring( ctxt, ring, hasZ, hasM ) );
     }
   }
   polygon->setInteriorRings( interiorRings );
@@ -984,16 +994,16 @@ QgsPolygonV2* QgsGeos::fromGeosPolygon( const GEOSGeometry* geos )
   return polygon;
 }
 
-QgsLineStringV2* QgsGeos::sequenceToLinestring( const GEOSGeometry* geos, bool hasZ, bool hasM )
+QgsLineStringV2* QgsGeos::sequenceToLinestring( GEOSContextHandle_t ctxt, const GEOSGeometry* geos, bool hasZ, bool hasM )
 {
   QgsPointSequenceV2 pts;
-  const GEOSCoordSequence* cs = GEOSGeom_getCoordSeq_r( geosinit.ctxt, geos );
+  const GEOSCoordSequence* cs = GEOSGeom_getCoordSeq_r( ctxt, geos );
   unsigned int nPoints;
-  GEOSCoordSeq_getSize_r( geosinit.ctxt, cs, &nPoints );
+  GEOSCoordSeq_getSize_r( ctxt, cs, &nPoints );
   pts.reserve( nPoints );
   for ( unsigned int i = 0; i < nPoints; ++i )
   {
-    pts.push_back( coordSeqPoint( cs, i, hasZ, hasM ) );
+    pts.push_back( coordSeqPoint( ctxt, cs, i, hasZ, hasM ) );
   }
   QgsLineStringV2* line = new QgsLineStringV2();
   line->setPoints( pts );
@@ -1015,6 +1025,11 @@ int QgsGeos::numberOfGeometries( GEOSGeometry* g )
 }
 
 QgsPointV2 QgsGeos::coordSeqPoint( const GEOSCoordSequence* cs, int i, bool hasZ, bool hasM )
+{
+  return coordSeqPoint( geosinit.ctxt, cs, i, hasZ, hasM );
+}
+
+QgsPointV2 QgsGeos::coordSeqPoint( GEOSContextHandle_t ctxt, const GEOSCoordSequence* cs, int i, bool hasZ, bool hasM )
 {
   if ( !cs )
   {
@@ -1024,15 +1039,15 @@ QgsPointV2 QgsGeos::coordSeqPoint( const GEOSCoordSequence* cs, int i, bool hasZ
   double x, y;
   double z = 0;
   double m = 0;
-  GEOSCoordSeq_getX_r( geosinit.ctxt, cs, i, &x );
-  GEOSCoordSeq_getY_r( geosinit.ctxt, cs, i, &y );
+  GEOSCoordSeq_getX_r( ctxt, cs, i, &x );
+  GEOSCoordSeq_getY_r( ctxt, cs, i, &y );
   if ( hasZ )
   {
-    GEOSCoordSeq_getZ_r( geosinit.ctxt, cs, i, &z );
+    GEOSCoordSeq_getZ_r( ctxt, cs, i, &z );
   }
   if ( hasM )
   {
-    GEOSCoordSeq_getOrdinate_r( geosinit.ctxt, cs, i, 3, &m );
+    GEOSCoordSeq_getOrdinate_r( ctxt, cs, i, 3, &m );
   }
 
   QgsWKBTypes::Type t = QgsWKBTypes::Point;
@@ -1052,6 +1067,11 @@ QgsPointV2 QgsGeos::coordSeqPoint( const GEOSCoordSequence* cs, int i, bool hasZ
 }
 
 GEOSGeometry* QgsGeos::asGeos( const QgsAbstractGeometryV2* geom, double precision )
+{
+  return asGeos( geosinit.ctxt, geom, precision );
+}
+
+GEOSGeometry* QgsGeos::asGeos( GEOSContextHandle_t ctxt, const QgsAbstractGeometryV2* geom, double precision )
 {
   int coordDims = 2;
   if ( geom->is3D() )
@@ -1100,24 +1120,24 @@ GEOSGeometry* QgsGeos::asGeos( const QgsAbstractGeometryV2* geom, double precisi
     QVector< GEOSGeometry* > geomVector( c->numGeometries() );
     for ( int i = 0; i < c->numGeometries(); ++i )
     {
-      geomVector[i] = asGeos( c->geometryN( i ), precision );
+      geomVector[i] = asGeos( ctxt, c->geometryN( i ), precision );
     }
-    return createGeosCollection( geosType, geomVector );
+    return createGeosCollection( ctxt, geosType, geomVector );
   }
   else
   {
     switch ( QgsWKBTypes::geometryType( geom->wkbType() ) )
     {
       case QgsWKBTypes::PointGeometry:
-        return createGeosPoint( static_cast<const QgsPointV2*>( geom ), coordDims, precision );
+        return createGeosPoint( ctxt, static_cast<const QgsPointV2*>( geom ), coordDims, precision );
         break;
 
       case QgsWKBTypes::LineGeometry:
-        return createGeosLinestring( static_cast<const QgsLineStringV2*>( geom ), precision );
+        return createGeosLinestring( ctxt, static_cast<const QgsLineStringV2*>( geom ), precision );
         break;
 
       case QgsWKBTypes::PolygonGeometry:
-        return createGeosPolygon( static_cast<const QgsPolygonV2*>( geom ), precision );
+        return createGeosPolygon( ctxt, static_cast<const QgsPolygonV2*>( geom ), precision );
         break;
 
       case QgsWKBTypes::UnknownGeometry:
@@ -1479,7 +1499,7 @@ bool QgsGeos::isEmpty( QString* errorMsg ) const
   CATCH_GEOS_WITH_ERRMSG( false );
 }
 
-GEOSCoordSequence* QgsGeos::createCoordinateSequence( const QgsCurveV2* curve, double precision, bool forceClose )
+GEOSCoordSequence* QgsGeos::createCoordinateSequence( GEOSContextHandle_t ctxt, const QgsCurveV2* curve, double precision, bool forceClose )
 {
   bool segmentize = false;
   const QgsLineStringV2* line = dynamic_cast<const QgsLineStringV2*>( curve );
@@ -1518,7 +1538,7 @@ GEOSCoordSequence* QgsGeos::createCoordinateSequence( const QgsCurveV2* curve, d
   GEOSCoordSequence* coordSeq = nullptr;
   try
   {
-    coordSeq = GEOSCoordSeq_create_r( geosinit.ctxt, numOutPoints, coordDims );
+    coordSeq = GEOSCoordSeq_create_r( ctxt, numOutPoints, coordDims );
     if ( !coordSeq )
     {
       QgsMessageLog::logMessage( QObject::tr( "Could not create coordinate sequence for %1 points in %2 dimensions" ).arg( numPoints ).arg( coordDims ), QObject::tr( "GEOS" ) );
@@ -1529,15 +1549,15 @@ GEOSCoordSequence* QgsGeos::createCoordinateSequence( const QgsCurveV2* curve, d
       for ( int i = 0; i < numOutPoints; ++i )
       {
         const QgsPointV2 &pt = line->pointN( i % numPoints ); //todo: create method to get const point reference
-        GEOSCoordSeq_setX_r( geosinit.ctxt, coordSeq, i, qgsRound( pt.x() / precision ) * precision );
-        GEOSCoordSeq_setY_r( geosinit.ctxt, coordSeq, i, qgsRound( pt.y() / precision ) * precision );
+        GEOSCoordSeq_setX_r( ctxt, coordSeq, i, qgsRound( pt.x() / precision ) * precision );
+        GEOSCoordSeq_setY_r( ctxt, coordSeq, i, qgsRound( pt.y() / precision ) * precision );
         if ( hasZ )
         {
-          GEOSCoordSeq_setOrdinate_r( geosinit.ctxt, coordSeq, i, 2, qgsRound( pt.z() / precision ) * precision );
+          GEOSCoordSeq_setOrdinate_r( ctxt, coordSeq, i, 2, qgsRound( pt.z() / precision ) * precision );
         }
         if ( hasM )
         {
-          GEOSCoordSeq_setOrdinate_r( geosinit.ctxt, coordSeq, i, 3, pt.m() );
+          GEOSCoordSeq_setOrdinate_r( ctxt, coordSeq, i, 3, pt.m() );
         }
       }
     }
@@ -1546,15 +1566,15 @@ GEOSCoordSequence* QgsGeos::createCoordinateSequence( const QgsCurveV2* curve, d
       for ( int i = 0; i < numOutPoints; ++i )
       {
         const QgsPointV2 &pt = line->pointN( i % numPoints ); //todo: create method to get const point reference
-        GEOSCoordSeq_setX_r( geosinit.ctxt, coordSeq, i, pt.x() );
-        GEOSCoordSeq_setY_r( geosinit.ctxt, coordSeq, i, pt.y() );
+        GEOSCoordSeq_setX_r( ctxt, coordSeq, i, pt.x() );
+        GEOSCoordSeq_setY_r( ctxt, coordSeq, i, pt.y() );
         if ( hasZ )
         {
-          GEOSCoordSeq_setOrdinate_r( geosinit.ctxt, coordSeq, i, 2, pt.z() );
+          GEOSCoordSeq_setOrdinate_r( ctxt, coordSeq, i, 2, pt.z() );
         }
         if ( hasM )
         {
-          GEOSCoordSeq_setOrdinate_r( geosinit.ctxt, coordSeq, i, 3, pt.m() );
+          GEOSCoordSeq_setOrdinate_r( ctxt, coordSeq, i, 3, pt.m() );
         }
       }
     }
@@ -1568,7 +1588,7 @@ GEOSCoordSequence* QgsGeos::createCoordinateSequence( const QgsCurveV2* curve, d
   return coordSeq;
 }
 
-GEOSGeometry* QgsGeos::createGeosPoint( const QgsAbstractGeometryV2* point, int coordDims, double precision )
+GEOSGeometry* QgsGeos::createGeosPoint( GEOSContextHandle_t ctxt, const QgsAbstractGeometryV2* point, int coordDims, double precision )
 {
   const QgsPointV2* pt = dynamic_cast<const QgsPointV2*>( point );
   if ( !pt )
@@ -1578,7 +1598,7 @@ GEOSGeometry* QgsGeos::createGeosPoint( const QgsAbstractGeometryV2* point, int
 
   try
   {
-    GEOSCoordSequence* coordSeq = GEOSCoordSeq_create_r( geosinit.ctxt, 1, coordDims );
+    GEOSCoordSequence* coordSeq = GEOSCoordSeq_create_r( ctxt, 1, coordDims );
     if ( !coordSeq )
     {
       QgsMessageLog::logMessage( QObject::tr( "Could not create coordinate sequence for point with %1 dimensions" ).arg( coordDims ), QObject::tr( "GEOS" ) );
@@ -1586,54 +1606,54 @@ GEOSGeometry* QgsGeos::createGeosPoint( const QgsAbstractGeometryV2* point, int
     }
     if ( precision > 0. )
     {
-      GEOSCoordSeq_setX_r( geosinit.ctxt, coordSeq, 0, qgsRound( pt->x() / precision ) * precision );
-      GEOSCoordSeq_setY_r( geosinit.ctxt, coordSeq, 0, qgsRound( pt->y() / precision ) * precision );
+      GEOSCoordSeq_setX_r( ctxt, coordSeq, 0, qgsRound( pt->x() / precision ) * precision );
+      GEOSCoordSeq_setY_r( ctxt, coordSeq, 0, qgsRound( pt->y() / precision ) * precision );
       if ( pt->is3D() )
       {
-        GEOSCoordSeq_setOrdinate_r( geosinit.ctxt, coordSeq, 0, 2, qgsRound( pt->z() / precision ) * precision );
+        GEOSCoordSeq_setOrdinate_r( ctxt, coordSeq, 0, 2, qgsRound( pt->z() / precision ) * precision );
       }
     }
     else
     {
-      GEOSCoordSeq_setX_r( geosinit.ctxt, coordSeq, 0, pt->x() );
-      GEOSCoordSeq_setY_r( geosinit.ctxt, coordSeq, 0, pt->y() );
+      GEOSCoordSeq_setX_r( ctxt, coordSeq, 0, pt->x() );
+      GEOSCoordSeq_setY_r( ctxt, coordSeq, 0, pt->y() );
       if ( pt->is3D() )
       {
-        GEOSCoordSeq_setOrdinate_r( geosinit.ctxt, coordSeq, 0, 2, pt->z() );
+        GEOSCoordSeq_setOrdinate_r( ctxt, coordSeq, 0, 2, pt->z() );
       }
     }
 #if 0 //disabled until geos supports m-coordinates
     if ( pt->isMeasure() )
     {
-      GEOSCoordSeq_setOrdinate_r( geosinit.ctxt, coordSeq, 0, 3, pt->m() );
+      GEOSCoordSeq_setOrdinate_r( ctxt, coordSeq, 0, 3, pt->m() );
     }
 #endif
-    geosPoint = GEOSGeom_createPoint_r( geosinit.ctxt, coordSeq );
+    geosPoint = GEOSGeom_createPoint_r( ctxt, coordSeq );
   }
   CATCH_GEOS( nullptr )
   return geosPoint;
 }
 
-GEOSGeometry* QgsGeos::createGeosLinestring( const QgsAbstractGeometryV2* curve , double precision )
+GEOSGeometry* QgsGeos::createGeosLinestring( GEOSContextHandle_t ctxt, const QgsAbstractGeometryV2* curve , double precision )
 {
   const QgsCurveV2* c = dynamic_cast<const QgsCurveV2*>( curve );
   if ( !c )
     return nullptr;
 
-  GEOSCoordSequence* coordSeq = createCoordinateSequence( c, precision );
+  GEOSCoordSequence* coordSeq = createCoordinateSequence( ctxt, c, precision );
   if ( !coordSeq )
     return nullptr;
 
   GEOSGeometry* geosGeom = nullptr;
   try
   {
-    geosGeom = GEOSGeom_createLineString_r( geosinit.ctxt, coordSeq );
+    geosGeom = GEOSGeom_createLineString_r( ctxt, coordSeq );
   }
   CATCH_GEOS( nullptr )
   return geosGeom;
 }
 
-GEOSGeometry* QgsGeos::createGeosPolygon( const QgsAbstractGeometryV2* poly , double precision )
+GEOSGeometry* QgsGeos::createGeosPolygon( GEOSContextHandle_t ctxt, const QgsAbstractGeometryV2* poly , double precision )
 {
   const QgsCurvePolygonV2* polygon = dynamic_cast<const QgsCurvePolygonV2*>( poly );
   if ( !polygon )
@@ -1648,7 +1668,7 @@ GEOSGeometry* QgsGeos::createGeosPolygon( const QgsAbstractGeometryV2* poly , do
   GEOSGeometry* geosPolygon = nullptr;
   try
   {
-    GEOSGeometry* exteriorRingGeos = GEOSGeom_createLinearRing_r( geosinit.ctxt, createCoordinateSequence( exteriorRing, precision, true ) );
+    GEOSGeometry* exteriorRingGeos = GEOSGeom_createLinearRing_r( ctxt, createCoordinateSequence( ctxt, exteriorRing, precision, true ) );
 
 
     int nHoles = polygon->numInteriorRings();
@@ -1661,9 +1681,9 @@ GEOSGeometry* QgsGeos::createGeosPolygon( const QgsAbstractGeometryV2* poly , do
     for ( int i = 0; i < nHoles; ++i )
     {
       const QgsCurveV2* interiorRing = polygon->interiorRing( i );
-      holes[i] = GEOSGeom_createLinearRing_r( geosinit.ctxt, createCoordinateSequence( interiorRing, precision, true ) );
+      holes[i] = GEOSGeom_createLinearRing_r( ctxt, createCoordinateSequence( ctxt, interiorRing, precision, true ) );
     }
-    geosPolygon = GEOSGeom_createPolygon_r( geosinit.ctxt, exteriorRingGeos, holes, nHoles );
+    geosPolygon = GEOSGeom_createPolygon_r( ctxt, exteriorRingGeos, holes, nHoles );
     delete[] holes;
   }
   CATCH_GEOS( nullptr )
@@ -1695,7 +1715,7 @@ QgsAbstractGeometryV2* QgsGeos::reshapeGeometry( const QgsLineStringV2& reshapeW
     return nullptr;
   }
 
-  GEOSGeometry* reshapeLineGeos = createGeosLinestring( &reshapeWithLine, mPrecision );
+  GEOSGeometry* reshapeLineGeos = createGeosLinestring( geosinit.ctxt, &reshapeWithLine, mPrecision );
 
   //single or multi?
   int numGeoms = GEOSGetNumGeometries_r( geosinit.ctxt, mGeos );
@@ -2028,9 +2048,9 @@ GEOSGeometry* QgsGeos::reshapeLine( const GEOSGeometry* line, const GEOSGeometry
     return nullptr;
 
   QgsPointV2 beginPoint( x1, y1 );
-  GEOSGeometry* beginLineVertex = createGeosPoint( &beginPoint, 2, precision );
+  GEOSGeometry* beginLineVertex = createGeosPoint( geosinit.ctxt, &beginPoint, 2, precision );
   QgsPointV2 endPoint( x2, y2 );
-  GEOSGeometry* endLineVertex = createGeosPoint( &endPoint, 2, precision );
+  GEOSGeometry* endLineVertex = createGeosPoint( geosinit.ctxt, &endPoint, 2, precision );
 
   bool isRing = false;
   if ( GEOSGeomTypeId_r( geosinit.ctxt, line ) == GEOS_LINEARRING
@@ -2088,9 +2108,9 @@ GEOSGeometry* QgsGeos::reshapeLine( const GEOSGeometry* line, const GEOSGeometry
     GEOSCoordSeq_getX_r( geosinit.ctxt, currentCoordSeq, currentCoordSeqSize - 1, &xEnd );
     GEOSCoordSeq_getY_r( geosinit.ctxt, currentCoordSeq, currentCoordSeqSize - 1, &yEnd );
     QgsPointV2 beginPoint( xBegin, yBegin );
-    GEOSGeometry* beginCurrentGeomVertex = createGeosPoint( &beginPoint, 2, precision );
+    GEOSGeometry* beginCurrentGeomVertex = createGeosPoint( geosinit.ctxt, &beginPoint, 2, precision );
     QgsPointV2 endPoint( xEnd, yEnd );
-    GEOSGeometry* endCurrentGeomVertex = createGeosPoint( &endPoint, 2, precision );
+    GEOSGeometry* endCurrentGeomVertex = createGeosPoint( geosinit.ctxt, &endPoint, 2, precision );
 
     //check how many endpoints of the line merge result are on the (original) line
     int nEndpointsOnOriginalLine = 0;
@@ -2417,3 +2437,14 @@ GEOSContextHandle_t QgsGeos::getGEOSHandler()
 {
   return geosinit.ctxt;
 }
+
+GEOSContextHandle_t QgsGeos::createGEOSHandler()
+{
+  return initGEOS_r( printGEOSNotice, throwGEOSException );
+}
+
+void QgsGeos::destroyGEOSHandler( GEOSContextHandle_t handle )
+{
+  if ( handle )
+    finishGEOS_r( handle );
+}
@@ -129,8 +129,36 @@ class CORE_EXPORT QgsGeos: public QgsGeometryEngine
     static GEOSGeometry* asGeos( const QgsAbstractGeometryV2* geom , double precision = 0 );
     static QgsPointV2 coordSeqPoint( const GEOSCoordSequence* cs, int i, bool hasZ, bool hasM );
 
+    /** Creates a QgsAbstractGeometryV2 from a GEOSGeometry using a GEOS context handle,
+     * e.g. one created with createGEOSHandler() for a worker thread.
+     * @param ctxt GEOS context handle
+     * @param geos GEOSGeometry. Ownership is NOT transferred.
+     * @note added in QGIS 2.18
+     */
+    static QgsAbstractGeometryV2* fromGeos( GEOSContextHandle_t ctxt, const GEOSGeometry* geos );
+
+    /** Converts a geometry to GEOS using a GEOS context handle, e.g. one created with
+     * createGEOSHandler() for a worker thread. The geometry must be destroyed with the
+     * same handle.
+     * @note added in QGIS 2.18
+     */
+    static GEOSGeometry* asGeos( GEOSContextHandle_t ctxt, const QgsAbstractGeometryV2* geom, double precision = 0 );
+
     static GEOSContextHandle_t getGEOSHandler();
 
+    /** Creates a new GEOS context handle which reports notices and errors in the same
+     * way as the shared handle returned by getGEOSHandler(). Worker threads should use
+     * a handle of their own when evaluating predicates concurrently.
+     * The caller takes ownership and must release it with destroyGEOSHandler().
+     * @note added in QGIS 2.18
+     */
+    static GEOSContextHandle_t createGEOSHandler();
+
+    /** Releases a handle created by createGEOSHandler().
+     * @note added in QGIS 2.18
+     */
+    static void destroyGEOSHandler( GEOSContextHandle_t handle );
+
   private:
     mutable GEOSGeometry* mGeos;
     const GEOSPreparedGeometry* mGeosPrepared;
@@ -159,19 +187,21 @@ class CORE_EXPORT QgsGeos: public QgsGeometryEngine
     void cacheGeos() const;
     QgsAbstractGeometryV2* overlay( const QgsAbstractGeometryV2& geom, Overlay op, QString* errorMsg = nullptr ) const;
     bool relation( const QgsAbstractGeometryV2& geom, Relation r, QString* errorMsg = nullptr ) const;
-    static GEOSCoordSequence* createCoordinateSequence( const QgsCurveV2* curve , double precision, bool forceClose = false );
-    static QgsLineStringV2* sequenceToLinestring( const GEOSGeometry* geos, bool hasZ, bool hasM );
+    static QgsPolygonV2* fromGeosPolygon( GEOSContextHandle_t ctxt, const GEOSGeometry* geos );
+    static QgsPointV2 coordSeqPoint( GEOSContextHandle_t ctxt, const GEOSCoordSequence* cs, int i, bool hasZ, bool hasM );
+    static GEOSCoordSequence* createCoordinateSequence( GEOSContextHandle_t ctxt, const QgsCurveV2* curve , double precision, bool forceClose = false );
+    static QgsLineStringV2* sequenceToLinestring( GEOSContextHandle_t ctxt, const GEOSGeometry* geos, bool hasZ, bool hasM );
     static int numberOfGeometries( GEOSGeometry* g );
     static GEOSGeometry* nodeGeometries( const GEOSGeometry *splitLine, const GEOSGeometry *geom );
     int mergeGeometriesMultiTypeSplit( QVector<GEOSGeometry*>& splitResult ) const;
 
     /** Ownership of geoms is transferred
      */
-    static GEOSGeometry* createGeosCollection( int typeId, const QVector<GEOSGeometry*>& geoms );
+    static GEOSGeometry* createGeosCollection( GEOSContextHandle_t ctxt, int typeId, const QVector<GEOSGeometry*>& geoms );
 
-    static GEOSGeometry* createGeosPoint( const QgsAbstractGeometryV2* point, int coordDims , double precision );
-    static GEOSGeometry* createGeosLinestring( const QgsAbstractGeometryV2* curve, double precision );
-    static GEOSGeometry* createGeosPolygon( const QgsAbstractGeometryV2* poly, double precision );
+    static GEOSGeometry* createGeosPoint( GEOSContextHandle_t ctxt, const QgsAbstractGeometryV2* point, int coordDims , double precision );
+    static GEOSGeometry* createGeosLinestring( GEOSContextHandle_t ctxt, const QgsAbstractGeometryV2* curve, double precision );
+    static GEOSGeometry* createGeosPolygon( GEOSContextHandle_t ctxt, const QgsAbstractGeometryV2* poly, double precision );
 
     //utils for geometry split
     int topologicalTestPointsSplit( const GEOSGeometry* splitLine, QgsPointSequenceV2 &testPoints, QString* errorMsg = nullptr ) const;
@@ -19,6 +19,7 @@
 #include "qgsfeature.h"
 #include "qgsfeaturerequest.h"
 #include "qgsfeatureiterator.h"
+#include "qgslogger.h"
 #include "qgsvectorlayer.h"
 
 
@@ -120,6 +121,125 @@ QVariant QgsAggregateCalculator::calculate( QgsAggregateCalculator::Aggregate ag
   return calculate( aggregate, fit, resultType, attrNum, expression.data(), mDelimiter, context, ok );
 }
 
+QHash<QString, QVariant> QgsAggregateCalculator::calculateGrouped( QgsAggregateCalculator::Aggregate aggregate,
+    const QString& fieldOrExpression, const QStringList& groupByFields,
+    QgsExpressionContext* context, bool* ok, QStringList* failedGroups ) const
+{
+  if ( ok )
+    *ok = false;
+
+  QHash<QString, QVariant> results;
+  if ( !mLayer || groupByFields.isEmpty() )
+    return results;
+
+  QList<int> groupIndexes;
+  Q_FOREACH ( const QString& groupField, groupByFields )
+  {
+    int idx = mLayer->fieldNameIndex( groupField );
+    if ( idx == -1 )
+      return results;
+    groupIndexes << idx;
+  }
+
+  QScopedPointer<QgsExpression> expression;
+  QScopedPointer<QgsExpressionContext> defaultContext;
+  if ( !context )
+  {
+    defaultContext.reset( createContext() );
+    context = defaultContext.data();
+  }
+
+  int attrNum = mLayer->fieldNameIndex( fieldOrExpression );
+
+  if ( attrNum == -1 )
+  {
+    context->setFields( mLayer->fields() );
+    // try to use expression
+    expression.reset( new QgsExpression( fieldOrExpression ) );
+
+    if ( expression->hasParserError() || !expression->prepare( context ) )
+    {
+      return results;
+    }
+  }
+
+  QStringList lst;
+  if ( expression.isNull() )
+    lst.append( fieldOrExpression );
+  else
+    lst = expression->referencedColumns();
+  lst << groupByFields;
+
+  QgsFeatureRequest request = QgsFeatureRequest()
+                              .setFlags(( expression.data() && expression->needsGeometry() ) ?
+                                        QgsFeatureRequest::NoFlags :
+                                        QgsFeatureRequest::NoGeometry )
+                              .setSubsetOfAttributes( lst, mLayer->fields() );
+  if ( !mFilterExpression.isEmpty() )
+    request.setFilterExpression( mFilterExpression );
+  request.setExpressionContext( *context );
+
+  // collect the values of every group in a single pass
+  QHash<QString, QVariantList> groupValues;
+  QVariant::Type resultType = attrNum == -1 ? QVariant::Invalid : mLayer->fields().at( attrNum ).type();
+  bool firstFeature = true;
+
+  QgsFeatureIterator fit = mLayer->getFeatures( request );
+  QgsFeature f;
+  QVariantList keyValues;
+  while ( fit.nextFeature( f ) )
+  {
+    keyValues.clear();
+    Q_FOREACH ( int idx, groupIndexes )
+      keyValues << f.attribute( idx );
+
+    QVariant v;
+    if ( expression )
+    {
+      context->setFeature( f );
+      v = expression->evaluate( context );
+      // like calculate(), the type of the first value determines the result type
+      if ( firstFeature )
+        resultType = v.type();
+    }
+    else
+    {
+      v = f.attribute( attrNum );
+    }
+    firstFeature = false;
+
+    groupValues[ groupKey( keyValues )] << v;
+  }
+
+  QHash<QString, QVariantList>::const_iterator groupIt = groupValues.constBegin();
+  for ( ; groupIt != groupValues.constEnd(); ++groupIt )
+  {
+    bool groupOk = false;
+    QVariant value = calculateFromValues( aggregate, groupIt.value(), resultType, mDelimiter, &groupOk );
+    if ( !groupOk )
+    {
+      // a failed group does not invalidate the others
+      QgsDebugMsg( QString( "Could not calculate aggregate for group %1" ).arg( groupIt.key() ) );
+      if ( failedGroups )
+        failedGroups->append( groupIt.key() );
+      continue;
+    }
+    results.insert( groupIt.key(), value );
+  }
+
+  if ( ok )
+    *ok = true;
+  return results;
+}
+
+QString QgsAggregateCalculator::groupKey( const QVariantList& values )
+{
+  QStringList parts;
+  Q_FOREACH ( const QVariant& value, values )
+    parts << value.toString();
+  return parts.join( QChar( 0x1f ) );
+}
+
 QgsAggregateCalculator::Aggregate QgsAggregateCalculator::stringToAggregate( const QString& string, bool* ok )
 {
   QString normalized = string.trimmed().toLower();
@@ -234,6 +354,90 @@ QVariant QgsAggregateCalculator::calculate( QgsAggregateCalculator::Aggregate ag
   return QVariant();
 }
 
+QVariant QgsAggregateCalculator::calculateFromValues( QgsAggregateCalculator::Aggregate aggregate, const QVariantList& values,
+    QVariant::Type resultType, const QString& delimiter, bool* ok )
+{
+  if ( ok )
+    *ok = false;
+
+  switch ( resultType )
+  {
+    case QVariant::Int:
+    case QVariant::UInt:
+    case QVariant::LongLong:
+    case QVariant::ULongLong:
+    case QVariant::Double:
+    {
+      bool statOk = false;
+      QgsStatisticalSummary::Statistic stat = numericStatFromAggregate( aggregate, &statOk );
+      if ( !statOk )
+        return QVariant();
+
+      QgsStatisticalSummary s( stat );
+      Q_FOREACH ( const QVariant& v, values )
+        s.addVariant( v );
+      s.finalize();
+
+      if ( ok )
+        *ok = true;
+      double val = s.statistic( stat );
+      return qIsNaN( val ) ? QVariant() : val;
+    }
+
+    case QVariant::Date:
+    case QVariant::DateTime:
+    {
+      bool statOk = false;
+      QgsDateTimeStatisticalSummary::Statistic stat = dateTimeStatFromAggregate( aggregate, &statOk );
+      if ( !statOk )
+        return QVariant();
+
+      QgsDateTimeStatisticalSummary s( stat );
+      Q_FOREACH ( const QVariant& v, values )
+        s.addValue( v );
+      s.finalize();
+
+      if ( ok )
+        *ok = true;
+      return s.statistic( stat );
+    }
+
+    default:
+    {
+      // treat as string
+      if ( aggregate == StringConcatenate )
+      {
+        QString result;
+        Q_FOREACH ( const QVariant& v, values )
+        {
+          if ( !result.isEmpty() )
+            result += delimiter;
+          result += v.toString();
+        }
+        if ( ok )
+          *ok = true;
+        return result;
+      }
+
+      bool statOk = false;
+      QgsStringStatisticalSummary::Statistic stat = stringStatFromAggregate( aggregate, &statOk );
+      if ( !statOk )
+        return QVariant();
+
+      QgsStringStatisticalSummary s( stat );
+      Q_FOREACH ( const QVariant& v, values )
+        s.addValue( v );
+      s.finalize();
+
+      if ( ok )
+        *ok = true;
+      return s.statistic( stat );
+    }
+  }
+
+  return QVariant();
+}
+
 QgsStatisticalSummary::Statistic QgsAggregateCalculator::numericStatFromAggregate( QgsAggregateCalculator::Aggregate aggregate, bool* ok )
 {
   if ( ok )
@@ -459,7 +663,7 @@ QVariant QgsAggregateCalculator::concatenateStrings( QgsFeatureIterator& fit, in
   return result;
 }
 
-QVariant QgsAggregateCalculator::defaultValue( QgsAggregateCalculator::Aggregate aggregate ) const
+QVariant QgsAggregateCalculator::defaultValue( QgsAggregateCalculator::Aggregate aggregate )
 {
   // value to return when NO features are aggregated:
   switch ( aggregate )
@@ -21,6 +21,8 @@
 #include "qgsstatisticalsummary.h"
 #include "qgsdatetimestatisticalsummary.h"
 #include "qgsstringstatisticalsummary.h"
+#include <QHash>
+#include <QStringList>
 #include <QVariant>
 
 
@@ -130,6 +132,24 @@ class CORE_EXPORT QgsAggregateCalculator
     QVariant calculate( Aggregate aggregate, const QString& fieldOrExpression,
                         QgsExpressionContext* context = nullptr, bool* ok = nullptr ) const;
 
+    /** Calculates the value of an aggregate for every group of features sharing the same
+     * values of a set of fields, in a single pass over the layer.
+     * @param aggregate aggregate to calculate
+     * @param fieldOrExpression source field or expression to use as basis for aggregated values.
+     * If an expression is used, then the context parameter must be set.
+     * @param groupByFields names of the fields which define the groups
+     * @param context expression context for evaluating expressions
+     * @param ok if specified, will be set to true if aggregate calculation was successful
+     * @param failedGroups if specified, receives the keys of the groups whose aggregate could not
+     * be calculated. These groups are not contained in the results, the other groups are.
+     * @returns calculated aggregate values, keyed by the groupKey() of the group field values.
+     * Groups without features are not contained, their value is defaultValue().
+     * @note added in QGIS 2.18
+     * @note not available in Python bindings
+     */
+    QHash<QString, QVariant> calculateGrouped( Aggregate aggregate, const QString& fieldOrExpression, const QStringList& groupByFields,
+        QgsExpressionContext* context = nullptr, bool* ok = nullptr, QStringList* failedGroups = nullptr ) const;
+
     /** Converts a string to a aggregate type.
      * @param string string to convert
      * @param ok if specified, will be set to true if conversion was successful
@@ -137,6 +157,17 @@ class CORE_EXPORT QgsAggregateCalculator
      */
     static Aggregate stringToAggregate( const QString& string, bool* ok = nullptr );
 
+    /** Returns the value of an aggregate calculated over no features.
+     * @note added in QGIS 2.18
+     */
+    static QVariant defaultValue( Aggregate aggregate );
+
+    /** Returns the key identifying a group of features in the results of calculateGrouped().
+     * @param values values of the group fields
+     * @note added in QGIS 2.18
+     */
+    static QString groupKey( const QVariantList& values );
+
   private:
 
     //! Source layer
@@ -170,7 +201,10 @@ class CORE_EXPORT QgsAggregateCalculator
     static QVariant concatenateStrings( QgsFeatureIterator& fit, int attr, QgsExpression* expression,
                                         QgsExpressionContext* context, const QString& delimiter );
 
-    QVariant defaultValue( Aggregate aggregate ) const;
+    //! Calculates an aggregate over a list of values
+    static QVariant calculateFromValues( Aggregate aggregate, const QVariantList& values, QVariant::Type resultType,
+                                         const QString& delimiter, bool* ok = nullptr );
+
 };
 
 #endif //QGSAGGREGATECALCULATOR_H
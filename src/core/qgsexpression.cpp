@@ -674,6 +674,64 @@ static QVariant fcnAggregate( const QVariantList& values, const QgsExpressionCon
   return result;
 }
 
+//! Number of groups evaluated one by one before an aggregate is calculated for all groups at once
+static const int GROUPED_AGGREGATE_THRESHOLD = 10;
+
+/** Looks up the aggregate of a group of features from a grouped calculation over the whole layer.
+ * The grouped calculation is only done once per expression context, and only after the aggregate
+ * has been requested for several groups, as a single group is cheaper to calculate with a filtered
+ * request. Returns false if the aggregate should be calculated for the group alone.
+ */
+static bool groupedAggregateValue( const QgsExpressionContext* context, QgsVectorLayer* layer, QgsAggregateCalculator::Aggregate aggregate,
+                                   const QString& subExpression, const QStringList& groupByFields,
+                                   const QgsAggregateCalculator::AggregateParameters& parameters,
+                                   const QVariantList& groupValues, QVariant& result )
+{
+  Q_FOREACH ( const QVariant& value, groupValues )
+  {
+    // null keys are matched with IS NULL, leave them to the filtered request
+    if ( value.isNull() )
+      return false;
+  }
+
+  QString planKey = QString( "aggplan:%1:%2:%3:%4:%5:%6" ).arg( layer->id(),
+                    QString::number( static_cast< int >( aggregate ) ),
+                    subExpression,
+                    groupByFields.join( "," ),
+                    parameters.filter,
+                    parameters.delimiter );
+  QString groupedKey = planKey + ":grouped";
+  QString failedKey = planKey + ":failed";
+
+  if ( !context->hasCachedValue( groupedKey ) )
+  {
+    int requests = context->cachedValue( planKey ).toInt() + 1;
+    context->setCachedValue( planKey, requests );
+    if ( requests < GROUPED_AGGREGATE_THRESHOLD )
+      return false;
+
+    bool ok = false;
+    QStringList failedGroups;
+    QgsExpressionContext subContext( *context );
+    QHash<QString, QVariant> grouped = layer->aggregateGrouped( aggregate, subExpression, groupByFields, parameters, &subContext, &ok, &failedGroups );
+    // an invalid value marks a failed calculation, which is not retried
+    context->setCachedValue( groupedKey, ok ? QVariant( grouped ) : QVariant() );
+    context->setCachedValue( failedKey, failedGroups );
+  }
+
+  QVariant grouped = context->cachedValue( groupedKey );
+  if ( !grouped.isValid() )
+    return false;
+
+  // the groups which failed are calculated alone, which reports their error as before
+  QString key = QgsAggregateCalculator::groupKey( groupValues );
+  if ( context->cachedValue( failedKey ).toStringList().contains( key ) )
+    return false;
+
+  result = grouped.toHash().value( key, QgsAggregateCalculator::defaultValue( aggregate ) );
+  return true;
+}
+
 static QVariant fcnAggregateRelation( const QVariantList& values, const QgsExpressionContext* context, QgsExpression *parent )
 {
   if ( !context )
@@ -748,6 +806,19 @@ static QVariant fcnAggregateRelation( const QVariantList& values, const QgsExpre
   }
 
   FEAT_FROM_CONTEXT( context, f );
+
+  // when many parents are evaluated, aggregate the children of all parents in one pass
+  QStringList referencingFields;
+  QVariantList referencedValues;
+  Q_FOREACH ( const QgsRelation::FieldPair& pair, relation.fieldPairs() )
+  {
+    referencingFields << pair.referencingField();
+    referencedValues << f.attribute( pair.referencedField() );
+  }
+  QVariant groupedResult;
+  if ( groupedAggregateValue( context, childLayer, aggregate, subExpression, referencingFields, parameters, referencedValues, groupedResult ) )
+    return groupedResult;
+
   parameters.filter = relation.getRelatedFeaturesFilter( f );
 
   QString cacheKey = QString( "relagg:%1:%2:%3:%4" ).arg( vl->id(),
@@ -829,6 +900,14 @@ static QVariant fcnAggregateGeneric( QgsAggregateCalculator::Aggregate aggregate
   {
     QgsExpression groupByExp( groupBy );
     QVariant groupByValue = groupByExp.evaluate( context );
+
+    // when grouping by a field, the aggregates of all groups can be calculated in one pass
+    QgsExpression::NodeColumnRef* groupByColumn = dynamic_cast< QgsExpression::NodeColumnRef* >( getNode( values.at( 1 ), parent ) );
+    QVariant groupedResult;
+    if ( groupByColumn && groupedAggregateValue( context, vl, aggregate, subExpression, QStringList() << groupByColumn->name(),
+         parameters, QVariantList() << groupByValue, groupedResult ) )
+      return groupedResult;
+
     if ( !parameters.filter.isEmpty() )
       parameters.filter = QString( "(%1) AND (%2=%3)" ).arg( parameters.filter, groupBy, QgsExpression::quotedValue( groupByValue ) );
     else
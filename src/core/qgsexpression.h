@@ -1433,6 +1433,17 @@ class CORE_EXPORT QgsExpression
         virtual void accept( Visitor& v ) const override { v.visit( *this ); }
         virtual Node* clone() const override;
 
+        /** Returns the WHEN ... THEN ... pairs of the condition.
+         * @note added in QGIS 2.18
+         * @note not available in Python bindings
+         */
+        WhenThenList conditions() const { return mConditions; }
+
+        /** Returns the ELSE expression of the condition, or nullptr if it has none.
+         * @note added in QGIS 2.18
+         */
+        Node* elseExp() const { return mElseExp; }
+
       protected:
         WhenThenList mConditions;
         Node* mElseExp;
@@ -45,6 +45,7 @@ class CORE_EXPORT QgsFeedback : public QObject
     QgsFeedback( QObject* parent = nullptr )
         : QObject( parent )
         , mCancelled( false )
+        , mProgress( 0.0 )
     {}
 
     virtual ~QgsFeedback() {}
@@ -61,13 +62,38 @@ class CORE_EXPORT QgsFeedback : public QObject
     //! Tells whether the operation has been cancelled already
     bool isCancelled() const { return mCancelled; }
 
+    /** Sets the current progress of the operation, in percents (0.0-100.0). This is run by
+     * the internal routines, usually in the worker thread.
+     * @see progress()
+     * @see progressChanged()
+     */
+    void setProgress( double progress )
+    {
+      mProgress = progress;
+      emit progressChanged( mProgress );
+    }
+
+    /** Returns the current progress of the operation, in percents (0.0-100.0)
+     * @see setProgress()
+     */
+    double progress() const { return mProgress; }
+
   signals:
     //! Internal routines can connect to this signal if they use event loop
     void cancelled();
 
+    /** Emitted when the progress of the operation changes. The signal is emitted from the
+     * thread running the operation, connect to it with a queued connection to update widgets.
+     * @see setProgress()
+     */
+    void progressChanged( double progress );
+
   private:
     //! Whether the operation has been cancelled already. False by default.
     bool mCancelled;
+
+    //! Current progress of the operation
+    double mProgress;
 };
 
 #endif // QGSFEEDBACK_H
@@ -17,6 +17,7 @@
 
 #include "qgslogger.h"
 #include "qgsproject.h"
+#include "qgsrenderprofiler.h"
 
 #include "feature.h"
 #include "labelposition.h"
@@ -211,6 +212,7 @@ void QgsLabelingEngineV2::run( QgsRenderContext& context )
   // for each provider: get labels and register them in PAL
   Q_FOREACH ( QgsAbstractLabelProvider* provider, mProviders )
   {
+    QgsRenderProfilerScope profile( context.profiler(), provider->layerId(), QgsRenderProfiler::LabelCandidates );
     processProvider( provider, context, p );
   }
 
@@ -241,6 +243,7 @@ void QgsLabelingEngineV2::run( QgsRenderContext& context )
   pal::Problem *problem;
   try
   {
+    QgsRenderProfilerScope profile( context.profiler(), QString(), QgsRenderProfiler::LabelCandidates );
     problem = p.extractProblem( bbox );
   }
   catch ( std::exception& e )
@@ -287,7 +290,10 @@ void QgsLabelingEngineV2::run( QgsRenderContext& context )
   }
 
   // find the solution
-  labels = p.solveProblem( problem, mFlags.testFlag( UseAllLabels ) );
+  {
+    QgsRenderProfilerScope profile( context.profiler(), QString(), QgsRenderProfiler::LabelSolving );
+    labels = p.solveProblem( problem, mFlags.testFlag( UseAllLabels ) );
+  }
 
   QgsDebugMsgLevel( QString( "LABELING work:  %1 ms ... labels# %2" ).arg( t.elapsed() ).arg( labels->size() ), 4 );
   t.restart();
@@ -316,6 +322,7 @@ void QgsLabelingEngineV2::run( QgsRenderContext& context )
       continue;
     }
 
+    QgsRenderProfilerScope profile( context.profiler(), lf->provider()->layerId(), QgsRenderProfiler::LabelRendering );
     lf->provider()->drawLabel( context, *it );
   }
 
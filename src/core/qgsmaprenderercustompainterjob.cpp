@@ -23,6 +23,7 @@
 #include "qgspallabeling.h"
 #include "qgsvectorlayer.h"
 #include "qgsrendererv2.h"
+#include "qgsrenderprofiler.h"
 
 #define LABELING_V2
 
@@ -60,6 +61,7 @@ void QgsMapRendererCustomPainterJob::start()
   mActive = true;
 
   mErrors.clear();
+  mLabelingRenderContext.setProfiler( mProfiler );
 
   QgsDebugMsg( "QPAINTER run!" );
 
@@ -270,7 +272,10 @@ void QgsMapRendererCustomPainterJob::doRender()
       QTime layerTime;
       layerTime.start();
 
-      job.renderer->render();
+      {
+        QgsRenderProfilerScope profile( job.context, QgsRenderProfiler::LayerTotal );
+        job.renderer->render();
+      }
 
       job.renderingTime = layerTime.elapsed();
     }
@@ -305,7 +310,9 @@ void QgsMapRendererJob::drawLabeling( const QgsMapSettings& settings, QgsRenderC
   painter->setCompositionMode( QPainter::CompositionMode_SourceOver );
 
   // TODO: this is not ideal - we could override rendering stopped flag that has been set in meanwhile
+  QgsRenderProfiler* profiler = renderContext.profiler();
   renderContext = QgsRenderContext::fromMapSettings( settings );
+  renderContext.setProfiler( profiler );
   renderContext.setPainter( painter );
   renderContext.setLabelingEngine( labelingEngine );
 
@@ -24,6 +24,7 @@
 #include "qgscrscache.h"
 #include "qgslogger.h"
 #include "qgsrendercontext.h"
+#include "qgsrenderprofiler.h"
 #include "qgsmaplayer.h"
 #include "qgsmaplayerregistry.h"
 #include "qgsmaplayerrenderer.h"
@@ -38,6 +39,7 @@ QgsMapRendererJob::QgsMapRendererJob( const QgsMapSettings& settings )
     : mSettings( settings )
     , mCache( nullptr )
     , mRenderingTime( 0 )
+    , mProfiler( nullptr )
 {
 }
 
@@ -259,6 +261,10 @@ LayerRenderJobs QgsMapRendererJob::prepareJobs( QPainter* painter, QgsPalLabelin
     job.context.setLabelingEngineV2( labelingEngine2 );
     job.context.setCoordinateTransform( ct );
     job.context.setExtent( r1 );
+    // every layer records its times in a profiler of its own, so that layers rendered
+    // in parallel do not wait for the lock of the shared profiler
+    job.profiler = mProfiler ? new QgsRenderProfiler() : nullptr;
+    job.context.setProfiler( job.profiler, ml->id() );
 
     // if we can use the cache, let's do it and avoid rendering!
     if ( mCache && !mCache->cacheImage( ml->id() ).isNull() )
@@ -284,6 +290,7 @@ LayerRenderJobs QgsMapRendererJob::prepareJobs( QPainter* painter, QgsPalLabelin
       {
         mErrors.append( Error( layerId, tr( "Insufficient memory for image %1x%2" ).arg( mSettings.outputSize().width() ).arg( mSettings.outputSize().height() ) ) );
         delete mypFlattenedImage;
+        delete job.profiler;
         layerJobs.removeLast();
         continue;
       }
@@ -346,6 +353,14 @@ void QgsMapRendererJob::cleanupJobs( LayerRenderJobs& jobs )
       delete job.renderer;
       job.renderer = nullptr;
     }
+
+    if ( job.profiler )
+    {
+      if ( mProfiler )
+        mProfiler->merge( *job.profiler );
+      delete job.profiler;
+      job.profiler = nullptr;
+    }
   }
 
   jobs.clear();
@@ -34,6 +34,7 @@ class QgsLabelingResults;
 class QgsMapLayerRenderer;
 class QgsMapRendererCache;
 class QgsPalLabeling;
+class QgsRenderProfiler;
 
 
 /** \ingroup core
@@ -50,6 +51,7 @@ struct LayerRenderJob
   bool cached; // if true, img already contains cached image from previous rendering
   QString layerId;
   int renderingTime; //!< time it took to render the layer in ms (it is -1 if not rendered or still rendering)
+  QgsRenderProfiler* profiler; //!< times of the layer, merged into the profiler of the map job when the job is cleaned up (may be null)
 };
 
 typedef QList<LayerRenderJob> LayerRenderJobs;
@@ -140,6 +142,21 @@ class CORE_EXPORT QgsMapRendererJob : public QObject
     //! Find out how log it took to finish the job (in miliseconds)
     int renderingTime() const { return mRenderingTime; }
 
+    /** Sets a profiler which collects the time spent in the stages of rendering each layer
+     * and the labels. Must be set before the job is started.
+     * @param profiler render profiler, or nullptr to disable profiling. Ownership is not transferred
+     * and the profiler must outlive the job.
+     * @see profiler()
+     * @note added in QGIS 2.18
+     */
+    void setProfiler( QgsRenderProfiler* profiler ) { mProfiler = profiler; }
+
+    /** Returns the profiler which collects the time spent in the stages of rendering, or nullptr.
+     * @see setProfiler()
+     * @note added in QGIS 2.18
+     */
+    QgsRenderProfiler* profiler() const { return mProfiler; }
+
     /**
      * Return map settings with which this job was started.
      * @return A QgsMapSettings instance with render settings
@@ -195,6 +212,8 @@ class CORE_EXPORT QgsMapRendererJob : public QObject
 
     QTime mRenderingStart;
     int mRenderingTime;
+
+    QgsRenderProfiler* mProfiler;
 };
 
 
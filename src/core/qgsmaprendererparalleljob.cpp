@@ -20,6 +20,7 @@
 #include "qgslogger.h"
 #include "qgsmaplayerrenderer.h"
 #include "qgspallabeling.h"
+#include "qgsrenderprofiler.h"
 
 #include <QtConcurrentMap>
 
@@ -56,6 +57,8 @@ void QgsMapRendererParallelJob::start()
 
   mStatus = RenderingLayers;
 
+  mLabelingRenderContext.setProfiler( mProfiler );
+
   delete mLabelingEngine;
   mLabelingEngine = nullptr;
 
@@ -258,6 +261,7 @@ void QgsMapRendererParallelJob::renderLayerStatic( LayerRenderJob& job )
 
   try
   {
+    QgsRenderProfilerScope profile( job.context, QgsRenderProfiler::LayerTotal );
     job.renderer->render();
   }
   catch ( QgsException & e )
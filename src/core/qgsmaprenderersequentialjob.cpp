@@ -68,6 +68,7 @@ void QgsMapRendererSequentialJob::start()
 
   mInternalJob = new QgsMapRendererCustomPainterJob( mSettings, mPainter );
   mInternalJob->setCache( mCache );
+  mInternalJob->setProfiler( mProfiler );
 
   connect( mInternalJob, SIGNAL( finished() ), SLOT( internalFinished() ) );
 
@@ -16,13 +16,17 @@
 #include "qgspointlocator.h"
 
 #include "qgsgeometry.h"
+#include "qgsgeometrypredicateengine.h"
 #include "qgsvectorlayer.h"
+#include "qgsvectorlayerfeatureiterator.h"
 #include "qgswkbptr.h"
 #include "qgis.h"
 
 #include <SpatialIndex.h>
 
 #include <QLinkedListIterator>
+#include <QtConcurrentRun>
+#include <qmath.h>
 
 using namespace SpatialIndex;
 
@@ -87,8 +91,9 @@ class QgsPointLocator_Stream : public IDataStream
 class QgsPointLocator_VisitorNearestVertex : public IVisitor
 {
   public:
-    QgsPointLocator_VisitorNearestVertex( QgsPointLocator* pl, QgsPointLocator::Match& m, const QgsPoint& srcPoint, QgsPointLocator::MatchFilter* filter = nullptr )
+    QgsPointLocator_VisitorNearestVertex( QgsPointLocator* pl, const QHash<QgsFeatureId, QgsGeometry*>& geoms, QgsPointLocator::Match& m, const QgsPoint& srcPoint, QgsPointLocator::MatchFilter* filter = nullptr )
         : mLocator( pl )
+        , mGeoms( geoms )
         , mBest( m )
         , mSrcPoint( srcPoint )
         , mFilter( filter )
@@ -100,7 +105,7 @@ class QgsPointLocator_VisitorNearestVertex : public IVisitor
     void visitData( const IData& d ) override
     {
       QgsFeatureId id = d.getIdentifier();
-      QgsGeometry* geom = mLocator->mGeoms.value( id );
+      QgsGeometry* geom = mGeoms.value( id );
       int vertexIndex, beforeVertex, afterVertex;
       double sqrDist;
       QgsPoint pt = geom->closestVertex( mSrcPoint, vertexIndex, beforeVertex, afterVertex, sqrDist );
@@ -118,6 +123,7 @@ class QgsPointLocator_VisitorNearestVertex : public IVisitor
 
   private:
     QgsPointLocator* mLocator;
+    const QHash<QgsFeatureId, QgsGeometry*>& mGeoms;
     QgsPointLocator::Match& mBest;
     QgsPoint mSrcPoint;
     QgsPointLocator::MatchFilter* mFilter;
@@ -134,8 +140,9 @@ class QgsPointLocator_VisitorNearestVertex : public IVisitor
 class QgsPointLocator_VisitorNearestEdge : public IVisitor
 {
   public:
-    QgsPointLocator_VisitorNearestEdge( QgsPointLocator* pl, QgsPointLocator::Match& m, const QgsPoint& srcPoint, QgsPointLocator::MatchFilter* filter = nullptr )
+    QgsPointLocator_VisitorNearestEdge( QgsPointLocator* pl, const QHash<QgsFeatureId, QgsGeometry*>& geoms, QgsPointLocator::Match& m, const QgsPoint& srcPoint, QgsPointLocator::MatchFilter* filter = nullptr )
         : mLocator( pl )
+        , mGeoms( geoms )
         , mBest( m )
         , mSrcPoint( srcPoint )
         , mFilter( filter )
@@ -147,7 +154,7 @@ class QgsPointLocator_VisitorNearestEdge : public IVisitor
     void visitData( const IData& d ) override
     {
       QgsFeatureId id = d.getIdentifier();
-      QgsGeometry* geom = mLocator->mGeoms.value( id );
+      QgsGeometry* geom = mGeoms.value( id );
       QgsPoint pt;
       int afterVertex;
       double sqrDist = geom->closestSegmentWithContext( mSrcPoint, pt, afterVertex, nullptr, POINT_LOC_EPSILON );
@@ -168,6 +175,7 @@ class QgsPointLocator_VisitorNearestEdge : public IVisitor
 
   private:
     QgsPointLocator* mLocator;
+    const QHash<QgsFeatureId, QgsGeometry*>& mGeoms;
     QgsPointLocator::Match& mBest;
     QgsPoint mSrcPoint;
     QgsPointLocator::MatchFilter* mFilter;
@@ -185,28 +193,27 @@ class QgsPointLocator_VisitorArea : public IVisitor
 {
   public:
     //! constructor
-    QgsPointLocator_VisitorArea( QgsPointLocator* pl, const QgsPoint& origPt, QgsPointLocator::MatchList& list )
-        : mLocator( pl )
-        , mList( list )
-        , mGeomPt( QgsGeometry::fromPoint( origPt ) )
+    QgsPointLocator_VisitorArea( const QHash<QgsFeatureId, QgsGeometry*>& geoms, QList<QgsFeatureId>& ids, QHash<QgsFeatureId, QgsGeometry*>& candidates )
+        : mGeoms( geoms )
+        , mIds( ids )
+        , mCandidates( candidates )
     {}
 
-    ~QgsPointLocator_VisitorArea() { delete mGeomPt; }
-
     void visitNode( const INode& n ) override { Q_UNUSED( n ); }
     void visitData( std::vector<const IData*>& v ) override { Q_UNUSED( v ); }
 
     void visitData( const IData& d ) override
     {
       QgsFeatureId id = d.getIdentifier();
-      QgsGeometry* g = mLocator->mGeoms.value( id );
-      if ( g->intersects( mGeomPt ) )
-        mList << QgsPointLocator::Match( QgsPointLocator::Area, mLocator->mLayer, id, 0, QgsPoint() );
+      if ( mCandidates.contains( id ) )
+        return; // already found in another tile
+      mIds << id;
+      mCandidates.insert( id, mGeoms.value( id ) );
     }
   private:
-    QgsPointLocator* mLocator;
-    QgsPointLocator::MatchList& mList;
-    QgsGeometry* mGeomPt;
+    const QHash<QgsFeatureId, QgsGeometry*>& mGeoms;
+    QList<QgsFeatureId>& mIds;
+    QHash<QgsFeatureId, QgsGeometry*>& mCandidates;
 };
 
 
@@ -523,8 +530,9 @@ static QgsPointLocator::MatchList _geometrySegmentsInRect( QgsGeometry *geom, co
 class QgsPointLocator_VisitorEdgesInRect : public IVisitor
 {
   public:
-    QgsPointLocator_VisitorEdgesInRect( QgsPointLocator* pl, QgsPointLocator::MatchList& lst, const QgsRectangle& srcRect, QgsPointLocator::MatchFilter* filter = nullptr )
+    QgsPointLocator_VisitorEdgesInRect( QgsPointLocator* pl, const QHash<QgsFeatureId, QgsGeometry*>& geoms, QgsPointLocator::MatchList& lst, const QgsRectangle& srcRect, QgsPointLocator::MatchFilter* filter = nullptr )
         : mLocator( pl )
+        , mGeoms( geoms )
         , mList( lst )
         , mSrcRect( srcRect )
         , mFilter( filter )
@@ -536,7 +544,7 @@ class QgsPointLocator_VisitorEdgesInRect : public IVisitor
     void visitData( const IData& d ) override
     {
       QgsFeatureId id = d.getIdentifier();
-      QgsGeometry* geom = mLocator->mGeoms.value( id );
+      QgsGeometry* geom = mGeoms.value( id );
 
       Q_FOREACH ( const QgsPointLocator::Match& m, _geometrySegmentsInRect( geom, mSrcRect, mLocator->mLayer, id ) )
       {
@@ -550,6 +558,7 @@ class QgsPointLocator_VisitorEdgesInRect : public IVisitor
 
   private:
     QgsPointLocator* mLocator;
+    const QHash<QgsFeatureId, QgsGeometry*>& mGeoms;
     QgsPointLocator::MatchList& mList;
     QgsRectangle mSrcRect;
     QgsPointLocator::MatchFilter* mFilter;
@@ -610,6 +619,144 @@ class QgsPointLocator_DumpTree : public SpatialIndex::IQueryStrategy
 ////////////////////////////////////////////////////////////////////////////
 
 
+/** \ingroup core
+ * Index of one tile of a tiled point locator, or a temporary index of a query rectangle.
+ * Features are stored in every tile their bounding box intersects.
+ * @note not available in Python bindings
+ */
+class QgsPointLocator_Tile
+{
+  public:
+    QgsPointLocator_Tile( const QgsRectangle& rect, int generation = 0 )
+        : rect( rect )
+        , storage( StorageManager::createNewMemoryStorageManager() )
+        , rtree( nullptr )
+        , memory( 0 )
+        , lastUsed( 0 )
+        , generation( generation )
+    {}
+
+    ~QgsPointLocator_Tile()
+    {
+      delete rtree;
+      delete storage;
+      qDeleteAll( geoms );
+    }
+
+    //! Rough estimate of the memory taken by a geometry, including its index entry
+    static qint64 geometryMemory( const QgsGeometry* geom )
+    {
+      return sizeof( QgsGeometry ) + geom->wkbSize() + 64;
+    }
+
+    //! Indexes the features of an iterator at once, geometries are transformed if ct is not null
+    void load( QgsFeatureIterator fi, QgsCoordinateTransform* ct )
+    {
+      QLinkedList<RTree::Data*> dataList;
+      QgsFeature f;
+      while ( fi.nextFeature( f ) )
+      {
+        if ( !f.constGeometry() )
+          continue;
+
+        if ( ct )
+        {
+          try
+          {
+            f.geometry()->transform( *ct );
+          }
+          catch ( const QgsException& e )
+          {
+            Q_UNUSED( e );
+            QgsDebugMsg( QString( "could not transform geometry to map, skipping the snap for it (%1)" ).arg( e.what() ) );
+            continue;
+          }
+        }
+
+        if ( geoms.contains( f.id() ) )
+          continue;
+
+        QgsGeometry* geom = new QgsGeometry( *f.constGeometry() );
+        dataList << new RTree::Data( 0, nullptr, rect2region( geom->boundingBox() ), f.id() );
+        geoms.insert( f.id(), geom );
+        memory += geometryMemory( geom );
+      }
+
+      if ( dataList.isEmpty() )
+        return;
+
+      QgsPointLocator_Stream stream( dataList );
+      SpatialIndex::id_type indexId;
+      rtree = RTree::createAndBulkLoadNewRTree( RTree::BLM_STR, stream, *storage, 0.7, 10, 10, 2, RTree::RV_RSTAR, indexId );
+    }
+
+    //! Adds a feature, takes ownership of the geometry
+    void insertFeature( QgsFeatureId fid, QgsGeometry* geom )
+    {
+      removeFeature( fid );
+      if ( !rtree )
+      {
+        SpatialIndex::id_type indexId;
+        rtree = RTree::createNewRTree( *storage, 0.7, 10, 10, 2, RTree::RV_RSTAR, indexId );
+      }
+      rtree->insertData( 0, nullptr, rect2region( geom->boundingBox() ), fid );
+      geoms.insert( fid, geom );
+      memory += geometryMemory( geom );
+    }
+
+    void removeFeature( QgsFeatureId fid )
+    {
+      QgsGeometry* geom = geoms.take( fid );
+      if ( !geom )
+        return;
+      rtree->deleteData( rect2region( geom->boundingBox() ), fid );
+      memory -= geometryMemory( geom );
+      delete geom;
+    }
+
+    QgsRectangle rect;
+    SpatialIndex::IStorageManager* storage;
+    SpatialIndex::ISpatialIndex* rtree;
+    QHash<QgsFeatureId, QgsGeometry*> geoms;
+    qint64 memory;
+    quint64 lastUsed;
+    int generation;
+
+  private:
+    QgsPointLocator_Tile( const QgsPointLocator_Tile& rh );
+    QgsPointLocator_Tile& operator=( const QgsPointLocator_Tile& rh );
+};
+
+
+/** \ingroup core
+ * Job indexing a tile in a background thread. The feature source is a snapshot of the layer
+ * taken in the main thread, the transform is a private copy. Both are deleted by the job.
+ * @note not available in Python bindings
+ */
+struct QgsPointLocator_TileJob
+{
+  QgsPointLocator_Tile* tile;
+  QgsAbstractFeatureSource* source;
+  QgsCoordinateTransform* transform;
+  QgsFeatureRequest request;
+};
+
+static QgsPointLocator_Tile* _buildTile( QgsPointLocator_TileJob job )
+{
+  job.tile->load( job.source->getFeatures( job.request ), job.transform );
+  delete job.source;
+  delete job.transform;
+  return job.tile;
+}
+
+//! queries spanning more tiles are answered from a temporary index and do not schedule tiles
+static const int MAX_TILES_PER_QUERY = 9;
+//! maximum number of tiles waiting to be indexed, older requests are dropped
+static const int MAX_QUEUED_TILES = 16;
+
+////////////////////////////////////////////////////////////////////////////
+
+
 QgsPointLocator::QgsPointLocator( QgsVectorLayer* layer, const QgsCoordinateReferenceSystem* destCRS, const QgsRectangle* extent )
     : mStorage( nullptr )
     , mRTree( nullptr )
@@ -617,6 +764,12 @@ QgsPointLocator::QgsPointLocator( QgsVectorLayer* layer, const QgsCoordinateRefe
     , mTransform( nullptr )
     , mLayer( layer )
     , mExtent( nullptr )
+    , mAreaEngine( nullptr )
+    , mTileSize( 0 )
+    , mTileMemoryBudget( 64 * 1024 * 1024 )
+    , mTileBuildRunning( false )
+    , mTileGeneration( 0 )
+    , mTileUseCounter( 0 )
 {
   if ( destCRS )
   {
@@ -631,15 +784,22 @@ QgsPointLocator::QgsPointLocator( QgsVectorLayer* layer, const QgsCoordinateRefe
   connect( mLayer, SIGNAL( featureDeleted( QgsFeatureId ) ), this, SLOT( onFeatureDeleted( QgsFeatureId ) ) );
   connect( mLayer, SIGNAL( geometryChanged( QgsFeatureId, QgsGeometry& ) ), this, SLOT( onGeometryChanged( QgsFeatureId, QgsGeometry& ) ) );
   connect( mLayer, SIGNAL( dataChanged() ), this, SLOT( destroyIndex() ) );
+  connect( &mTileWatcher, SIGNAL( finished() ), this, SLOT( onTileBuilt() ) );
 }
 
 
 QgsPointLocator::~QgsPointLocator()
 {
+  if ( mTileBuildRunning )
+  {
+    mTileWatcher.waitForFinished();
+    delete mTileWatcher.result();
+  }
   destroyIndex();
   delete mStorage;
   delete mTransform;
   delete mExtent;
+  delete mAreaEngine;
 }
 
 const QgsCoordinateReferenceSystem* QgsPointLocator::destCRS() const
@@ -666,7 +826,244 @@ bool QgsPointLocator::init( int maxFeaturesToIndex )
 
 bool QgsPointLocator::hasIndex() const
 {
-  return mRTree || mIsEmptyLayer;
+  return mRTree || mIsEmptyLayer || mTileSize > 0;
+}
+
+
+void QgsPointLocator::setTiling( double tileSize, qint64 memoryBudget )
+{
+  tileSize = qMax( 0.0, tileSize );
+  mTileMemoryBudget = memoryBudget;
+  if ( tileSize == mTileSize )
+  {
+    evictTiles();
+    return;
+  }
+
+  destroyIndex();
+  mTileSize = tileSize;
+}
+
+
+int QgsPointLocator::cachedGeometryCount() const
+{
+  if ( mTileSize <= 0 )
+    return mGeoms.count();
+
+  int count = 0;
+  Q_FOREACH ( const QgsPointLocator_Tile* tile, mTiles )
+    count += tile->geoms.count();
+  return count;
+}
+
+
+QgsRectangle QgsPointLocator::tileRect( const TileKey& key ) const
+{
+  return QgsRectangle( key.first * mTileSize, key.second * mTileSize,
+                       ( key.first + 1 ) * mTileSize, ( key.second + 1 ) * mTileSize );
+}
+
+
+bool QgsPointLocator::tileRequest( const QgsRectangle& rect, QgsFeatureRequest& request ) const
+{
+  QgsRectangle r = rect;
+  if ( mExtent )
+  {
+    if ( !mExtent->intersects( r ) )
+      return false;
+    r = r.intersect( mExtent );
+  }
+
+  if ( mTransform )
+  {
+    try
+    {
+      r = mTransform->transformBoundingBox( r, QgsCoordinateTransform::ReverseTransform );
+    }
+    catch ( const QgsException& e )
+    {
+      Q_UNUSED( e );
+      // See http://hub.qgis.org/issues/12634
+      QgsDebugMsg( QString( "could not transform bounding box to map, skipping the tile (%1)" ).arg( e.what() ) );
+      return false;
+    }
+  }
+
+  request.setSubsetOfAttributes( QgsAttributeList() );
+  request.setFilterRect( r );
+  return true;
+}
+
+
+QList<QgsPointLocator_Tile*> QgsPointLocator::tilesForQuery( const QgsRectangle& rect, QgsPointLocator_Tile*& temporaryTile )
+{
+  temporaryTile = nullptr;
+  QList<QgsPointLocator_Tile*> tiles;
+  if ( mLayer->geometryType() == QGis::NoGeometry )
+    return tiles;
+
+  int col0 = qFloor( rect.xMinimum() / mTileSize ), col1 = qFloor( rect.xMaximum() / mTileSize );
+  int row0 = qFloor( rect.yMinimum() / mTileSize ), row1 = qFloor( rect.yMaximum() / mTileSize );
+  bool complete = true;
+  if (( col1 - col0 + 1 ) * ( row1 - row0 + 1 ) > MAX_TILES_PER_QUERY )
+  {
+    complete = false;
+  }
+  else
+  {
+    for ( int row = row0; row <= row1; ++row )
+    {
+      for ( int col = col0; col <= col1; ++col )
+      {
+        TileKey key( col, row );
+        if ( QgsPointLocator_Tile* tile = mTiles.value( key ) )
+        {
+          tile->lastUsed = ++mTileUseCounter;
+          tiles << tile;
+          continue;
+        }
+
+        complete = false;
+        if ( !( mTileBuildRunning && mBuildingTile == key ) )
+        {
+          mTileQueue.removeAll( key );
+          mTileQueue << key;
+        }
+      }
+    }
+
+    while ( mTileQueue.count() > MAX_QUEUED_TILES )
+      mTileQueue.removeFirst();
+    startNextTileBuild();
+  }
+
+  if ( complete )
+    return tiles;
+
+  // some tiles are not ready yet - fetch just the features of the query rectangle
+  temporaryTile = new QgsPointLocator_Tile( rect );
+  QgsFeatureRequest request;
+  if ( tileRequest( rect, request ) )
+    temporaryTile->load( mLayer->getFeatures( request ), mTransform );
+  return QList<QgsPointLocator_Tile*>() << temporaryTile;
+}
+
+
+void QgsPointLocator::startNextTileBuild()
+{
+  if ( mTileBuildRunning )
+    return;
+
+  while ( !mTileQueue.isEmpty() )
+  {
+    TileKey key = mTileQueue.takeLast();
+    QgsPointLocator_Tile* tile = new QgsPointLocator_Tile( tileRect( key ), mTileGeneration );
+
+    QgsPointLocator_TileJob job;
+    if ( !tileRequest( tile->rect, job.request ) )
+    {
+      // nothing to index in this tile
+      tile->lastUsed = ++mTileUseCounter;
+      mTiles.insert( key, tile );
+      continue;
+    }
+
+    job.tile = tile;
+    job.source = new QgsVectorLayerFeatureSource( mLayer );
+    job.transform = mTransform ? mTransform->clone() : nullptr;
+
+    mBuildingTile = key;
+    mTileBuildRunning = true;
+    mEditedWhileBuilding.clear();
+    mTileWatcher.setFuture( QtConcurrent::run( _buildTile, job ) );
+    return;
+  }
+}
+
+
+void QgsPointLocator::onTileBuilt()
+{
+  if ( !mTileBuildRunning )
+    return;
+
+  mTileBuildRunning = false;
+  QgsPointLocator_Tile* tile = mTileWatcher.result();
+  if ( tile->generation != mTileGeneration || mTileSize <= 0 )
+  {
+    // the tiles have been dropped while this one was built
+    delete tile;
+  }
+  else
+  {
+    // the tile was built from a snapshot of the layer, apply the edits made in the meantime
+    Q_FOREACH ( QgsFeatureId fid, mEditedWhileBuilding )
+    {
+      tile->removeFeature( fid );
+      QgsGeometry* geom = destGeometry( fid );
+      if ( geom && tile->rect.intersects( geom->boundingBox() ) )
+        tile->insertFeature( fid, geom );
+      else
+        delete geom;
+    }
+
+    tile->lastUsed = ++mTileUseCounter;
+    delete mTiles.take( mBuildingTile );
+    mTiles.insert( mBuildingTile, tile );
+    evictTiles();
+  }
+  mEditedWhileBuilding.clear();
+
+  startNextTileBuild();
+}
+
+
+void QgsPointLocator::evictTiles()
+{
+  qint64 memory = 0;
+  Q_FOREACH ( const QgsPointLocator_Tile* tile, mTiles )
+    memory += tile->memory;
+
+  while ( memory > mTileMemoryBudget && mTiles.count() > 1 )
+  {
+    QHash<TileKey, QgsPointLocator_Tile*>::const_iterator lru = mTiles.constBegin();
+    QHash<TileKey, QgsPointLocator_Tile*>::const_iterator it = mTiles.constBegin();
+    for ( ; it != mTiles.constEnd(); ++it )
+    {
+      if ( it.value()->lastUsed < lru.value()->lastUsed )
+        lru = it;
+    }
+
+    memory -= lru.value()->memory;
+    delete mTiles.take( lru.key() );
+  }
+}
+
+
+QgsGeometry* QgsPointLocator::destGeometry( QgsFeatureId fid ) const
+{
+  QgsFeature f;
+  if ( !mLayer->getFeatures( QgsFeatureRequest( fid ).setSubsetOfAttributes( QgsAttributeList() ) ).nextFeature( f ) || !f.constGeometry() )
+    return nullptr;
+
+  if ( mTransform )
+  {
+    try
+    {
+      f.geometry()->transform( *mTransform );
+    }
+    catch ( const QgsException& e )
+    {
+      Q_UNUSED( e );
+      // See http://hub.qgis.org/issues/12634
+      QgsDebugMsg( QString( "could not transform geometry to map, skipping the snap for it (%1)" ).arg( e.what() ) );
+      return nullptr;
+    }
+  }
+
+  if ( f.constGeometry()->boundingBox().isNull() )
+    return nullptr;
+
+  return new QgsGeometry( *f.constGeometry() );
 }
 
 
@@ -769,10 +1166,40 @@ void QgsPointLocator::destroyIndex()
   qDeleteAll( mGeoms );
 
   mGeoms.clear();
+
+  qDeleteAll( mTiles );
+  mTiles.clear();
+  mTileQueue.clear();
+  // a tile being built is discarded when it is ready
+  ++mTileGeneration;
+
+  if ( mAreaEngine )
+    mAreaEngine->clearCache();
 }
 
 void QgsPointLocator::onFeatureAdded( QgsFeatureId fid )
 {
+  if ( mTileSize > 0 )
+  {
+    if ( mTileBuildRunning )
+      mEditedWhileBuilding << fid;
+    if ( mTiles.isEmpty() )
+      return;
+
+    QgsGeometry* geom = destGeometry( fid );
+    if ( !geom )
+      return;
+
+    QgsRectangle bbox = geom->boundingBox();
+    Q_FOREACH ( QgsPointLocator_Tile* tile, mTiles )
+    {
+      if ( tile->rect.intersects( bbox ) )
+        tile->insertFeature( fid, new QgsGeometry( *geom ) );
+    }
+    delete geom;
+    return;
+  }
+
   if ( !mRTree )
   {
     if ( mIsEmptyLayer )
@@ -816,6 +1243,17 @@ void QgsPointLocator::onFeatureAdded( QgsFeatureId fid )
 
 void QgsPointLocator::onFeatureDeleted( QgsFeatureId fid )
 {
+  if ( mTileSize > 0 )
+  {
+    if ( mTileBuildRunning )
+      mEditedWhileBuilding << fid;
+    Q_FOREACH ( QgsPointLocator_Tile* tile, mTiles )
+      tile->removeFeature( fid );
+    if ( mAreaEngine )
+      mAreaEngine->invalidateGeometry( fid );
+    return;
+  }
+
   if ( !mRTree )
     return; // nothing to do if we are not initialized yet
 
@@ -824,6 +1262,9 @@ void QgsPointLocator::onFeatureDeleted( QgsFeatureId fid )
     mRTree->deleteData( rect2region( mGeoms[fid]->boundingBox() ), fid );
     delete mGeoms.take( fid );
   }
+
+  if ( mAreaEngine )
+    mAreaEngine->invalidateGeometry( fid );
 }
 
 void QgsPointLocator::onGeometryChanged( QgsFeatureId fid, QgsGeometry& geom )
@@ -836,6 +1277,24 @@ void QgsPointLocator::onGeometryChanged( QgsFeatureId fid, QgsGeometry& geom )
 
 QgsPointLocator::Match QgsPointLocator::nearestVertex( const QgsPoint& point, double tolerance, MatchFilter* filter )
 {
+  if ( mTileSize > 0 )
+  {
+    Match m;
+    QgsRectangle rect( point.x() - tolerance, point.y() - tolerance, point.x() + tolerance, point.y() + tolerance );
+    QgsPointLocator_Tile* temporaryTile;
+    Q_FOREACH ( QgsPointLocator_Tile* tile, tilesForQuery( rect, temporaryTile ) )
+    {
+      if ( !tile->rtree )
+        continue;
+      QgsPointLocator_VisitorNearestVertex visitor( this, tile->geoms, m, point, filter );
+      tile->rtree->intersectsWithQuery( rect2region( rect ), visitor );
+    }
+    delete temporaryTile;
+    if ( m.isValid() && m.distance() > tolerance )
+      return Match();
+    return m;
+  }
+
   if ( !mRTree )
   {
     init();
@@ -844,7 +1303,7 @@ QgsPointLocator::Match QgsPointLocator::nearestVertex( const QgsPoint& point, do
   }
 
   Match m;
-  QgsPointLocator_VisitorNearestVertex visitor( this, m, point, filter );
+  QgsPointLocator_VisitorNearestVertex visitor( this, mGeoms, m, point, filter );
   QgsRectangle rect( point.x() - tolerance, point.y() - tolerance, point.x() + tolerance, point.y() + tolerance );
   mRTree->intersectsWithQuery( rect2region( rect ), visitor );
   if ( m.isValid() && m.distance() > tolerance )
@@ -854,6 +1313,27 @@ QgsPointLocator::Match QgsPointLocator::nearestVertex( const QgsPoint& point, do
 
 QgsPointLocator::Match QgsPointLocator::nearestEdge( const QgsPoint& point, double tolerance, MatchFilter* filter )
 {
+  if ( mTileSize > 0 )
+  {
+    if ( mLayer->geometryType() == QGis::Point )
+      return Match();
+
+    Match m;
+    QgsRectangle rect( point.x() - tolerance, point.y() - tolerance, point.x() + tolerance, point.y() + tolerance );
+    QgsPointLocator_Tile* temporaryTile;
+    Q_FOREACH ( QgsPointLocator_Tile* tile, tilesForQuery( rect, temporaryTile ) )
+    {
+      if ( !tile->rtree )
+        continue;
+      QgsPointLocator_VisitorNearestEdge visitor( this, tile->geoms, m, point, filter );
+      tile->rtree->intersectsWithQuery( rect2region( rect ), visitor );
+    }
+    delete temporaryTile;
+    if ( m.isValid() && m.distance() > tolerance )
+      return Match();
+    return m;
+  }
+
   if ( !mRTree )
   {
     init();
@@ -866,7 +1346,7 @@ QgsPointLocator::Match QgsPointLocator::nearestEdge( const QgsPoint& point, doub
     return Match();
 
   Match m;
-  QgsPointLocator_VisitorNearestEdge visitor( this, m, point, filter );
+  QgsPointLocator_VisitorNearestEdge visitor( this, mGeoms, m, point, filter );
   QgsRectangle rect( point.x() - tolerance, point.y() - tolerance, point.x() + tolerance, point.y() + tolerance );
   mRTree->intersectsWithQuery( rect2region( rect ), visitor );
   if ( m.isValid() && m.distance() > tolerance )
@@ -876,6 +1356,40 @@ QgsPointLocator::Match QgsPointLocator::nearestEdge( const QgsPoint& point, doub
 
 QgsPointLocator::MatchList QgsPointLocator::edgesInRect( const QgsRectangle& rect, QgsPointLocator::MatchFilter* filter )
 {
+  if ( mTileSize > 0 )
+  {
+    if ( mLayer->geometryType() == QGis::Point )
+      return MatchList();
+
+    MatchList lst;
+    QgsPointLocator_Tile* temporaryTile;
+    QList<QgsPointLocator_Tile*> tiles = tilesForQuery( rect, temporaryTile );
+    Q_FOREACH ( QgsPointLocator_Tile* tile, tiles )
+    {
+      if ( !tile->rtree )
+        continue;
+      QgsPointLocator_VisitorEdgesInRect visitor( this, tile->geoms, lst, rect, filter );
+      tile->rtree->intersectsWithQuery( rect2region( rect ), visitor );
+    }
+    delete temporaryTile;
+    if ( tiles.count() < 2 )
+      return lst;
+
+    // features spanning several tiles have been visited once per tile
+    MatchList unique;
+    QSet< QPair<QgsFeatureId, int> > seen;
+    Q_FOREACH ( const Match& m, lst )
+    {
+      QPair<QgsFeatureId, int> edge( m.featureId(), m.vertexIndex() );
+      if ( !seen.contains( edge ) )
+      {
+        seen.insert( edge );
+        unique << m;
+      }
+    }
+    return unique;
+  }
+
   if ( !mRTree )
   {
     init();
@@ -888,7 +1402,7 @@ QgsPointLocator::MatchList QgsPointLocator::edgesInRect( const QgsRectangle& rec
     return MatchList();
 
   MatchList lst;
-  QgsPointLocator_VisitorEdgesInRect visitor( this, lst, rect, filter );
+  QgsPointLocator_VisitorEdgesInRect visitor( this, mGeoms, lst, rect, filter );
   mRTree->intersectsWithQuery( rect2region( rect ), visitor );
 
   return lst;
@@ -903,7 +1417,7 @@ QgsPointLocator::MatchList QgsPointLocator::edgesInRect( const QgsPoint& point,
 
 QgsPointLocator::MatchList QgsPointLocator::pointInPolygon( const QgsPoint& point )
 {
-  if ( !mRTree )
+  if ( !mRTree && mTileSize <= 0 )
   {
     init();
     if ( !mRTree ) // still invalid?
@@ -914,8 +1428,41 @@ QgsPointLocator::MatchList QgsPointLocator::pointInPolygon( const QgsPoint& poin
   if ( geomType == QGis::Point || geomType == QGis::Line )
     return MatchList();
 
+  QList<QgsFeatureId> ids;
+  QHash<QgsFeatureId, QgsGeometry*> candidates;
+  QScopedPointer<QgsPointLocator_Tile> temporaryTile;
+  if ( mTileSize > 0 )
+  {
+    QgsPointLocator_Tile* tmp;
+    Q_FOREACH ( QgsPointLocator_Tile* tile, tilesForQuery( QgsRectangle( point, point ), tmp ) )
+    {
+      if ( !tile->rtree )
+        continue;
+      QgsPointLocator_VisitorArea visitor( tile->geoms, ids, candidates );
+      tile->rtree->intersectsWithQuery( point2point( point ), visitor );
+    }
+    temporaryTile.reset( tmp );
+  }
+  else
+  {
+    QgsPointLocator_VisitorArea visitor( mGeoms, ids, candidates );
+    mRTree->intersectsWithQuery( point2point( point ), visitor );
+  }
+  if ( ids.isEmpty() )
+    return MatchList();
+
+  // polygons stay converted to GEOS between queries, only the point is converted each time
+  if ( !mAreaEngine )
+    mAreaEngine = new QgsGeometryPredicateEngine();
+  QScopedPointer< QgsGeometry > pointGeom( QgsGeometry::fromPoint( point ) );
+  mAreaEngine->setReferenceGeometry( pointGeom.data() );
+  QgsFeatureIds matching = mAreaEngine->evaluate( QgsGeometryPredicateEngine::Intersects, candidates );
+
   MatchList lst;
-  QgsPointLocator_VisitorArea visitor( this, point, lst );
-  mRTree->intersectsWithQuery( point2point( point ), visitor );
+  Q_FOREACH ( QgsFeatureId id, ids )
+  {
+    if ( matching.contains( id ) )
+      lst << QgsPointLocator::Match( QgsPointLocator::Area, mLayer, id, 0, QgsPoint() );
+  }
   return lst;
 }
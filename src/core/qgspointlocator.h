@@ -23,13 +23,18 @@ class QgsVectorLayer;
 #include "qgspoint.h"
 #include "qgsrectangle.h"
 
+#include <QFutureWatcher>
+
 class QgsCoordinateTransform;
 class QgsCoordinateReferenceSystem;
+class QgsGeometryPredicateEngine;
+class QgsFeatureRequest;
 
 class QgsPointLocator_VisitorNearestVertex;
 class QgsPointLocator_VisitorNearestEdge;
 class QgsPointLocator_VisitorArea;
 class QgsPointLocator_VisitorEdgesInRect;
+class QgsPointLocator_Tile;
 
 namespace SpatialIndex
 {
@@ -95,6 +100,48 @@ class CORE_EXPORT QgsPointLocator : public QObject
     /** Indicate whether the data have been already indexed */
     bool hasIndex() const;
 
+    /** Switches the locator to a tiled index. Instead of indexing the whole layer (or extent) at once,
+     * the plane is split into square tiles and only the tiles touched by queries are indexed.
+     * Missing tiles are indexed one by one in a background thread, the most recently requested
+     * tile first. Until a tile is ready, queries are answered from the features of the query
+     * rectangle, fetched directly from the layer. When the estimated memory used by the indexed
+     * tiles exceeds the budget, the least recently used tiles are dropped. Edits of the layer
+     * are applied to the indexed tiles.
+     * With a tiled index, init() does nothing and hasIndex() always returns true.
+     * @param tileSize size of a tile in destination CRS units. Use 0 to switch back to a single index.
+     * @param memoryBudget maximum estimated memory in bytes used by the indexed tiles
+     * @note added in QGIS 2.18
+     */
+    void setTiling( double tileSize, qint64 memoryBudget = 64 * 1024 * 1024 );
+
+    /** Returns the size of a tile of the tiled index, or 0 if the layer is indexed at once
+     * @see setTiling()
+     * @note added in QGIS 2.18
+     */
+    double tileSize() const { return mTileSize; }
+
+    /** Returns true if the locator uses a tiled index
+     * @see setTiling()
+     * @note added in QGIS 2.18
+     */
+    bool isTiled() const { return mTileSize > 0; }
+
+    /** Returns the maximum estimated memory in bytes used by the indexed tiles
+     * @see setTiling()
+     * @note added in QGIS 2.18
+     */
+    qint64 tileMemoryBudget() const { return mTileMemoryBudget; }
+
+    /** Returns the number of indexed tiles
+     * @note added in QGIS 2.18
+     */
+    int cachedTileCount() const { return mTiles.count(); }
+
+    /** Returns true if tiles are waiting to be indexed or being indexed in the background
+     * @note added in QGIS 2.18
+     */
+    bool hasPendingTiles() const { return mTileBuildRunning || !mTileQueue.isEmpty(); }
+
     struct Match
     {
       //! construct invalid match
@@ -202,8 +249,9 @@ class CORE_EXPORT QgsPointLocator : public QObject
     //
 
     //! Return how many geometries are cached in the index
+    //! With a tiled index, features spanning several tiles are counted once per tile.
     //! @note added in QGIS 2.14
-    int cachedGeometryCount() const { return mGeoms.count(); }
+    int cachedGeometryCount() const;
 
   protected:
     bool rebuildIndex( int maxFeaturesToIndex = -1 );
@@ -213,8 +261,25 @@ class CORE_EXPORT QgsPointLocator : public QObject
     void onFeatureAdded( QgsFeatureId fid );
     void onFeatureDeleted( QgsFeatureId fid );
     void onGeometryChanged( QgsFeatureId fid, QgsGeometry& geom );
+    void onTileBuilt();
 
   private:
+    typedef QPair<int, int> TileKey;
+
+    //! Returns the tiles covering a query rectangle. Tiles which are not indexed yet are scheduled
+    //! and a temporary index of the rectangle is returned in their place (to be deleted by the caller).
+    QList<QgsPointLocator_Tile*> tilesForQuery( const QgsRectangle& rect, QgsPointLocator_Tile*& temporaryTile );
+    //! Sets up a request for the features of a rectangle in destination CRS, returns false if there are none
+    bool tileRequest( const QgsRectangle& rect, QgsFeatureRequest& request ) const;
+    //! Returns the rectangle of a tile in destination CRS
+    QgsRectangle tileRect( const TileKey& key ) const;
+    //! Starts indexing the most recently requested tile if no tile is being indexed
+    void startNextTileBuild();
+    //! Drops the least recently used tiles until the budget is met
+    void evictTiles();
+    //! Fetches a feature and returns its geometry in destination CRS, or null
+    QgsGeometry* destGeometry( QgsFeatureId fid ) const;
+
     /** Storage manager */
     SpatialIndex::IStorageManager* mStorage;
 
@@ -229,10 +294,30 @@ class CORE_EXPORT QgsPointLocator : public QObject
     QgsVectorLayer* mLayer;
     QgsRectangle* mExtent;
 
+    //! keeps GEOS versions of polygons tested by pointInPolygon()
+    QgsGeometryPredicateEngine* mAreaEngine;
+
+    //! size of a tile, 0 if the layer is indexed at once
+    double mTileSize;
+    qint64 mTileMemoryBudget;
+    QHash<TileKey, QgsPointLocator_Tile*> mTiles;
+    //! tiles waiting to be indexed, most recently requested last
+    QList<TileKey> mTileQueue;
+    QFutureWatcher<QgsPointLocator_Tile*> mTileWatcher;
+    bool mTileBuildRunning;
+    TileKey mBuildingTile;
+    //! features edited while a tile is indexed from a snapshot of the layer
+    QgsFeatureIds mEditedWhileBuilding;
+    //! incremented whenever the tiles are dropped, so that results of outdated builds are discarded
+    int mTileGeneration;
+    //! counter used to find the least recently used tiles
+    quint64 mTileUseCounter;
+
     friend class QgsPointLocator_VisitorNearestVertex;
     friend class QgsPointLocator_VisitorNearestEdge;
     friend class QgsPointLocator_VisitorArea;
     friend class QgsPointLocator_VisitorEdgesInRect;
+    friend class QgsPointLocator_Tile;
 };
 
 
@@ -37,6 +37,7 @@ QgsRenderContext::QgsRenderContext()
     , mFeatureFilterProvider( nullptr )
     , mSegmentationTolerance( M_PI_2 / 90 )
     , mSegmentationToleranceType( QgsAbstractGeometryV2::MaximumAngle )
+    , mProfiler( nullptr )
 {
   mVectorSimplifyMethod.setSimplifyHints( QgsVectorSimplifyMethod::NoSimplification );
 }
@@ -60,6 +61,8 @@ QgsRenderContext::QgsRenderContext( const QgsRenderContext& rh )
     , mFeatureFilterProvider( rh.mFeatureFilterProvider ? rh.mFeatureFilterProvider->clone() : nullptr )
     , mSegmentationTolerance( rh.mSegmentationTolerance )
     , mSegmentationToleranceType( rh.mSegmentationToleranceType )
+    , mProfiler( rh.mProfiler )
+    , mProfilerLayerId( rh.mProfilerLayerId )
 {
 }
 
@@ -83,6 +86,8 @@ QgsRenderContext&QgsRenderContext::operator=( const QgsRenderContext & rh )
   mFeatureFilterProvider = rh.mFeatureFilterProvider ? rh.mFeatureFilterProvider->clone() : nullptr;
   mSegmentationTolerance = rh.mSegmentationTolerance;
   mSegmentationToleranceType = rh.mSegmentationToleranceType;
+  mProfiler = rh.mProfiler;
+  mProfilerLayerId = rh.mProfilerLayerId;
   return *this;
 }
 
@@ -34,6 +34,7 @@ class QgsLabelingEngineInterface;
 class QgsLabelingEngineV2;
 class QgsMapSettings;
 class QgsFeatureFilterProvider;
+class QgsRenderProfiler;
 
 
 /** \ingroup core
@@ -234,6 +235,28 @@ class CORE_EXPORT QgsRenderContext
     /** Gets segmentation tolerance type (maximum angle or maximum difference between curve and approximation)*/
     QgsAbstractGeometryV2::SegmentationToleranceType segmentationToleranceType() const { return mSegmentationToleranceType; }
 
+    /** Sets the profiler which collects the time spent in the rendering stages.
+     * @param profiler render profiler, or nullptr to disable profiling. Ownership is not transferred.
+     * @param layerId ID of the layer the times are recorded for, empty for stages which are not
+     * specific to a layer
+     * @see profiler()
+     * @note added in QGIS 2.18
+     */
+    void setProfiler( QgsRenderProfiler* profiler, const QString& layerId = QString() ) { mProfiler = profiler; mProfilerLayerId = layerId; }
+
+    /** Returns the profiler which collects the time spent in the rendering stages, or nullptr
+     * if rendering is not profiled.
+     * @see setProfiler()
+     * @note added in QGIS 2.18
+     */
+    QgsRenderProfiler* profiler() const { return mProfiler; }
+
+    /** Returns the ID of the layer the profiled times are recorded for.
+     * @see setProfiler()
+     * @note added in QGIS 2.18
+     */
+    QString profilerLayerId() const { return mProfilerLayerId; }
+
   private:
 
     Flags mFlags;
@@ -284,6 +307,9 @@ class CORE_EXPORT QgsRenderContext
     double mSegmentationTolerance;
 
     QgsAbstractGeometryV2::SegmentationToleranceType mSegmentationToleranceType;
+
+    QgsRenderProfiler* mProfiler;
+    QString mProfilerLayerId;
 };
 
 Q_DECLARE_OPERATORS_FOR_FLAGS( QgsRenderContext::Flags )
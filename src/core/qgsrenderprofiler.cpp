@@ -0,0 +1,224 @@
+/***************************************************************************
+                         qgsrenderprofiler.cpp
+                         ---------------------
+    begin                : October 2018
+    copyright            : (C) 2018 by NextGIS
+    email                : info at nextgis dot com
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "qgsrenderprofiler.h"
+#include "qgsrendercontext.h"
+
+#include <QCoreApplication>
+#include <QMutexLocker>
+#include <QSet>
+
+uint qHash( const QgsRenderProfiler::Key& key )
+{
+  return qHash( key.layerId ) ^ qHash( key.detail ) ^ static_cast< uint >( key.stage * 0x9e3779b9 );
+}
+
+static bool entryTimeGreaterThan( const QgsRenderProfiler::Entry& e1, const QgsRenderProfiler::Entry& e2 )
+{
+  return e1.time > e2.time;
+}
+
+QgsRenderProfiler::QgsRenderProfiler()
+{
+}
+
+void QgsRenderProfiler::addTime( const QString& layerId, Stage stage, const QString& detail, qint64 nsecs )
+{
+  Key key = { layerId, stage, detail };
+
+  QMutexLocker locker( &mMutex );
+  QHash<Key, Entry>::iterator it = mEntries.find( key );
+  if ( it == mEntries.end() )
+  {
+    Entry entry = { layerId, stage, detail, 0.0, 0 };
+    it = mEntries.insert( key, entry );
+  }
+  it.value().time += nsecs / 1000000.0;
+  it.value().count++;
+}
+
+QList<QgsRenderProfiler::Entry> QgsRenderProfiler::entries() const
+{
+  QMutexLocker locker( &mMutex );
+  return mEntries.values();
+}
+
+QList<QgsRenderProfiler::Entry> QgsRenderProfiler::entries( const QString& layerId ) const
+{
+  QList<Entry> result;
+  QMutexLocker locker( &mMutex );
+  QHash<Key, Entry>::const_iterator it = mEntries.constBegin();
+  for ( ; it != mEntries.constEnd(); ++it )
+  {
+    if ( it.key().layerId == layerId )
+      result << it.value();
+  }
+  return result;
+}
+
+QStringList QgsRenderProfiler::layerIds() const
+{
+  QSet<QString> ids;
+  QMutexLocker locker( &mMutex );
+  QHash<Key, Entry>::const_iterator it = mEntries.constBegin();
+  for ( ; it != mEntries.constEnd(); ++it )
+  {
+    ids.insert( it.key().layerId );
+  }
+  return ids.toList();
+}
+
+double QgsRenderProfiler::totalTime( const QString& layerId, Stage stage ) const
+{
+  double total = 0.0;
+  QMutexLocker locker( &mMutex );
+  QHash<Key, Entry>::const_iterator it = mEntries.constBegin();
+  for ( ; it != mEntries.constEnd(); ++it )
+  {
+    if ( it.key().stage == stage && it.key().layerId == layerId )
+      total += it.value().time;
+  }
+  return total;
+}
+
+void QgsRenderProfiler::merge( const QgsRenderProfiler& other )
+{
+  if ( &other == this )
+    return;
+
+  QList<Entry> otherEntries = other.entries();
+
+  QMutexLocker locker( &mMutex );
+  Q_FOREACH ( const Entry& entry, otherEntries )
+  {
+    Key key = { entry.layerId, entry.stage, entry.detail };
+    QHash<Key, Entry>::iterator it = mEntries.find( key );
+    if ( it == mEntries.end() )
+    {
+      mEntries.insert( key, entry );
+    }
+    else
+    {
+      it.value().time += entry.time;
+      it.value().count += entry.count;
+    }
+  }
+}
+
+void QgsRenderProfiler::clear()
+{
+  QMutexLocker locker( &mMutex );
+  mEntries.clear();
+}
+
+bool QgsRenderProfiler::isEmpty() const
+{
+  QMutexLocker locker( &mMutex );
+  return mEntries.isEmpty();
+}
+
+QString QgsRenderProfiler::stageName( Stage stage )
+{
+  switch ( stage )
+  {
+    case LayerTotal:
+      return QCoreApplication::translate( "QgsRenderProfiler", "Total" );
+    case FeatureFetch:
+      return QCoreApplication::translate( "QgsRenderProfiler", "Feature fetching" );
+    case ExpressionEvaluation:
+      return QCoreApplication::translate( "QgsRenderProfiler", "Expression evaluation" );
+    case CoordinateTransform:
+      return QCoreApplication::translate( "QgsRenderProfiler", "Coordinate transform" );
+    case Simplification:
+      return QCoreApplication::translate( "QgsRenderProfiler", "Clipping and simplification" );
+    case SymbolLayerRendering:
+      return QCoreApplication::translate( "QgsRenderProfiler", "Symbol layers" );
+    case LabelCandidates:
+      return QCoreApplication::translate( "QgsRenderProfiler", "Label candidates" );
+    case LabelSolving:
+      return QCoreApplication::translate( "QgsRenderProfiler", "Label placement" );
+    case LabelRendering:
+      return QCoreApplication::translate( "QgsRenderProfiler", "Label drawing" );
+  }
+  return QString();
+}
+
+QString QgsRenderProfiler::report() const
+{
+  QList<Entry> allEntries = entries();
+  qSort( allEntries.begin(), allEntries.end(), entryTimeGreaterThan );
+
+  QStringList ids = layerIds();
+  qSort( ids );
+
+  QString text;
+  Q_FOREACH ( const QString& layerId, ids )
+  {
+    text += ( layerId.isEmpty() ? QCoreApplication::translate( "QgsRenderProfiler", "(map)" ) : layerId ) + '\n';
+    Q_FOREACH ( const Entry& entry, allEntries )
+    {
+      if ( entry.layerId != layerId )
+        continue;
+
+      QString name = stageName( entry.stage );
+      if ( !entry.detail.isEmpty() )
+        name += QString( " [%1]" ).arg( entry.detail );
+      text += QString( "  %1 ms\t%2 calls\t%3\n" ).arg( entry.time, 0, 'f', 1 ).arg( entry.count ).arg( name );
+    }
+  }
+  return text;
+}
+
+
+QgsRenderProfilerScope::QgsRenderProfilerScope( const QgsRenderContext& context, QgsRenderProfiler::Stage stage )
+    : mProfiler( context.profiler() )
+    , mStage( stage )
+{
+  if ( mProfiler )
+  {
+    mLayerId = context.profilerLayerId();
+    mTimer.start();
+  }
+}
+
+QgsRenderProfilerScope::QgsRenderProfilerScope( QgsRenderProfiler* profiler, const QString& layerId, QgsRenderProfiler::Stage stage )
+    : mProfiler( profiler )
+    , mStage( stage )
+{
+  if ( mProfiler )
+  {
+    mLayerId = layerId;
+    mTimer.start();
+  }
+}
+
+QgsRenderProfilerScope::~QgsRenderProfilerScope()
+{
+  if ( mProfiler )
+    mProfiler->addTime( mLayerId, mStage, mDetail, mTimer.nsecsElapsed() );
+}
+
+void QgsRenderProfilerScope::setStage( QgsRenderProfiler::Stage stage )
+{
+  if ( !mProfiler )
+    return;
+
+  mProfiler->addTime( mLayerId, mStage, mDetail, mTimer.nsecsElapsed() );
+  mStage = stage;
+  mDetail.clear();
+  mTimer.start();
+}
@@ -0,0 +1,193 @@
+/***************************************************************************
+                         qgsrenderprofiler.h
+                         -------------------
+    begin                : October 2018
+    copyright            : (C) 2018 by NextGIS
+    email                : info at nextgis dot com
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#ifndef QGSRENDERPROFILER_H
+#define QGSRENDERPROFILER_H
+
+#include <QElapsedTimer>
+#include <QHash>
+#include <QList>
+#include <QMutex>
+#include <QString>
+#include <QStringList>
+
+class QgsRenderContext;
+
+/** \ingroup core
+ * \class QgsRenderProfiler
+ * \brief Collects the time spent in the individual stages of map rendering.
+ *
+ * A profiler is attached to a map render job with QgsMapRendererJob::setProfiler(). While
+ * the job runs, the time spent fetching features, evaluating expressions, transforming,
+ * clipping and simplifying geometries, drawing every symbol layer and generating, solving
+ * and drawing labels is accumulated per map layer. Each entry also carries a detail string,
+ * e.g. the type and position of a symbol layer, so that costly style elements can be
+ * identified.
+ *
+ * Times are summed over all calls. Map render jobs record the times of every layer in a
+ * profiler of its own and merge them into the job's profiler when the layer is done, so
+ * that layers rendered in parallel do not wait for each other. Profiling adds some overhead
+ * to rendering, so it should only be enabled while investigating performance.
+ *
+ * \note added in QGIS 2.18
+ */
+class CORE_EXPORT QgsRenderProfiler
+{
+  public:
+
+    //! Profiled rendering stages
+    enum Stage
+    {
+      LayerTotal, //!< Total time spent rendering a layer
+      FeatureFetch, //!< Preparing feature requests and fetching features from the data provider
+      ExpressionEvaluation, //!< Evaluating rules and classification expressions to choose feature symbols
+      CoordinateTransform, //!< Transforming geometries to the destination CRS and to screen coordinates
+      Simplification, //!< Reading, clipping and simplifying geometries before they are drawn
+      SymbolLayerRendering, //!< Drawing with a symbol layer
+      LabelCandidates, //!< Registering label features and generating label candidates
+      LabelSolving, //!< Solving the label placement problem
+      LabelRendering, //!< Drawing the placed labels
+    };
+
+    //! Accumulated time for a layer, stage and detail
+    struct Entry
+    {
+      //! Map layer ID, empty for stages which are not specific to a layer
+      QString layerId;
+      //! Rendering stage
+      QgsRenderProfiler::Stage stage;
+      //! Detail within the stage, e.g. the symbol layer
+      QString detail;
+      //! Total time in milliseconds
+      double time;
+      //! Number of timed calls
+      int count;
+    };
+
+    QgsRenderProfiler();
+
+    /** Adds the time of a call to the totals of a layer, stage and detail.
+     * @param layerId map layer ID, or an empty string for stages which are not specific to a layer
+     * @param stage rendering stage
+     * @param detail detail within the stage, may be empty
+     * @param nsecs elapsed time in nanoseconds
+     */
+    void addTime( const QString& layerId, Stage stage, const QString& detail, qint64 nsecs );
+
+    //! Returns all recorded entries
+    QList<QgsRenderProfiler::Entry> entries() const;
+
+    //! Returns the recorded entries of a layer
+    QList<QgsRenderProfiler::Entry> entries( const QString& layerId ) const;
+
+    //! Returns the IDs of all layers with recorded entries
+    QStringList layerIds() const;
+
+    /** Returns the total time in milliseconds recorded for a stage of a layer, summed over all details.
+     */
+    double totalTime( const QString& layerId, Stage stage ) const;
+
+    //! Adds the entries recorded by another profiler to the totals of this profiler
+    void merge( const QgsRenderProfiler& other );
+
+    //! Removes all recorded entries
+    void clear();
+
+    //! Returns true if no times have been recorded
+    bool isEmpty() const;
+
+    //! Returns a translated, user friendly name for a stage
+    static QString stageName( Stage stage );
+
+    //! Returns a plain text report of all entries, sorted by layer and by decreasing time
+    QString report() const;
+
+  private:
+
+    struct Key
+    {
+      QString layerId;
+      int stage;
+      QString detail;
+
+      bool operator==( const Key& other ) const
+      {
+        return stage == other.stage && layerId == other.layerId && detail == other.detail;
+      }
+    };
+
+    friend uint qHash( const QgsRenderProfiler::Key& key );
+
+    mutable QMutex mMutex;
+    QHash<Key, Entry> mEntries;
+
+    QgsRenderProfiler( const QgsRenderProfiler& rh );
+    QgsRenderProfiler& operator=( const QgsRenderProfiler& rh );
+};
+
+/** \ingroup core
+ * \class QgsRenderProfilerScope
+ * \brief Times the lifetime of the object and adds it to a render profiler.
+ *
+ * If the render context has no profiler attached, the scope does nothing, so it can be
+ * placed in rendering code unconditionally. Scopes are meant to be created on the stack,
+ * consecutive stages of the same code are timed with setStage().
+ *
+ * \note not available in Python bindings
+ * \note added in QGIS 2.18
+ */
+class CORE_EXPORT QgsRenderProfilerScope
+{
+  public:
+
+    /** Starts timing a stage for the layer of a render context.
+     */
+    QgsRenderProfilerScope( const QgsRenderContext& context, QgsRenderProfiler::Stage stage );
+
+    /** Starts timing a stage for a layer.
+     * @param profiler profiler to add the time to. If null, nothing is timed.
+     * @param layerId map layer ID
+     * @param stage rendering stage
+     */
+    QgsRenderProfilerScope( QgsRenderProfiler* profiler, const QString& layerId, QgsRenderProfiler::Stage stage );
+
+    //! Adds the elapsed time to the profiler
+    ~QgsRenderProfilerScope();
+
+    //! Returns true if the scope is timed. Details should only be built for active scopes.
+    bool isActive() const { return nullptr != mProfiler; }
+
+    //! Sets the detail within the stage
+    void setDetail( const QString& detail ) { mDetail = detail; }
+
+    /** Adds the time elapsed so far to the current stage and starts timing another stage.
+     * The detail is cleared.
+     */
+    void setStage( QgsRenderProfiler::Stage stage );
+
+  private:
+    QgsRenderProfiler* mProfiler;
+    QString mLayerId;
+    QgsRenderProfiler::Stage mStage;
+    QString mDetail;
+    QElapsedTimer mTimer;
+
+    QgsRenderProfilerScope( const QgsRenderProfilerScope& rh );
+    QgsRenderProfilerScope& operator=( const QgsRenderProfilerScope& rh );
+};
+
+#endif // QGSRENDERPROFILER_H
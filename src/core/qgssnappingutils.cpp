@@ -96,6 +96,10 @@ bool QgsSnappingUtils::isIndexPrepared( QgsVectorLayer* vl, const QgsRectangle&
 
   QgsPointLocator* loc = locatorForLayer( vl );
 
+  // tiled locators index the tiles around the area of interest on their own
+  if ( loc->isTiled() )
+    return mStrategy == IndexHybrid;
+
   if ( mStrategy == IndexAlwaysFull && loc->hasIndex() )
     return true;
 
@@ -351,6 +355,9 @@ void QgsSnappingUtils::prepareIndex( const QList<LayerAndAreaOfInterest>& layers
       QTime tt;
       tt.start();
       QgsPointLocator* loc = locatorForLayer( vl );
+      if ( mStrategy != IndexHybrid && loc->isTiled() )
+        loc->setTiling( 0 );
+
       if ( mStrategy == IndexExtent )
       {
         QgsRectangle rect( mMapSettings.extent() );
@@ -386,20 +393,9 @@ void QgsSnappingUtils::prepareIndex( const QList<LayerAndAreaOfInterest>& layers
         }
         else
         {
-          // use area as big as we think may fit into our limit
-          QgsPoint c = entry.second.center();
-          double halfSide = sqrt( indexReasonableArea ) / 2;
-          QgsRectangle rect( c.x() - halfSide, c.y() - halfSide,
-                             c.x() + halfSide, c.y() + halfSide );
-          loc->setExtent( &rect );
-
-          // see if it's possible build index for this area
-          if ( !loc->init( mHybridPerLayerFeatureLimit ) )
-          {
-            // hmm that didn't work out - too many features!
-            // let's make the allowed area smaller for the next time
-            mHybridMaxAreaPerLayer[vl->id()] /= 4;
-          }
+          // index only the tiles visited by the cursor, built in the background.
+          // A tile is a quarter of the area we think may fit into our limit.
+          loc->setTiling( sqrt( indexReasonableArea ) / 2 );
         }
 
       }
@@ -552,7 +548,9 @@ QString QgsSnappingUtils::dump()
         }
         else
           extentStr = "full extent";
-        if ( loc->hasIndex() )
+        if ( loc->isTiled() )
+          cachedGeoms = QString( "%1 feats in %2 tiles of %3" ).arg( loc->cachedGeometryCount() ).arg( loc->cachedTileCount() ).arg( loc->tileSize() );
+        else if ( loc->hasIndex() )
           cachedGeoms = QString( "%1 feats" ).arg( loc->cachedGeometryCount() );
         else
           cachedGeoms = "not initialized";
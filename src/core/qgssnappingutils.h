@@ -88,7 +88,7 @@ class CORE_EXPORT QgsSnappingUtils : public QObject
     {
       IndexAlwaysFull,    //!< For all layers build index of full extent. Uses more memory, but queries are faster.
       IndexNeverFull,     //!< For all layers only create temporary indexes of small extent. Low memory usage, slower queries.
-      IndexHybrid,        //!< For "big" layers using IndexNeverFull, for the rest IndexAlwaysFull. Compromise between speed and memory usage.
+      IndexHybrid,        //!< For "big" layers index only the visited tiles (built in the background), for the rest IndexAlwaysFull. Compromise between speed and memory usage.
       IndexExtent         //!< For all layer build index of extent given in map settings
     };
 
@@ -229,11 +229,9 @@ class CORE_EXPORT QgsSnappingUtils : public QObject
     //! a record for each layer seen:
     //! - value -1  == it is small layer -> fully indexed
     //! - value > 0 == maximum area (in map units) for which it may make sense to build index.
-    //!   This means that index is built in area around the point with this total area, because
-    //!   for a larger area the number of features will likely exceed the limit. When the limit
-    //!   is exceeded, the maximum area is lowered to prevent that from happening.
-    //!   When requesting snap in area that is not currently indexed, layer's index is destroyed
-    //!   and a new one is built in the different area.
+    //!   The layer gets a tiled index with tiles of a quarter of this area, because for a larger
+    //!   area the number of features will likely exceed the limit. Tiles are indexed in the
+    //!   background when they are visited and the least recently used ones are dropped.
     QHash<QString, double> mHybridMaxAreaPerLayer;
     //! if using hybrid strategy, how many features of one layer may be indexed (to limit amount of consumed memory)
     int mHybridPerLayerFeatureLimit;
@@ -20,7 +20,12 @@
 #include "qgsgeos.h"
 #include "qgslogger.h"
 #include "qgsvectorlayer.h"
+#include "qgsvectorlayerfeatureiterator.h"
 
+#include <QtConcurrentRun>
+#include <qmath.h>
+
+#include <algorithm>
 #include <queue>
 #include <vector>
 
@@ -87,7 +92,13 @@ double closestSegment( const QgsPolyline& pl, const QgsPoint& pt, int& vertexAft
 /** Simple graph structure for shortest path search */
 struct QgsTracerGraph
 {
-  QgsTracerGraph() : joinedVertices( 0 ) {}
+  QgsTracerGraph()
+      : joinedVertices( 0 )
+      , gridCols( 0 )
+      , gridRows( 0 )
+      , cellSize( 0 )
+      , searchRun( 0 )
+  {}
 
   struct E  // bidirectional edge
   {
@@ -95,16 +106,18 @@ struct QgsTracerGraph
     int v1, v2;
     //! coordinates of the edge (including endpoints)
     QVector<QgsPoint> coords;
+    //! length of the edge
+    double w;
 
     int otherVertex( int v0 ) const { return v1 == v0 ? v2 : v1; }
-    double weight() const { return distance2D( coords ); }
+    double weight() const { return w; }
   };
 
   struct V
   {
     //! location of the vertex
     QgsPoint pt;
-    //! indices of adjacent edges (used in Dijkstra algorithm)
+    //! indices of adjacent edges (used in path search)
     QVector<int> edges;
   };
 
@@ -117,43 +130,111 @@ struct QgsTracerGraph
   QSet<int> inactiveEdges;
   //! Temporarily added vertices (for each there are two extra edges)
   int joinedVertices;
+
+  //! Vertex for each location (not including the temporarily added vertices)
+  QHash<QgsPoint, int> point2vertex;
+  //! Vertices where the linework was split at tile boundaries - they are left out of traced paths
+  QSet<QgsPoint> seams;
+
+  //! Uniform grid with the edges whose bounding box touches each cell
+  QgsRectangle gridExtent;
+  int gridCols, gridRows;
+  double cellSize;
+  QVector< QVector<int> > cells;
+
+  //! Search buffers reused between path searches. A vertex has a valid entry
+  //! only if its stamp matches the number of the current search.
+  QVector<double> searchDist;
+  QVector<int> searchEdge;
+  QVector<quint32> searchStamp;
+  QVector<quint32> searchClosed;
+  quint32 searchRun;
 };
 
 
-QgsTracerGraph* makeGraph( const QVector<QgsPolyline>& edges )
+static QgsRectangle polylineBoundingBox( const QgsPolyline& coords )
+{
+  QgsRectangle r( coords[0], coords[0] );
+  for ( int i = 1; i < coords.count(); ++i )
+    r.combineExtentWith( coords[i].x(), coords[i].y() );
+  return r;
+}
+
+
+//! Returns the range of grid cells covered by a rectangle, false if it is outside of the grid
+static bool gridCellRange( const QgsTracerGraph& g, const QgsRectangle& r, int& col0, int& row0, int& col1, int& row1 )
+{
+  if ( g.cells.isEmpty() || !g.gridExtent.intersects( r ) )
+    return false;
+
+  col0 = qBound( 0, static_cast<int>(( r.xMinimum() - g.gridExtent.xMinimum() ) / g.cellSize ), g.gridCols - 1 );
+  col1 = qBound( 0, static_cast<int>(( r.xMaximum() - g.gridExtent.xMinimum() ) / g.cellSize ), g.gridCols - 1 );
+  row0 = qBound( 0, static_cast<int>(( r.yMinimum() - g.gridExtent.yMinimum() ) / g.cellSize ), g.gridRows - 1 );
+  row1 = qBound( 0, static_cast<int>(( r.yMaximum() - g.gridExtent.yMinimum() ) / g.cellSize ), g.gridRows - 1 );
+  return true;
+}
+
+
+//! Returns the edges of the graph (not including the temporary ones) which may be within epsilon of a point
+static QVector<int> edgesNearPoint( const QgsTracerGraph& g, const QgsPoint& pt, double epsilon )
+{
+  QVector<int> result;
+  int col0, row0, col1, row1;
+  QgsRectangle r( pt.x() - epsilon, pt.y() - epsilon, pt.x() + epsilon, pt.y() + epsilon );
+  if ( !gridCellRange( g, r, col0, row0, col1, row1 ) )
+    return result;
+
+  for ( int row = row0; row <= row1; ++row )
+    for ( int col = col0; col <= col1; ++col )
+      result << g.cells[ row * g.gridCols + col ];
+
+  if ( col0 != col1 || row0 != row1 )
+  {
+    // edges spanning several cells are listed more than once
+    std::sort( result.begin(), result.end() );
+    result.erase( std::unique( result.begin(), result.end() ), result.end() );
+  }
+  return result;
+}
+
+
+QgsTracerGraph* makeGraph( const QVector<QgsPolyline>& edges, const QSet<QgsPoint>& seams = QSet<QgsPoint>() )
 {
   QgsTracerGraph *g = new QgsTracerGraph();
   g->joinedVertices = 0;
-  QHash<QgsPoint, int> point2vertex;
+  g->seams = seams;
 
   Q_FOREACH ( const QgsPolyline& line, edges )
   {
+    if ( line.count() < 2 )
+      continue;
+
     QgsPoint p1( line[0] );
     QgsPoint p2( line[line.count() - 1] );
 
     int v1 = -1, v2 = -1;
     // get or add vertex 1
-    if ( point2vertex.contains( p1 ) )
-      v1 = point2vertex.value( p1 );
+    if ( g->point2vertex.contains( p1 ) )
+      v1 = g->point2vertex.value( p1 );
     else
     {
       v1 = g->v.count();
       QgsTracerGraph::V v;
       v.pt = p1;
       g->v.append( v );
-      point2vertex[p1] = v1;
+      g->point2vertex[p1] = v1;
     }
 
     // get or add vertex 2
-    if ( point2vertex.contains( p2 ) )
-      v2 = point2vertex.value( p2 );
+    if ( g->point2vertex.contains( p2 ) )
+      v2 = g->point2vertex.value( p2 );
     else
     {
       v2 = g->v.count();
       QgsTracerGraph::V v;
       v.pt = p2;
       g->v.append( v );
-      point2vertex[p2] = v2;
+      g->point2vertex[p2] = v2;
     }
 
     // add edge
@@ -161,6 +242,7 @@ QgsTracerGraph* makeGraph( const QVector<QgsPolyline>& edges )
     e.v1 = v1;
     e.v2 = v2;
     e.coords = line;
+    e.w = distance2D( line );
     g->e.append( e );
 
     // link edge to vertices
@@ -169,31 +251,84 @@ QgsTracerGraph* makeGraph( const QVector<QgsPolyline>& edges )
     g->v[v2].edges << eIdx;
   }
 
+  if ( g->e.isEmpty() )
+    return g;
+
+  // index the edges in a grid with roughly one edge per cell
+  QVector<QgsRectangle> boxes( g->e.count() );
+  for ( int i = 0; i < g->e.count(); ++i )
+  {
+    boxes[i] = polylineBoundingBox( g->e[i].coords );
+    if ( i == 0 )
+      g->gridExtent = boxes[i];
+    else
+      g->gridExtent.combineExtentWith( boxes[i] );
+  }
+
+  int side = qMax( 1, static_cast<int>( sqrt( static_cast<double>( g->e.count() ) ) ) );
+  g->cellSize = qMax( g->gridExtent.width(), g->gridExtent.height() ) / side;
+  if ( g->cellSize <= 0 )
+    g->cellSize = 1;
+  g->gridCols = qMax( 1, static_cast<int>( ceil( g->gridExtent.width() / g->cellSize ) ) );
+  g->gridRows = qMax( 1, static_cast<int>( ceil( g->gridExtent.height() / g->cellSize ) ) );
+  g->cells.resize( g->gridCols * g->gridRows );
+
+  for ( int i = 0; i < boxes.count(); ++i )
+  {
+    int col0, row0, col1, row1;
+    gridCellRange( *g, boxes[i], col0, row0, col1, row1 );
+    for ( int row = row0; row <= row1; ++row )
+      for ( int col = col0; col <= col1; ++col )
+        g->cells[ row * g->gridCols + col ] << i;
+  }
+
   return g;
 }
 
 
-QVector<QgsPoint> shortestPath( const QgsTracerGraph& g, int v1, int v2 )
+QVector<QgsPoint> shortestPath( QgsTracerGraph& g, int v1, int v2 )
 {
   if ( v1 == -1 || v2 == -1 )
     return QVector<QgsPoint>(); // invalid input
 
-  // priority queue to drive Dijkstra:
-  // first of the pair is vertex index, second is distance
-  std::priority_queue< DijkstraQueueItem, std::vector< DijkstraQueueItem >, comp > Q;
+  // A* search - the straight line distance to the end vertex never overestimates
+  // the remaining length of the path, so the first time the end vertex is taken
+  // from the queue, its path is the shortest one.
+  const QgsPoint& target = g.v[v2].pt;
 
-  // shortest distances to each vertex
-  QVector<double> D( g.v.count(), std::numeric_limits<double>::max() );
-  D[v1] = 0;
+  // priority queue to drive the search:
+  // first of the pair is vertex index, second is the distance from the start
+  // plus the estimated distance to the end
+  std::priority_queue< DijkstraQueueItem, std::vector< DijkstraQueueItem >, comp > Q;
 
-  // whether vertices have been already processed
-  QVector<bool> F( g.v.count() );
+  // reuse the buffers of the previous searches
+  int count = g.v.count();
+  if ( g.searchStamp.count() < count )
+  {
+    g.searchDist.resize( count );
+    g.searchEdge.resize( count );
+    g.searchStamp.resize( count );
+    g.searchClosed.resize( count );
+  }
+  if ( ++g.searchRun == 0 )
+  {
+    // the counter wrapped around - clear the stamps
+    g.searchStamp.fill( 0 );
+    g.searchClosed.fill( 0 );
+    g.searchRun = 1;
+  }
+  const quint32 run = g.searchRun;
+  double* D = g.searchDist.data();      // shortest distances to each vertex
+  int* S = g.searchEdge.data();         // using which edge there is shortest path to each vertex
+  quint32* stamp = g.searchStamp.data();   // whether D and S are valid in this search
+  quint32* closed = g.searchClosed.data(); // whether vertices have been already processed
 
-  // using which edge there is shortest path to each vertex
-  QVector<int> S( g.v.count(), -1 );
+  D[v1] = 0;
+  S[v1] = -1;
+  stamp[v1] = run;
 
   int u = -1;
-  Q.push( DijkstraQueueItem( v1, 0 ) );
+  Q.push( DijkstraQueueItem( v1, sqrt( target.sqrDist( g.v[v1].pt ) ) ) );
 
   while ( !Q.empty() )
   {
@@ -203,38 +338,38 @@ QVector<QgsPoint> shortestPath( const QgsTracerGraph& g, int v1, int v2 )
     if ( u == v2 )
       break; // we can stop now, there won't be a shorter path
 
-    if ( F[u] )
+    if ( closed[u] == run )
       continue;  // ignore previously added path which is actually longer
 
     const QgsTracerGraph::V& vu = g.v[u];
     const int* vuEdges = vu.edges.constData();
-    int count = vu.edges.count();
-    for ( int i = 0; i < count; ++i )
+    int edgeCount = vu.edges.count();
+    for ( int i = 0; i < edgeCount; ++i )
     {
       const QgsTracerGraph::E& edge = g.e[ vuEdges[i] ];
       int v = edge.otherVertex( u );
-      double w = edge.weight();
-      if ( !F[v] && D[u] + w < D[v] )
+      if ( closed[v] == run )
+        continue;
+
+      double d = D[u] + edge.weight();
+      if ( stamp[v] != run || d < D[v] )
       {
         // found a shorter way to the vertex
-        D[v] = D[u] + w;
+        D[v] = d;
         S[v] = vuEdges[i];
-        Q.push( DijkstraQueueItem( v, D[v] ) );
+        stamp[v] = run;
+        Q.push( DijkstraQueueItem( v, d + sqrt( target.sqrDist( g.v[v].pt ) ) ) );
       }
     }
-    F[u] = 1; // mark the vertex as processed (we know the fastest path to it)
+    closed[u] = run; // mark the vertex as processed (we know the fastest path to it)
   }
 
   if ( u != v2 ) // there's no path to the end vertex
     return QVector<QgsPoint>();
 
-  //qDebug("dist %f", D[u]);
-
   QVector<QgsPoint> points;
-  QList<int> path;
   while ( S[u] != -1 )
   {
-    path << S[u];
     const QgsTracerGraph::E& e = g.e[S[u]];
     QVector<QgsPoint> edgePoints = e.coords;
     if ( edgePoints[0] != g.v[u].pt )
@@ -245,20 +380,53 @@ QVector<QgsPoint> shortestPath( const QgsTracerGraph& g, int v1, int v2 )
     u = e.otherVertex( u );
   }
 
-  std::reverse( path.begin(), path.end() );
-  //Q_FOREACH (int x, path)
-  //  qDebug("e: %d", x);
-
   std::reverse( points.begin(), points.end() );
+
+  if ( !g.seams.isEmpty() && points.count() > 2 )
+  {
+    // drop the vertices added at tile boundaries, they lie on straight segments of the input
+    QVector<QgsPoint> cleaned;
+    cleaned.reserve( points.count() );
+    cleaned << points.first();
+    for ( int i = 1; i < points.count() - 1; ++i )
+    {
+      if ( !g.seams.contains( points[i] ) )
+        cleaned << points[i];
+    }
+    cleaned << points.last();
+    points = cleaned;
+  }
+
   return points;
 }
 
 
 int point2vertex( const QgsTracerGraph& g, const QgsPoint& pt, double epsilon = 1e-6 )
 {
-  // TODO: use spatial index
+  int vertexCount = g.v.count() - g.joinedVertices;
+
+  int exact = g.point2vertex.value( pt, -1 );
+  if ( exact != -1 )
+    return exact;
+
+  // vertices near the point are endpoints of edges near the point
+  int best = -1;
+  Q_FOREACH ( int eIdx, edgesNearPoint( g, pt, epsilon ) )
+  {
+    const QgsTracerGraph::E& e = g.e.at( eIdx );
+    int ends[2] = { e.v1, e.v2 };
+    for ( int k = 0; k < 2; ++k )
+    {
+      const QgsPoint& vpt = g.v.at( ends[k] ).pt;
+      if ( fabs( vpt.x() - pt.x() ) < epsilon && fabs( vpt.y() - pt.y() ) < epsilon && ( best == -1 || ends[k] < best ) )
+        best = ends[k];
+    }
+  }
+  if ( best != -1 )
+    return best;
 
-  for ( int i = 0; i < g.v.count(); ++i )
+  // temporarily added vertices are not indexed
+  for ( int i = vertexCount; i < g.v.count(); ++i )
   {
     const QgsTracerGraph::V& v = g.v.at( i );
     if ( v.pt == pt || ( fabs( v.pt.x() - pt.x() ) < epsilon && fabs( v.pt.y() - pt.y() ) < epsilon ) )
@@ -273,7 +441,12 @@ int point2edge( const QgsTracerGraph& g, const QgsPoint& pt, int& lineVertexAfte
 {
   int vertexAfter;
 
-  for ( int i = 0; i < g.e.count(); ++i )
+  QVector<int> candidates = edgesNearPoint( g, pt, epsilon );
+  // temporarily added edges are not indexed
+  for ( int i = g.e.count() - g.joinedVertices * 2; i < g.e.count(); ++i )
+    candidates << i;
+
+  Q_FOREACH ( int i, candidates )
   {
     if ( g.inactiveEdges.contains( i ) )
       continue;  // ignore temporarily disabled edges
@@ -339,11 +512,13 @@ int joinVertexToGraph( QgsTracerGraph& g, const QgsPoint& pt )
   e1.v1 = e.v1;
   e1.v2 = vIdx;
   e1.coords = out1;
+  e1.w = distance2D( out1 );
 
   QgsTracerGraph::E e2;
   e2.v1 = vIdx;
   e2.v2 = e.v2;
   e2.coords = out2;
+  e2.w = distance2D( out2 );
 
   // update edge connectivity of existing vertices
   v1.edges.replace( v1.edges.indexOf( eIdx ), e1Idx );
@@ -449,56 +624,166 @@ void extractLinework( const QgsGeometry* g, QgsMultiPolyline& mpl )
   }
 }
 
-// -------------
-
+typedef QPair<QgsVectorLayer*, QgsFeatureId> QgsTracerFeatureKey;
 
-QgsTracer::QgsTracer()
-    : mGraph( 0 )
-    , mReprojectionEnabled( false )
-    , mMaxFeatureCount( 0 )
-    , mHasTopologyProblem( false )
+/** Noded linework of one tile of the graph */
+struct QgsTracerTile
 {
-}
+  QgsTracerTile()
+      : tooManyFeatures( false )
+      , topologyProblem( false )
+      , lastUsed( 0 )
+  {}
+
+  //! extent of the tile (empty if the whole layers are used)
+  QgsRectangle rect;
+  //! noded linework within the tile
+  QgsMultiPolyline lines;
+  //! points where the linework was split at the tile boundary
+  QSet<QgsPoint> seams;
+  //! bounding boxes of the features read for the tile
+  QHash<QgsTracerFeatureKey, QgsRectangle> features;
+  //! the tile has not been completed because of the limit of features
+  bool tooManyFeatures;
+  //! noding of the linework failed
+  bool topologyProblem;
+  //! value of the tracer's use counter when the tile was used last time
+  quint64 lastUsed;
+};
 
+/** Features of one layer read by a tile job. The source and the transform are owned by the job. */
+struct QgsTracerTileSource
+{
+  QgsVectorLayer* layer;
+  QgsAbstractFeatureSource* source;
+  QgsCoordinateTransform* ct;
+  QgsFeatureRequest request;
+};
 
-bool QgsTracer::initGraph()
+/** Everything needed to build a tile in a worker thread */
+struct QgsTracerTileJob
 {
-  if ( mGraph )
-    return true; // already initialized
+  QgsRectangle rect;
+  int col, row;
+  double tileSize;
+  int maxFeatureCount;
+  QList<QgsTracerTileSource> sources;
+};
 
-  mHasTopologyProblem = false;
+//! maximum number of tiles kept in memory
+static const int MAX_CACHED_TILES = 64;
 
-  QgsFeature f;
-  QgsMultiPolyline mpl;
 
-  // extract linestrings
+static bool splitPositionLessThan( const QPair<double, QgsPoint>& s1, const QPair<double, QgsPoint>& s2 )
+{
+  return s1.first < s2.first;
+}
 
-  // TODO: use QgsPointLocator as a source for the linework
 
-  QTime t1, t2, t2a, t3;
+//! Appends the parts of a line within a tile. The line is split at all tile boundaries it crosses.
+//! Split points are computed the same way regardless of the direction of the segment, so that
+//! the tiles on both sides of a boundary get exactly the same point.
+static void clipLineToTile( const QgsPolyline& line, int col, int row, double tileSize, QgsMultiPolyline& out, QSet<QgsPoint>& seams )
+{
+  bool inside = true;
+  Q_FOREACH ( const QgsPoint& pt, line )
+  {
+    if ( qFloor( pt.x() / tileSize ) != col || qFloor( pt.y() / tileSize ) != row )
+    {
+      inside = false;
+      break;
+    }
+  }
+  if ( inside )
+  {
+    out << line;
+    return;
+  }
 
-  t1.start();
-  int featuresCounted = 0;
-  Q_FOREACH ( QgsVectorLayer* vl, mLayers )
+  QgsPolyline part;
+  for ( int i = 1; i < line.count(); ++i )
   {
-    QgsCoordinateTransform ct( vl->crs(), mCRS );
+    const QgsPoint& a = line[i - 1];
+    const QgsPoint& b = line[i];
+    bool swapped = b.x() < a.x() || ( b.x() == a.x() && b.y() < a.y() );
+    const QgsPoint& p = swapped ? b : a;
+    const QgsPoint& q = swapped ? a : b;
+    double dx = q.x() - p.x(), dy = q.y() - p.y();
+
+    // crossings with the vertical and horizontal tile boundaries, by position along p -> q
+    QVector< QPair<double, QgsPoint> > splits;
+    if ( dx != 0 )
+    {
+      for ( int k = qFloor( p.x() / tileSize ) + 1; k * tileSize < q.x(); ++k )
+      {
+        double t = ( k * tileSize - p.x() ) / dx;
+        splits << qMakePair( t, QgsPoint( k * tileSize, p.y() + dy * t ) );
+      }
+    }
+    if ( dy != 0 )
+    {
+      double yMin = qMin( p.y(), q.y() ), yMax = qMax( p.y(), q.y() );
+      for ( int k = qFloor( yMin / tileSize ) + 1; k * tileSize < yMax; ++k )
+      {
+        double t = ( k * tileSize - p.y() ) / dy;
+        splits << qMakePair( t, QgsPoint( p.x() + dx * t, k * tileSize ) );
+      }
+    }
+    std::sort( splits.begin(), splits.end(), splitPositionLessThan );
+    if ( swapped )
+      std::reverse( splits.begin(), splits.end() );
+    splits << qMakePair( 1.0, b );
+
+    // keep the pieces whose middle is in the tile
+    QgsPoint prev = a;
+    for ( int j = 0; j < splits.count(); ++j )
+    {
+      const QgsPoint& next = splits[j].second;
+      bool isSplit = j < splits.count() - 1;
+      double mx = ( prev.x() + next.x() ) / 2, my = ( prev.y() + next.y() ) / 2;
+      if ( qFloor( mx / tileSize ) == col && qFloor( my / tileSize ) == row )
+      {
+        if ( part.isEmpty() )
+          part << prev;
+        part << next;
+        if ( isSplit )
+          seams << next;
+      }
+      else
+      {
+        if ( part.count() >= 2 )
+          out << part;
+        part.clear();
+      }
+      prev = next;
+    }
+  }
+  if ( part.count() >= 2 )
+    out << part;
+}
+
 
-    QgsFeatureRequest request;
-    request.setSubsetOfAttributes( QgsAttributeList() );
-    if ( !mExtent.isEmpty() )
-      request.setFilterRect( mReprojectionEnabled ? ct.transformBoundingBox( mExtent, QgsCoordinateTransform::ReverseTransform ) : mExtent );
+//! Reads and nodes the linework of a tile. Runs in a worker thread.
+static QgsTracerTile* buildTracerTile( QgsTracerTileJob job )
+{
+  QgsTracerTile* tile = new QgsTracerTile;
+  tile->rect = job.rect;
 
-    QgsFeatureIterator fi = vl->getFeatures( request );
-    while ( fi.nextFeature( f ) )
+  QgsMultiPolyline mpl;
+  QgsFeature f;
+  Q_FOREACH ( const QgsTracerTileSource& src, job.sources )
+  {
+    QgsFeatureIterator fi = src.source->getFeatures( src.request );
+    while ( !tile->tooManyFeatures && fi.nextFeature( f ) )
     {
       if ( !f.constGeometry() )
         continue;
 
-      if ( mReprojectionEnabled && !ct.isShortCircuited() )
+      if ( src.ct && !src.ct->isShortCircuited() )
       {
         try
         {
-          f.geometry()->transform( ct );
+          f.geometry()->transform( *src.ct );
         }
         catch ( QgsCsException& )
         {
@@ -506,72 +791,342 @@ bool QgsTracer::initGraph()
         }
       }
 
-      extractLinework( f.constGeometry(), mpl );
+      QgsMultiPolyline featureLines;
+      extractLinework( f.constGeometry(), featureLines );
+      if ( job.tileSize > 0 )
+      {
+        Q_FOREACH ( const QgsPolyline& line, featureLines )
+        {
+          if ( line.count() >= 2 )
+            clipLineToTile( line, job.col, job.row, job.tileSize, mpl, tile->seams );
+        }
+      }
+      else
+        mpl << featureLines;
 
-      ++featuresCounted;
-      if ( mMaxFeatureCount != 0 && featuresCounted >= mMaxFeatureCount )
-        return false;
+      tile->features.insert( qMakePair( src.layer, f.id() ), f.constGeometry()->boundingBox() );
+      if ( job.maxFeatureCount != 0 && tile->features.count() >= job.maxFeatureCount )
+        tile->tooManyFeatures = true;
     }
   }
-  int timeExtract = t1.elapsed();
 
-  // resolve intersections
-
-  t2.start();
-
-  int timeNodingCall = 0;
+  Q_FOREACH ( const QgsTracerTileSource& src, job.sources )
+  {
+    delete src.source;
+    delete src.ct;
+  }
 
-#if 0
-  // without noding - if data are known to be noded beforehand
-#else
-  QgsGeometry* allGeom = QgsGeometry::fromMultiPolyline( mpl );
+  if ( tile->tooManyFeatures || mpl.isEmpty() )
+    return tile;
 
+  // resolve intersections
+  QScopedPointer<QgsGeometry> allGeom( QgsGeometry::fromMultiPolyline( mpl ) );
+  // the shared GEOS handle must not be used from several threads, all the GEOS geometries
+  // of the tile are created, noded, converted and destroyed with a handle of its own
+  GEOSContextHandle_t ctxt = QgsGeos::createGEOSHandler();
+  GEOSGeometry* allGeos = nullptr;
+  GEOSGeometry* allNoded = nullptr;
   try
   {
-    t2a.start();
+    allGeos = QgsGeos::asGeos( ctxt, allGeom->geometry() );
     // GEOSNode_r may throw an exception
-    GEOSGeometry* allNoded = GEOSNode_r( QgsGeometry::getGEOSHandler(), allGeom->asGeos() );
-    timeNodingCall = t2a.elapsed();
-
-    QgsGeometry* noded = new QgsGeometry;
-    noded->fromGeos( allNoded );
-    delete allGeom;
+    allNoded = GEOSNode_r( ctxt, allGeos );
 
-    mpl = noded->asMultiPolyline();
-
-    delete noded;
+    QgsAbstractGeometryV2* nodedV2 = QgsGeos::fromGeos( ctxt, allNoded );
+    if ( nodedV2 )
+    {
+      QgsGeometry noded( nodedV2 );
+      mpl.clear();
+      extractLinework( &noded, mpl );
+    }
   }
   catch ( GEOSException &e )
   {
     // no big deal... we will just not have nicely noded linework, potentially
     // missing some intersections
-
-    mHasTopologyProblem = true;
+    tile->topologyProblem = true;
 
     QgsDebugMsg( "Tracer Noding Exception: " + e.what() );
   }
-#endif
+  GEOSGeom_destroy_r( ctxt, allGeos );
+  GEOSGeom_destroy_r( ctxt, allNoded );
+  QgsGeos::destroyGEOSHandler( ctxt );
+
+  tile->lines = mpl;
+  return tile;
+}
+
+// -------------
+
+
+QgsTracer::QgsTracer()
+    : mGraph( 0 )
+    , mReprojectionEnabled( false )
+    , mMaxFeatureCount( 0 )
+    , mHasTopologyProblem( false )
+    , mTileSize( 0 )
+    , mTileUseCounter( 0 )
+{
+}
+
+
+bool QgsTracer::initGraph()
+{
+  if ( mGraph )
+    return true; // already initialized
+
+  mHasTopologyProblem = false;
+
+  QTime t1, t2;
+  t1.start();
+
+  // start all missing tiles first, so that they are built in parallel
+  QList<TileKey> keys = extentTiles();
+  Q_FOREACH ( const TileKey& key, keys )
+  {
+    if ( !mTiles.contains( key ) && !mPendingTiles.contains( key ) )
+      scheduleTile( key );
+  }
+
+  QList<QgsTracerTile*> tiles;
+  Q_FOREACH ( const TileKey& key, keys )
+    tiles << waitForTile( key );
+
+  int timeTiles = t1.elapsed();
+
+  // count the features within the extent
+  QSet<QgsTracerFeatureKey> features;
+  Q_FOREACH ( const QgsTracerTile* tile, tiles )
+  {
+    if ( tile->tooManyFeatures )
+      return false;
+
+    QHash<QgsTracerFeatureKey, QgsRectangle>::const_iterator it = tile->features.constBegin();
+    for ( ; it != tile->features.constEnd(); ++it )
+    {
+      if ( mExtent.isEmpty() || mExtent.intersects( it.value() ) )
+        features.insert( it.key() );
+    }
+  }
+  if ( mMaxFeatureCount != 0 && features.count() >= mMaxFeatureCount )
+    return false;
+
+  t2.start();
+
+  QgsMultiPolyline mpl;
+  QSet<QgsPoint> seams;
+  Q_FOREACH ( const QgsTracerTile* tile, tiles )
+  {
+    mpl << tile->lines;
+    seams.unite( tile->seams );
+    if ( tile->topologyProblem )
+      mHasTopologyProblem = true;
+  }
 
-  int timeNoding = t2.elapsed();
+  mGraph = makeGraph( mpl, seams );
+  mGraphTiles = keys;
 
-  t3.start();
+  int timeMake = t2.elapsed();
 
-  mGraph = makeGraph( mpl );
+  // keep the most recently used tiles outside of the extent for panning back
+  while ( mTiles.count() > MAX_CACHED_TILES )
+  {
+    QHash<TileKey, QgsTracerTile*>::iterator lru = mTiles.end();
+    for ( QHash<TileKey, QgsTracerTile*>::iterator it = mTiles.begin(); it != mTiles.end(); ++it )
+    {
+      if ( keys.contains( it.key() ) )
+        continue;
+      if ( lru == mTiles.end() || it.value()->lastUsed < lru.value()->lastUsed )
+        lru = it;
+    }
+    if ( lru == mTiles.end() )
+      break;
 
-  int timeMake = t3.elapsed();
+    delete lru.value();
+    mTiles.erase( lru );
+  }
 
-  Q_UNUSED( timeExtract );
-  Q_UNUSED( timeNoding );
-  Q_UNUSED( timeNodingCall );
+  Q_UNUSED( timeTiles );
   Q_UNUSED( timeMake );
-  QgsDebugMsg( QString( "tracer extract %1 ms, noding %2 ms (call %3 ms), make %4 ms" )
-               .arg( timeExtract ).arg( timeNoding ).arg( timeNodingCall ).arg( timeMake ) );
+  QgsDebugMsg( QString( "tracer tiles %1 ms (%2 tiles), make %3 ms" )
+               .arg( timeTiles ).arg( keys.count() ).arg( timeMake ) );
   return true;
 }
 
+QList<QgsTracer::TileKey> QgsTracer::extentTiles()
+{
+  QList<TileKey> keys;
+  if ( mExtent.isEmpty() )
+  {
+    // a single tile with whole layers
+    if ( mTileSize != 0 )
+    {
+      clearTiles();
+      mTileSize = 0;
+    }
+    keys << TileKey( 0, 0 );
+    return keys;
+  }
+
+  // start over if the extent has been zoomed out or in a lot since the size of tiles was chosen
+  double side = qMax( mExtent.width(), mExtent.height() );
+  if ( mTileSize <= 0 || side > mTileSize * 6 || side * 4 < mTileSize )
+  {
+    clearTiles();
+    mTileSize = side / 2;
+  }
+
+  int col0 = qFloor( mExtent.xMinimum() / mTileSize ), col1 = qFloor( mExtent.xMaximum() / mTileSize );
+  int row0 = qFloor( mExtent.yMinimum() / mTileSize ), row1 = qFloor( mExtent.yMaximum() / mTileSize );
+  for ( int row = row0; row <= row1; ++row )
+    for ( int col = col0; col <= col1; ++col )
+      keys << TileKey( col, row );
+  return keys;
+}
+
+void QgsTracer::scheduleTile( const TileKey& key )
+{
+  QgsTracerTileJob job;
+  job.col = key.first;
+  job.row = key.second;
+  job.tileSize = mTileSize;
+  job.maxFeatureCount = mMaxFeatureCount;
+  if ( mTileSize > 0 )
+    job.rect = QgsRectangle( key.first * mTileSize, key.second * mTileSize, ( key.first + 1 ) * mTileSize, ( key.second + 1 ) * mTileSize );
+
+  Q_FOREACH ( QgsVectorLayer* vl, mLayers )
+  {
+    QgsTracerTileSource src;
+    src.layer = vl;
+    src.ct = mReprojectionEnabled ? new QgsCoordinateTransform( vl->crs(), mCRS ) : nullptr;
+    src.request.setSubsetOfAttributes( QgsAttributeList() );
+    if ( !job.rect.isEmpty() )
+    {
+      try
+      {
+        src.request.setFilterRect( src.ct ? src.ct->transformBoundingBox( job.rect, QgsCoordinateTransform::ReverseTransform ) : job.rect );
+      }
+      catch ( QgsCsException& )
+      {
+        delete src.ct;
+        continue; // the tile is out of the area of the layer CRS
+      }
+    }
+    // the feature source is a snapshot of the layer which can be read in another thread
+    src.source = new QgsVectorLayerFeatureSource( vl );
+    job.sources << src;
+  }
+
+  mStaleTiles.remove( key );
+  mPendingTiles.insert( key, QtConcurrent::run( buildTracerTile, job ) );
+}
+
+QgsTracerTile* QgsTracer::waitForTile( const TileKey& key )
+{
+  while ( true )
+  {
+    if ( QgsTracerTile* tile = mTiles.value( key ) )
+    {
+      tile->lastUsed = ++mTileUseCounter;
+      return tile;
+    }
+
+    if ( !mPendingTiles.contains( key ) )
+      scheduleTile( key );
+
+    QFuture<QgsTracerTile*> future = mPendingTiles.take( key );
+    future.waitForFinished();
+    QgsTracerTile* tile = future.result();
+    if ( mStaleTiles.remove( key ) )
+    {
+      // features were edited while the tile was built
+      delete tile;
+      continue;
+    }
+    mTiles.insert( key, tile );
+  }
+}
+
+void QgsTracer::clearTiles()
+{
+  qDeleteAll( mTiles );
+  mTiles.clear();
+  mGraphTiles.clear();
+  mStaleTiles.clear();
+
+  // builds cannot be interrupted - their results are deleted once they finish
+  mDiscardedTiles << mPendingTiles.values();
+  mPendingTiles.clear();
+  for ( int i = mDiscardedTiles.count() - 1; i >= 0; --i )
+  {
+    if ( mDiscardedTiles.at( i ).isFinished() )
+    {
+      delete mDiscardedTiles.at( i ).result();
+      mDiscardedTiles.removeAt( i );
+    }
+  }
+}
+
+void QgsTracer::invalidateFeature( QgsVectorLayer* vl, QgsFeatureId fid )
+{
+  if ( !vl )
+    return;
+
+  // where the feature is now
+  QgsRectangle bbox;
+  bool hasBBox = false;
+  QgsFeature f;
+  if ( vl->getFeatures( QgsFeatureRequest( fid ).setSubsetOfAttributes( QgsAttributeList() ) ).nextFeature( f ) && f.constGeometry() )
+  {
+    bbox = f.constGeometry()->boundingBox();
+    hasBBox = true;
+    if ( mReprojectionEnabled )
+    {
+      try
+      {
+        bbox = QgsCoordinateTransform( vl->crs(), mCRS ).transformBoundingBox( bbox );
+      }
+      catch ( QgsCsException& )
+      {
+        hasBBox = false;
+      }
+    }
+  }
+
+  // tiles being built may have read the feature before the change
+  Q_FOREACH ( const TileKey& key, mPendingTiles.keys() )
+    mStaleTiles.insert( key );
+
+  // rebuild the tiles where the feature was and where it is now
+  QgsTracerFeatureKey featureKey( vl, fid );
+  bool graphAffected = false;
+  Q_FOREACH ( const TileKey& key, mTiles.keys() )
+  {
+    const QgsTracerTile* tile = mTiles.value( key );
+    if ( !tile->features.contains( featureKey ) && !( hasBBox && ( mTileSize <= 0 || tile->rect.intersects( bbox ) ) ) )
+      continue;
+
+    delete mTiles.take( key );
+    if ( mGraphTiles.contains( key ) )
+    {
+      graphAffected = true;
+      scheduleTile( key );
+    }
+  }
+
+  if ( graphAffected )
+    invalidateGraph();
+}
+
 QgsTracer::~QgsTracer()
 {
   invalidateGraph();
+  clearTiles();
+  Q_FOREACH ( QFuture<QgsTracerTile*> future, mDiscardedTiles )
+  {
+    future.waitForFinished();
+    delete future.result();
+  }
 }
 
 void QgsTracer::setLayers( const QList<QgsVectorLayer*>& layers )
@@ -597,6 +1152,7 @@ void QgsTracer::setLayers( const QList<QgsVectorLayer*>& layers )
     connect( layer, SIGNAL( destroyed( QObject* ) ), this, SLOT( onLayerDestroyed( QObject* ) ) );
   }
 
+  clearTiles();
   invalidateGraph();
 }
 
@@ -606,6 +1162,7 @@ void QgsTracer::setCrsTransformEnabled( bool enabled )
     return;
 
   mReprojectionEnabled = enabled;
+  clearTiles();
   invalidateGraph();
 }
 
@@ -615,6 +1172,7 @@ void QgsTracer::setDestinationCrs( const QgsCoordinateReferenceSystem& crs )
     return;
 
   mCRS = crs;
+  clearTiles();
   invalidateGraph();
 }
 
@@ -627,6 +1185,17 @@ void QgsTracer::setExtent( const QgsRectangle& extent )
   invalidateGraph();
 }
 
+void QgsTracer::setMaxFeatureCount( int count )
+{
+  if ( mMaxFeatureCount == count )
+    return;
+
+  // tiles stop reading features at the limit
+  mMaxFeatureCount = count;
+  clearTiles();
+  invalidateGraph();
+}
+
 bool QgsTracer::init()
 {
   if ( mGraph )
@@ -638,6 +1207,20 @@ bool QgsTracer::init()
   return initGraph();
 }
 
+void QgsTracer::prepareGraph()
+{
+  if ( mGraph )
+    return;
+
+  configure();
+
+  Q_FOREACH ( const TileKey& key, extentTiles() )
+  {
+    if ( !mTiles.contains( key ) && !mPendingTiles.contains( key ) )
+      scheduleTile( key );
+  }
+}
+
 
 void QgsTracer::invalidateGraph()
 {
@@ -647,27 +1230,25 @@ void QgsTracer::invalidateGraph()
 
 void QgsTracer::onFeatureAdded( QgsFeatureId fid )
 {
-  Q_UNUSED( fid );
-  invalidateGraph();
+  invalidateFeature( qobject_cast<QgsVectorLayer*>( sender() ), fid );
 }
 
 void QgsTracer::onFeatureDeleted( QgsFeatureId fid )
 {
-  Q_UNUSED( fid );
-  invalidateGraph();
+  invalidateFeature( qobject_cast<QgsVectorLayer*>( sender() ), fid );
 }
 
 void QgsTracer::onGeometryChanged( QgsFeatureId fid, QgsGeometry& geom )
 {
-  Q_UNUSED( fid );
   Q_UNUSED( geom );
-  invalidateGraph();
+  invalidateFeature( qobject_cast<QgsVectorLayer*>( sender() ), fid );
 }
 
 void QgsTracer::onLayerDestroyed( QObject* obj )
 {
   // remove the layer before it is completely invalid (static_cast should be the safest cast)
   mLayers.removeAll( static_cast<QgsVectorLayer*>( obj ) );
+  clearTiles();
   invalidateGraph();
 }
 
@@ -18,6 +18,9 @@
 
 class QgsVectorLayer;
 
+#include <QFuture>
+#include <QHash>
+#include <QPair>
 #include <QSet>
 #include <QVector>
 
@@ -27,12 +30,18 @@ class QgsVectorLayer;
 #include "qgsrectangle.h"
 
 struct QgsTracerGraph;
+struct QgsTracerTile;
 
 /** \ingroup core
  * Utility class that construct a planar graph from the input vector
  * layers and provides shortest path search for tracing of existing
  * features.
  *
+ * The graph is assembled from tiles covering the extent. Tiles are read and noded
+ * in background threads and kept when the extent moves, so only the newly visible
+ * tiles need to be built. When features are edited, only the tiles where they were
+ * and where they are now are rebuilt.
+ *
  * @note added in QGIS 2.14
  */
 class CORE_EXPORT QgsTracer : public QObject
@@ -65,7 +74,7 @@ class CORE_EXPORT QgsTracer : public QObject
     //! Get maximum possible number of features in graph. If the number is exceeded, graph is not created.
     int maxFeatureCount() const { return mMaxFeatureCount; }
     //! Get maximum possible number of features in graph. If the number is exceeded, graph is not created.
-    void setMaxFeatureCount( int count ) { mMaxFeatureCount = count; }
+    void setMaxFeatureCount( int count );
 
     //! Build the internal data structures. This may take some time
     //! depending on how big the input layers are. It is not necessary
@@ -73,6 +82,11 @@ class CORE_EXPORT QgsTracer : public QObject
     //! if necessary.
     bool init();
 
+    //! Start building the parts of the graph covering the extent in background threads
+    //! and return immediately. The graph is completed by init() or findShortestPath().
+    //! @note added in QGIS 2.18
+    void prepareGraph();
+
     //! Whether the internal data structures have been initialized
     bool isInitialized() const { return mGraph != nullptr; }
 
@@ -110,7 +124,19 @@ class CORE_EXPORT QgsTracer : public QObject
     void invalidateGraph();
 
   private:
+    typedef QPair<int, int> TileKey;
+
     bool initGraph();
+    //! Return tiles covering the extent, choosing the size of tiles if necessary
+    QList<TileKey> extentTiles();
+    //! Start building a tile in a background thread
+    void scheduleTile( const TileKey& key );
+    //! Return a tile, waiting for it to be built if necessary
+    QgsTracerTile* waitForTile( const TileKey& key );
+    //! Drop all tiles
+    void clearTiles();
+    //! Drop the tiles affected by a change of a feature
+    void invalidateFeature( QgsVectorLayer* vl, QgsFeatureId fid );
 
   private slots:
     void onFeatureAdded( QgsFeatureId fid );
@@ -135,6 +161,20 @@ class CORE_EXPORT QgsTracer : public QObject
     //! A flag indicating that there was an error during graph creation
     //! due to noding exception, indicating some input data topology problems
     bool mHasTopologyProblem;
+    //! Size of tiles in destination CRS units (0 if there is a single tile without limits)
+    double mTileSize;
+    //! Built tiles
+    QHash<TileKey, QgsTracerTile*> mTiles;
+    //! Tiles being built in background threads
+    QHash<TileKey, QFuture<QgsTracerTile*> > mPendingTiles;
+    //! Tiles being built from features which have been changed since
+    QSet<TileKey> mStaleTiles;
+    //! Builds which are not needed anymore, their results are deleted once they finish
+    QList< QFuture<QgsTracerTile*> > mDiscardedTiles;
+    //! Tiles the current graph was assembled from
+    QList<TileKey> mGraphTiles;
+    //! Counter used to find the least recently used tiles
+    quint64 mTileUseCounter;
 };
 
 
@@ -406,6 +406,21 @@ QVariant QgsVectorDataProvider::aggregate( QgsAggregateCalculator::Aggregate agg
   return QVariant();
 }
 
+QHash<QString, QVariant> QgsVectorDataProvider::groupedAggregate( QgsAggregateCalculator::Aggregate aggregate, int index,
+    const QgsAttributeList& groupByIndexes, const QgsAggregateCalculator::AggregateParameters& parameters,
+    QgsExpressionContext* context, bool& ok )
+{
+  //base implementation does nothing
+  Q_UNUSED( aggregate );
+  Q_UNUSED( index );
+  Q_UNUSED( groupByIndexes );
+  Q_UNUSED( parameters );
+  Q_UNUSED( context );
+
+  ok = false;
+  return QHash<QString, QVariant>();
+}
+
 void QgsVectorDataProvider::clearMinMaxCache()
 {
   mCacheMinMaxDirty = true;
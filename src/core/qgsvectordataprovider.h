@@ -224,6 +224,27 @@ class CORE_EXPORT QgsVectorDataProvider : public QgsDataProvider
                                 QgsExpressionContext* context,
                                 bool& ok );
 
+    /** Calculates an aggregated value for every group of features sharing the same values of
+     * a set of attributes, e.g. with a GROUP BY query. The base implementation does nothing,
+     * but subclasses can override this method to handoff calculation of grouped aggregates to
+     * the provider.
+     * @param aggregate aggregate to calculate
+     * @param index the index of the attribute to calculate aggregate over
+     * @param groupByIndexes the indexes of the attributes which define the groups
+     * @param parameters parameters controlling aggregate calculation
+     * @param context expression context for filter
+     * @param ok will be set to true if calculation was successfully performed by the data provider
+     * @return calculated aggregate values, keyed by QgsAggregateCalculator::groupKey()
+     * @note added in QGIS 2.18
+     * @note not available in Python bindings
+     */
+    virtual QHash<QString, QVariant> groupedAggregate( QgsAggregateCalculator::Aggregate aggregate,
+        int index,
+        const QgsAttributeList& groupByIndexes,
+        const QgsAggregateCalculator::AggregateParameters& parameters,
+        QgsExpressionContext* context,
+        bool& ok );
+
     /**
      * Returns the possible enum values of an attribute. Returns an empty stringlist if a provider does not support enum types
      * or if the given attribute is not an enum type.
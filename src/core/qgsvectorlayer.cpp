@@ -3659,6 +3659,56 @@ QVariant QgsVectorLayer::aggregate( QgsAggregateCalculator::Aggregate aggregate,
   return c.calculate( aggregate, fieldOrExpression, context, ok );
 }
 
+QHash<QString, QVariant> QgsVectorLayer::aggregateGrouped( QgsAggregateCalculator::Aggregate aggregate, const QString& fieldOrExpression,
+    const QStringList& groupByFields, const QgsAggregateCalculator::AggregateParameters& parameters, QgsExpressionContext* context, bool* ok,
+    QStringList* failedGroups )
+{
+  if ( ok )
+    *ok = false;
+
+  if ( !mDataProvider )
+  {
+    return QHash<QString, QVariant>();
+  }
+
+  // if the aggregate and the groups are based on provider fields and there are no pending
+  // edits, the provider may be able to calculate all groups at once (e.g. with GROUP BY)
+  int attrIndex = mUpdatedFields.fieldNameIndex( fieldOrExpression );
+  if ( attrIndex >= 0 && mUpdatedFields.fieldOrigin( attrIndex ) == QgsFields::OriginProvider && !isModified() )
+  {
+    QgsAttributeList groupByIndexes;
+    Q_FOREACH ( const QString& groupField, groupByFields )
+    {
+      int groupIndex = mUpdatedFields.fieldNameIndex( groupField );
+      if ( groupIndex < 0 || mUpdatedFields.fieldOrigin( groupIndex ) != QgsFields::OriginProvider )
+      {
+        groupByIndexes.clear();
+        break;
+      }
+      groupByIndexes << mUpdatedFields.fieldOriginIndex( groupIndex );
+    }
+
+    if ( !groupByIndexes.isEmpty() )
+    {
+      bool providerOk = false;
+      QHash<QString, QVariant> values = mDataProvider->groupedAggregate( aggregate, mUpdatedFields.fieldOriginIndex( attrIndex ),
+                                        groupByIndexes, parameters, context, providerOk );
+      if ( providerOk )
+      {
+        // provider handled calculation
+        if ( ok )
+          *ok = true;
+        return values;
+      }
+    }
+  }
+
+  // fallback to a single pass with the aggregate calculator
+  QgsAggregateCalculator c( this );
+  c.setParameters( parameters );
+  return c.calculateGrouped( aggregate, fieldOrExpression, groupByFields, context, ok, failedGroups );
+}
+
 QList<QVariant> QgsVectorLayer::getValues( const QString &fieldOrExpression, bool& ok, bool selectedOnly )
 {
   QList<QVariant> values;
@@ -1854,6 +1854,28 @@ class CORE_EXPORT QgsVectorLayer : public QgsMapLayer
                         QgsExpressionContext* context = nullptr,
                         bool* ok = nullptr );
 
+    /** Calculates an aggregated value for every group of features sharing the same values of
+     * a set of fields, in a single pass over the layer's features.
+     * @param aggregate aggregate to calculate
+     * @param fieldOrExpression source field or expression to use as basis for aggregated values.
+     * @param groupByFields names of the fields which define the groups
+     * @param parameters parameters controlling aggregate calculation
+     * @param context expression context for expressions and filters
+     * @param ok if specified, will be set to true if aggregate calculation was successful
+     * @param failedGroups if specified, receives the keys of the groups whose aggregate could not
+     * be calculated. These groups are not contained in the results.
+     * @return calculated aggregate values, keyed by QgsAggregateCalculator::groupKey()
+     * @note added in QGIS 2.18
+     * @note not available in Python bindings
+     */
+    QHash<QString, QVariant> aggregateGrouped( QgsAggregateCalculator::Aggregate aggregate,
+        const QString& fieldOrExpression,
+        const QStringList& groupByFields,
+        const QgsAggregateCalculator::AggregateParameters& parameters = QgsAggregateCalculator::AggregateParameters(),
+        QgsExpressionContext* context = nullptr,
+        bool* ok = nullptr,
+        QStringList* failedGroups = nullptr );
+
     /** Fetches all values from a specified field name or expression.
      * @param fieldOrExpression field name or an expression string
      * @param ok will be set to false if field or expression is invalid, otherwise true
@@ -26,6 +26,9 @@
 #include "qgsdistancearea.h"
 #include "qgsproject.h"
 
+//! Number of provider features read ahead when joined rows are fetched in batches
+static const int JOIN_BATCH_SIZE = 1000;
+
 QgsVectorLayerFeatureSource::QgsVectorLayerFeatureSource( QgsVectorLayer *layer )
     : mCrsId( 0 )
 {
@@ -95,6 +98,7 @@ QgsFeatureIterator QgsVectorLayerFeatureSource::getFeatures( const QgsFeatureReq
 QgsVectorLayerFeatureIterator::QgsVectorLayerFeatureIterator( QgsVectorLayerFeatureSource* source, bool ownSource, const QgsFeatureRequest& request )
     : QgsAbstractFeatureIteratorFromSource<QgsVectorLayerFeatureSource>( source, ownSource, request )
     , mFetchedFid( false )
+    , mHasBatchedJoins( false )
     , mInterruptionChecker( nullptr )
 {
   if ( mRequest.filterType() == QgsFeatureRequest::FilterExpression )
@@ -123,6 +127,22 @@ QgsVectorLayerFeatureIterator::QgsVectorLayerFeatureIterator( QgsVectorLayerFeat
 
   mHasVirtualAttributes = !mFetchJoinInfo.isEmpty() || !mExpressionFieldInfo.isEmpty();
 
+  // joins without memory cache are fetched for batches of provider features, as long as
+  // the join value can be read from the provider feature directly
+  QMap<const QgsVectorJoinInfo*, FetchJoinInfo>::iterator joinIt = mFetchJoinInfo.begin();
+  for ( ; joinIt != mFetchJoinInfo.end(); ++joinIt )
+  {
+    FetchJoinInfo& info = joinIt.value();
+    info.batched = !info.joinInfo->memoryCache
+                   && info.joinField >= 0 && info.joinField < info.joinLayer->fields().count()
+                   && mSource->mFields.fieldOrigin( info.targetField ) == QgsFields::OriginProvider;
+    if ( info.batched )
+    {
+      info.batchField = info.joinLayer->fields().at( info.joinField );
+      mHasBatchedJoins = true;
+    }
+  }
+
   // by default provider's request is the same
   mProviderRequest = mRequest;
 
@@ -280,7 +300,7 @@ bool QgsVectorLayerFeatureIterator::fetchFeature( QgsFeature& f )
     mProviderIterator.setInterruptionChecker( mInterruptionChecker );
   }
 
-  while ( mProviderIterator.nextFeature( f ) )
+  while ( fetchNextProviderFeature( f ) )
   {
     if ( mFetchConsidered.contains( f.id() ) )
       continue;
@@ -333,6 +353,7 @@ bool QgsVectorLayerFeatureIterator::rewind()
   else
   {
     mProviderIterator.rewind();
+    mProviderBatch.clear();
     rewindEditBuffer();
   }
 
@@ -345,6 +366,7 @@ bool QgsVectorLayerFeatureIterator::close()
     return false;
 
   mProviderIterator.close();
+  mProviderBatch.clear();
 
   iteratorClosed();
 
@@ -501,6 +523,57 @@ void QgsVectorLayerFeatureIterator::rewindEditBuffer()
   mFetchChangedGeomIt = mSource->mChangedGeometries.constBegin();
 }
 
+bool QgsVectorLayerFeatureIterator::fetchNextProviderFeature( QgsFeature& f )
+{
+  if ( !mHasBatchedJoins )
+    return mProviderIterator.nextFeature( f );
+
+  if ( mProviderBatch.isEmpty() )
+  {
+    QgsFeature batchFeature;
+    while ( mProviderBatch.count() < JOIN_BATCH_SIZE && mProviderIterator.nextFeature( batchFeature ) )
+      mProviderBatch << batchFeature;
+
+    if ( mProviderBatch.isEmpty() )
+      return false;
+
+    prepareJoinBatch();
+  }
+
+  f = mProviderBatch.takeFirst();
+  return true;
+}
+
+void QgsVectorLayerFeatureIterator::prepareJoinBatch()
+{
+  QMap<const QgsVectorJoinInfo*, FetchJoinInfo>::iterator joinIt = mFetchJoinInfo.begin();
+  for ( ; joinIt != mFetchJoinInfo.end(); ++joinIt )
+  {
+    FetchJoinInfo& info = joinIt.value();
+    if ( !info.batched )
+      continue;
+
+    // collect the distinct join values of the batch, null values are joined directly
+    QSet<QString> keys;
+    QList<QVariant> joinValues;
+    Q_FOREACH ( const QgsFeature& feature, mProviderBatch )
+    {
+      QVariant value = feature.attribute( info.targetField );
+      if ( !value.isValid() || value.isNull() )
+        continue;
+
+      QString key = value.toString();
+      if ( keys.contains( key ) )
+        continue;
+
+      keys.insert( key );
+      joinValues << value;
+    }
+
+    info.fetchJoinedAttributesBatch( joinValues );
+  }
+}
+
 void QgsVectorLayerFeatureIterator::prepareJoin( int fieldIdx )
 {
   if ( !mSource->mFields.exists( fieldIdx ) )
@@ -519,6 +592,7 @@ void QgsVectorLayerFeatureIterator::prepareJoin( int fieldIdx )
   if ( !mFetchJoinInfo.contains( joinInfo ) )
   {
     FetchJoinInfo info;
+    info.batched = false;
     info.joinInfo = joinInfo;
     info.joinLayer = joinLayer;
     info.indexOffset = mSource->mJoinBuffer->joinedFieldsOffset( joinInfo, mSource->mFields );
@@ -642,7 +716,9 @@ void QgsVectorLayerFeatureIterator::addJoinedAttributes( QgsFeature &f )
       continue;
 
     const QHash< QString, QgsAttributes>& memoryCache = info.joinInfo->cachedAttributes;
-    if ( memoryCache.isEmpty() )
+    if ( info.batched )
+      info.addJoinedAttributesBatched( f, targetFieldValue );
+    else if ( memoryCache.isEmpty() )
       info.addJoinedAttributesDirect( f, targetFieldValue );
     else
       info.addJoinedAttributesCached( f, targetFieldValue );
@@ -711,11 +787,10 @@ bool QgsVectorLayerFeatureIterator::providerCanSimplify( QgsSimplifyMethod::Meth
 }
 
 
-void QgsVectorLayerFeatureIterator::FetchJoinInfo::addJoinedAttributesCached( QgsFeature& f, const QVariant& joinValue ) const
+static void setJoinedAttributes( QgsFeature& f, int indexOffset, const QHash<QString, QgsAttributes>& joinedAttributes, const QString& key )
 {
-  const QHash<QString, QgsAttributes>& memoryCache = joinInfo->cachedAttributes;
-  QHash<QString, QgsAttributes>::const_iterator it = memoryCache.find( joinValue.toString() );
-  if ( it == memoryCache.constEnd() )
+  QHash<QString, QgsAttributes>::const_iterator it = joinedAttributes.find( key );
+  if ( it == joinedAttributes.constEnd() )
     return; // joined value not found -> leaving the attributes empty (null)
 
   int index = indexOffset;
@@ -727,20 +802,130 @@ void QgsVectorLayerFeatureIterator::FetchJoinInfo::addJoinedAttributesCached( Qg
   }
 }
 
+void QgsVectorLayerFeatureIterator::FetchJoinInfo::addJoinedAttributesCached( QgsFeature& f, const QVariant& joinValue ) const
+{
+  setJoinedAttributes( f, indexOffset, joinInfo->cachedAttributes, joinValue.toString() );
+}
 
+void QgsVectorLayerFeatureIterator::FetchJoinInfo::addJoinedAttributesBatched( QgsFeature& f, const QVariant& joinValue ) const
+{
+  if ( joinValue.isNull() )
+  {
+    addJoinedAttributesDirect( f, joinValue );
+    return;
+  }
 
-void QgsVectorLayerFeatureIterator::FetchJoinInfo::addJoinedAttributesDirect( QgsFeature& f, const QVariant& joinValue ) const
+  QString key = batchKey( joinValue );
+  if ( !batchKeys.contains( key ) )
+  {
+    // value changed in the edit buffer
+    addJoinedAttributesDirect( f, joinValue );
+    return;
+  }
+
+  if ( !batchAttributes.contains( key ) && joinValue.type() != batchField.type() )
+  {
+    // the provider may still match values of different types which have different keys, e.g. 5 and "05"
+    addJoinedAttributesDirect( f, joinValue );
+    return;
+  }
+
+  setJoinedAttributes( f, indexOffset, batchAttributes, key );
+}
+
+QString QgsVectorLayerFeatureIterator::FetchJoinInfo::batchKey( const QVariant& value ) const
 {
-  // no memory cache, query the joined values by setting substring
-  QString subsetString;
+  QVariant converted( value );
+  if ( !batchField.convertCompatible( converted ) )
+    return value.toString();
+
+  // a lossy conversion, e.g. 5.5 to an integer field, does not match the joined rows
+  QVariant restored( converted );
+  if ( !restored.convert( value.type() ) || restored != value )
+    return value.toString();
+
+  return converted.toString();
+}
+
+void QgsVectorLayerFeatureIterator::FetchJoinInfo::fetchJoinedAttributesBatch( const QList<QVariant>& joinValues )
+{
+  // only keep the rows of one batch to bound the memory use
+  batchKeys.clear();
+  batchAttributes.clear();
+
+  if ( joinValues.isEmpty() )
+    return;
+
+  QStringList quotedValues;
+  Q_FOREACH ( const QVariant& value, joinValues )
+  {
+    batchKeys.insert( batchKey( value ) );
+    quotedValues << QgsExpression::quotedValue( value );
+  }
+
+  QString filter = QString( "%1 IN (%2)" ).arg( QgsExpression::quotedColumnRef( joinFieldName() ), quotedValues.join( "," ) );
+
+  // maybe user requested just a subset of layer's attributes
+  // so we do not have to fetch everything
+  bool hasSubset = joinInfo->joinFieldNamesSubset();
+  QVector<int> subsetIndices;
+  if ( hasSubset )
+    subsetIndices = QgsVectorLayerJoinBuffer::joinSubsetIndices( joinLayer, *joinInfo->joinFieldNamesSubset() );
+
+  QgsAttributeList requestAttributes = attributes;
+  if ( !requestAttributes.contains( joinField ) )
+    requestAttributes << joinField;
+
+  // select (no geometry)
+  QgsFeatureRequest request;
+  request.setFlags( QgsFeatureRequest::NoGeometry );
+  request.setSubsetOfAttributes( requestAttributes );
+  request.setFilterExpression( filter );
+  QgsFeatureIterator fi = joinLayer->getFeatures( request );
 
-  QString joinFieldName;
+  QgsFeature fet;
+  while ( fi.nextFeature( fet ) )
+  {
+    const QgsAttributes attr = fet.attributes();
+    QString key = batchKey( attr.at( joinField ) );
+
+    // like the direct request, the first matching row wins
+    if ( batchAttributes.contains( key ) )
+      continue;
+
+    if ( hasSubset )
+    {
+      QgsAttributes subsetAttrs( subsetIndices.count() );
+      for ( int i = 0; i < subsetIndices.count(); ++i )
+        subsetAttrs[i] = attr.at( subsetIndices.at( i ) );
+      batchAttributes.insert( key, subsetAttrs );
+    }
+    else
+    {
+      // use all fields except for the one used for join (has same value as exiting field in target layer)
+      QgsAttributes joinedAttrs = attr;
+      joinedAttrs.remove( joinField );
+      batchAttributes.insert( key, joinedAttrs );
+    }
+  }
+}
+
+QString QgsVectorLayerFeatureIterator::FetchJoinInfo::joinFieldName() const
+{
   if ( joinInfo->joinFieldName.isEmpty() && joinInfo->joinFieldIndex >= 0 && joinInfo->joinFieldIndex < joinLayer->fields().count() )
-    joinFieldName = joinLayer->fields().field( joinInfo->joinFieldIndex ).name();   // for compatibility with 1.x
+    return joinLayer->fields().field( joinInfo->joinFieldIndex ).name();   // for compatibility with 1.x
   else
-    joinFieldName = joinInfo->joinFieldName;
+    return joinInfo->joinFieldName;
+}
+
+
+
+void QgsVectorLayerFeatureIterator::FetchJoinInfo::addJoinedAttributesDirect( QgsFeature& f, const QVariant& joinValue ) const
+{
+  // no memory cache, query the joined values by setting substring
+  QString subsetString;
 
-  subsetString.append( QString( "\"%1\"" ).arg( joinFieldName ) );
+  subsetString.append( QString( "\"%1\"" ).arg( joinFieldName() ) );
 
   if ( joinValue.isNull() )
   {
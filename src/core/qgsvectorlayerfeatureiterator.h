@@ -127,6 +127,20 @@ class CORE_EXPORT QgsVectorLayerFeatureIterator : public QgsAbstractFeatureItera
     //! @note not available in Python bindings
     void addJoinedAttributes( QgsFeature &f );
 
+    /** Fetches the next feature from the provider. If there are joins without memory cache,
+     * features are read ahead in batches so that the joined rows of a whole batch can be
+     * fetched with one request per join.
+     * @note added in QGIS 2.18
+     * @note not available in Python bindings
+     */
+    bool fetchNextProviderFeature( QgsFeature& f );
+
+    /** Fetches the joined rows for the features of the current provider batch.
+     * @note added in QGIS 2.18
+     * @note not available in Python bindings
+     */
+    void prepareJoinBatch();
+
     /**
      * Adds attributes that don't source from the provider but are added inside QGIS
      * Includes
@@ -167,9 +181,31 @@ class CORE_EXPORT QgsVectorLayerFeatureIterator : public QgsAbstractFeatureItera
       QgsVectorLayer* joinLayer;        //!< resolved pointer to the joined layer
       int targetField;                  //!< index of field (of this layer) that drives the join
       int joinField;                    //!< index of field (of the joined layer) must have equal value
+      bool batched;                     //!< whether the joined rows are fetched for batches of features
+      QgsField batchField;              //!< join field of the joined layer, batch keys are values of its type
+      QSet<QString> batchKeys;          //!< join values requested for the current batch
+      QHash<QString, QgsAttributes> batchAttributes; //!< joined attributes of the current batch, keyed by join value
 
       void addJoinedAttributesCached( QgsFeature& f, const QVariant& joinValue ) const;
       void addJoinedAttributesDirect( QgsFeature& f, const QVariant& joinValue ) const;
+
+      /** Fetches the joined rows for a batch of join values with a single request and
+       * stores them in batchAttributes, replacing the rows of the previous batch.
+       */
+      void fetchJoinedAttributesBatch( const QList<QVariant>& joinValues );
+
+      /** Adds the joined attributes from the current batch. Falls back to a direct
+       * request if the join value was not part of the batch.
+       */
+      void addJoinedAttributesBatched( QgsFeature& f, const QVariant& joinValue ) const;
+
+      /** Returns the key of a join value in batchKeys and batchAttributes. The value is converted
+       * to the type of the join field first, so that e.g. 5 and "5" have the same key.
+       */
+      QString batchKey( const QVariant& value ) const;
+
+      //! Returns the name of the join field in the joined layer
+      QString joinFieldName() const;
     };
 
     QgsFeatureRequest mProviderRequest;
@@ -192,6 +228,12 @@ class CORE_EXPORT QgsVectorLayerFeatureIterator : public QgsAbstractFeatureItera
 
     bool mHasVirtualAttributes;
 
+    //! True if any join is fetched in batches
+    bool mHasBatchedJoins;
+
+    //! Provider features read ahead for batched joins
+    QList<QgsFeature> mProviderBatch;
+
   private:
     QScopedPointer<QgsExpressionContext> mExpressionContext;
 
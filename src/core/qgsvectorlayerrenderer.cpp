@@ -23,6 +23,7 @@
 #include "qgspallabeling.h"
 #include "qgsrendererv2.h"
 #include "qgsrendercontext.h"
+#include "qgsrenderprofiler.h"
 #include "qgssinglesymbolrendererv2.h"
 #include "qgssymbollayerv2.h"
 #include "qgssymbolv2.h"
@@ -243,7 +244,11 @@ bool QgsVectorLayerRenderer::render()
     mContext.setVectorSimplifyMethod( vectorMethod );
   }
 
-  QgsFeatureIterator fit = mSource->getFeatures( featureRequest );
+  QgsFeatureIterator fit;
+  {
+    QgsRenderProfilerScope profile( mContext, QgsRenderProfiler::FeatureFetch );
+    fit = mSource->getFeatures( featureRequest );
+  }
   // Attach an interruption checker so that iterators that have potentially
   // slow fetchFeature() implementations, such as in the WFS provider, can
   // check it, instead of relying on just the mContext.renderingStopped() check
@@ -281,8 +286,11 @@ void QgsVectorLayerRenderer::drawRendererV2( QgsFeatureIterator& fit )
   QgsExpressionContextScope* symbolScope = QgsExpressionContextUtils::updateSymbolScope( nullptr, new QgsExpressionContextScope() );
   mContext.expressionContext().appendScope( symbolScope );
 
+  // only layers with labels or diagrams report the time spent registering label features
+  QgsRenderProfiler* labelProfiler = ( mLabeling || mDiagrams || mLabelProvider || mDiagramProvider ) ? mContext.profiler() : nullptr;
+
   QgsFeature fet;
-  while ( fit.nextFeature( fet ) )
+  while ( fetchFeature( fit, fet ) )
   {
     try
     {
@@ -312,6 +320,8 @@ void QgsVectorLayerRenderer::drawRendererV2( QgsFeatureIterator& fit )
       // labeling - register feature
       if ( rendered )
       {
+        QgsRenderProfilerScope profile( labelProfiler, mLayerID, QgsRenderProfiler::LabelCandidates );
+
         if ( mContext.labelingEngine() )
         {
           if ( mLabeling )
@@ -379,9 +389,12 @@ void QgsVectorLayerRenderer::drawRendererV2Levels( QgsFeatureIterator& fit )
   QgsExpressionContextScope* symbolScope = QgsExpressionContextUtils::updateSymbolScope( nullptr, new QgsExpressionContextScope() );
   mContext.expressionContext().appendScope( symbolScope );
 
+  // only layers with labels or diagrams report the time spent registering label features
+  QgsRenderProfiler* labelProfiler = ( mLabeling || mDiagrams || mLabelProvider || mDiagramProvider ) ? mContext.profiler() : nullptr;
+
   // 1. fetch features
   QgsFeature fet;
-  while ( fit.nextFeature( fet ) )
+  while ( fetchFeature( fit, fet ) )
   {
     if ( mContext.renderingStopped() )
     {
@@ -395,7 +408,11 @@ void QgsVectorLayerRenderer::drawRendererV2Levels( QgsFeatureIterator& fit )
       continue; // skip features without geometry
 
     mContext.expressionContext().setFeature( fet );
-    QgsSymbolV2* sym = mRendererV2->symbolForFeature( fet, mContext );
+    QgsSymbolV2* sym = nullptr;
+    {
+      QgsRenderProfilerScope profile( mContext, QgsRenderProfiler::ExpressionEvaluation );
+      sym = mRendererV2->symbolForFeature( fet, mContext );
+    }
     if ( !sym )
     {
       continue;
@@ -413,6 +430,8 @@ void QgsVectorLayerRenderer::drawRendererV2Levels( QgsFeatureIterator& fit )
       mCache->cacheGeometry( fet.id(), *fet.constGeometry() );
     }
 
+    QgsRenderProfilerScope labelProfile( labelProfiler, mLayerID, QgsRenderProfiler::LabelCandidates );
+
     if ( mContext.labelingEngine() )
     {
       mContext.expressionContext().setFeature( fet );
@@ -519,6 +538,12 @@ void QgsVectorLayerRenderer::drawRendererV2Levels( QgsFeatureIterator& fit )
 }
 
 
+bool QgsVectorLayerRenderer::fetchFeature( QgsFeatureIterator& fit, QgsFeature& feature )
+{
+  QgsRenderProfilerScope profile( mContext, QgsRenderProfiler::FeatureFetch );
+  return fit.nextFeature( feature );
+}
+
 void QgsVectorLayerRenderer::stopRendererV2( QgsSingleSymbolRendererV2* selRenderer )
 {
   mRendererV2->stopRender( mContext );
@@ -96,6 +96,9 @@ class QgsVectorLayerRenderer : public QgsMapLayerRenderer
     /** Stop version 2 renderer and selected renderer (if required) */
     void stopRendererV2( QgsSingleSymbolRendererV2* selRenderer );
 
+    /** Fetches the next feature, recording the time spent if rendering is profiled */
+    bool fetchFeature( QgsFeatureIterator& fit, QgsFeature& feature );
+
 
   protected:
 
@@ -27,6 +27,7 @@ QgsBrightnessContrastFilter::QgsBrightnessContrastFilter( QgsRasterInterface* in
     , mBrightness( 0 )
     , mContrast( 0 )
 {
+  updateLookupTable();
 }
 
 QgsBrightnessContrastFilter::~QgsBrightnessContrastFilter()
@@ -142,39 +143,56 @@ QgsRasterBlock * QgsBrightnessContrastFilter::block2( int bandNo, QgsRectangle
     return inputBlock;
   }
 
-  if ( !outputBlock->reset( QGis::ARGB32_Premultiplied, width, height ) )
+  // adjust the image of the input block in place
+  if ( !inputBlock->convert( QGis::ARGB32_Premultiplied ) )
   {
     delete inputBlock;
     return outputBlock;
   }
+  delete outputBlock;
 
-  // adjust image
-  QRgb myNoDataColor = qRgba( 0, 0, 0, 0 );
-  QRgb myColor;
+  adjustPixels( reinterpret_cast< QRgb* >( inputBlock->bits() ), static_cast< qgssize >( inputBlock->width() ) * inputBlock->height() );
+  return inputBlock;
+}
+
+void QgsBrightnessContrastFilter::adjustPixels( QRgb* pixels, qgssize count ) const
+{
+  if ( mBrightness == 0 && mContrast == 0 )
+    return;
 
-  int r, g, b, alpha;
   double f = qPow(( mContrast + 100 ) / 100.0, 2 );
 
-  for ( qgssize i = 0; i < ( qgssize )width*height; i++ )
+  for ( qgssize i = 0; i < count; i++ )
   {
-    if ( inputBlock->color( i ) == myNoDataColor )
+    QRgb myColor = pixels[i];
+    int alpha = qAlpha( myColor );
+
+    if ( alpha == 255 )
     {
-      outputBlock->setColor( i, myNoDataColor );
-      continue;
+      pixels[i] = qRgba( mLookupTable[qRed( myColor )], mLookupTable[qGreen( myColor )], mLookupTable[qBlue( myColor )], 255 );
+    }
+    else if ( alpha == 0 )
+    {
+      // no data or totally transparent pixel
+      pixels[i] = qRgba( 0, 0, 0, 0 );
+    }
+    else
+    {
+      int r = adjustColorComponent( qRed( myColor ), alpha, mBrightness, f );
+      int g = adjustColorComponent( qGreen( myColor ), alpha, mBrightness, f );
+      int b = adjustColorComponent( qBlue( myColor ), alpha, mBrightness, f );
+      pixels[i] = qRgba( r, g, b, alpha );
     }
-
-    myColor = inputBlock->color( i );
-    alpha = qAlpha( myColor );
-
-    r = adjustColorComponent( qRed( myColor ), alpha, mBrightness, f );
-    g = adjustColorComponent( qGreen( myColor ), alpha, mBrightness, f );
-    b = adjustColorComponent( qBlue( myColor ), alpha, mBrightness, f );
-
-    outputBlock->setColor( i, qRgba( r, g, b, alpha ) );
   }
+}
 
-  delete inputBlock;
-  return outputBlock;
+void QgsBrightnessContrastFilter::updateLookupTable()
+{
+  double f = qPow(( mContrast + 100 ) / 100.0, 2 );
+  for ( int c = 0; c < 256; c++ )
+  {
+    mLookupTable[c] = adjustColorComponent( c, 255, mBrightness, f );
+  }
 }
 
 int QgsBrightnessContrastFilter::adjustColorComponent( int colorComponent, int alpha, int brightness, double contrastFactor ) const
@@ -224,4 +242,5 @@ void QgsBrightnessContrastFilter::readXML( const QDomElement& filterElem )
 
   mBrightness = filterElem.attribute( "brightness", "0" ).toInt();
   mContrast = filterElem.attribute( "contrast", "0" ).toInt();
+  updateLookupTable();
 }
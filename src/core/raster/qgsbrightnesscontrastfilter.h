@@ -43,12 +43,21 @@ class CORE_EXPORT QgsBrightnessContrastFilter : public QgsRasterInterface
     QgsRasterBlock *block( int bandNo, const QgsRectangle &extent, int width, int height ) override;
     QgsRasterBlock *block2( int bandNo, const QgsRectangle &extent, int width, int height, QgsRasterBlockFeedback* feedback = nullptr ) override;
 
-    void setBrightness( int brightness ) { mBrightness = qBound( -255, brightness, 255 ); }
+    void setBrightness( int brightness ) { mBrightness = qBound( -255, brightness, 255 ); updateLookupTable(); }
     int brightness() const { return mBrightness; }
 
-    void setContrast( int contrast ) { mContrast = qBound( -100, contrast, 100 ); }
+    void setContrast( int contrast ) { mContrast = qBound( -100, contrast, 100 ); updateLookupTable(); }
     int contrast() const { return mContrast; }
 
+    /** Adjusts premultiplied ARGB pixels in place by the brightness and contrast of the filter.
+     * Lets a following filter adjust the pixels of a block in the same pass as its own changes.
+     * @param pixels first pixel to adjust
+     * @param count number of contiguous pixels
+     * @note added in QGIS 2.18
+     * @note not available in python bindings
+     */
+    void adjustPixels( QRgb* pixels, qgssize count ) const;
+
     void writeXML( QDomDocument& doc, QDomElement& parentElem ) const override;
 
     /** Sets base class members from xml. Usually called from create() methods of subclasses*/
@@ -58,11 +67,17 @@ class CORE_EXPORT QgsBrightnessContrastFilter : public QgsRasterInterface
     /** Adjusts a color component by the specified brightness and contrast factor*/
     int  adjustColorComponent( int colorComponent, int alpha, int brightness, double contrastFactor ) const;
 
+    /** Updates the adjusted color components of opaque pixels*/
+    void updateLookupTable();
+
     /** Current brightness coefficient value. Default: 0. Range: -255...255 */
     int mBrightness;
 
     /** Current contrast coefficient value. Default: 0. Range: -100...100 */
     double mContrast;
+
+    /** Adjusted color component of opaque pixels by color component*/
+    unsigned char mLookupTable[256];
 };
 
 #endif // QGSBRIGHTNESSCONTRASTFILTER_H
@@ -28,6 +28,12 @@ originally part of the larger QgsRasterLayer class
 
 #include <cmath>
 
+// Whether a color ramp item is below a value, for searching the first item equal or higher to the value
+static bool colorRampItemLessThan( const QgsColorRampShader::ColorRampItem& item, double value )
+{
+  return item.value + DOUBLE_DIFF_THRESHOLD < value;
+}
+
 QgsColorRampShader::QgsColorRampShader( double theMinimumValue, double theMaximumValue )
     : QgsRasterShaderFunction( theMinimumValue, theMaximumValue )
     , mColorRampType( INTERPOLATED )
@@ -148,11 +154,12 @@ bool QgsColorRampShader::shade( double theValue, int* theReturnRedValue, int* th
     // get initial value from LUT
     idx = mLUT.at( lutIndex );
 
-    // check if it's correct and if not increase untill correct
+    // check if it's correct and if not search the correct one in the following items,
     // the LUT is made in such a way the index is always correct or too low, never too high
-    while ( idx < colorRampItemListCount && mColorRampItemList.at( idx ).value + DOUBLE_DIFF_THRESHOLD < theValue )
+    if ( idx < colorRampItemListCount && mColorRampItemList.at( idx ).value + DOUBLE_DIFF_THRESHOLD < theValue )
     {
-      idx++;
+      QVector<QgsColorRampShader::ColorRampItem>::const_iterator itemIt = qLowerBound( mColorRampItemList.constBegin() + idx, mColorRampItemList.constEnd(), theValue, colorRampItemLessThan );
+      idx = itemIt - mColorRampItemList.constBegin();
     }
     if ( idx >= colorRampItemListCount )
     {
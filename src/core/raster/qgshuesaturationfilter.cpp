@@ -16,6 +16,7 @@
  ***************************************************************************/
 
 #include "qgsrasterdataprovider.h"
+#include "qgsbrightnesscontrastfilter.h"
 #include "qgshuesaturationfilter.h"
 
 #include <QDomDocument>
@@ -134,9 +135,24 @@ QgsRasterBlock * QgsHueSaturationFilter::block2( int bandNo, QgsRectangle  const
     return outputBlock;
   }
 
+  bool adjust = mSaturation != 0 || mGrayscaleMode != GrayscaleOff || mColorizeOn;
+
+  // A brightness/contrast filter before this filter adjusts the pixels in the same pass,
+  // so the pixels are read and written only once for both filters
+  QgsRasterInterface *input = mInput;
+  const QgsBrightnessContrastFilter *brightnessFilter = nullptr;
+  if ( adjust )
+  {
+    brightnessFilter = dynamic_cast< const QgsBrightnessContrastFilter * >( mInput );
+    if ( brightnessFilter && brightnessFilter->input() )
+      input = brightnessFilter->input();
+    else
+      brightnessFilter = nullptr;
+  }
+
   // At this moment we know that we read rendered image
   int bandNumber = 1;
-  QgsRasterBlock *inputBlock = mInput->block2( bandNumber, extent, width, height, feedback );
+  QgsRasterBlock *inputBlock = input->block2( bandNumber, extent, width, height, feedback );
   if ( !inputBlock || inputBlock->isEmpty() )
   {
     QgsDebugMsg( "No raster data!" );
@@ -144,50 +160,62 @@ QgsRasterBlock * QgsHueSaturationFilter::block2( int bandNo, QgsRectangle  const
     return outputBlock;
   }
 
-  if ( mSaturation == 0 && mGrayscaleMode == GrayscaleOff && !mColorizeOn )
+  if ( !adjust )
   {
     QgsDebugMsgLevel( "No hue/saturation change.", 4 );
     delete outputBlock;
     return inputBlock;
   }
 
-  if ( !outputBlock->reset( QGis::ARGB32_Premultiplied, width, height ) )
+  // adjust the image of the input block in place
+  if ( !inputBlock->convert( QGis::ARGB32_Premultiplied ) )
   {
     delete inputBlock;
     return outputBlock;
   }
+  delete outputBlock;
+
+  QRgb *pixels = reinterpret_cast< QRgb * >( inputBlock->bits() );
+  int blockWidth = inputBlock->width();
+  for ( int row = 0; row < inputBlock->height(); row++ )
+  {
+    // process row by row, so that the pixels adjusted by the brightness filter are still in the cache
+    QRgb *rowPixels = pixels + static_cast< qgssize >( row ) * blockWidth;
+    if ( brightnessFilter )
+    {
+      brightnessFilter->adjustPixels( rowPixels, blockWidth );
+    }
+    adjustPixels( rowPixels, blockWidth );
+  }
 
-  // adjust image
-  QRgb myNoDataColor = qRgba( 0, 0, 0, 0 );
-  QRgb myRgb;
+  return inputBlock;
+}
+
+void QgsHueSaturationFilter::adjustPixels( QRgb *pixels, qgssize count )
+{
   QColor myColor;
   int h, s, l;
   int r, g, b, alpha;
   double alphaFactor = 1.0;
+  bool changeSaturation = ( mGrayscaleMode != GrayscaleOff ) || ( mSaturationScale != 1 );
 
-  for ( qgssize i = 0; i < ( qgssize )width*height; i++ )
+  for ( qgssize i = 0; i < count; i++ )
   {
-    if ( inputBlock->color( i ) == myNoDataColor )
-    {
-      outputBlock->setColor( i, myNoDataColor );
-      continue;
-    }
-
-    myRgb = inputBlock->color( i );
-    myColor = QColor( myRgb );
+    QRgb myRgb = pixels[i];
 
     // Alpha must be taken from QRgb, since conversion from QRgb->QColor loses alpha
     alpha = qAlpha( myRgb );
 
     if ( alpha == 0 )
     {
-      // totally transparent, no changes required
-      outputBlock->setColor( i, myRgb );
+      // no data or totally transparent, no changes required
       continue;
     }
 
-    // Get rgb for color
-    myColor.getRgb( &r, &g, &b );
+    r = qRed( myRgb );
+    g = qGreen( myRgb );
+    b = qBlue( myRgb );
+    myColor = QColor::fromRgb( r, g, b );
     if ( alpha != 255 )
     {
       // Semi-transparent pixel. We need to adjust the colors since we are using QGis::ARGB32_Premultiplied
@@ -202,7 +230,7 @@ QgsRasterBlock * QgsHueSaturationFilter::block2( int bandNo, QgsRectangle  const
     myColor.getHsl( &h, &s, &l );
 
     // Changing saturation?
-    if (( mGrayscaleMode != GrayscaleOff ) || ( mSaturationScale != 1 ) )
+    if ( changeSaturation )
     {
       processSaturation( r, g, b, h, s, l );
     }
@@ -222,11 +250,8 @@ QgsRasterBlock * QgsHueSaturationFilter::block2( int bandNo, QgsRectangle  const
       b *= alphaFactor;
     }
 
-    outputBlock->setColor( i, qRgba( r, g, b, alpha ) );
+    pixels[i] = qRgba( r, g, b, alpha );
   }
-
-  delete inputBlock;
-  return outputBlock;
 }
 
 // Process a colorization and update resultant HSL & RGB values
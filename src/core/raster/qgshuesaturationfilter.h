@@ -72,6 +72,8 @@ class CORE_EXPORT QgsHueSaturationFilter : public QgsRasterInterface
     void readXML( const QDomElement& filterElem ) override;
 
   private:
+    /** Adjusts premultiplied ARGB pixels in place*/
+    void adjustPixels( QRgb *pixels, qgssize count );
     /** Process a change in saturation and update resultant HSL & RGB values*/
     void processSaturation( int &r, int &g, int &b, int &h, int &s, int &l );
     /** Process a colorization and update resultant HSL & RGB values*/
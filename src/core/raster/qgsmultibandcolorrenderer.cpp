@@ -18,11 +18,54 @@
 #include "qgsmultibandcolorrenderer.h"
 #include "qgscontrastenhancement.h"
 #include "qgsrastertransparency.h"
+#include "qgsrastervaluelookup_p.h"
 #include "qgsrasterviewport.h"
 #include <QDomDocument>
 #include <QDomElement>
 #include <QImage>
 #include <QSet>
+#include <QVector>
+
+#include <limits>
+
+// value of no data pixels and pixels outside of the displayable range in looked up band values
+static const int NO_BAND_VALUE = std::numeric_limits<int>::min();
+
+// Looks up the stretched values of the pixels of an integer band block, the value of every
+// pixel value is computed only once. Returns false if the block values can not be looked up.
+static bool lookupBandValues( QgsRasterBlock* block, QgsContrastEnhancement* contrastEnhancement, qgssize count, QVector<int>& values )
+{
+  if ( !block )
+  {
+    // band not set
+    values.fill( 0, count );
+    return true;
+  }
+
+  QgsRasterValueLookup lookup;
+  if ( !lookup.setBlock( block ) )
+  {
+    return false;
+  }
+
+  QVector<int> table( lookup.size() );
+  for ( int j = 0; j < lookup.size(); j++ )
+  {
+    double value = lookup.value( j );
+    if ( lookup.isNoData( j ) || ( contrastEnhancement && !contrastEnhancement->isValueInDisplayableRange( value ) ) )
+    {
+      table[j] = NO_BAND_VALUE;
+    }
+    else
+    {
+      table[j] = contrastEnhancement ? contrastEnhancement->enhanceContrast( value ) : static_cast< int >( value );
+    }
+  }
+
+  values.resize( count );
+  lookup.lookup( table.constData(), NO_BAND_VALUE, values.data() );
+  return true;
+}
 
 QgsMultiBandColorRenderer::QgsMultiBandColorRenderer( QgsRasterInterface* input, int redBand, int greenBand, int blueBand,
     QgsContrastEnhancement* redEnhancement,
@@ -231,93 +274,111 @@ QgsRasterBlock* QgsMultiBandColorRenderer::block2( int bandNo, QgsRectangle  con
   }
 
   QRgb myDefaultColor = NODATA_COLOR;
-
-  for ( qgssize i = 0; i < ( qgssize )width*height; i++ )
+  QRgb *outputData = reinterpret_cast< QRgb * >( outputBlock->bits() );
+  qgssize count = ( qgssize )width * height;
+
+  QVector<int> redValues;
+  QVector<int> greenValues;
+  QVector<int> blueValues;
+  if ( lookupBandValues( redBlock, mRedContrastEnhancement, count, redValues )
+       && lookupBandValues( greenBlock, mGreenContrastEnhancement, count, greenValues )
+       && lookupBandValues( blueBlock, mBlueContrastEnhancement, count, blueValues ) )
   {
-    if ( fastDraw ) //fast rendering if no transparency, stretching, color inversion, etc.
+    // stretched values of integer bands are looked up, only the opacity is computed per pixel
+    const int *redData = redValues.constData();
+    const int *greenData = greenValues.constData();
+    const int *blueData = blueValues.constData();
+    for ( qgssize i = 0; i < count; i++ )
     {
-      if ( redBlock->isNoData( i ) ||
-           greenBlock->isNoData( i ) ||
-           blueBlock->isNoData( i ) )
+      int redVal = redData[i];
+      int greenVal = greenData[i];
+      int blueVal = blueData[i];
+      if ( redVal == NO_BAND_VALUE || greenVal == NO_BAND_VALUE || blueVal == NO_BAND_VALUE )
       {
-        outputBlock->setColor( i, myDefaultColor );
+        outputData[i] = myDefaultColor;
+        continue;
       }
-      else
+
+      if ( fastDraw )
       {
-        int redVal = ( int )redBlock->value( i );
-        int greenVal = ( int )greenBlock->value( i );
-        int blueVal = ( int )blueBlock->value( i );
-        outputBlock->setColor( i, qRgba( redVal, greenVal, blueVal, 255 ) );
+        outputData[i] = qRgba( redVal, greenVal, blueVal, 255 );
+        continue;
       }
-      continue;
-    }
 
-    bool isNoData = false;
-    double redVal = 0;
-    double greenVal = 0;
-    double blueVal = 0;
-    if ( mRedBand > 0 )
-    {
-      redVal = redBlock->value( i );
-      if ( redBlock->isNoData( i ) ) isNoData = true;
-    }
-    if ( !isNoData && mGreenBand > 0 )
-    {
-      greenVal = greenBlock->value( i );
-      if ( greenBlock->isNoData( i ) ) isNoData = true;
-    }
-    if ( !isNoData && mBlueBand > 0 )
-    {
-      blueVal = blueBlock->value( i );
-      if ( blueBlock->isNoData( i ) ) isNoData = true;
+      outputData[i] = pixelColor( redVal, greenVal, blueVal, alphaBlock ? alphaBlock->value( i ) / 255.0 : 1.0 );
     }
-    if ( isNoData )
+  }
+  else
+  {
+    for ( qgssize i = 0; i < ( qgssize )width*height; i++ )
     {
-      outputBlock->setColor( i, myDefaultColor );
-      continue;
-    }
+      if ( fastDraw ) //fast rendering if no transparency, stretching, color inversion, etc.
+      {
+        if ( redBlock->isNoData( i ) ||
+             greenBlock->isNoData( i ) ||
+             blueBlock->isNoData( i ) )
+        {
+          outputData[i] = myDefaultColor;
+        }
+        else
+        {
+          int redVal = ( int )redBlock->value( i );
+          int greenVal = ( int )greenBlock->value( i );
+          int blueVal = ( int )blueBlock->value( i );
+          outputData[i] = qRgba( redVal, greenVal, blueVal, 255 );
+        }
+        continue;
+      }
 
-    //apply default color if red, green or blue not in displayable range
-    if (( mRedContrastEnhancement && !mRedContrastEnhancement->isValueInDisplayableRange( redVal ) )
-        || ( mGreenContrastEnhancement && !mGreenContrastEnhancement->isValueInDisplayableRange( redVal ) )
-        || ( mBlueContrastEnhancement && !mBlueContrastEnhancement->isValueInDisplayableRange( redVal ) ) )
-    {
-      outputBlock->setColor( i, myDefaultColor );
-      continue;
-    }
+      bool isNoData = false;
+      double redVal = 0;
+      double greenVal = 0;
+      double blueVal = 0;
+      if ( mRedBand > 0 )
+      {
+        redVal = redBlock->value( i );
+        if ( redBlock->isNoData( i ) ) isNoData = true;
+      }
+      if ( !isNoData && mGreenBand > 0 )
+      {
+        greenVal = greenBlock->value( i );
+        if ( greenBlock->isNoData( i ) ) isNoData = true;
+      }
+      if ( !isNoData && mBlueBand > 0 )
+      {
+        blueVal = blueBlock->value( i );
+        if ( blueBlock->isNoData( i ) ) isNoData = true;
+      }
+      if ( isNoData )
+      {
+        outputData[i] = myDefaultColor;
+        continue;
+      }
 
-    //stretch color values
-    if ( mRedContrastEnhancement )
-    {
-      redVal = mRedContrastEnhancement->enhanceContrast( redVal );
-    }
-    if ( mGreenContrastEnhancement )
-    {
-      greenVal = mGreenContrastEnhancement->enhanceContrast( greenVal );
-    }
-    if ( mBlueContrastEnhancement )
-    {
-      blueVal = mBlueContrastEnhancement->enhanceContrast( blueVal );
-    }
+      //apply default color if red, green or blue not in displayable range
+      if (( mRedContrastEnhancement && !mRedContrastEnhancement->isValueInDisplayableRange( redVal ) )
+          || ( mGreenContrastEnhancement && !mGreenContrastEnhancement->isValueInDisplayableRange( greenVal ) )
+          || ( mBlueContrastEnhancement && !mBlueContrastEnhancement->isValueInDisplayableRange( blueVal ) ) )
+      {
+        outputData[i] = myDefaultColor;
+        continue;
+      }
 
-    //opacity
-    double currentOpacity = mOpacity;
-    if ( mRasterTransparency )
-    {
-      currentOpacity = mRasterTransparency->alphaValue( redVal, greenVal, blueVal, mOpacity * 255 ) / 255.0;
-    }
-    if ( mAlphaBand > 0 )
-    {
-      currentOpacity *= alphaBlock->value( i ) / 255.0;
-    }
+      //stretch color values
+      if ( mRedContrastEnhancement )
+      {
+        redVal = mRedContrastEnhancement->enhanceContrast( redVal );
+      }
+      if ( mGreenContrastEnhancement )
+      {
+        greenVal = mGreenContrastEnhancement->enhanceContrast( greenVal );
+      }
+      if ( mBlueContrastEnhancement )
+      {
+        blueVal = mBlueContrastEnhancement->enhanceContrast( blueVal );
+      }
 
-    if ( qgsDoubleNear( currentOpacity, 1.0 ) )
-    {
-      outputBlock->setColor( i, qRgba( redVal, greenVal, blueVal, 255 ) );
-    }
-    else
-    {
-      outputBlock->setColor( i, qRgba( currentOpacity * redVal, currentOpacity * greenVal, currentOpacity * blueVal, currentOpacity * 255 ) );
+      outputData[i] = pixelColor( redVal, greenVal, blueVal, alphaBlock ? alphaBlock->value( i ) / 255.0 : 1.0 );
     }
   }
 
@@ -331,6 +392,25 @@ QgsRasterBlock* QgsMultiBandColorRenderer::block2( int bandNo, QgsRectangle  con
   return outputBlock;
 }
 
+QRgb QgsMultiBandColorRenderer::pixelColor( double redVal, double greenVal, double blueVal, double alphaFactor ) const
+{
+  double currentOpacity = mOpacity;
+  if ( mRasterTransparency )
+  {
+    currentOpacity = mRasterTransparency->alphaValue( redVal, greenVal, blueVal, mOpacity * 255 ) / 255.0;
+  }
+  if ( mAlphaBand > 0 )
+  {
+    currentOpacity *= alphaFactor;
+  }
+
+  if ( qgsDoubleNear( currentOpacity, 1.0 ) )
+  {
+    return qRgba( redVal, greenVal, blueVal, 255 );
+  }
+  return qRgba( currentOpacity * redVal, currentOpacity * greenVal, currentOpacity * blueVal, currentOpacity * 255 );
+}
+
 void QgsMultiBandColorRenderer::writeXML( QDomDocument& doc, QDomElement& parentElem ) const
 {
   if ( parentElem.isNull() )
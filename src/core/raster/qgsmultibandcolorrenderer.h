@@ -72,6 +72,9 @@ class CORE_EXPORT QgsMultiBandColorRenderer: public QgsRasterRenderer
     QgsContrastEnhancement* mGreenContrastEnhancement;
     QgsContrastEnhancement* mBlueContrastEnhancement;
 
+    //! Returns the color of stretched band values, alphaFactor is the value of the alpha band scaled to 0..1
+    QRgb pixelColor( double redVal, double greenVal, double blueVal, double alphaFactor ) const;
+
     QgsMultiBandColorRenderer( const QgsMultiBandColorRenderer& );
     const QgsMultiBandColorRenderer& operator=( const QgsMultiBandColorRenderer& );
 };
@@ -19,6 +19,8 @@
 
 #include <QByteArray>
 #include <QColor>
+#include <QList>
+#include <QMutex>
 
 #include "qgslogger.h"
 #include "qgsrasterblock.h"
@@ -26,6 +28,170 @@
 // See #9101 before any change of NODATA_COLOR!
 const QRgb QgsRasterBlock::mNoDataColor = qRgba( 0, 0, 0, 0 );
 
+///@cond PRIVATE
+
+/** Buffers of deleted or reset raster blocks kept for reuse. The stages of a raster pipe
+ * allocate blocks of the same size and type for every request, so most blocks take their
+ * buffer from the pool instead of allocating it. The least recently released buffers are
+ * freed first when the pool grows over its capacity.
+ */
+class QgsRasterBlockBufferPool
+{
+  public:
+    QgsRasterBlockBufferPool()
+        : mCapacity( 64 * 1024 * 1024 )
+        , mSize( 0 )
+    {}
+
+    ~QgsRasterBlockBufferPool()
+    {
+      shrink( 0 );
+    }
+
+    void* takeData( qgssize size )
+    {
+      QMutexLocker locker( &mMutex );
+      for ( int i = mBuffers.count() - 1; i >= 0; --i )
+      {
+        const Buffer& buffer = mBuffers.at( i );
+        if ( buffer.data && buffer.size == size )
+        {
+          void* data = buffer.data;
+          mSize -= size;
+          mBuffers.removeAt( i );
+          return data;
+        }
+      }
+      return nullptr;
+    }
+
+    QImage* takeImage( int width, int height, QImage::Format format )
+    {
+      QMutexLocker locker( &mMutex );
+      for ( int i = mBuffers.count() - 1; i >= 0; --i )
+      {
+        const Buffer& buffer = mBuffers.at( i );
+        if ( buffer.image && buffer.image->width() == width && buffer.image->height() == height
+             && buffer.image->format() == format )
+        {
+          QImage* image = buffer.image;
+          mSize -= buffer.size;
+          mBuffers.removeAt( i );
+          return image;
+        }
+      }
+      return nullptr;
+    }
+
+    void releaseData( void* data, qgssize size )
+    {
+      QMutexLocker locker( &mMutex );
+      if ( size == 0 || size > mCapacity )
+      {
+        qgsFree( data );
+        return;
+      }
+      Buffer buffer = { data, nullptr, size };
+      mBuffers << buffer;
+      mSize += size;
+      shrink( mCapacity );
+    }
+
+    void releaseImage( QImage* image )
+    {
+      // an image still shared with a copy returned by QgsRasterBlock::image() cannot be reused
+      qgssize size = static_cast< qgssize >( image->byteCount() );
+      QMutexLocker locker( &mMutex );
+      if ( size == 0 || size > mCapacity || !image->isDetached() || !image->textKeys().isEmpty() )
+      {
+        delete image;
+        return;
+      }
+      Buffer buffer = { nullptr, image, size };
+      mBuffers << buffer;
+      mSize += size;
+      shrink( mCapacity );
+    }
+
+    void setCapacity( qgssize capacity )
+    {
+      QMutexLocker locker( &mMutex );
+      mCapacity = capacity;
+      shrink( mCapacity );
+    }
+
+    qgssize capacity()
+    {
+      QMutexLocker locker( &mMutex );
+      return mCapacity;
+    }
+
+  private:
+    struct Buffer
+    {
+      void* data;
+      QImage* image;
+      qgssize size;
+    };
+
+    QMutex mMutex;
+    QList<Buffer> mBuffers;
+    qgssize mCapacity;
+    qgssize mSize;
+
+    void shrink( qgssize capacity )
+    {
+      while ( mSize > capacity && !mBuffers.isEmpty() )
+      {
+        Buffer buffer = mBuffers.takeFirst();
+        qgsFree( buffer.data );
+        delete buffer.image;
+        mSize -= buffer.size;
+      }
+    }
+};
+
+Q_GLOBAL_STATIC( QgsRasterBlockBufferPool, sBufferPool )
+
+static void* allocateBlockData( qgssize size )
+{
+  QgsRasterBlockBufferPool* pool = sBufferPool();
+  void* data = pool ? pool->takeData( size ) : nullptr;
+  return data ? data : qgsMalloc( size );
+}
+
+static void freeBlockData( void* data, qgssize size )
+{
+  if ( !data )
+    return;
+
+  // the pool does not exist anymore if a block is deleted while the application exits
+  if ( QgsRasterBlockBufferPool* pool = sBufferPool() )
+    pool->releaseData( data, size );
+  else
+    qgsFree( data );
+}
+
+static QImage* createBlockImage( int width, int height, QImage::Format format )
+{
+  QgsRasterBlockBufferPool* pool = sBufferPool();
+  QImage* image = pool ? pool->takeImage( width, height, format ) : nullptr;
+  return image ? image : new QImage( width, height, format );
+}
+
+static void deleteBlockImage( QImage* image )
+{
+  if ( !image )
+    return;
+
+  if ( QgsRasterBlockBufferPool* pool = sBufferPool() )
+    pool->releaseImage( image );
+  else
+    delete image;
+}
+
+///@endcond
+
 QgsRasterBlock::QgsRasterBlock()
     : mValid( true )
     , mDataType( QGis::UnknownDataType )
@@ -79,8 +245,8 @@ QgsRasterBlock::QgsRasterBlock( QGis::DataType theDataType, int theWidth, int th
 QgsRasterBlock::~QgsRasterBlock()
 {
   QgsDebugMsgLevel( QString( "mData = %1" ).arg( reinterpret_cast< ulong >( mData ) ), 4 );
-  qgsFree( mData );
-  delete mImage;
+  freeBlockData( mData, dataSize() );
+  deleteBlockImage( mImage );
   qgsFree( mNoDataBitmap );
 }
 
@@ -100,9 +266,9 @@ bool QgsRasterBlock::reset( QGis::DataType theDataType, int theWidth, int theHei
 {
   QgsDebugMsgLevel( QString( "theWidth= %1 theHeight = %2 theDataType = %3 theNoDataValue = %4" ).arg( theWidth ).arg( theHeight ).arg( theDataType ).arg( theNoDataValue ), 4 );
 
-  qgsFree( mData );
+  freeBlockData( mData, dataSize() );
   mData = nullptr;
-  delete mImage;
+  deleteBlockImage( mImage );
   mImage = nullptr;
   qgsFree( mNoDataBitmap );
   mNoDataBitmap = nullptr;
@@ -119,7 +285,7 @@ bool QgsRasterBlock::reset( QGis::DataType theDataType, int theWidth, int theHei
     QgsDebugMsgLevel( "Numeric type", 4 );
     qgssize tSize = typeSize( theDataType );
     QgsDebugMsgLevel( QString( "allocate %1 bytes" ).arg( tSize * theWidth * theHeight ), 4 );
-    mData = qgsMalloc( tSize * theWidth * theHeight );
+    mData = allocateBlockData( tSize * theWidth * theHeight );
     if ( !mData )
     {
       QgsDebugMsg( QString( "Couldn't allocate data memory of %1 bytes" ).arg( tSize * theWidth * theHeight ) );
@@ -130,7 +296,7 @@ bool QgsRasterBlock::reset( QGis::DataType theDataType, int theWidth, int theHei
   {
     QgsDebugMsgLevel( "Color type", 4 );
     QImage::Format format = imageFormat( theDataType );
-    mImage = new QImage( theWidth, theHeight, format );
+    mImage = createBlockImage( theWidth, theHeight, format );
   }
   else
   {
@@ -714,7 +880,7 @@ bool QgsRasterBlock::convert( QGis::DataType destDataType )
       QgsDebugMsg( "Cannot convert raster block" );
       return false;
     }
-    qgsFree( mData );
+    freeBlockData( mData, dataSize() );
     mData = data;
     mDataType = destDataType;
     mTypeSize = typeSize( mDataType );
@@ -779,9 +945,9 @@ QImage QgsRasterBlock::image() const
 
 bool QgsRasterBlock::setImage( const QImage * image )
 {
-  qgsFree( mData );
+  freeBlockData( mData, dataSize() );
   mData = nullptr;
-  delete mImage;
+  deleteBlockImage( mImage );
   mImage = nullptr;
   mImage = new QImage( *image );
   mWidth = mImage->width();
@@ -792,6 +958,18 @@ bool QgsRasterBlock::setImage( const QImage * image )
   return true;
 }
 
+void QgsRasterBlock::setBufferPoolCapacity( qgssize bytes )
+{
+  if ( QgsRasterBlockBufferPool* pool = sBufferPool() )
+    pool->setCapacity( bytes );
+}
+
+qgssize QgsRasterBlock::bufferPoolCapacity()
+{
+  QgsRasterBlockBufferPool* pool = sBufferPool();
+  return pool ? pool->capacity() : 0;
+}
+
 QString QgsRasterBlock::printValue( double value )
 {
   /*
@@ -855,7 +1033,7 @@ QString QgsRasterBlock::printValue( float value )
 void * QgsRasterBlock::convert( void *srcData, QGis::DataType srcDataType, QGis::DataType destDataType, qgssize size )
 {
   int destDataTypeSize = typeSize( destDataType );
-  void *destData = qgsMalloc( destDataTypeSize * size );
+  void *destData = allocateBlockData( destDataTypeSize * size );
   for ( qgssize i = 0; i < size; i++ )
   {
     double value = readValue( srcData, srcDataType, i );
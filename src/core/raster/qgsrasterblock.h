@@ -352,10 +352,28 @@ class CORE_EXPORT QgsRasterBlock
      */
     int height() const { return mHeight; }
 
+    /** Sets the maximum size in bytes of the buffers of deleted raster blocks which are kept
+     * for reuse. Blocks take a buffer of the same size and type from this pool instead of
+     * allocating a new one. The pool is shared by all blocks. A capacity of 0 disables the pool.
+     * @see bufferPoolCapacity()
+     * @note added in QGIS 2.18
+     */
+    static void setBufferPoolCapacity( qgssize bytes );
+
+    /** Returns the maximum size in bytes of the buffers of deleted raster blocks which are kept
+     * for reuse. Defaults to 64 MB.
+     * @see setBufferPoolCapacity()
+     * @note added in QGIS 2.18
+     */
+    static qgssize bufferPoolCapacity();
+
   private:
     static QImage::Format imageFormat( QGis::DataType theDataType );
     static QGis::DataType dataType( QImage::Format theFormat );
 
+    //! Returns the size in bytes of the numeric data
+    qgssize dataSize() const { return static_cast< qgssize >( mTypeSize ) * mWidth * mHeight; }
+
     /** Test if value is nodata comparing to noDataValue
      * @param value tested value
      * @param noDataValue no data value
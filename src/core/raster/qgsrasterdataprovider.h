@@ -276,16 +276,27 @@ class CORE_EXPORT QgsRasterDataProvider : public QgsDataProvider, public QgsRast
       return nullptr;
     }
 
-    /** \brief Create pyramid overviews */
+    /** \brief Create pyramid overviews
+     * @param thePyramidList pyramids, those with the build flag set are created
+     * @param theResamplingMethod resampling method name
+     * @param theFormat format of the pyramids
+     * @param theConfigOptions driver specific configuration options
+     * @param feedback optional feedback object which receives the progress and allows
+     * cancelling the build from another thread. Added in QGIS 2.18.
+     * @return null string on success, otherwise a string specifying error. "ERROR_CANCELED"
+     * is returned if the build was cancelled.
+     */
     virtual QString buildPyramids( const QList<QgsRasterPyramid> & thePyramidList,
                                    const QString & theResamplingMethod = "NEAREST",
                                    QgsRaster::RasterPyramidsFormat theFormat = QgsRaster::PyramidsGTiff,
-                                   const QStringList & theConfigOptions = QStringList() )
+                                   const QStringList & theConfigOptions = QStringList(),
+                                   QgsFeedback* feedback = nullptr )
     {
       Q_UNUSED( thePyramidList );
       Q_UNUSED( theResamplingMethod );
       Q_UNUSED( theFormat );
       Q_UNUSED( theConfigOptions );
+      Q_UNUSED( feedback );
       return "FAILED_NOT_SUPPORTED";
     }
 
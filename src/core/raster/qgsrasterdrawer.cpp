@@ -17,16 +17,195 @@
 
 #include "qgslogger.h"
 #include "qgsrasterdrawer.h"
+#include "qgsrasterblock.h"
 #include "qgsrasterinterface.h"
 #include "qgsrasteriterator.h"
 #include "qgsrasterviewport.h"
 #include "qgsmaptopixel.h"
 #include "qgsrendercontext.h"
 #include <QImage>
+#include <QMutex>
 #include <QPainter>
 #include <QPrinter>
+#include <QThread>
+#include <QWaitCondition>
+#include <QtConcurrentMap>
 
-QgsRasterDrawer::QgsRasterDrawer( QgsRasterIterator* iterator ): mIterator( iterator )
+///@cond PRIVATE
+
+//! Minimum height of the parts of the raster processed in parallel, in output pixels
+static const int MIN_PARALLEL_PART_HEIGHT = 256;
+//! Number of output pixels by which parts processed in parallel overlap, so that resampling is continuous across parts
+static const int PARALLEL_PART_MARGIN = 8;
+//! Ratio of the view port size to the size of the coarse preview drawn first in progressive rendering
+static const int PROGRESSIVE_PREVIEW_FACTOR = 8;
+//! Minimum view port size for which a coarse preview is drawn, in output pixels
+static const int PROGRESSIVE_MIN_SIZE = 512;
+//! Maximum size of the parts drawn one after another in progressive rendering, in output pixels
+static const int PROGRESSIVE_PART_SIZE = 512;
+
+struct QgsRasterDrawerPart
+{
+  //! Extent of the part including the margins
+  QgsRectangle extent;
+  //! Size of the part including the margins
+  int width;
+  int height;
+  //! Margins on the left and on the top of the part
+  int left;
+  int top;
+  //! Size and position of the part in the view port
+  int nCols;
+  int nRows;
+  int topLeftCol;
+  int topLeftRow;
+};
+
+//! Returns a copy of the interfaces from the data provider up to an interface, or null on failure
+static QgsRasterInterface* cloneRasterPipe( const QgsRasterInterface* last )
+{
+  QgsRasterInterface* clone = last->clone();
+  if ( !clone || !last->input() )
+    return clone;
+
+  QgsRasterInterface* input = cloneRasterPipe( last->input() );
+  if ( !input || !clone->setInput( input ) )
+  {
+    while ( input )
+    {
+      QgsRasterInterface* next = input->input();
+      delete input;
+      input = next;
+    }
+    delete clone;
+    return nullptr;
+  }
+  return clone;
+}
+
+//! Copies of the raster pipe shared by the threads, each copy is used by a single thread at a time
+class QgsRasterDrawerPipePool
+{
+  public:
+    QgsRasterDrawerPipePool() {}
+
+    ~QgsRasterDrawerPipePool()
+    {
+      Q_FOREACH ( QgsRasterInterface* pipe, mPipes )
+      {
+        while ( pipe )
+        {
+          QgsRasterInterface* input = pipe->input();
+          delete pipe;
+          pipe = input;
+        }
+      }
+    }
+
+    //! Adds copies of the pipe ending with an interface, returns false if it could not be copied
+    bool addCopies( const QgsRasterInterface* last, int count )
+    {
+      for ( int i = 0; i < count; ++i )
+      {
+        QgsRasterInterface* pipe = cloneRasterPipe( last );
+        if ( !pipe )
+          return false;
+        mPipes << pipe;
+        mFree << pipe;
+      }
+      return true;
+    }
+
+    QgsRasterInterface* acquire()
+    {
+      QMutexLocker locker( &mMutex );
+      while ( mFree.isEmpty() )
+        mReleased.wait( &mMutex );
+      return mFree.takeLast();
+    }
+
+    void release( QgsRasterInterface* pipe )
+    {
+      QMutexLocker locker( &mMutex );
+      mFree << pipe;
+      mReleased.wakeOne();
+    }
+
+  private:
+    QList<QgsRasterInterface*> mPipes;
+    QList<QgsRasterInterface*> mFree;
+    QMutex mMutex;
+    QWaitCondition mReleased;
+};
+
+//! Draws the parts processed in parallel as soon as they are completed, one at a time
+struct QgsRasterDrawerOutput
+{
+  const QgsRasterDrawer* drawer;
+  QPainter* painter;
+  QgsRasterViewPort* viewPort;
+  const QgsMapToPixel* mapToPixel;
+  QMutex mutex;
+};
+
+class QgsRasterDrawerPartReader
+{
+  public:
+    typedef QImage result_type;
+
+    /** Constructor for QgsRasterDrawerPartReader. If output is set, the parts are drawn to it
+     * by the threads which process them and null images are returned.
+     */
+    QgsRasterDrawerPartReader( int bandNumber, QgsRasterDrawerPipePool* pool, QgsRasterBlockFeedback* feedback, QgsRasterDrawerOutput* output = nullptr )
+        : mBandNumber( bandNumber )
+        , mPool( pool )
+        , mFeedback( feedback )
+        , mOutput( output )
+    {}
+
+    QImage operator()( const QgsRasterDrawerPart& part )
+    {
+      if ( mFeedback && mFeedback->isCancelled() )
+        return QImage();
+
+      QgsRasterInterface* pipe = mPool->acquire();
+      QgsRasterBlock* block = pipe->block2( mBandNumber, part.extent, part.width, part.height, mFeedback );
+      mPool->release( pipe );
+
+      if ( !block )
+        return QImage();
+
+      QImage img = block->image();
+      delete block;
+
+      if ( part.width != part.nCols || part.height != part.nRows )
+        img = img.copy( part.left, part.top, part.nCols, part.nRows );
+
+      if ( mOutput )
+      {
+        if ( mFeedback && mFeedback->isCancelled() )
+          return QImage();
+
+        QMutexLocker locker( &mOutput->mutex );
+        mOutput->drawer->drawPart( mOutput->painter, mOutput->viewPort, img, part.topLeftCol, part.topLeftRow, mOutput->mapToPixel, mFeedback );
+        return QImage();
+      }
+      return img;
+    }
+
+  private:
+    int mBandNumber;
+    QgsRasterDrawerPipePool* mPool;
+    QgsRasterBlockFeedback* mFeedback;
+    QgsRasterDrawerOutput* mOutput;
+};
+
+///@endcond
+
+QgsRasterDrawer::QgsRasterDrawer( QgsRasterIterator* iterator )
+    : mIterator( iterator )
+    , mParallel( false )
+    , mProgressive( false )
 {
 }
 
@@ -38,6 +217,29 @@ void QgsRasterDrawer::draw( QPainter* p, QgsRasterViewPort* viewPort, const QgsM
     return;
   }
 
+  // partial output is drawn to a temporary image of the layer which is shown while the map is rendered
+  bool progressive = mProgressive && feedback && feedback->renderPartialOutput() && !feedback->isPreviewOnly();
+  if ( progressive )
+  {
+    drawPreview( p, viewPort, theQgsMapToPixel, feedback );
+    if ( feedback->isCancelled() )
+      return;
+  }
+
+  if ( mParallel && drawParallel( p, viewPort, theQgsMapToPixel, ctx, feedback, progressive ) )
+  {
+    return;
+  }
+
+  // smaller parts replace the preview more often
+  int maxTileWidth = mIterator->maximumTileWidth();
+  int maxTileHeight = mIterator->maximumTileHeight();
+  if ( progressive )
+  {
+    mIterator->setMaximumTileWidth( qMin( maxTileWidth, PROGRESSIVE_PART_SIZE ) );
+    mIterator->setMaximumTileHeight( qMin( maxTileHeight, PROGRESSIVE_PART_SIZE ) );
+  }
+
   // last pipe filter has only 1 band
   int bandNumber = 1;
   mIterator->startRasterRead( bandNumber, viewPort->mWidth, viewPort->mHeight, viewPort->mDrawnExtent, feedback );
@@ -63,55 +265,178 @@ void QgsRasterDrawer::draw( QPainter* p, QgsRasterViewPort* viewPort, const QgsM
       continue;
     }
 
-    QImage img = block->image();
+    drawPart( p, viewPort, block->image(), topLeftCol, topLeftRow, theQgsMapToPixel, feedback );
 
-    // Because of bug in Acrobat Reader we must use "white" transparent color instead
-    // of "black" for PDF. See #9101.
-    QPrinter *printer = dynamic_cast<QPrinter *>( p->device() );
-    if ( printer && printer->outputFormat() == QPrinter::PdfFormat )
-    {
-      QgsDebugMsgLevel( "PdfFormat", 4 );
+    delete block;
 
-      img = img.convertToFormat( QImage::Format_ARGB32 );
-      QRgb transparentBlack = qRgba( 0, 0, 0, 0 );
-      QRgb transparentWhite = qRgba( 255, 255, 255, 0 );
-      for ( int x = 0; x < img.width(); x++ )
-      {
-        for ( int y = 0; y < img.height(); y++ )
-        {
-          if ( img.pixel( x, y ) == transparentBlack )
-          {
-            img.setPixel( x, y, transparentWhite );
-          }
-        }
-      }
+    // ok this does not matter much anyway as the tile size quite big so most of the time
+    // there would be just one tile for the whole display area, but it won't hurt...
+    if ( feedback && feedback->isCancelled() )
+      break;
+
+    // for compatibility
+    if ( ctx && ctx->renderingStopped() )
+      break;
+  }
+
+  mIterator->setMaximumTileWidth( maxTileWidth );
+  mIterator->setMaximumTileHeight( maxTileHeight );
+}
+
+void QgsRasterDrawer::drawPreview( QPainter* p, QgsRasterViewPort* viewPort, const QgsMapToPixel* theQgsMapToPixel, QgsRasterBlockFeedback* feedback )
+{
+  if ( viewPort->mWidth < PROGRESSIVE_MIN_SIZE && viewPort->mHeight < PROGRESSIVE_MIN_SIZE )
+    return;
+
+  // the provider reads a coarse request from an overview if there is one
+  int width = qMax( 1, viewPort->mWidth / PROGRESSIVE_PREVIEW_FACTOR );
+  int height = qMax( 1, viewPort->mHeight / PROGRESSIVE_PREVIEW_FACTOR );
+
+  QImage preview( width, height, QImage::Format_ARGB32_Premultiplied );
+  if ( preview.isNull() )
+    return;
+  preview.fill( 0 );
+
+  int bandNumber = 1;
+  mIterator->startRasterRead( bandNumber, width, height, viewPort->mDrawnExtent, feedback );
+
+  int nCols = 0;
+  int nRows = 0;
+  int topLeftCol = 0;
+  int topLeftRow = 0;
+  QgsRasterBlock *block;
+  QPainter previewPainter( &preview );
+  previewPainter.setCompositionMode( QPainter::CompositionMode_Source );
+  while ( mIterator->readNextRasterPart( bandNumber, nCols, nRows, &block, topLeftCol, topLeftRow ) )
+  {
+    if ( block )
+    {
+      previewPainter.drawImage( topLeftCol, topLeftRow, block->image() );
+      delete block;
     }
+    if ( feedback->isCancelled() )
+      break;
+  }
+  previewPainter.end();
+
+  if ( feedback->isCancelled() )
+    return;
+
+  drawPart( p, viewPort, preview.scaled( viewPort->mWidth, viewPort->mHeight ), 0, 0, theQgsMapToPixel, feedback );
+}
+
+bool QgsRasterDrawer::drawParallel( QPainter* p, QgsRasterViewPort* viewPort, const QgsMapToPixel* theQgsMapToPixel, const QgsRenderContext *ctx, QgsRasterBlockFeedback* feedback, bool progressive )
+{
+  int threads = QThread::idealThreadCount();
+  if ( threads < 2 || viewPort->mHeight < 2 * MIN_PARALLEL_PART_HEIGHT || !mIterator->input() )
+    return false;
+
+  // split the view port into horizontal strips, a few for every thread, so that the
+  // threads stay busy even if some strips take longer than others
+  int partHeight = qMax( MIN_PARALLEL_PART_HEIGHT, viewPort->mHeight / ( 2 * threads ) + 1 );
+  int maxTileHeight = mIterator->maximumTileHeight();
+  mIterator->setMaximumTileHeight( qMin( maxTileHeight, partHeight ) );
+
+  int bandNumber = 1;
+  mIterator->startRasterRead( bandNumber, viewPort->mWidth, viewPort->mHeight, viewPort->mDrawnExtent, feedback );
+
+  double xRes = viewPort->mDrawnExtent.width() / viewPort->mWidth;
+  double yRes = viewPort->mDrawnExtent.height() / viewPort->mHeight;
 
-    if ( feedback && feedback->renderPartialOutput() )
+  QVector<QgsRasterDrawerPart> parts;
+  QgsRasterDrawerPart part;
+  QgsRectangle partExtent;
+  while ( mIterator->nextRasterPart( bandNumber, part.nCols, part.nRows, partExtent, part.topLeftCol, part.topLeftRow ) )
+  {
+    // extend the part into its neighbours, the margins are cropped after processing
+    part.left = qMin( PARALLEL_PART_MARGIN, part.topLeftCol );
+    part.top = qMin( PARALLEL_PART_MARGIN, part.topLeftRow );
+    int right = qMin( PARALLEL_PART_MARGIN, viewPort->mWidth - part.topLeftCol - part.nCols );
+    int bottom = qMin( PARALLEL_PART_MARGIN, viewPort->mHeight - part.topLeftRow - part.nRows );
+    part.width = part.left + part.nCols + right;
+    part.height = part.top + part.nRows + bottom;
+    part.extent = QgsRectangle( partExtent.xMinimum() - part.left * xRes, partExtent.yMinimum() - bottom * yRes,
+                                partExtent.xMaximum() + right * xRes, partExtent.yMaximum() + part.top * yRes );
+    parts << part;
+  }
+  mIterator->stopRasterRead( bandNumber );
+  mIterator->setMaximumTileHeight( maxTileHeight );
+
+  // every thread works with its own copy of the pipe, the interfaces keep state while processing a block
+  QgsRasterDrawerPipePool pool;
+  if ( parts.size() < 2 || !pool.addCopies( mIterator->input(), qMin( threads, parts.size() ) ) )
+    return false;
+
+  if ( progressive )
+  {
+    // the parts replace the preview as soon as they are completed
+    QgsRasterDrawerOutput output;
+    output.drawer = this;
+    output.painter = p;
+    output.viewPort = viewPort;
+    output.mapToPixel = theQgsMapToPixel;
+    QtConcurrent::blockingMapped< QVector<QImage> >( parts, QgsRasterDrawerPartReader( bandNumber, &pool, feedback, &output ) );
+    return true;
+  }
+
+  // the calling thread takes part in the work, so this does not deadlock when it is a thread
+  // of the global pool itself, e.g. in parallel map rendering
+  QVector<QImage> images = QtConcurrent::blockingMapped< QVector<QImage> >( parts, QgsRasterDrawerPartReader( bandNumber, &pool, feedback ) );
+
+  for ( int i = 0; i < parts.size(); ++i )
+  {
+    if ( ( feedback && feedback->isCancelled() ) || ( ctx && ctx->renderingStopped() ) )
+      break;
+
+    if ( images.at( i ).isNull() )
     {
-      // there could have been partial preview written before
-      // so overwrite anything with the resulting image.
-      // (we are guaranteed to have a temporary image for this layer, see QgsMapRendererJob::needTemporaryImage)
-      p->setCompositionMode( QPainter::CompositionMode_Source );
+      QgsDebugMsg( "Cannot get block" );
+      continue;
     }
 
-    drawImage( p, viewPort, img, topLeftCol, topLeftRow, theQgsMapToPixel );
+    drawPart( p, viewPort, images.at( i ), parts.at( i ).topLeftCol, parts.at( i ).topLeftRow, theQgsMapToPixel, feedback );
+  }
 
-    delete block;
+  return true;
+}
 
-    if ( feedback && feedback->renderPartialOutput() )
+void QgsRasterDrawer::drawPart( QPainter* p, QgsRasterViewPort* viewPort, QImage img, int topLeftCol, int topLeftRow, const QgsMapToPixel* theQgsMapToPixel, QgsRasterBlockFeedback* feedback ) const
+{
+  // Because of bug in Acrobat Reader we must use "white" transparent color instead
+  // of "black" for PDF. See #9101.
+  QPrinter *printer = dynamic_cast<QPrinter *>( p->device() );
+  if ( printer && printer->outputFormat() == QPrinter::PdfFormat )
+  {
+    QgsDebugMsgLevel( "PdfFormat", 4 );
+
+    img = img.convertToFormat( QImage::Format_ARGB32 );
+    QRgb transparentBlack = qRgba( 0, 0, 0, 0 );
+    QRgb transparentWhite = qRgba( 255, 255, 255, 0 );
+    for ( int x = 0; x < img.width(); x++ )
     {
-      p->setCompositionMode( QPainter::CompositionMode_SourceOver );  // go back to the default composition mode
+      for ( int y = 0; y < img.height(); y++ )
+      {
+        if ( img.pixel( x, y ) == transparentBlack )
+        {
+          img.setPixel( x, y, transparentWhite );
+        }
+      }
     }
+  }
 
-    // ok this does not matter much anyway as the tile size quite big so most of the time
-    // there would be just one tile for the whole display area, but it won't hurt...
-    if ( feedback && feedback->isCancelled() )
-      break;
+  if ( feedback && feedback->renderPartialOutput() )
+  {
+    // there could have been partial preview written before
+    // so overwrite anything with the resulting image.
+    // (we are guaranteed to have a temporary image for this layer, see QgsMapRendererJob::needTemporaryImage)
+    p->setCompositionMode( QPainter::CompositionMode_Source );
+  }
 
-    // for compatibility
-    if ( ctx && ctx->renderingStopped() )
-      break;
+  drawImage( p, viewPort, img, topLeftCol, topLeftRow, theQgsMapToPixel );
+
+  if ( feedback && feedback->renderPartialOutput() )
+  {
+    p->setCompositionMode( QPainter::CompositionMode_SourceOver );  // go back to the default composition mode
   }
 }
 
@@ -46,6 +46,38 @@ class CORE_EXPORT QgsRasterDrawer
      */
     void draw( QPainter* p, QgsRasterViewPort* viewPort, const QgsMapToPixel* theQgsMapToPixel, const QgsRenderContext *ctx = nullptr, QgsRasterBlockFeedback* feedback = nullptr );
 
+    /** Sets whether the raster is split into parts which are read and processed on several
+     * threads. Every thread uses its own copy of the pipe, including the data provider, so it
+     * should only be enabled for inputs which can be opened several times cheaply, e.g. local
+     * files. Disabled by default.
+     * @see isParallelRenderingEnabled()
+     * @note added in QGIS 2.18
+     */
+    void setParallelRenderingEnabled( bool enabled ) { mParallel = enabled; }
+
+    /** Returns whether the raster is split into parts which are read and processed on several threads.
+     * @see setParallelRenderingEnabled()
+     * @note added in QGIS 2.18
+     */
+    bool isParallelRenderingEnabled() const { return mParallel; }
+
+    /** Sets whether the raster is drawn progressively when the feedback asks for partial output,
+     * e.g. in the map canvas: a coarse preview of the whole view port is drawn first, from an
+     * overview if available, and then replaced part by part with the raster drawn at full
+     * resolution as the parts are completed. The preview costs an additional read of the
+     * input, so it should only be enabled for inputs which are read quickly at a coarse
+     * resolution. Disabled by default.
+     * @see isProgressiveRenderingEnabled()
+     * @note added in QGIS 2.18
+     */
+    void setProgressiveRenderingEnabled( bool enabled ) { mProgressive = enabled; }
+
+    /** Returns whether the raster is drawn progressively when the feedback asks for partial output.
+     * @see setProgressiveRenderingEnabled()
+     * @note added in QGIS 2.18
+     */
+    bool isProgressiveRenderingEnabled() const { return mProgressive; }
+
   protected:
     /** Draws raster part
      * @param p the painter to draw to
@@ -60,6 +92,21 @@ class CORE_EXPORT QgsRasterDrawer
 
   private:
     QgsRasterIterator* mIterator;
+    bool mParallel;
+    bool mProgressive;
+
+    //! Draws the parts of the raster read and processed on several threads
+    //! @param progressive whether the parts are drawn as soon as they are processed
+    //! @returns false if the parts could not be processed in parallel
+    bool drawParallel( QPainter* p, QgsRasterViewPort* viewPort, const QgsMapToPixel* theQgsMapToPixel, const QgsRenderContext *ctx, QgsRasterBlockFeedback* feedback, bool progressive );
+
+    //! Draws a coarse preview of the whole view port, scaled up to the view port size
+    void drawPreview( QPainter* p, QgsRasterViewPort* viewPort, const QgsMapToPixel* theQgsMapToPixel, QgsRasterBlockFeedback* feedback );
+
+    //! Draws the image of a part of the raster
+    void drawPart( QPainter* p, QgsRasterViewPort* viewPort, QImage img, int topLeftCol, int topLeftRow, const QgsMapToPixel* theQgsMapToPixel, QgsRasterBlockFeedback* feedback ) const;
+
+    friend class QgsRasterDrawerPartReader;
 };
 
 #endif // QGSRASTERDRAWER_H
@@ -22,9 +22,268 @@
 #include "qgsrasterprojector.h"
 
 #include <QCoreApplication>
+#include <QMap>
+#include <QMutex>
 #include <QProgressDialog>
+#include <QRegExp>
+#include <QRunnable>
 #include <QTextStream>
+#include <QThreadPool>
+#include <QTime>
 #include <QMessageBox>
+#include <QWaitCondition>
+
+///@cond PRIVATE
+
+//! Size of the internal tiles of cloud optimized GeoTIFF output, in pixels
+static const int INTERNAL_TILE_SIZE = 512;
+//! Number of parts every reading thread may read ahead of the part being written
+static const int PARTS_AHEAD_PER_THREAD = 2;
+
+struct QgsRasterFileWriterPart
+{
+  QgsRectangle extent;
+  int nCols;
+  int nRows;
+  int topLeftCol;
+  int topLeftRow;
+};
+
+//! Reads the blocks of all bands of a part, converted to a data type unless it is unknown
+static QList<QgsRasterBlock*> readPartBlocks( QgsRasterInterface* input, const QgsRasterFileWriterPart& part, int bandCount, QGis::DataType dataType )
+{
+  QList<QgsRasterBlock*> blocks;
+  for ( int i = 1; i <= bandCount; ++i )
+  {
+    QgsRasterBlock* block = input->block2( i, part.extent, part.nCols, part.nRows );
+    if ( block && dataType != QGis::UnknownDataType && block->dataType() != dataType )
+    {
+      // TODO: this conversion should go to QgsRasterDataProvider::write with additional input data type param
+      block->convert( dataType );
+    }
+    blocks << block;
+  }
+  return blocks;
+}
+
+/** Blocks of the parts read by the threads, taken by the writing thread in the order of the parts.
+ * The threads read a limited number of parts ahead of the part being written, so that the memory
+ * used stays bounded when the output is written slower than the input is read.
+ */
+class QgsRasterFileWriterQueue
+{
+  public:
+    QgsRasterFileWriterQueue( int partCount, int maxPartsAhead )
+        : mPartCount( partCount )
+        , mMaxPartsAhead( maxPartsAhead )
+        , mNextPart( 0 )
+        , mTakenParts( 0 )
+        , mCanceled( false )
+    {}
+
+    ~QgsRasterFileWriterQueue()
+    {
+      Q_FOREACH ( const QList<QgsRasterBlock*>& blocks, mBlocks )
+      {
+        qDeleteAll( blocks );
+      }
+    }
+
+    //! Returns the index of the next part to read, or -1 if all parts are read or if canceled
+    int takePart()
+    {
+      QMutexLocker locker( &mMutex );
+      while ( !mCanceled && mNextPart < mPartCount && mNextPart >= mTakenParts + mMaxPartsAhead )
+        mPartTaken.wait( &mMutex );
+
+      if ( mCanceled || mNextPart >= mPartCount )
+        return -1;
+
+      return mNextPart++;
+    }
+
+    void putBlocks( int part, const QList<QgsRasterBlock*>& blocks )
+    {
+      QMutexLocker locker( &mMutex );
+      if ( mCanceled )
+      {
+        qDeleteAll( blocks );
+        return;
+      }
+      mBlocks.insert( part, blocks );
+      mPartRead.wakeAll();
+    }
+
+    //! Takes the blocks of a part, returns false if the part has not been read within the timeout
+    bool takeBlocks( int part, QList<QgsRasterBlock*>& blocks, unsigned long timeout )
+    {
+      QMutexLocker locker( &mMutex );
+      if ( !mBlocks.contains( part ) )
+        mPartRead.wait( &mMutex, timeout );
+
+      if ( !mBlocks.contains( part ) )
+        return false;
+
+      blocks = mBlocks.take( part );
+      mTakenParts = part + 1;
+      mPartTaken.wakeAll();
+      return true;
+    }
+
+    void cancel()
+    {
+      QMutexLocker locker( &mMutex );
+      mCanceled = true;
+      mPartTaken.wakeAll();
+    }
+
+  private:
+    QMutex mMutex;
+    QWaitCondition mPartRead;
+    QWaitCondition mPartTaken;
+    QMap<int, QList<QgsRasterBlock*> > mBlocks;
+    int mPartCount;
+    int mMaxPartsAhead;
+    int mNextPart;
+    int mTakenParts;
+    bool mCanceled;
+};
+
+//! Reads parts with its own copy of the pipe until all parts are read
+class QgsRasterFileWriterPartReader : public QRunnable
+{
+  public:
+    QgsRasterFileWriterPartReader( QgsRasterFileWriterQueue* queue, const QVector<QgsRasterFileWriterPart>* parts,
+                                   const QgsRasterPipe* pipe, int bandCount, QGis::DataType dataType )
+        : mQueue( queue )
+        , mParts( parts )
+        , mPipe( pipe )
+        , mBandCount( bandCount )
+        , mDataType( dataType )
+    {}
+
+    void run() override
+    {
+      int index;
+      while (( index = mQueue->takePart() ) >= 0 )
+      {
+        mQueue->putBlocks( index, readPartBlocks( mPipe->last(), mParts->at( index ), mBandCount, mDataType ) );
+      }
+    }
+
+  private:
+    QgsRasterFileWriterQueue* mQueue;
+    const QVector<QgsRasterFileWriterPart>* mParts;
+    const QgsRasterPipe* mPipe;
+    int mBandCount;
+    QGis::DataType mDataType;
+};
+
+/** Reads the parts of the output in their order, either in the calling thread or in
+ * parallel by threads working with copies of the pipe, the interfaces keep state while
+ * processing a block.
+ */
+class QgsRasterFileWriterPartSource
+{
+  public:
+    QgsRasterFileWriterPartSource( const QgsRasterPipe* pipe, int bandCount, QGis::DataType dataType, int threadCount )
+        : mPipe( pipe )
+        , mBandCount( bandCount )
+        , mDataType( dataType )
+        , mThreadCount( threadCount )
+        , mQueue( nullptr )
+        , mCurrentPart( 0 )
+    {}
+
+    ~QgsRasterFileWriterPartSource()
+    {
+      if ( mQueue )
+      {
+        mQueue->cancel();
+        mThreadPool.waitForDone();
+        delete mQueue;
+      }
+      qDeleteAll( mPipeCopies );
+    }
+
+    //! Splits the output into parts with the iterator and starts reading them
+    void start( QgsRasterIterator* iter, int nCols, int nRows, const QgsRectangle& outputExtent )
+    {
+      int bandNumber = 1;
+      QgsRasterFileWriterPart part;
+      iter->startRasterRead( bandNumber, nCols, nRows, outputExtent );
+      while ( iter->nextRasterPart( bandNumber, part.nCols, part.nRows, part.extent, part.topLeftCol, part.topLeftRow ) )
+      {
+        mParts << part;
+      }
+      iter->stopRasterRead( bandNumber );
+
+      int threadCount = qMin( mThreadCount, mParts.size() );
+      if ( threadCount < 2 )
+        return;
+
+      mQueue = new QgsRasterFileWriterQueue( mParts.size(), PARTS_AHEAD_PER_THREAD * threadCount );
+      mThreadPool.setMaxThreadCount( threadCount );
+      for ( int i = 0; i < threadCount; ++i )
+      {
+        QgsRasterPipe* pipe = new QgsRasterPipe( *mPipe );
+        mPipeCopies << pipe;
+        mThreadPool.start( new QgsRasterFileWriterPartReader( mQueue, &mParts, pipe, mBandCount, mDataType ) );
+      }
+    }
+
+    int partCount() const { return mParts.size(); }
+
+    /** Returns the next part and the blocks of its bands, owned by the caller. Returns false
+     * if all parts have been returned. Events are processed while waiting for the threads if requested.
+     */
+    bool next( QgsRasterFileWriterPart& part, QList<QgsRasterBlock*>& blocks, bool processEvents )
+    {
+      if ( mCurrentPart >= mParts.size() )
+        return false;
+
+      part = mParts.at( mCurrentPart );
+      if ( mQueue )
+      {
+        while ( !mQueue->takeBlocks( mCurrentPart, blocks, 100 ) )
+        {
+          if ( processEvents )
+            QCoreApplication::processEvents( QEventLoop::AllEvents, 100 );
+        }
+      }
+      else
+      {
+        blocks = readPartBlocks( mPipe->last(), part, mBandCount, mDataType );
+      }
+      ++mCurrentPart;
+      return true;
+    }
+
+  private:
+    const QgsRasterPipe* mPipe;
+    int mBandCount;
+    QGis::DataType mDataType;
+    int mThreadCount;
+    QVector<QgsRasterFileWriterPart> mParts;
+    QgsRasterFileWriterQueue* mQueue;
+    QThreadPool mThreadPool;
+    QList<QgsRasterPipe*> mPipeCopies;
+    int mCurrentPart;
+};
+
+//! Returns the progress label of a part with the rate at which data has been written so far
+static QString partProgressLabel( int part, int partCount, qint64 bytesWritten, int elapsedMsecs )
+{
+  QString label = QObject::tr( "Reading raster part %1 of %2" ).arg( part ).arg( partCount );
+  if ( bytesWritten > 0 && elapsedMsecs > 0 )
+  {
+    double rate = bytesWritten / ( 1024.0 * 1024.0 ) / ( elapsedMsecs / 1000.0 );
+    label += '\n' + QObject::tr( "Writing %1 MB/s" ).arg( rate, 0, 'f', 1 );
+  }
+  return label;
+}
+
+///@endcond
 
 QgsRasterFileWriter::QgsRasterFileWriter( const QString& outputUrl )
     : mMode( Raw )
@@ -36,6 +295,8 @@ QgsRasterFileWriter::QgsRasterFileWriter( const QString& outputUrl )
     , mMaxTileHeight( 500 )
     , mBuildPyramidsFlag( QgsRaster::PyramidsFlagNo )
     , mPyramidsFormat( QgsRaster::PyramidsGTiff )
+    , mMaxThreadCount( 1 )
+    , mCloudOptimized( false )
     , mProgressDialog( nullptr )
     , mPipe( nullptr )
     , mInput( nullptr )
@@ -52,6 +313,8 @@ QgsRasterFileWriter::QgsRasterFileWriter()
     , mMaxTileHeight( 500 )
     , mBuildPyramidsFlag( QgsRaster::PyramidsFlagNo )
     , mPyramidsFormat( QgsRaster::PyramidsGTiff )
+    , mMaxThreadCount( 1 )
+    , mCloudOptimized( false )
     , mProgressDialog( nullptr )
     , mPipe( nullptr )
     , mInput( nullptr )
@@ -154,8 +417,7 @@ QgsRasterFileWriter::WriterError QgsRasterFileWriter::writeDataRaster( const Qgs
     return SourceProviderError;
   }
 
-  iter->setMaximumTileWidth( mMaxTileWidth );
-  iter->setMaximumTileHeight( mMaxTileHeight );
+  setPartSize( iter );
 
   int nBands = iface->bandCount();
   if ( nBands < 1 )
@@ -306,6 +568,13 @@ QgsRasterFileWriter::WriterError QgsRasterFileWriter::writeDataRaster( const Qgs
   if ( destProvider )
     delete destProvider;
 
+  // the pyramids of a single file are built once it is closed, so that they are built from all the data written
+  if ( error == NoError && !mTiledMode && !( progressDialog && progressDialog->wasCanceled() )
+       && ( mBuildPyramidsFlag == QgsRaster::PyramidsFlagYes || writesInternalTiles() ) )
+  {
+    buildPyramids( mOutputUrl );
+  }
+
   return error;
 }
 
@@ -321,12 +590,9 @@ QgsRasterFileWriter::WriterError QgsRasterFileWriter::writeDataRaster(
   QgsRasterDataProvider* destProvider,
   QProgressDialog* progressDialog )
 {
-  Q_UNUSED( pipe );
-  Q_UNUSED( destHasNoDataValueList );
   QgsDebugMsgLevel( "Entered", 4 );
 
   const QgsRasterInterface* iface = iter->input();
-  const QgsRasterDataProvider *srcProvider = dynamic_cast<const QgsRasterDataProvider*>( iface->srcInput() );
   int nBands = iface->bandCount();
   QgsDebugMsgLevel( QString( "nBands = %1" ).arg( nBands ), 4 );
 
@@ -336,92 +602,53 @@ QgsRasterFileWriter::WriterError QgsRasterFileWriter::writeDataRaster(
   int iterCols = 0;
   int iterRows = 0;
 
-  QList<QgsRasterBlock*> blockList;
-  blockList.reserve( nBands );
   for ( int i = 1; i <= nBands; ++i )
   {
-    iter->startRasterRead( i, nCols, nRows, outputExtent );
-    blockList.push_back( nullptr );
     if ( destProvider && destHasNoDataValueList.value( i - 1 ) ) // no tiles
     {
       destProvider->setNoDataValue( i, destNoDataValueList.value( i - 1 ) );
     }
   }
 
-  int nParts = 0;
+  // It may happen that internal data type (dataType) is wider than destDataType,
+  // the blocks are converted by the threads reading them
+  QgsRasterFileWriterPartSource partSource( pipe, nBands, destDataType, mMaxThreadCount );
+  partSource.start( iter, nCols, nRows, outputExtent );
+
+  int nParts = partSource.partCount();
   int fileIndex = 0;
   if ( progressDialog )
   {
-    int nPartsX = nCols / iter->maximumTileWidth() + 1;
-    int nPartsY = nRows / iter->maximumTileHeight() + 1;
-    nParts = nPartsX * nPartsY;
     progressDialog->setMaximum( nParts );
     progressDialog->show();
     progressDialog->setLabelText( QObject::tr( "Reading raster part %1 of %2" ).arg( fileIndex + 1 ).arg( nParts ) );
   }
 
-  // hmm why is there a for(;;) here ..
-  // not good coding practice IMHO, it might be better to use [ for() and break ] or  [ while (test) ]
-  Q_FOREVER
-  {
-    for ( int i = 1; i <= nBands; ++i )
-    {
-      if ( !iter->readNextRasterPart( i, iterCols, iterRows, &( blockList[i - 1] ), iterLeft, iterTop ) )
-      {
-        // No more parts, create VRT and return
-        if ( mTiledMode )
-        {
-          QString vrtFilePath( mOutputUrl + '/' + vrtFileName() );
-          writeVRT( vrtFilePath );
-          if ( mBuildPyramidsFlag == QgsRaster::PyramidsFlagYes )
-          {
-            buildPyramids( vrtFilePath );
-          }
-        }
-        else
-        {
-          if ( mBuildPyramidsFlag == QgsRaster::PyramidsFlagYes )
-          {
-            buildPyramids( mOutputUrl );
-          }
-        }
+  QTime writeTime;
+  writeTime.start();
+  qint64 bytesWritten = 0;
 
-        QgsDebugMsgLevel( "Done", 4 );
-        return NoError; //reached last tile, bail out
-      }
-      // TODO: verify if NoDataConflict happened, to do that we need the whole pipe or nuller interface
-    }
+  QgsRasterFileWriterPart part;
+  QList<QgsRasterBlock*> destBlockList;
+  while ( partSource.next( part, destBlockList, progressDialog != nullptr ) )
+  {
+    iterCols = part.nCols;
+    iterRows = part.nRows;
+    iterLeft = part.topLeftCol;
+    iterTop = part.topLeftRow;
+    // TODO: verify if NoDataConflict happened, to do that we need the whole pipe or nuller interface
 
     if ( progressDialog && fileIndex < ( nParts - 1 ) )
     {
       progressDialog->setValue( fileIndex + 1 );
-      progressDialog->setLabelText( QObject::tr( "Reading raster part %1 of %2" ).arg( fileIndex + 2 ).arg( nParts ) );
+      progressDialog->setLabelText( partProgressLabel( fileIndex + 2, nParts, bytesWritten, writeTime.elapsed() ) );
       QCoreApplication::processEvents( QEventLoop::AllEvents, 1000 );
       if ( progressDialog->wasCanceled() )
       {
-        for ( int i = 0; i < nBands; ++i )
-        {
-          delete blockList[i];
-        }
-        break;
-      }
-    }
-
-    // It may happen that internal data type (dataType) is wider than destDataType
-    QList<QgsRasterBlock*> destBlockList;
-    for ( int i = 1; i <= nBands; ++i )
-    {
-      if ( srcProvider && srcProvider->dataType( i ) == destDataType )
-      {
-        destBlockList.push_back( blockList[i-1] );
-      }
-      else
-      {
-        // TODO: this conversion should go to QgsRasterDataProvider::write with additional input data type param
-        blockList[i-1]->convert( destDataType );
-        destBlockList.push_back( blockList[i-1] );
+        qDeleteAll( destBlockList );
+        QgsDebugMsgLevel( "Canceled", 4 );
+        return NoError;
       }
-      blockList[i-1] = nullptr;
     }
 
     if ( mTiledMode ) //write to file
@@ -441,7 +668,7 @@ QgsRasterFileWriter::WriterError QgsRasterFileWriter::writeDataRaster(
             partDestProvider->setNoDataValue( i, destNoDataValueList.value( i - 1 ) );
           }
           partDestProvider->write( destBlockList[i - 1]->bits( 0 ), i, iterCols, iterRows, 0, 0 );
-          delete destBlockList[i - 1];
+          bytesWritten += static_cast< qint64 >( destBlockList[i - 1]->dataTypeSize() ) * iterCols * iterRows;
           addToVRT( partFileName( fileIndex ), i, iterCols, iterRows, iterLeft, iterTop );
         }
         delete partDestProvider;
@@ -453,12 +680,27 @@ QgsRasterFileWriter::WriterError QgsRasterFileWriter::writeDataRaster(
       for ( int i = 1; i <= nBands; ++i )
       {
         destProvider->write( destBlockList[i - 1]->bits( 0 ), i, iterCols, iterRows, iterLeft, iterTop );
-        delete destBlockList[i - 1];
+        bytesWritten += static_cast< qint64 >( destBlockList[i - 1]->dataTypeSize() ) * iterCols * iterRows;
       }
     }
+    qDeleteAll( destBlockList );
+    destBlockList.clear();
     ++fileIndex;
   }
 
+  QgsDebugMsgLevel( QString( "%1 bytes written in %2 ms" ).arg( bytesWritten ).arg( writeTime.elapsed() ), 2 );
+
+  // No more parts, create VRT and return
+  if ( mTiledMode )
+  {
+    QString vrtFilePath( mOutputUrl + '/' + vrtFileName() );
+    writeVRT( vrtFilePath );
+    if ( mBuildPyramidsFlag == QgsRaster::PyramidsFlagYes )
+    {
+      buildPyramids( vrtFilePath );
+    }
+  }
+
   QgsDebugMsgLevel( "Done", 4 );
   return NoError;
 }
@@ -482,13 +724,13 @@ QgsRasterFileWriter::WriterError QgsRasterFileWriter::writeImageRaster( QgsRaste
     return SourceProviderError;
   }
 
-  iter->setMaximumTileWidth( mMaxTileWidth );
-  iter->setMaximumTileHeight( mMaxTileHeight );
+  setPartSize( iter );
 
-  void* redData = qgsMalloc( mMaxTileWidth * mMaxTileHeight );
-  void* greenData = qgsMalloc( mMaxTileWidth * mMaxTileHeight );
-  void* blueData = qgsMalloc( mMaxTileWidth * mMaxTileHeight );
-  void* alphaData = qgsMalloc( mMaxTileWidth * mMaxTileHeight );
+  qgssize maxPartPixels = static_cast< qgssize >( iter->maximumTileWidth() ) * iter->maximumTileHeight();
+  void* redData = qgsMalloc( maxPartPixels );
+  void* greenData = qgsMalloc( maxPartPixels );
+  void* blueData = qgsMalloc( maxPartPixels );
+  void* alphaData = qgsMalloc( maxPartPixels );
   QgsRectangle mapRect;
   int iterLeft = 0, iterTop = 0, iterCols = 0, iterRows = 0;
   int fileIndex = 0;
@@ -501,31 +743,40 @@ QgsRasterFileWriter::WriterError QgsRasterFileWriter::writeImageRaster( QgsRaste
 
   destProvider = initOutput( nCols, nRows, crs, geoTransform, 4, QGis::Byte );
 
-  iter->startRasterRead( 1, nCols, nRows, outputExtent );
+  // the parts are rendered by the threads, colors are written as they are
+  QgsRasterFileWriterPartSource partSource( mPipe, 1, QGis::UnknownDataType, mMaxThreadCount );
+  partSource.start( iter, nCols, nRows, outputExtent );
 
-  int nParts = 0;
+  int nParts = partSource.partCount();
   if ( progressDialog )
   {
-    int nPartsX = nCols / iter->maximumTileWidth() + 1;
-    int nPartsY = nRows / iter->maximumTileHeight() + 1;
-    nParts = nPartsX * nPartsY;
     progressDialog->setMaximum( nParts );
     progressDialog->show();
     progressDialog->setLabelText( QObject::tr( "Reading raster part %1 of %2" ).arg( fileIndex + 1 ).arg( nParts ) );
   }
 
-  QgsRasterBlock *inputBlock = nullptr;
-  while ( iter->readNextRasterPart( 1, iterCols, iterRows, &inputBlock, iterLeft, iterTop ) )
+  QTime writeTime;
+  writeTime.start();
+  qint64 bytesWritten = 0;
+
+  QgsRasterFileWriterPart part;
+  QList<QgsRasterBlock*> inputBlocks;
+  while ( partSource.next( part, inputBlocks, progressDialog != nullptr ) )
   {
+    QgsRasterBlock *inputBlock = inputBlocks.value( 0 );
     if ( !inputBlock )
     {
       continue;
     }
+    iterCols = part.nCols;
+    iterRows = part.nRows;
+    iterLeft = part.topLeftCol;
+    iterTop = part.topLeftRow;
 
     if ( progressDialog && fileIndex < ( nParts - 1 ) )
     {
       progressDialog->setValue( fileIndex + 1 );
-      progressDialog->setLabelText( QObject::tr( "Reading raster part %1 of %2" ).arg( fileIndex + 2 ).arg( nParts ) );
+      progressDialog->setLabelText( partProgressLabel( fileIndex + 2, nParts, bytesWritten, writeTime.elapsed() ) );
       QCoreApplication::processEvents( QEventLoop::AllEvents, 1000 );
       if ( progressDialog->wasCanceled() )
       {
@@ -595,10 +846,13 @@ QgsRasterFileWriter::WriterError QgsRasterFileWriter::writeImageRaster( QgsRaste
       destProvider->write( blueData, 3, iterCols, iterRows, iterLeft, iterTop );
       destProvider->write( alphaData, 4, iterCols, iterRows, iterLeft, iterTop );
     }
+    bytesWritten += 4 * static_cast< qint64 >( nPixels );
 
     ++fileIndex;
   }
 
+  QgsDebugMsgLevel( QString( "%1 bytes written in %2 ms" ).arg( bytesWritten ).arg( writeTime.elapsed() ), 2 );
+
   if ( destProvider )
     delete destProvider;
 
@@ -623,7 +877,7 @@ QgsRasterFileWriter::WriterError QgsRasterFileWriter::writeImageRaster( QgsRaste
   }
   else
   {
-    if ( mBuildPyramidsFlag == QgsRaster::PyramidsFlagYes )
+    if ( mBuildPyramidsFlag == QgsRaster::PyramidsFlagYes || writesInternalTiles() )
     {
       buildPyramids( mOutputUrl );
     }
@@ -724,18 +978,35 @@ void QgsRasterFileWriter::buildPyramids( const QString& filename )
   // TODO progress report
   // TODO test mTiledMode - not tested b/c segfault at line # 289
   // connect( provider, SIGNAL( progressUpdate( int ) ), mPyramidProgress, SLOT( setValue( int ) ) );
+  QList< int > myPyramidLevels = mPyramidsList;
+  QgsRaster::RasterPyramidsFormat myPyramidsFormat = mPyramidsFormat;
+  if ( writesInternalTiles() )
+  {
+    // internal overviews down to the size of a tile
+    myPyramidsFormat = QgsRaster::PyramidsInternal;
+    if ( myPyramidLevels.isEmpty() )
+    {
+      int mySize = qMax( destProvider->xSize(), destProvider->ySize() );
+      for ( int myLevel = 2; mySize > INTERNAL_TILE_SIZE; myLevel *= 2 )
+      {
+        myPyramidLevels << myLevel;
+        mySize /= 2;
+      }
+    }
+  }
+
   QList< QgsRasterPyramid> myPyramidList;
-  if ( ! mPyramidsList.isEmpty() )
-    myPyramidList = destProvider->buildPyramidList( mPyramidsList );
+  if ( ! myPyramidLevels.isEmpty() )
+    myPyramidList = destProvider->buildPyramidList( myPyramidLevels );
   for ( int myCounterInt = 0; myCounterInt < myPyramidList.count(); myCounterInt++ )
   {
     myPyramidList[myCounterInt].build = true;
   }
 
-  QgsDebugMsgLevel( QString( "building pyramids : %1 pyramids, %2 resampling, %3 format, %4 options" ).arg( myPyramidList.count() ).arg( mPyramidsResampling ).arg( mPyramidsFormat ).arg( mPyramidsConfigOptions.count() ), 4 );
+  QgsDebugMsgLevel( QString( "building pyramids : %1 pyramids, %2 resampling, %3 format, %4 options" ).arg( myPyramidList.count() ).arg( mPyramidsResampling ).arg( myPyramidsFormat ).arg( mPyramidsConfigOptions.count() ), 4 );
   // QApplication::setOverrideCursor( Qt::WaitCursor );
   QString res = destProvider->buildPyramids( myPyramidList, mPyramidsResampling,
-                mPyramidsFormat, mPyramidsConfigOptions );
+                myPyramidsFormat, mPyramidsConfigOptions );
   // QApplication::restoreOverrideCursor();
 
   // TODO put this in provider or elsewhere
@@ -934,7 +1205,23 @@ QgsRasterDataProvider* QgsRasterFileWriter::initOutput( int nCols, int nRows, co
       mCreateOptions << "COPY_SRC_OVERVIEWS=YES";
 #endif
 
-    QgsRasterDataProvider* destProvider = QgsRasterDataProvider::create( mOutputProviderKey, mOutputUrl, mOutputFormat, nBands, type, nCols, nRows, geoTransform, crs, mCreateOptions );
+    QStringList createOptions = mCreateOptions;
+    if ( writesInternalTiles() )
+    {
+      // options set by the user take precedence
+      QStringList tileOptions;
+      tileOptions << "TILED=YES"
+      << QString( "BLOCKXSIZE=%1" ).arg( INTERNAL_TILE_SIZE )
+      << QString( "BLOCKYSIZE=%1" ).arg( INTERNAL_TILE_SIZE );
+      Q_FOREACH ( const QString& option, tileOptions )
+      {
+        QString key = option.section( '=', 0, 0 );
+        if ( createOptions.filter( QRegExp( '^' + key + '=', Qt::CaseInsensitive ) ).isEmpty() )
+          createOptions << option;
+      }
+    }
+
+    QgsRasterDataProvider* destProvider = QgsRasterDataProvider::create( mOutputProviderKey, mOutputUrl, mOutputFormat, nBands, type, nCols, nRows, geoTransform, crs, createOptions );
 
     if ( !destProvider )
     {
@@ -963,6 +1250,26 @@ void QgsRasterFileWriter::globalOutputParameters( const QgsRectangle& extent, in
   geoTransform[5] = -( extent.height() / nRows );
 }
 
+bool QgsRasterFileWriter::writesInternalTiles() const
+{
+  return mCloudOptimized && !mTiledMode && mOutputProviderKey == "gdal"
+         && mOutputFormat.compare( "GTiff", Qt::CaseInsensitive ) == 0;
+}
+
+void QgsRasterFileWriter::setPartSize( QgsRasterIterator* iter ) const
+{
+  int width = static_cast< int >( mMaxTileWidth );
+  int height = static_cast< int >( mMaxTileHeight );
+  if ( writesInternalTiles() )
+  {
+    // parts made of whole internal tiles, so that GDAL writes every tile once
+    width = qMax( 1, ( width + INTERNAL_TILE_SIZE - 1 ) / INTERNAL_TILE_SIZE ) * INTERNAL_TILE_SIZE;
+    height = qMax( 1, ( height + INTERNAL_TILE_SIZE - 1 ) / INTERNAL_TILE_SIZE ) * INTERNAL_TILE_SIZE;
+  }
+  iter->setMaximumTileWidth( width );
+  iter->setMaximumTileHeight( height );
+}
+
 QString QgsRasterFileWriter::partFileName( int fileIndex )
 {
   // .tif for now
@@ -93,6 +93,36 @@ class CORE_EXPORT QgsRasterFileWriter
     void setPyramidsConfigOptions( const QStringList& list ) { mPyramidsConfigOptions = list; }
     QStringList pyramidsConfigOptions() const { return mPyramidsConfigOptions; }
 
+    /** Sets the maximum number of threads which read the raster parts through copies of the pipe.
+     * The parts are written by the calling thread in their order. With 1 thread (the default)
+     * the parts are read by the calling thread.
+     * @see maxThreadCount()
+     * @note added in QGIS 2.18
+     */
+    void setMaxThreadCount( int count ) { mMaxThreadCount = qMax( 1, count ); }
+
+    /** Returns the maximum number of threads which read the raster parts.
+     * @see setMaxThreadCount()
+     * @note added in QGIS 2.18
+     */
+    int maxThreadCount() const { return mMaxThreadCount; }
+
+    /** Sets whether a single GeoTIFF file is written with internal tiles and internal overviews,
+     * the layout of a cloud optimized GeoTIFF. The parts are aligned to the internal tiles so that
+     * every tile is written once, and the overviews in pyramidsList() (or halving the size down
+     * to a tile if it is empty) are built into the file after the data is written, even if
+     * buildPyramidsFlag() is not set.
+     * @see cloudOptimized()
+     * @note added in QGIS 2.18
+     */
+    void setCloudOptimized( bool enabled ) { mCloudOptimized = enabled; }
+
+    /** Returns whether a single GeoTIFF file is written with internal tiles and internal overviews.
+     * @see setCloudOptimized()
+     * @note added in QGIS 2.18
+     */
+    bool cloudOptimized() const { return mCloudOptimized; }
+
   private:
     QgsRasterFileWriter(); //forbidden
     WriterError writeDataRaster( const QgsRasterPipe* pipe, QgsRasterIterator* iter, int nCols, int nRows, const QgsRectangle& outputExtent,
@@ -156,6 +186,12 @@ class CORE_EXPORT QgsRasterFileWriter
     QString partFileName( int fileIndex );
     QString vrtFileName();
 
+    /** Returns true if the output is a single GeoTIFF file written with internal tiles */
+    bool writesInternalTiles() const;
+
+    /** Sets the size of the parts the raster is read and written by */
+    void setPartSize( QgsRasterIterator* iter ) const;
+
     Mode mMode;
     QString mOutputUrl;
     QString mOutputProviderKey;
@@ -174,6 +210,9 @@ class CORE_EXPORT QgsRasterFileWriter
     QgsRaster::RasterPyramidsFormat mPyramidsFormat;
     QStringList mPyramidsConfigOptions;
 
+    int mMaxThreadCount;
+    bool mCloudOptimized;
+
     QDomDocument mVRTDocument;
     QList<QDomElement> mVRTBands;
 
@@ -19,7 +19,9 @@
 #include <typeinfo>
 
 #include <QByteArray>
+#include <QThread>
 #include <QTime>
+#include <QtConcurrentMap>
 
 #include <qmath.h>
 
@@ -29,6 +31,233 @@
 #include "qgsrasterinterface.h"
 #include "qgsrectangle.h"
 
+///@cond PRIVATE
+
+//! Minimum number of pixels for which statistics and histograms are collected on several threads
+static const qgssize PARALLEL_STATISTICS_MIN_PIXELS = 1000000;
+
+//! Rows of blocks of a raster band read by one thread when collecting statistics or a histogram
+struct QgsRasterStatisticsPart
+{
+  //! Interface the blocks are read from, a clone of the interface if the part is read on another thread
+  QgsRasterInterface* source;
+  int bandNo;
+  //! Extent and size of the whole region of the statistics
+  QgsRectangle extent;
+  int width;
+  int height;
+  int xBlockSize;
+  int yBlockSize;
+  //! Block rows of the part
+  int firstYBlock;
+  int endYBlock;
+  //! Histogram bins
+  int binCount;
+  double binMinimum;
+  double binSize;
+  bool includeOutOfRange;
+
+  int xBlockCount() const { return ( width + xBlockSize - 1 ) / xBlockSize; }
+
+  QgsRasterBlock* readBlock( int xBlock, int yBlock ) const
+  {
+    double xRes = extent.width() / width;
+    double yRes = extent.height() / height;
+    int blockWidth = qMin( xBlockSize, width - xBlock * xBlockSize );
+    int blockHeight = qMin( yBlockSize, height - yBlock * yBlockSize );
+
+    double xmin = extent.xMinimum() + xBlock * xBlockSize * xRes;
+    double xmax = xmin + blockWidth * xRes;
+    double ymin = extent.yMaximum() - yBlock * yBlockSize * yRes;
+    double ymax = ymin - blockHeight * yRes;
+
+    return source->block( bandNo, QgsRectangle( xmin, ymin, xmax, ymax ), blockWidth, blockHeight );
+  }
+};
+
+//! Statistics of a part of a band, parts are merged with the pairwise algorithm by Chan et al.
+struct QgsRasterStatisticsAccumulator
+{
+  QgsRasterStatisticsAccumulator()
+      : count( 0 )
+      , sum( 0 )
+      , minimum( std::numeric_limits<double>::max() )
+      , maximum( -std::numeric_limits<double>::max() )
+      , mean( 0 )
+      , sumOfSquares( 0 )
+  {}
+
+  void add( double value )
+  {
+    sum += value;
+    count++;
+    minimum = qMin( minimum, value );
+    maximum = qMax( maximum, value );
+
+    // Single pass stdev
+    double delta = value - mean;
+    mean += delta / count;
+    sumOfSquares += delta * ( value - mean );
+  }
+
+  void merge( const QgsRasterStatisticsAccumulator& other )
+  {
+    if ( other.count == 0 )
+      return;
+
+    qgssize total = count + other.count;
+    double delta = other.mean - mean;
+    mean += delta * other.count / total;
+    sumOfSquares += other.sumOfSquares + delta * delta * ( static_cast< double >( count ) * other.count / total );
+    count = total;
+    sum += other.sum;
+    minimum = qMin( minimum, other.minimum );
+    maximum = qMax( maximum, other.maximum );
+  }
+
+  qgssize count;
+  double sum;
+  double minimum;
+  double maximum;
+  double mean;
+  double sumOfSquares;
+};
+
+//! Collects the statistics of a part
+struct QgsRasterStatisticsCollector
+{
+  typedef QgsRasterStatisticsAccumulator result_type;
+
+  QgsRasterStatisticsAccumulator operator()( const QgsRasterStatisticsPart& part ) const
+  {
+    QgsRasterStatisticsAccumulator statistics;
+    for ( int yBlock = part.firstYBlock; yBlock < part.endYBlock; yBlock++ )
+    {
+      for ( int xBlock = 0; xBlock < part.xBlockCount(); xBlock++ )
+      {
+        QgsRasterBlock* blk = part.readBlock( xBlock, yBlock );
+        qgssize count = static_cast< qgssize >( blk->width() ) * blk->height();
+        for ( qgssize i = 0; i < count; i++ )
+        {
+          if ( blk->isNoData( i ) ) continue; // NULL
+
+          statistics.add( blk->value( i ) );
+        }
+        delete blk;
+      }
+    }
+    return statistics;
+  }
+};
+
+//! Histogram counts of a part
+struct QgsRasterHistogramCounts
+{
+  QgsRasterHistogramCounts()
+      : nonNullCount( 0 )
+  {}
+
+  QgsRasterHistogram::HistogramVector counts;
+  int nonNullCount;
+};
+
+//! Collects the histogram counts of a part
+struct QgsRasterHistogramCollector
+{
+  typedef QgsRasterHistogramCounts result_type;
+
+  QgsRasterHistogramCounts operator()( const QgsRasterStatisticsPart& part ) const
+  {
+    QgsRasterHistogramCounts histogram;
+    histogram.counts.resize( part.binCount );
+    int myBinCount = part.binCount;
+    for ( int yBlock = part.firstYBlock; yBlock < part.endYBlock; yBlock++ )
+    {
+      for ( int xBlock = 0; xBlock < part.xBlockCount(); xBlock++ )
+      {
+        QgsRasterBlock* blk = part.readBlock( xBlock, yBlock );
+        qgssize count = static_cast< qgssize >( blk->width() ) * blk->height();
+
+        // Collect the histogram counts.
+        for ( qgssize i = 0; i < count; i++ )
+        {
+          if ( blk->isNoData( i ) )
+          {
+            continue; // NULL
+          }
+          double myValue = blk->value( i );
+
+          int myBinIndex = static_cast <int>( qFloor(( myValue - part.binMinimum ) / part.binSize ) );
+
+          if (( myBinIndex < 0 || myBinIndex > ( myBinCount - 1 ) ) && !part.includeOutOfRange )
+          {
+            continue;
+          }
+          if ( myBinIndex < 0 ) myBinIndex = 0;
+          if ( myBinIndex > ( myBinCount - 1 ) ) myBinIndex = myBinCount - 1;
+
+          histogram.counts[myBinIndex] += 1;
+          histogram.nonNullCount++;
+        }
+        delete blk;
+      }
+    }
+    return histogram;
+  }
+};
+
+/** Splits the blocks of a region of a band to parts read on several threads, each from its own
+ * clone of the interface. Small regions and interfaces with an input are read in a single part
+ * from the interface itself.
+ */
+static QList<QgsRasterStatisticsPart> statisticsParts( QgsRasterInterface* interface, const QgsRasterStatisticsPart& region )
+{
+  int yBlockCount = ( region.height + region.yBlockSize - 1 ) / region.yBlockSize;
+
+  int partCount = 1;
+  if ( !interface->input() && static_cast< qgssize >( region.width ) * region.height >= PARALLEL_STATISTICS_MIN_PIXELS )
+  {
+    partCount = qBound( 1, QThread::idealThreadCount(), yBlockCount );
+  }
+
+  QList<QgsRasterStatisticsPart> parts;
+  for ( int i = 0; i < partCount; i++ )
+  {
+    QgsRasterStatisticsPart part = region;
+    part.firstYBlock = yBlockCount * i / partCount;
+    part.endYBlock = yBlockCount * ( i + 1 ) / partCount;
+    part.source = partCount > 1 ? interface->clone() : interface;
+    if ( !part.source )
+    {
+      // cannot be read in parallel, read it at once from the interface
+      Q_FOREACH ( const QgsRasterStatisticsPart& clonePart, parts )
+      {
+        delete clonePart.source;
+      }
+      parts.clear();
+      part = region;
+      part.firstYBlock = 0;
+      part.endYBlock = yBlockCount;
+      part.source = interface;
+      parts << part;
+      return parts;
+    }
+    parts << part;
+  }
+  return parts;
+}
+
+static void deleteStatisticsParts( QgsRasterInterface* interface, const QList<QgsRasterStatisticsPart>& parts )
+{
+  Q_FOREACH ( const QgsRasterStatisticsPart& part, parts )
+  {
+    if ( part.source != interface )
+      delete part.source;
+  }
+}
+
+///@endcond
+
 QgsRasterInterface::QgsRasterInterface( QgsRasterInterface * input )
     : mInput( input )
     , mOn( true )
@@ -139,12 +368,6 @@ QgsRasterBandStats QgsRasterInterface::bandStatistics( int theBandNo,
     }
   }
 
-  QgsRectangle myExtent = myRasterBandStats.extent;
-  int myWidth = myRasterBandStats.width;
-  int myHeight = myRasterBandStats.height;
-
-  //int myDataType = dataType( theBandNo );
-
   int myXBlockSize = xBlockSize();
   int myYBlockSize = yBlockSize();
   if ( myXBlockSize == 0 ) // should not happen, but happens
@@ -156,81 +379,53 @@ QgsRasterBandStats QgsRasterInterface::bandStatistics( int theBandNo,
     myYBlockSize = 500;
   }
 
-  int myNXBlocks = ( myWidth + myXBlockSize - 1 ) / myXBlockSize;
-  int myNYBlocks = ( myHeight + myYBlockSize - 1 ) / myYBlockSize;
+  QgsRasterStatisticsPart region;
+  region.source = this;
+  region.bandNo = theBandNo;
+  region.extent = myRasterBandStats.extent;
+  region.width = myRasterBandStats.width;
+  region.height = myRasterBandStats.height;
+  region.xBlockSize = myXBlockSize;
+  region.yBlockSize = myYBlockSize;
+  region.binCount = 0;
+  region.binMinimum = 0;
+  region.binSize = 0;
+  region.includeOutOfRange = false;
 
-  double myXRes = myExtent.width() / myWidth;
-  double myYRes = myExtent.height() / myHeight;
   // TODO: progress signals
 
-  // used by single pass stdev
-  double myMean = 0;
-  double mySumOfSquares = 0;
-
-  bool myFirstIterationFlag = true;
-  for ( int myYBlock = 0; myYBlock < myNYBlocks; myYBlock++ )
+  // the blocks are read on several threads, each part from its own copy of the interface
+  QList<QgsRasterStatisticsPart> parts = statisticsParts( this, region );
+  QList<QgsRasterStatisticsAccumulator> partStatistics;
+  if ( parts.size() > 1 )
   {
-    for ( int myXBlock = 0; myXBlock < myNXBlocks; myXBlock++ )
-    {
-      QgsDebugMsgLevel( QString( "myYBlock = %1 myXBlock = %2" ).arg( myYBlock ).arg( myXBlock ), 4 );
-      int myBlockWidth = qMin( myXBlockSize, myWidth - myXBlock * myXBlockSize );
-      int myBlockHeight = qMin( myYBlockSize, myHeight - myYBlock * myYBlockSize );
-
-      double xmin = myExtent.xMinimum() + myXBlock * myXBlockSize * myXRes;
-      double xmax = xmin + myBlockWidth * myXRes;
-      double ymin = myExtent.yMaximum() - myYBlock * myYBlockSize * myYRes;
-      double ymax = ymin - myBlockHeight * myYRes;
-
-      QgsRectangle myPartExtent( xmin, ymin, xmax, ymax );
-
-      QgsRasterBlock* blk = block( theBandNo, myPartExtent, myBlockWidth, myBlockHeight );
-
-      // Collect the histogram counts.
-      for ( qgssize i = 0; i < ( static_cast< qgssize >( myBlockHeight ) ) * myBlockWidth; i++ )
-      {
-        if ( blk->isNoData( i ) ) continue; // NULL
-
-        double myValue = blk->value( i );
-
-        myRasterBandStats.sum += myValue;
-        myRasterBandStats.elementCount++;
-
-        if ( myFirstIterationFlag )
-        {
-          myFirstIterationFlag = false;
-          myRasterBandStats.minimumValue = myValue;
-          myRasterBandStats.maximumValue = myValue;
-        }
-        else
-        {
-          if ( myValue < myRasterBandStats.minimumValue )
-          {
-            myRasterBandStats.minimumValue = myValue;
-          }
-          if ( myValue > myRasterBandStats.maximumValue )
-          {
-            myRasterBandStats.maximumValue = myValue;
-          }
-        }
+    partStatistics = QtConcurrent::blockingMapped< QList<QgsRasterStatisticsAccumulator> >( parts, QgsRasterStatisticsCollector() );
+  }
+  else
+  {
+    partStatistics << QgsRasterStatisticsCollector()( parts.first() );
+  }
+  deleteStatisticsParts( this, parts );
 
-        // Single pass stdev
-        double myDelta = myValue - myMean;
-        myMean += myDelta / myRasterBandStats.elementCount;
-        mySumOfSquares += myDelta * ( myValue - myMean );
-      }
-      delete blk;
-    }
+  QgsRasterStatisticsAccumulator statistics;
+  Q_FOREACH ( const QgsRasterStatisticsAccumulator& part, partStatistics )
+  {
+    statistics.merge( part );
   }
 
+  myRasterBandStats.sum = statistics.sum;
+  myRasterBandStats.elementCount = statistics.count;
+  myRasterBandStats.minimumValue = statistics.minimum;
+  myRasterBandStats.maximumValue = statistics.maximum;
   myRasterBandStats.range = myRasterBandStats.maximumValue - myRasterBandStats.minimumValue;
   myRasterBandStats.mean = myRasterBandStats.sum / myRasterBandStats.elementCount;
 
-  myRasterBandStats.sumOfSquares = mySumOfSquares; // OK with single pass?
+  myRasterBandStats.sumOfSquares = statistics.sumOfSquares; // OK with single pass?
 
   // stdDev may differ  from GDAL stats, because GDAL is using naive single pass
   // algorithm which is more error prone (because of rounding errors)
   // Divide result by sample size - 1 and get square root to get stdev
-  myRasterBandStats.stdDev = sqrt( mySumOfSquares / ( myRasterBandStats.elementCount - 1 ) );
+  myRasterBandStats.stdDev = sqrt( statistics.sumOfSquares / ( myRasterBandStats.elementCount - 1 ) );
 
   QgsDebugMsgLevel( "************ STATS **************", 4 );
   QgsDebugMsgLevel( QString( "MIN %1" ).arg( myRasterBandStats.minimumValue ), 4 );
@@ -415,9 +610,6 @@ QgsRasterHistogram QgsRasterInterface::histogram( int theBandNo,
   }
 
   int myBinCount = myHistogram.binCount;
-  int myWidth = myHistogram.width;
-  int myHeight = myHistogram.height;
-  QgsRectangle myExtent = myHistogram.extent;
   myHistogram.histogramVector.resize( myBinCount );
 
   int myXBlockSize = xBlockSize();
@@ -431,12 +623,6 @@ QgsRasterHistogram QgsRasterInterface::histogram( int theBandNo,
     myYBlockSize = 500;
   }
 
-  int myNXBlocks = ( myWidth + myXBlockSize - 1 ) / myXBlockSize;
-  int myNYBlocks = ( myHeight + myYBlockSize - 1 ) / myYBlockSize;
-
-  double myXRes = myExtent.width() / myWidth;
-  double myYRes = myExtent.height() / myHeight;
-
   double myMinimum = myHistogram.minimum;
   double myMaximum = myHistogram.maximum;
 
@@ -450,46 +636,41 @@ QgsRasterHistogram QgsRasterInterface::histogram( int theBandNo,
 
   double myBinSize = ( myMaximum - myMinimum ) / myBinCount;
 
-  // TODO: progress signals
-  for ( int myYBlock = 0; myYBlock < myNYBlocks; myYBlock++ )
-  {
-    for ( int myXBlock = 0; myXBlock < myNXBlocks; myXBlock++ )
-    {
-      int myBlockWidth = qMin( myXBlockSize, myWidth - myXBlock * myXBlockSize );
-      int myBlockHeight = qMin( myYBlockSize, myHeight - myYBlock * myYBlockSize );
-
-      double xmin = myExtent.xMinimum() + myXBlock * myXBlockSize * myXRes;
-      double xmax = xmin + myBlockWidth * myXRes;
-      double ymin = myExtent.yMaximum() - myYBlock * myYBlockSize * myYRes;
-      double ymax = ymin - myBlockHeight * myYRes;
+  QgsRasterStatisticsPart region;
+  region.source = this;
+  region.bandNo = theBandNo;
+  region.extent = myHistogram.extent;
+  region.width = myHistogram.width;
+  region.height = myHistogram.height;
+  region.xBlockSize = myXBlockSize;
+  region.yBlockSize = myYBlockSize;
+  region.binCount = myBinCount;
+  region.binMinimum = myMinimum;
+  region.binSize = myBinSize;
+  region.includeOutOfRange = theIncludeOutOfRange;
 
-      QgsRectangle myPartExtent( xmin, ymin, xmax, ymax );
-
-      QgsRasterBlock* blk = block( theBandNo, myPartExtent, myBlockWidth, myBlockHeight );
-
-      // Collect the histogram counts.
-      for ( qgssize i = 0; i < ( static_cast< qgssize >( myBlockHeight ) ) * myBlockWidth; i++ )
-      {
-        if ( blk->isNoData( i ) )
-        {
-          continue; // NULL
-        }
-        double myValue = blk->value( i );
-
-        int myBinIndex = static_cast <int>( qFloor(( myValue - myMinimum ) /  myBinSize ) );
+  // TODO: progress signals
 
-        if (( myBinIndex < 0 || myBinIndex > ( myBinCount - 1 ) ) && !theIncludeOutOfRange )
-        {
-          continue;
-        }
-        if ( myBinIndex < 0 ) myBinIndex = 0;
-        if ( myBinIndex > ( myBinCount - 1 ) ) myBinIndex = myBinCount - 1;
+  // the blocks are read on several threads, each part from its own copy of the interface
+  QList<QgsRasterStatisticsPart> parts = statisticsParts( this, region );
+  QList<QgsRasterHistogramCounts> partHistograms;
+  if ( parts.size() > 1 )
+  {
+    partHistograms = QtConcurrent::blockingMapped< QList<QgsRasterHistogramCounts> >( parts, QgsRasterHistogramCollector() );
+  }
+  else
+  {
+    partHistograms << QgsRasterHistogramCollector()( parts.first() );
+  }
+  deleteStatisticsParts( this, parts );
 
-        myHistogram.histogramVector[myBinIndex] += 1;
-        myHistogram.nonNullCount++;
-      }
-      delete blk;
+  Q_FOREACH ( const QgsRasterHistogramCounts& part, partHistograms )
+  {
+    for ( int i = 0; i < myBinCount; i++ )
+    {
+      myHistogram.histogramVector[i] += part.counts.at( i );
     }
+    myHistogram.nonNullCount += part.nonNullCount;
   }
 
   myHistogram.valid = true;
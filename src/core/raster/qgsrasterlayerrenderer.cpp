@@ -227,6 +227,12 @@ bool QgsRasterLayerRenderer::render()
   // Drawer to pipe?
   QgsRasterIterator iterator( mPipe->last() );
   QgsRasterDrawer drawer( &iterator );
+  // process parts of local rasters on several threads. Remote providers are read by a single
+  // thread, they report partial data through the feedback and would send several requests at once
+  drawer.setParallelRenderingEnabled( mPipe->provider() && mPipe->provider()->name() == "gdal" );
+  // in the map canvas local rasters are drawn from an overview first and then refined part by part,
+  // remote providers draw their own previews when data arrive
+  drawer.setProgressiveRenderingEnabled( mPipe->provider() && mPipe->provider()->name() == "gdal" );
   drawer.draw( mPainter, mRasterViewPort, mMapToPixel, nullptr, mFeedback );
 
   QgsDebugMsgLevel( QString( "total raster draw time (ms):     %1" ).arg( time.elapsed(), 5 ), 4 );
@@ -0,0 +1,270 @@
+/***************************************************************************
+                         qgsrasterpyramidbuilder.cpp
+                         ---------------------------
+    begin                : October 2018
+    copyright            : (C) 2018 by NextGIS
+    email                : info at nextgis dot com
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "qgsrasterpyramidbuilder.h"
+#include "qgsfeedback.h"
+#include "qgslogger.h"
+#include "qgsproviderregistry.h"
+#include "qgsrasterdataprovider.h"
+#include "qgsrasterlayer.h"
+
+#include <QCoreApplication>
+#include <QRunnable>
+#include <QThread>
+
+///@cond PRIVATE
+
+/** Builds the pyramids of one layer with a data provider opened in the worker thread,
+ * GDAL dataset handles must not be shared between threads */
+class QgsRasterPyramidBuildRunnable : public QRunnable
+{
+  public:
+    QgsRasterPyramidBuildRunnable( QgsRasterPyramidBuilder* builder, int index, const QString& providerKey, const QString& dataSource,
+                                   const QList<QgsRasterPyramid>& pyramids, const QString& resamplingMethod,
+                                   QgsRaster::RasterPyramidsFormat format, const QStringList& configOptions, QgsFeedback* feedback )
+        : mBuilder( builder )
+        , mIndex( index )
+        , mProviderKey( providerKey )
+        , mDataSource( dataSource )
+        , mPyramids( pyramids )
+        , mResamplingMethod( resamplingMethod )
+        , mFormat( format )
+        , mConfigOptions( configOptions )
+        , mFeedback( feedback )
+    {}
+
+    void run() override
+    {
+      QString error;
+      if ( mFeedback->isCancelled() )
+      {
+        error = "ERROR_CANCELED";
+      }
+      else
+      {
+        QgsRasterDataProvider* provider = qobject_cast< QgsRasterDataProvider* >( QgsProviderRegistry::instance()->provider( mProviderKey, mDataSource ) );
+        if ( !provider || !provider->isValid() )
+        {
+          QgsDebugMsg( "Cannot open data source " + mDataSource );
+          error = "FAILED_NOT_SUPPORTED";
+        }
+        else
+        {
+          error = provider->buildPyramids( mPyramids, mResamplingMethod, mFormat, mConfigOptions, mFeedback );
+        }
+        delete provider;
+      }
+
+      // the builder is deleted only after all runnables have finished
+      QMetaObject::invokeMethod( mBuilder, "buildFinished", Qt::QueuedConnection, Q_ARG( int, mIndex ), Q_ARG( QString, error ) );
+    }
+
+  private:
+    QgsRasterPyramidBuilder* mBuilder;
+    int mIndex;
+    QString mProviderKey;
+    QString mDataSource;
+    QList<QgsRasterPyramid> mPyramids;
+    QString mResamplingMethod;
+    QgsRaster::RasterPyramidsFormat mFormat;
+    QStringList mConfigOptions;
+    QgsFeedback* mFeedback;
+};
+
+///@endcond
+
+QgsRasterPyramidBuilder::QgsRasterPyramidBuilder( QObject* parent )
+    : QObject( parent )
+    , mActive( false )
+    , mPendingCount( 0 )
+{
+  mThreadPool.setMaxThreadCount( qMax( 1, QThread::idealThreadCount() ) );
+}
+
+QgsRasterPyramidBuilder::~QgsRasterPyramidBuilder()
+{
+  cancel();
+  mThreadPool.waitForDone();
+
+  Q_FOREACH ( const Build& build, mBuilds )
+  {
+    delete build.feedback;
+  }
+}
+
+int QgsRasterPyramidBuilder::addLayer( QgsRasterLayer* layer, const QList<QgsRasterPyramid>& pyramids, const QString& resamplingMethod,
+                                       QgsRaster::RasterPyramidsFormat format, const QStringList& configOptions )
+{
+  if ( mActive || !layer || !layer->dataProvider() || !layer->dataProvider()->isValid() )
+    return -1;
+
+  QgsRasterDataProvider* provider = layer->dataProvider();
+
+  Build build;
+  build.layer = layer;
+  build.providerKey = layer->providerType();
+  build.dataSource = provider->dataSourceUri();
+  build.pyramids = pyramids;
+  if ( build.pyramids.isEmpty() )
+  {
+    build.pyramids = provider->buildPyramidList();
+    for ( int i = 0; i < build.pyramids.count(); ++i )
+    {
+      build.pyramids[i].build = true;
+    }
+  }
+  build.resamplingMethod = resamplingMethod;
+  build.format = format;
+  build.configOptions = configOptions;
+  build.feedback = new QgsFeedback();
+  build.finished = false;
+
+  // emitted from the worker thread, delivered queued
+  connect( build.feedback, SIGNAL( progressChanged( double ) ), this, SLOT( buildProgressChanged( double ) ) );
+
+  mBuilds << build;
+  return mBuilds.count() - 1;
+}
+
+QgsRasterLayer* QgsRasterPyramidBuilder::layer( int index ) const
+{
+  if ( index < 0 || index >= mBuilds.count() )
+    return nullptr;
+
+  return mBuilds.at( index ).layer.data();
+}
+
+void QgsRasterPyramidBuilder::setMaxConcurrentBuilds( int count )
+{
+  mThreadPool.setMaxThreadCount( qMax( 1, count ) );
+}
+
+int QgsRasterPyramidBuilder::maxConcurrentBuilds() const
+{
+  return mThreadPool.maxThreadCount();
+}
+
+void QgsRasterPyramidBuilder::start()
+{
+  if ( mActive )
+    return;
+
+  mPendingCount = 0;
+  for ( int i = 0; i < mBuilds.count(); ++i )
+  {
+    const Build& build = mBuilds.at( i );
+    if ( build.finished )
+      continue;
+
+    mThreadPool.start( new QgsRasterPyramidBuildRunnable( this, i, build.providerKey, build.dataSource, build.pyramids,
+                       build.resamplingMethod, build.format, build.configOptions, build.feedback ) );
+    ++mPendingCount;
+  }
+
+  if ( mPendingCount == 0 )
+  {
+    emit finished();
+    return;
+  }
+
+  mActive = true;
+}
+
+void QgsRasterPyramidBuilder::cancel()
+{
+  Q_FOREACH ( const Build& build, mBuilds )
+  {
+    if ( !build.finished )
+      build.feedback->cancel();
+  }
+}
+
+void QgsRasterPyramidBuilder::waitForFinished()
+{
+  mThreadPool.waitForDone();
+
+  // deliver the results queued by the worker threads
+  QCoreApplication::sendPostedEvents( this, QEvent::MetaCall );
+}
+
+double QgsRasterPyramidBuilder::progress( int index ) const
+{
+  if ( index < 0 || index >= mBuilds.count() )
+    return 0.0;
+
+  const Build& build = mBuilds.at( index );
+  return build.finished ? 100.0 : build.feedback->progress();
+}
+
+double QgsRasterPyramidBuilder::totalProgress() const
+{
+  if ( mBuilds.isEmpty() )
+    return 0.0;
+
+  double total = 0.0;
+  for ( int i = 0; i < mBuilds.count(); ++i )
+  {
+    total += progress( i );
+  }
+  return total / mBuilds.count();
+}
+
+QString QgsRasterPyramidBuilder::error( int index ) const
+{
+  if ( index < 0 || index >= mBuilds.count() )
+    return QString();
+
+  return mBuilds.at( index ).error;
+}
+
+void QgsRasterPyramidBuilder::buildProgressChanged( double progress )
+{
+  for ( int i = 0; i < mBuilds.count(); ++i )
+  {
+    if ( mBuilds.at( i ).feedback == sender() )
+    {
+      if ( !mBuilds.at( i ).finished )
+        emit progressChanged( i, progress );
+      return;
+    }
+  }
+}
+
+void QgsRasterPyramidBuilder::buildFinished( int index, const QString& error )
+{
+  Build& build = mBuilds[index];
+  build.finished = true;
+  build.error = error;
+
+  if ( error.isNull() && build.layer )
+  {
+    // the layer provider opened the dataset before the pyramids were built
+    build.layer->reload();
+    build.layer->triggerRepaint();
+  }
+
+  QgsDebugMsgLevel( QString( "Pyramids of %1 built: %2" ).arg( build.dataSource, error.isNull() ? "OK" : error ), 2 );
+
+  emit progressChanged( index, 100.0 );
+  emit layerFinished( index, error );
+
+  if ( --mPendingCount == 0 )
+  {
+    mActive = false;
+    emit finished();
+  }
+}
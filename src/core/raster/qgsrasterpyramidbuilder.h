@@ -0,0 +1,158 @@
+/***************************************************************************
+                         qgsrasterpyramidbuilder.h
+                         -------------------------
+    begin                : October 2018
+    copyright            : (C) 2018 by NextGIS
+    email                : info at nextgis dot com
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#ifndef QGSRASTERPYRAMIDBUILDER_H
+#define QGSRASTERPYRAMIDBUILDER_H
+
+#include <QList>
+#include <QObject>
+#include <QPointer>
+#include <QStringList>
+#include <QThreadPool>
+
+#include "qgsraster.h"
+#include "qgsrasterpyramid.h"
+
+class QgsFeedback;
+class QgsRasterLayer;
+
+/** \ingroup core
+ * \class QgsRasterPyramidBuilder
+ * \brief Builds the pyramids (overviews) of raster layers in background threads.
+ *
+ * Layers are added with addLayer() and the build is started with start(). Every layer is
+ * built by its own data provider instance, opened on the same data source in a worker
+ * thread, so the layer itself can still be rendered while its pyramids are being built.
+ * The pyramids of several layers, e.g. of all the raster layers of a project, are built
+ * at the same time, up to maxConcurrentBuilds() layers at once.
+ *
+ * The progress of every layer is reported with progressChanged(). When the pyramids of
+ * a layer are built, the layer is reloaded to use them and layerFinished() is emitted.
+ * cancel() stops all builds, the pyramids built partially are removed by the providers.
+ *
+ * \note added in QGIS 2.18
+ */
+class CORE_EXPORT QgsRasterPyramidBuilder : public QObject
+{
+    Q_OBJECT
+
+  public:
+
+    //! Constructor for QgsRasterPyramidBuilder
+    explicit QgsRasterPyramidBuilder( QObject* parent = nullptr );
+
+    //! Cancels the builds which are running and waits for them to stop
+    ~QgsRasterPyramidBuilder();
+
+    /** Adds a layer whose pyramids are built. Layers can not be added once the build is started.
+     * @param layer raster layer
+     * @param pyramids pyramids of the layer as returned by QgsRasterDataProvider::buildPyramidList(),
+     * those with the build flag set are built. If empty, all the pyramids listed by the provider are built.
+     * @param resamplingMethod resampling method, see QgsRasterDataProvider::pyramidResamplingMethods()
+     * @param format format of the pyramids
+     * @param configOptions driver specific configuration options
+     * @returns index of the layer in the builder, or -1 if the layer has no valid data provider
+     */
+    int addLayer( QgsRasterLayer* layer,
+                  const QList<QgsRasterPyramid>& pyramids = QList<QgsRasterPyramid>(),
+                  const QString& resamplingMethod = "NEAREST",
+                  QgsRaster::RasterPyramidsFormat format = QgsRaster::PyramidsGTiff,
+                  const QStringList& configOptions = QStringList() );
+
+    //! Returns the number of layers added to the builder
+    int layerCount() const { return mBuilds.count(); }
+
+    //! Returns the layer with the specified index, or nullptr if it has been deleted
+    QgsRasterLayer* layer( int index ) const;
+
+    /** Sets the maximum number of layers whose pyramids are built at the same time.
+     * @see maxConcurrentBuilds()
+     */
+    void setMaxConcurrentBuilds( int count );
+
+    /** Returns the maximum number of layers whose pyramids are built at the same time.
+     * Defaults to the number of processor cores.
+     * @see setMaxConcurrentBuilds()
+     */
+    int maxConcurrentBuilds() const;
+
+    //! Starts building the pyramids of the layers in background threads
+    void start();
+
+    //! Returns true if pyramids are being built
+    bool isActive() const { return mActive; }
+
+    //! Cancels the builds which have not finished yet
+    void cancel();
+
+    //! Blocks until all builds have finished
+    void waitForFinished();
+
+    //! Returns the build progress of a layer, in percents (0.0-100.0)
+    double progress( int index ) const;
+
+    //! Returns the overall build progress, in percents (0.0-100.0)
+    double totalProgress() const;
+
+    /** Returns the error of a layer build as returned by QgsRasterDataProvider::buildPyramids(),
+     * a null string if its pyramids were built successfully or if the build has not finished yet.
+     */
+    QString error( int index ) const;
+
+  signals:
+
+    //! Emitted when the build progress of a layer changes, in percents (0.0-100.0)
+    void progressChanged( int index, double progress );
+
+    //! Emitted when the build of a layer has finished, error is null on success
+    void layerFinished( int index, const QString& error );
+
+    //! Emitted when all builds have finished
+    void finished();
+
+  private slots:
+
+    void buildProgressChanged( double progress );
+
+    void buildFinished( int index, const QString& error );
+
+  private:
+
+    struct Build
+    {
+      QPointer<QgsRasterLayer> layer;
+      QString providerKey;
+      QString dataSource;
+      QList<QgsRasterPyramid> pyramids;
+      QString resamplingMethod;
+      QgsRaster::RasterPyramidsFormat format;
+      QStringList configOptions;
+      QgsFeedback* feedback;
+      bool finished;
+      QString error;
+    };
+
+    QList<Build> mBuilds;
+    QThreadPool mThreadPool;
+    bool mActive;
+    int mPendingCount;
+
+    QgsRasterPyramidBuilder( const QgsRasterPyramidBuilder& rh );
+    QgsRasterPyramidBuilder& operator=( const QgsRasterPyramidBuilder& rh );
+};
+
+#endif // QGSRASTERPYRAMIDBUILDER_H
@@ -0,0 +1,185 @@
+/***************************************************************************
+                         qgsrastervaluelookup_p.h
+                         ------------------------
+    begin                : October 2018
+    copyright            : (C) 2018 by NextGIS
+    email                : info at nextgis dot com
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#ifndef QGSRASTERVALUELOOKUP_PRIVATE_H
+#define QGSRASTERVALUELOOKUP_PRIVATE_H
+
+/// @cond PRIVATE
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the QGIS API.  It exists purely as an
+// implementation detail.  This header file may change from version to
+// version without notice, or even be removed.
+//
+
+#include "qgsrasterblock.h"
+
+/** Maps the pixels of an integer raster block through a table with an entry for every value
+ * between the lowest and the highest value of the block.
+ *
+ * Renderers compute the entry of every value in the table once, e.g. its stretched value or
+ * color, instead of computing it again for every pixel with this value. Tables are used only
+ * for integer blocks whose values span a range which is small compared to the block size.
+ */
+class QgsRasterValueLookup
+{
+  public:
+
+    //! Maximum number of entries in a table
+    static const int MAX_SIZE = 65536;
+
+    QgsRasterValueLookup()
+        : mBlock( nullptr )
+        , mMinimum( 0 )
+        , mSize( 0 )
+    {}
+
+    /** Finds the range of the values of a block. Returns false if a table can not be used for
+     * the block, the pixels must be processed one by one then.
+     */
+    bool setBlock( QgsRasterBlock* block )
+    {
+      mBlock = nullptr;
+      mSize = 0;
+      if ( !block || block->isEmpty() )
+        return false;
+
+      qgssize count = static_cast< qgssize >( block->width() ) * block->height();
+      const char* data = block->bits();
+      qint64 minimum = 0;
+      qint64 maximum = 0;
+      switch ( block->dataType() )
+      {
+        case QGis::Byte:
+          range( reinterpret_cast< const quint8* >( data ), count, minimum, maximum );
+          break;
+        case QGis::UInt16:
+          range( reinterpret_cast< const quint16* >( data ), count, minimum, maximum );
+          break;
+        case QGis::Int16:
+          range( reinterpret_cast< const qint16* >( data ), count, minimum, maximum );
+          break;
+        case QGis::UInt32:
+          range( reinterpret_cast< const quint32* >( data ), count, minimum, maximum );
+          break;
+        case QGis::Int32:
+          range( reinterpret_cast< const qint32* >( data ), count, minimum, maximum );
+          break;
+        default:
+          return false;
+      }
+
+      // a table larger than the block takes longer to fill than the pixels to process
+      qint64 size = maximum - minimum + 1;
+      if ( size > MAX_SIZE || static_cast< qgssize >( size ) > qMax( static_cast< qgssize >( 256 ), count ) )
+        return false;
+
+      mBlock = block;
+      mMinimum = minimum;
+      mSize = static_cast< int >( size );
+      return true;
+    }
+
+    //! Returns the number of entries of the table
+    int size() const { return mSize; }
+
+    //! Returns the value of a table entry
+    double value( int index ) const { return static_cast< double >( mMinimum + index ); }
+
+    //! Returns true if the value of a table entry is the no data value of the block
+    bool isNoData( int index ) const
+    {
+      return mBlock->hasNoDataValue() && qgsDoubleNear( value( index ), mBlock->noDataValue() );
+    }
+
+    /** Writes the table entry of every pixel of the block to output.
+     * @param table table with size() entries
+     * @param noDataEntry entry of no data pixels which are not identified by the no data value
+     * @param output array with an item for every pixel
+     */
+    template <typename T> void lookup( const T* table, const T& noDataEntry, T* output ) const
+    {
+      const char* data = mBlock->bits();
+      switch ( mBlock->dataType() )
+      {
+        case QGis::Byte:
+          lookupValues( reinterpret_cast< const quint8* >( data ), table, output );
+          break;
+        case QGis::UInt16:
+          lookupValues( reinterpret_cast< const quint16* >( data ), table, output );
+          break;
+        case QGis::Int16:
+          lookupValues( reinterpret_cast< const qint16* >( data ), table, output );
+          break;
+        case QGis::UInt32:
+          lookupValues( reinterpret_cast< const quint32* >( data ), table, output );
+          break;
+        case QGis::Int32:
+          lookupValues( reinterpret_cast< const qint32* >( data ), table, output );
+          break;
+        default:
+          return;
+      }
+
+      // no data set in the no data bitmap of the block
+      if ( !mBlock->hasNoDataValue() && mBlock->hasNoData() )
+      {
+        qgssize count = static_cast< qgssize >( mBlock->width() ) * mBlock->height();
+        for ( qgssize i = 0; i < count; i++ )
+        {
+          if ( mBlock->isNoData( i ) )
+            output[i] = noDataEntry;
+        }
+      }
+    }
+
+  private:
+
+    QgsRasterBlock* mBlock;
+    qint64 mMinimum;
+    int mSize;
+
+    template <typename V> static void range( const V* values, qgssize count, qint64& minimum, qint64& maximum )
+    {
+      // no branches in the loop, so that the compiler can vectorize it
+      V low = values[0];
+      V high = values[0];
+      for ( qgssize i = 1; i < count; i++ )
+      {
+        low = qMin( low, values[i] );
+        high = qMax( high, values[i] );
+      }
+      minimum = low;
+      maximum = high;
+    }
+
+    template <typename V, typename T> void lookupValues( const V* values, const T* table, T* output ) const
+    {
+      qgssize count = static_cast< qgssize >( mBlock->width() ) * mBlock->height();
+      for ( qgssize i = 0; i < count; i++ )
+      {
+        output[i] = table[static_cast< qint64 >( values[i] ) - mMinimum];
+      }
+    }
+};
+
+/// @endcond
+
+#endif // QGSRASTERVALUELOOKUP_PRIVATE_H
@@ -18,9 +18,11 @@
 #include "qgssinglebandgrayrenderer.h"
 #include "qgscontrastenhancement.h"
 #include "qgsrastertransparency.h"
+#include "qgsrastervaluelookup_p.h"
 #include <QDomDocument>
 #include <QDomElement>
 #include <QImage>
+#include <QVector>
 
 QgsSingleBandGrayRenderer::QgsSingleBandGrayRenderer( QgsRasterInterface* input, int grayBand ):
     QgsRasterRenderer( input, "singlebandgray" ), mGrayBand( grayBand ), mGradient( BlackToWhite ), mContrastEnhancement( nullptr )
@@ -128,47 +130,30 @@ QgsRasterBlock* QgsSingleBandGrayRenderer::block2( int bandNo, QgsRectangle  con
   }
 
   QRgb myDefaultColor = NODATA_COLOR;
-  for ( qgssize i = 0; i < ( qgssize )width*height; i++ )
-  {
-    if ( inputBlock->isNoData( i ) )
-    {
-      outputBlock->setColor( i, myDefaultColor );
-      continue;
-    }
-    double grayVal = inputBlock->value( i );
+  QRgb *outputData = reinterpret_cast< QRgb * >( outputBlock->bits() );
 
-    double currentAlpha = mOpacity;
-    if ( mRasterTransparency )
-    {
-      currentAlpha = mRasterTransparency->alphaValue( grayVal, mOpacity * 255 ) / 255.0;
-    }
-    if ( mAlphaBand > 0 )
+  QgsRasterValueLookup lookup;
+  if ( !alphaBlock && lookup.setBlock( inputBlock ) )
+  {
+    // the color of a pixel depends only on its value, compute the color of every value once
+    QVector<QRgb> colors( lookup.size() );
+    for ( int j = 0; j < lookup.size(); j++ )
     {
-      currentAlpha *= alphaBlock->value( i ) / 255.0;
+      colors[j] = lookup.isNoData( j ) ? myDefaultColor : pixelColor( lookup.value( j ), 1.0 );
     }
-
-    if ( mContrastEnhancement )
+    lookup.lookup( colors.constData(), myDefaultColor, outputData );
+  }
+  else
+  {
+    for ( qgssize i = 0; i < ( qgssize )width*height; i++ )
     {
-      if ( !mContrastEnhancement->isValueInDisplayableRange( grayVal ) )
+      if ( inputBlock->isNoData( i ) )
       {
-        outputBlock->setColor( i, myDefaultColor );
+        outputData[i] = myDefaultColor;
         continue;
       }
-      grayVal = mContrastEnhancement->enhanceContrast( grayVal );
-    }
-
-    if ( mGradient == WhiteToBlack )
-    {
-      grayVal = 255 - grayVal;
-    }
-
-    if ( qgsDoubleNear( currentAlpha, 1.0 ) )
-    {
-      outputBlock->setColor( i, qRgba( grayVal, grayVal, grayVal, 255 ) );
-    }
-    else
-    {
-      outputBlock->setColor( i, qRgba( currentAlpha * grayVal, currentAlpha * grayVal, currentAlpha * grayVal, currentAlpha * 255 ) );
+      double alphaFactor = mAlphaBand > 0 ? alphaBlock->value( i ) / 255.0 : 1.0;
+      outputData[i] = pixelColor( inputBlock->value( i ), alphaFactor );
     }
   }
 
@@ -181,6 +166,39 @@ QgsRasterBlock* QgsSingleBandGrayRenderer::block2( int bandNo, QgsRectangle  con
   return outputBlock;
 }
 
+QRgb QgsSingleBandGrayRenderer::pixelColor( double grayVal, double alphaFactor ) const
+{
+  double currentAlpha = mOpacity;
+  if ( mRasterTransparency )
+  {
+    currentAlpha = mRasterTransparency->alphaValue( grayVal, mOpacity * 255 ) / 255.0;
+  }
+  if ( mAlphaBand > 0 )
+  {
+    currentAlpha *= alphaFactor;
+  }
+
+  if ( mContrastEnhancement )
+  {
+    if ( !mContrastEnhancement->isValueInDisplayableRange( grayVal ) )
+    {
+      return NODATA_COLOR;
+    }
+    grayVal = mContrastEnhancement->enhanceContrast( grayVal );
+  }
+
+  if ( mGradient == WhiteToBlack )
+  {
+    grayVal = 255 - grayVal;
+  }
+
+  if ( qgsDoubleNear( currentAlpha, 1.0 ) )
+  {
+    return qRgba( grayVal, grayVal, grayVal, 255 );
+  }
+  return qRgba( currentAlpha * grayVal, currentAlpha * grayVal, currentAlpha * grayVal, currentAlpha * 255 );
+}
+
 void QgsSingleBandGrayRenderer::writeXML( QDomDocument& doc, QDomElement& parentElem ) const
 {
   if ( parentElem.isNull() )
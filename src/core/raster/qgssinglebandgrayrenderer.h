@@ -64,6 +64,9 @@ class CORE_EXPORT QgsSingleBandGrayRenderer: public QgsRasterRenderer
     Gradient mGradient;
     QgsContrastEnhancement* mContrastEnhancement;
 
+    //! Returns the color of a pixel value, alphaFactor is the value of the alpha band scaled to 0..1
+    QRgb pixelColor( double grayVal, double alphaFactor ) const;
+
     QgsSingleBandGrayRenderer( const QgsSingleBandGrayRenderer& );
     const QgsSingleBandGrayRenderer& operator=( const QgsSingleBandGrayRenderer& );
 };
@@ -18,10 +18,12 @@
 #include "qgssinglebandpseudocolorrenderer.h"
 #include "qgsrastershader.h"
 #include "qgsrastertransparency.h"
+#include "qgsrastervaluelookup_p.h"
 #include "qgsrasterviewport.h"
 #include <QDomDocument>
 #include <QDomElement>
 #include <QImage>
+#include <QVector>
 
 QgsSingleBandPseudoColorRenderer::QgsSingleBandPseudoColorRenderer( QgsRasterInterface* input, int band, QgsRasterShader* shader ):
     QgsRasterRenderer( input, "singlebandpseudocolor" )
@@ -158,48 +160,30 @@ QgsRasterBlock* QgsSingleBandPseudoColorRenderer::block2( int bandNo, QgsRectang
   }
 
   QRgb myDefaultColor = NODATA_COLOR;
+  QRgb *outputData = reinterpret_cast< QRgb * >( outputBlock->bits() );
 
-  for ( qgssize i = 0; i < ( qgssize )width*height; i++ )
+  QgsRasterValueLookup lookup;
+  if ( !alphaBlock && lookup.setBlock( inputBlock ) )
   {
-    if ( inputBlock->isNoData( i ) )
+    // the color of a pixel depends only on its value, shade every value once
+    QVector<QRgb> colors( lookup.size() );
+    for ( int j = 0; j < lookup.size(); j++ )
     {
-      outputBlock->setColor( i, myDefaultColor );
-      continue;
+      colors[j] = lookup.isNoData( j ) ? myDefaultColor : pixelColor( lookup.value( j ), hasTransparency, 1.0 );
     }
-    double val = inputBlock->value( i );
-    int red, green, blue, alpha;
-    if ( !mShader->shade( val, &red, &green, &blue, &alpha ) )
-    {
-      outputBlock->setColor( i, myDefaultColor );
-      continue;
-    }
-
-    if ( alpha < 255 )
-    {
-      // Working with premultiplied colors, so multiply values by alpha
-      red *= ( alpha / 255.0 );
-      blue *= ( alpha / 255.0 );
-      green *= ( alpha / 255.0 );
-    }
-
-    if ( !hasTransparency )
-    {
-      outputBlock->setColor( i, qRgba( red, green, blue, alpha ) );
-    }
-    else
+    lookup.lookup( colors.constData(), myDefaultColor, outputData );
+  }
+  else
+  {
+    for ( qgssize i = 0; i < ( qgssize )width*height; i++ )
     {
-      //opacity
-      double currentOpacity = mOpacity;
-      if ( mRasterTransparency )
-      {
-        currentOpacity = mRasterTransparency->alphaValue( val, mOpacity * 255 ) / 255.0;
-      }
-      if ( mAlphaBand > 0 )
+      if ( inputBlock->isNoData( i ) )
       {
-        currentOpacity *= alphaBlock->value( i ) / 255.0;
+        outputData[i] = myDefaultColor;
+        continue;
       }
-
-      outputBlock->setColor( i, qRgba( currentOpacity * red, currentOpacity * green, currentOpacity * blue, currentOpacity * alpha ) );
+      double alphaFactor = mAlphaBand > 0 ? alphaBlock->value( i ) / 255.0 : 1.0;
+      outputData[i] = pixelColor( inputBlock->value( i ), hasTransparency, alphaFactor );
     }
   }
 
@@ -212,6 +196,41 @@ QgsRasterBlock* QgsSingleBandPseudoColorRenderer::block2( int bandNo, QgsRectang
   return outputBlock;
 }
 
+QRgb QgsSingleBandPseudoColorRenderer::pixelColor( double val, bool hasTransparency, double alphaFactor ) const
+{
+  int red, green, blue, alpha;
+  if ( !mShader->shade( val, &red, &green, &blue, &alpha ) )
+  {
+    return NODATA_COLOR;
+  }
+
+  if ( alpha < 255 )
+  {
+    // Working with premultiplied colors, so multiply values by alpha
+    red *= ( alpha / 255.0 );
+    blue *= ( alpha / 255.0 );
+    green *= ( alpha / 255.0 );
+  }
+
+  if ( !hasTransparency )
+  {
+    return qRgba( red, green, blue, alpha );
+  }
+
+  //opacity
+  double currentOpacity = mOpacity;
+  if ( mRasterTransparency )
+  {
+    currentOpacity = mRasterTransparency->alphaValue( val, mOpacity * 255 ) / 255.0;
+  }
+  if ( mAlphaBand > 0 )
+  {
+    currentOpacity *= alphaFactor;
+  }
+
+  return qRgba( currentOpacity * red, currentOpacity * green, currentOpacity * blue, currentOpacity * alpha );
+}
+
 void QgsSingleBandPseudoColorRenderer::writeXML( QDomDocument& doc, QDomElement& parentElem ) const
 {
   if ( parentElem.isNull() )
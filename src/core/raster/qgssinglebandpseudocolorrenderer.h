@@ -80,6 +80,9 @@ class CORE_EXPORT QgsSingleBandPseudoColorRenderer: public QgsRasterRenderer
 
     int mClassificationMinMaxOrigin;
 
+    //! Returns the color of a pixel value, alphaFactor is the value of the alpha band scaled to 0..1
+    QRgb pixelColor( double val, bool hasTransparency, double alphaFactor ) const;
+
     QgsSingleBandPseudoColorRenderer( const QgsSingleBandPseudoColorRenderer& );
     const QgsSingleBandPseudoColorRenderer& operator=( const QgsSingleBandPseudoColorRenderer& );
 };
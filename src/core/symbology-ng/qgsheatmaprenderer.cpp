@@ -30,9 +30,87 @@
 
 #include <QDomDocument>
 #include <QDomElement>
+#include <QThread>
+#include <QtConcurrentMap>
+
+//below this number of kernel evaluations, spreading the accumulation over threads is not worth it
+#define PARALLEL_ACCUMULATION_THRESHOLD 1000000
+
+/// @cond PRIVATE
+
+struct QgsHeatmapBin
+{
+  int x;
+  int y;
+  double weight;
+};
+
+static bool heatmapBinRowLessThan( const QgsHeatmapBin& bin1, const QgsHeatmapBin& bin2 )
+{
+  return bin1.y < bin2.y;
+}
+
+/** Stamps the kernel of every bin into a horizontal band of the value buffer. Bands
+ * do not overlap, so several bands can be accumulated concurrently without locking.
+ */
+class QgsHeatmapBandAccumulator
+{
+  public:
+    typedef void result_type;
+
+    QgsHeatmapBandAccumulator( double* values, int width, const QVector<double>& stamp, int radius, const QVector<QgsHeatmapBin>& bins )
+        : mValues( values )
+        , mWidth( width )
+        , mStamp( stamp.constData() )
+        , mRadius( radius )
+        , mBins( bins )
+    {}
+
+    //! Accumulates rows [band.first, band.second)
+    void operator()( const QPair<int, int>& band )
+    {
+      int diameter = 2 * mRadius;
+
+      //bins are sorted by row, so skip straight to the first one whose kernel reaches the band
+      QgsHeatmapBin firstBin = { 0, band.first - mRadius, 0 };
+      QVector<QgsHeatmapBin>::const_iterator binIt = qLowerBound( mBins.constBegin(), mBins.constEnd(), firstBin, heatmapBinRowLessThan );
+      for ( ; binIt != mBins.constEnd() && binIt->y - mRadius < band.second; ++binIt )
+      {
+        int rowMin = qMax( binIt->y - mRadius, band.first );
+        int rowMax = qMin( binIt->y + mRadius, band.second );
+        int colMin = qMax( binIt->x - mRadius, 0 );
+        int colMax = qMin( binIt->x + mRadius, mWidth );
+        int count = colMax - colMin;
+        if ( count <= 0 )
+          continue;
+
+        double weight = binIt->weight;
+        for ( int row = rowMin; row < rowMax; ++row )
+        {
+          const double* stampRow = mStamp + ( row - binIt->y + mRadius ) * diameter + ( colMin - binIt->x + mRadius );
+          double* valueRow = mValues + row * mWidth + colMin;
+          for ( int i = 0; i < count; ++i )
+          {
+            valueRow[i] += weight * stampRow[i];
+          }
+        }
+      }
+    }
+
+  private:
+    double* mValues;
+    int mWidth;
+    const double* mStamp;
+    int mRadius;
+    const QVector<QgsHeatmapBin>& mBins;
+};
+
+///@endcond
 
 QgsHeatmapRenderer::QgsHeatmapRenderer()
     : QgsFeatureRendererV2( "heatmapRenderer" )
+    , mValuesWidth( 0 )
+    , mValuesHeight( 0 )
     , mCalculatedMaxValue( 0 )
     , mRadius( 10 )
     , mRadiusPixels( 0 )
@@ -62,6 +140,22 @@ void QgsHeatmapRenderer::initializeValues( QgsRenderContext& context )
   mFeaturesRendered = 0;
   mRadiusPixels = qRound( mRadius * QgsSymbolLayerV2Utils::pixelSizeScaleFactor( context, mRadiusUnit, mRadiusMapUnitScale ) / mRenderQuality );
   mRadiusSquared = mRadiusPixels * mRadiusPixels;
+  mValuesWidth = context.painter()->device()->width() / mRenderQuality;
+  mValuesHeight = context.painter()->device()->height() / mRenderQuality;
+  mPointBins.clear();
+
+  //precompute the kernel for every pixel offset within the radius
+  int diameter = 2 * mRadiusPixels;
+  mKernelStamp.resize( diameter * diameter );
+  int idx = 0;
+  for ( int dy = -mRadiusPixels; dy < mRadiusPixels; ++dy )
+  {
+    for ( int dx = -mRadiusPixels; dx < mRadiusPixels; ++dx )
+    {
+      double distanceSquared = dx * dx + dy * dy;
+      mKernelStamp[ idx++ ] = distanceSquared > mRadiusSquared ? 0.0 : quarticKernel( sqrt( distanceSquared ), mRadiusPixels );
+    }
+  }
 }
 
 void QgsHeatmapRenderer::startRender( QgsRenderContext& context, const QgsFields& fields )
@@ -138,54 +232,39 @@ bool QgsHeatmapRenderer::renderFeature( QgsFeature& feature, QgsRenderContext& c
     }
   }
 
-  int width = context.painter()->device()->width() / mRenderQuality;
-  int height = context.painter()->device()->height() / mRenderQuality;
-
-  //transform geometry if required
-  QgsGeometry* transformedGeom = nullptr;
+  //convert point to multipoint, and transform the points if required
+  QgsMultiPoint multiPoint = convertToMultipoint( feature.constGeometry() );
   const QgsCoordinateTransform* xform = context.coordinateTransform();
-  if ( xform )
-  {
-    transformedGeom = new QgsGeometry( *feature.constGeometry() );
-    transformedGeom->transform( *xform );
-  }
-
-  //convert point to multipoint
-  QgsMultiPoint multiPoint = convertToMultipoint( transformedGeom ? transformedGeom : feature.constGeometry() );
-
-  delete transformedGeom;
-  transformedGeom = nullptr;
 
-  //loop through all points in multipoint
+  //loop through all points in multipoint, and sum up the weights of points which fall
+  //into the same heatmap pixel. The kernels are stamped once per pixel in stopRender
   for ( QgsMultiPoint::const_iterator pointIt = multiPoint.constBegin(); pointIt != multiPoint.constEnd(); ++pointIt )
   {
-    QgsPoint pixel = context.mapToPixel().transform( *pointIt );
-    int pointX = pixel.x() / mRenderQuality;
-    int pointY = pixel.y() / mRenderQuality;
-    for ( int x = qMax( pointX - mRadiusPixels, 0 ); x < qMin( pointX + mRadiusPixels, width ); ++x )
+    QgsPoint point = *pointIt;
+    if ( xform )
     {
-      for ( int y = qMax( pointY - mRadiusPixels, 0 ); y < qMin( pointY + mRadiusPixels, height ); ++y )
+      try
       {
-        int index = y * width + x;
-        if ( index >= mValues.count() )
-        {
-          continue;
-        }
-        double distanceSquared = pow( pointX - x, 2.0 ) + pow( pointY - y, 2.0 );
-        if ( distanceSquared > mRadiusSquared )
-        {
-          continue;
-        }
-
-        double score = weight * quarticKernel( sqrt( distanceSquared ), mRadiusPixels );
-        double value = mValues.at( index ) + score;
-        if ( value > mCalculatedMaxValue )
-        {
-          mCalculatedMaxValue = value;
-        }
-        mValues[ index ] = value;
+        point = xform->transform( point );
+      }
+      catch ( QgsCsException &cse )
+      {
+        Q_UNUSED( cse );
+        continue;
       }
     }
+
+    QgsPoint pixel = context.mapToPixel().transform( point );
+    int pointX = pixel.x() / mRenderQuality;
+    int pointY = pixel.y() / mRenderQuality;
+    if ( pointX + mRadiusPixels <= 0 || pointX - mRadiusPixels >= mValuesWidth
+         || pointY + mRadiusPixels <= 0 || pointY - mRadiusPixels >= mValuesHeight )
+    {
+      continue;
+    }
+
+    qint64 key = static_cast< qint64 >(( static_cast< quint64 >( static_cast< quint32 >( pointX ) ) << 32 ) | static_cast< quint32 >( pointY ) );
+    mPointBins[ key ] += weight;
   }
 
   mFeaturesRendered++;
@@ -229,10 +308,56 @@ double QgsHeatmapRenderer::triangularKernel( const double distance, const int ba
 
 void QgsHeatmapRenderer::stopRender( QgsRenderContext& context )
 {
+  accumulateValues();
   renderImage( context );
   mWeightExpression.reset();
 }
 
+void QgsHeatmapRenderer::accumulateValues()
+{
+  QVector<QgsHeatmapBin> bins;
+  bins.reserve( mPointBins.size() );
+  for ( QHash<qint64, double>::const_iterator binIt = mPointBins.constBegin(); binIt != mPointBins.constEnd(); ++binIt )
+  {
+    quint64 key = static_cast< quint64 >( binIt.key() );
+    QgsHeatmapBin bin = { static_cast< qint32 >( static_cast< quint32 >( key >> 32 ) ), static_cast< qint32 >( static_cast< quint32 >( key & 0xffffffff ) ), binIt.value() };
+    bins << bin;
+  }
+  mPointBins.clear();
+
+  if ( !bins.isEmpty() && mRadiusPixels > 0 && mValuesWidth > 0 && mValuesHeight > 0 )
+  {
+    qSort( bins.begin(), bins.end(), heatmapBinRowLessThan );
+
+    QgsHeatmapBandAccumulator accumulator( mValues.data(), mValuesWidth, mKernelStamp, mRadiusPixels, bins );
+    int threads = QThread::idealThreadCount();
+    if ( threads > 1 && static_cast< qint64 >( bins.count() ) * mKernelStamp.count() > PARALLEL_ACCUMULATION_THRESHOLD )
+    {
+      //split the image into horizontal bands, so that every thread writes to its own rows
+      int bandHeight = qMax( 1, mValuesHeight / ( threads * 4 ) );
+      QList< QPair<int, int> > bands;
+      for ( int row = 0; row < mValuesHeight; row += bandHeight )
+      {
+        bands << qMakePair( row, qMin( row + bandHeight, mValuesHeight ) );
+      }
+      QtConcurrent::blockingMap( bands, accumulator );
+    }
+    else
+    {
+      accumulator( qMakePair( 0, mValuesHeight ) );
+    }
+  }
+
+  mCalculatedMaxValue = 0;
+  int count = mValuesWidth * mValuesHeight;
+  const double* values = mValues.constData();
+  for ( int i = 0; i < count; ++i )
+  {
+    if ( values[i] > mCalculatedMaxValue )
+      mCalculatedMaxValue = values[i];
+  }
+}
+
 void QgsHeatmapRenderer::renderImage( QgsRenderContext& context )
 {
   if ( !context.painter() || !mGradientRamp )
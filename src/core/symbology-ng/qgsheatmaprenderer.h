@@ -173,6 +173,14 @@ class CORE_EXPORT QgsHeatmapRenderer : public QgsFeatureRendererV2
     QgsHeatmapRenderer& operator=( const QgsHeatmapRenderer& );
 
     QVector<double> mValues;
+    int mValuesWidth;
+    int mValuesHeight;
+
+    //! Kernel values for a point, precomputed for the current radius (row-major, 2 * radius pixels wide)
+    QVector<double> mKernelStamp;
+
+    //! Summed weights of all points which fall into the same heatmap pixel, keyed by packed pixel position
+    QHash<qint64, double> mPointBins;
 
     double mCalculatedMaxValue;
 
@@ -202,6 +210,7 @@ class CORE_EXPORT QgsHeatmapRenderer : public QgsFeatureRendererV2
 
     QgsMultiPoint convertToMultipoint( const QgsGeometry *geom );
     void initializeValues( QgsRenderContext& context );
+    void accumulateValues();
     void renderImage( QgsRenderContext &context );
 };
 
@@ -16,9 +16,9 @@
  ***************************************************************************/
 
 #include "qgspointdisplacementrenderer.h"
+#include "qgscoordinatetransform.h"
 #include "qgsgeometry.h"
 #include "qgslogger.h"
-#include "qgsspatialindex.h"
 #include "qgssymbolv2.h"
 #include "qgssymbollayerv2utils.h"
 #include "qgsvectorlayer.h"
@@ -26,12 +26,11 @@
 #include "qgspainteffect.h"
 #include "qgspainteffectregistry.h"
 #include "qgsfontutils.h"
-#include "qgsmultipointv2.h"
-#include "qgspointv2.h"
 #include "qgsunittypes.h"
-#include "qgswkbptr.h"
 
 #include <QDomElement>
+#include <QMutex>
+#include <QMutexLocker>
 #include <QPainter>
 
 #include <cmath>
@@ -40,6 +39,29 @@
 #define M_SQRT2 1.41421356237309504880
 #endif
 
+//above this number of assignments, the cached groups are dropped instead of growing further
+#define MAX_CACHED_GROUP_ASSIGNMENTS 2000000
+
+/// @cond PRIVATE
+
+/** Group assignments of the last renders, shared between the clones of a renderer. Assignments
+ * are only valid for the search distance they have been computed with.
+ */
+class QgsPointDisplacementGroupCache
+{
+  public:
+    QgsPointDisplacementGroupCache()
+        : searchDistance( -1.0 )
+    {}
+
+    QMutex mutex;
+    double searchDistance;
+    //! feature ID to the ID of the seed feature of its group
+    QHash<QgsFeatureId, QgsFeatureId> seeds;
+};
+
+///@endcond
+
 QgsPointDisplacementRenderer::QgsPointDisplacementRenderer( const QString& labelAttributeName )
     : QgsFeatureRendererV2( "pointDisplacement" )
     , mLabelAttributeName( labelAttributeName )
@@ -51,7 +73,10 @@ QgsPointDisplacementRenderer::QgsPointDisplacementRenderer( const QString& label
     , mCircleColor( QColor( 125, 125, 125 ) )
     , mCircleRadiusAddition( 0 )
     , mMaxLabelScaleDenominator( -1 )
-    , mSpatialIndex( nullptr )
+    , mClusterThreshold( 0 )
+    , mSearchDistance( 0.0 )
+    , mGridCellSize( 1.0 )
+    , mGroupCache( new QgsPointDisplacementGroupCache() )
 {
   mRenderer = QgsFeatureRendererV2::defaultRenderer( QGis::Point );
   mCenterSymbol = new QgsMarkerSymbolV2(); //the symbol for the center of a displacement group
@@ -79,6 +104,9 @@ QgsPointDisplacementRenderer* QgsPointDisplacementRenderer::clone() const
   r->setTolerance( mTolerance );
   r->setToleranceUnit( mToleranceUnit );
   r->setToleranceMapUnitScale( mToleranceMapUnitScale );
+  r->setClusterThreshold( mClusterThreshold );
+  // clones are created for every render job, share the assignments with them
+  r->mGroupCache = mGroupCache;
   if ( mCenterSymbol )
   {
     r->setCenterSymbol( mCenterSymbol->clone() );
@@ -126,62 +154,118 @@ bool QgsPointDisplacementRenderer::renderFeature( QgsFeature& feature, QgsRender
   if ( selected )
     mSelectedFeatures.insert( feature.id() );
 
-  double searchDistance = mTolerance * QgsSymbolLayerV2Utils::mapUnitScaleFactor( context, mToleranceUnit, mToleranceMapUnitScale );
-  QList<QgsFeatureId> intersectList = mSpatialIndex->intersects( searchRect( feature.constGeometry()->asPoint(), searchDistance ) );
-  if ( intersectList.empty() )
+  QgsPoint point = geom->asPoint();
+  int groupIdx = -1;
+
+  //prefer the group of the previous render, as long as its seed is still close enough
+  QHash<QgsFeatureId, QgsFeatureId>::const_iterator cachedIt = mCachedSeeds.constFind( feature.id() );
+  if ( cachedIt != mCachedSeeds.constEnd() )
   {
-    mSpatialIndex->insertFeature( feature );
-    // create new group
-    DisplacementGroup newGroup;
-    newGroup.insert( feature.id(), qMakePair( feature, symbol ) );
-    mDisplacementGroups.push_back( newGroup );
-    // add to group index
-    mGroupIndex.insert( feature.id(), mDisplacementGroups.count() - 1 );
-    return true;
+    QHash<QgsFeatureId, int>::const_iterator seedIt = mSeedGroups.constFind( cachedIt.value() );
+    if ( seedIt != mSeedGroups.constEnd() && withinSearchDistance( mGroupInfos.at( seedIt.value() ).seed, point ) )
+    {
+      groupIdx = seedIt.value();
+    }
   }
 
-  //go through all the displacement group maps and search an entry where the id equals the result of the spatial search
-  QgsFeatureId existingEntry = intersectList.at( 0 );
+  if ( groupIdx < 0 )
+  {
+    groupIdx = findGroup( point );
+  }
 
-  int groupIdx = mGroupIndex[ existingEntry ];
+  if ( groupIdx < 0 )
+  {
+    // create new group, seeded by this feature
+    GroupInfo info = { feature.id(), point, 0.0, 0.0, 0 };
+    mGroupInfos.append( info );
+    mDisplacementGroups.push_back( DisplacementGroup() );
+    groupIdx = mDisplacementGroups.count() - 1;
+    mSeedGroups.insert( feature.id(), groupIdx );
+    mGroupGrid[ gridCell( point )].append( groupIdx );
+  }
+
+  GroupInfo& info = mGroupInfos[groupIdx];
+  info.sumX += point.x();
+  info.sumY += point.y();
+  info.count++;
+
+  // clustered groups are drawn from their count and centroid, so there is no need to keep all features
   DisplacementGroup& group = mDisplacementGroups[groupIdx];
+  if ( mClusterThreshold <= 0 || group.size() <= mClusterThreshold )
+  {
+    group.insert( feature.id(), qMakePair( feature, symbol ) );
+  }
 
-  // add to a group
-  group.insert( feature.id(), qMakePair( feature, symbol ) );
-  // add to group index
-  mGroupIndex.insert( feature.id(), groupIdx );
+  mNewSeeds.insert( feature.id(), info.seedId );
   return true;
 }
 
-void QgsPointDisplacementRenderer::drawGroup( const DisplacementGroup& group, QgsRenderContext& context )
+QgsPointDisplacementRenderer::GridCell QgsPointDisplacementRenderer::gridCell( const QgsPoint& p ) const
+{
+  return qMakePair( static_cast< qint64 >( floor( p.x() / mGridCellSize ) ), static_cast< qint64 >( floor( p.y() / mGridCellSize ) ) );
+}
+
+int QgsPointDisplacementRenderer::findGroup( const QgsPoint& p ) const
+{
+  //the cells are as large as the search distance, so all candidate seeds are in the neighbouring cells
+  GridCell cell = gridCell( p );
+  int groupIdx = -1;
+  for ( qint64 dx = -1; dx <= 1; ++dx )
+  {
+    for ( qint64 dy = -1; dy <= 1; ++dy )
+    {
+      QHash<GridCell, QList<int> >::const_iterator cellIt = mGroupGrid.constFind( qMakePair( cell.first + dx, cell.second + dy ) );
+      if ( cellIt == mGroupGrid.constEnd() )
+        continue;
+
+      Q_FOREACH ( int idx, cellIt.value() )
+      {
+        if (( groupIdx < 0 || idx < groupIdx ) && withinSearchDistance( mGroupInfos.at( idx ).seed, p ) )
+          groupIdx = idx;
+      }
+    }
+  }
+  return groupIdx;
+}
+
+bool QgsPointDisplacementRenderer::withinSearchDistance( const QgsPoint& p1, const QgsPoint& p2 ) const
+{
+  return qAbs( p1.x() - p2.x() ) <= mSearchDistance && qAbs( p1.y() - p2.y() ) <= mSearchDistance;
+}
+
+void QgsPointDisplacementRenderer::drawGroup( const DisplacementGroup& group, const GroupInfo& info, QgsRenderContext& context )
 {
   const QgsFeature& feature = group.begin().value().first;
   bool selected = mSelectedFeatures.contains( feature.id() ); // maybe we should highlight individual features instead of the whole group?
 
+  //calculate centroid of all points, this will be center of group
+  QPointF pt( info.sumX / info.count, info.sumY / info.count );
+  if ( context.coordinateTransform() )
+  {
+    double z = 0; // dummy variable for coordinate transform
+    context.coordinateTransform()->transformInPlace( pt.rx(), pt.ry(), z );
+  }
+  context.mapToPixel().transformInPlace( pt.rx(), pt.ry() );
 
+  if ( mClusterThreshold > 0 && info.count > mClusterThreshold )
+  {
+    QgsSymbolV2RenderContext symbolContext( context, QgsSymbolV2::MM, 1.0, selected );
+    drawCluster( feature, pt, info.count, symbolContext, selected );
+    return;
+  }
 
   //get list of labels and symbols
   QStringList labelAttributeList;
   QList< QgsMarkerSymbolV2* > symbolList;
   QgsFeatureList featureList;
 
-  QgsMultiPointV2* groupMultiPoint = new QgsMultiPointV2();
   for ( DisplacementGroup::const_iterator attIt = group.constBegin(); attIt != group.constEnd(); ++attIt )
   {
     labelAttributeList << ( mDrawLabels ? getLabel( attIt.value().first ) : QString() );
     symbolList << dynamic_cast<QgsMarkerSymbolV2*>( attIt.value().second );
     featureList << attIt.value().first;
-    groupMultiPoint->addGeometry( attIt.value().first.constGeometry()->geometry()->clone() );
   }
 
-  //calculate centroid of all points, this will be center of group
-  QgsGeometry groupGeom( groupMultiPoint );
-  QgsGeometry* centroid = groupGeom.centroid();
-  QPointF pt;
-  QgsConstWkbPtr wkbPtr( centroid->asWkb(), centroid->wkbSize() );
-  _getPoint( pt, context, wkbPtr );
-  delete centroid;
-
   //calculate max diagonal size from all symbols in group
   double diagonal = 0;
   Q_FOREACH ( QgsMarkerSymbolV2* symbol, symbolList )
@@ -224,6 +308,44 @@ void QgsPointDisplacementRenderer::drawGroup( const DisplacementGroup& group, Qg
   drawLabels( pt, symbolContext, labelPositions, labelAttributeList );
 }
 
+void QgsPointDisplacementRenderer::drawCluster( const QgsFeature& feature, QPointF centerPoint, int count, QgsSymbolV2RenderContext& context, bool selected )
+{
+  QPainter* p = context.renderContext().painter();
+  if ( !p )
+  {
+    return;
+  }
+
+  if ( mCenterSymbol )
+  {
+    mCenterSymbol->renderPoint( centerPoint, &feature, context.renderContext(), -1, selected );
+  }
+  else
+  {
+    p->drawRect( QRectF( centerPoint.x() - context.outputLineWidth( 1 ), centerPoint.y() - context.outputLineWidth( 1 ), context.outputLineWidth( 2 ), context.outputLineWidth( 2 ) ) );
+  }
+
+  //the number of points is drawn centered on the group, using the label font
+  QPen labelPen( mLabelColor );
+  p->setPen( labelPen );
+
+  QFont pixelSizeFont = mLabelFont;
+  pixelSizeFont.setPixelSize( context.outputLineWidth( mLabelFont.pointSizeF() * 0.3527 ) );
+  QFont scaledFont = pixelSizeFont;
+  scaledFont.setPixelSize( pixelSizeFont.pixelSize() * context.renderContext().rasterScaleFactor() );
+  p->setFont( scaledFont );
+
+  QString text = QString::number( count );
+  QFontMetricsF fontMetrics( pixelSizeFont );
+  QPointF drawingPoint( centerPoint.x() - fontMetrics.width( text ) / 2.0, centerPoint.y() + ( fontMetrics.ascent() - fontMetrics.descent() ) / 2.0 );
+
+  p->save();
+  p->translate( drawingPoint.x(), drawingPoint.y() );
+  p->scale( 1.0 / context.renderContext().rasterScaleFactor(), 1.0 / context.renderContext().rasterScaleFactor() );
+  p->drawText( QPointF( 0, 0 ), text );
+  p->restore();
+}
+
 void QgsPointDisplacementRenderer::setEmbeddedRenderer( QgsFeatureRendererV2* r )
 {
   delete mRenderer;
@@ -353,10 +475,28 @@ void QgsPointDisplacementRenderer::startRender( QgsRenderContext& context, const
   mRenderer->startRender( context, fields );
 
   mDisplacementGroups.clear();
-  mGroupIndex.clear();
-  mSpatialIndex = new QgsSpatialIndex;
+  mGroupInfos.clear();
+  mSeedGroups.clear();
+  mGroupGrid.clear();
+  mNewSeeds.clear();
   mSelectedFeatures.clear();
 
+  mSearchDistance = mTolerance * QgsSymbolLayerV2Utils::mapUnitScaleFactor( context, mToleranceUnit, mToleranceMapUnitScale );
+  mGridCellSize = mSearchDistance > 0 ? mSearchDistance : 1.0;
+
+  //group assignments of previous renders can only be reused for the same search distance
+  {
+    QMutexLocker locker( &mGroupCache->mutex );
+    if ( qgsDoubleNear( mGroupCache->searchDistance, mSearchDistance ) )
+    {
+      mCachedSeeds = mGroupCache->seeds;
+    }
+    else
+    {
+      mCachedSeeds.clear();
+    }
+  }
+
   if ( mLabelAttributeName.isEmpty() )
   {
     mLabelIndex = -1;
@@ -388,15 +528,40 @@ void QgsPointDisplacementRenderer::stopRender( QgsRenderContext& context )
 
   //printInfoDisplacementGroups(); //just for debugging
 
-  Q_FOREACH ( const DisplacementGroup& group, mDisplacementGroups )
+  for ( int i = 0; i < mDisplacementGroups.size(); ++i )
   {
-    drawGroup( group, context );
+    drawGroup( mDisplacementGroups.at( i ), mGroupInfos.at( i ), context );
+  }
+
+  if ( !context.renderingStopped() )
+  {
+    QMutexLocker locker( &mGroupCache->mutex );
+    if ( !qgsDoubleNear( mGroupCache->searchDistance, mSearchDistance )
+         || mGroupCache->seeds.size() + mNewSeeds.size() > MAX_CACHED_GROUP_ASSIGNMENTS )
+    {
+      mGroupCache->seeds.clear();
+      mGroupCache->searchDistance = mSearchDistance;
+    }
+    if ( mGroupCache->seeds.isEmpty() )
+    {
+      mGroupCache->seeds = mNewSeeds;
+    }
+    else
+    {
+      QHash<QgsFeatureId, QgsFeatureId>::const_iterator seedIt = mNewSeeds.constBegin();
+      for ( ; seedIt != mNewSeeds.constEnd(); ++seedIt )
+      {
+        mGroupCache->seeds.insert( seedIt.key(), seedIt.value() );
+      }
+    }
   }
 
   mDisplacementGroups.clear();
-  mGroupIndex.clear();
-  delete mSpatialIndex;
-  mSpatialIndex = nullptr;
+  mGroupInfos.clear();
+  mSeedGroups.clear();
+  mGroupGrid.clear();
+  mCachedSeeds.clear();
+  mNewSeeds.clear();
   mSelectedFeatures.clear();
 
   mRenderer->stopRender( context );
@@ -425,6 +590,7 @@ QgsFeatureRendererV2* QgsPointDisplacementRenderer::create( QDomElement& symbolo
   r->setTolerance( symbologyElem.attribute( "tolerance", "0.00001" ).toDouble() );
   r->setToleranceUnit( QgsSymbolLayerV2Utils::decodeOutputUnit( symbologyElem.attribute( "toleranceUnit", "MapUnit" ) ) );
   r->setToleranceMapUnitScale( QgsSymbolLayerV2Utils::decodeMapUnitScale( symbologyElem.attribute( "toleranceUnitScale" ) ) );
+  r->setClusterThreshold( symbologyElem.attribute( "clusterThreshold", "0" ).toInt() );
 
   //look for an embedded renderer <renderer-v2>
   QDomElement embeddedRendererElem = symbologyElem.firstChildElement( "renderer-v2" );
@@ -458,6 +624,7 @@ QDomElement QgsPointDisplacementRenderer::save( QDomDocument& doc )
   rendererElement.setAttribute( "tolerance", QString::number( mTolerance ) );
   rendererElement.setAttribute( "toleranceUnit", QgsSymbolLayerV2Utils::encodeOutputUnit( mToleranceUnit ) );
   rendererElement.setAttribute( "toleranceUnitScale", QgsSymbolLayerV2Utils::encodeMapUnitScale( mToleranceMapUnitScale ) );
+  rendererElement.setAttribute( "clusterThreshold", mClusterThreshold );
 
   if ( mRenderer )
   {
@@ -503,11 +670,6 @@ QgsLegendSymbolList QgsPointDisplacementRenderer::legendSymbolItems( double scal
 }
 
 
-QgsRectangle QgsPointDisplacementRenderer::searchRect( const QgsPoint& p, double distance ) const
-{
-  return QgsRectangle( p.x() - distance, p.y() - distance, p.x() + distance, p.y() + distance );
-}
-
 void QgsPointDisplacementRenderer::printInfoDisplacementGroups()
 {
   int nGroups = mDisplacementGroups.size();
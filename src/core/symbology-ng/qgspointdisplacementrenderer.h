@@ -24,8 +24,9 @@
 #include "qgsrendererv2.h"
 #include <QFont>
 #include <QSet>
+#include <QSharedPointer>
 
-class QgsSpatialIndex;
+class QgsPointDisplacementGroupCache;
 
 /** \ingroup core
  * A renderer that automatically displaces points with the same position
@@ -198,6 +199,22 @@ class CORE_EXPORT QgsPointDisplacementRenderer: public QgsFeatureRendererV2
      */
     const QgsMapUnitScale& toleranceMapUnitScale() const { return mToleranceMapUnitScale; }
 
+    /** Sets the minimum number of points for a group to be drawn as an aggregated cluster.
+     * Groups with more points than the threshold are drawn as the center symbol with the
+     * number of grouped points as label, instead of displacing every single symbol.
+     * @param threshold cluster threshold. A value of 0 disables clustering.
+     * @see clusterThreshold()
+     * @note added in QGIS 2.18
+     */
+    void setClusterThreshold( int threshold ) { mClusterThreshold = qMax( 0, threshold ); }
+
+    /** Returns the minimum number of points for a group to be drawn as an aggregated cluster,
+     * or 0 if clustering is disabled.
+     * @see setClusterThreshold()
+     * @note added in QGIS 2.18
+     */
+    int clusterThreshold() const { return mClusterThreshold; }
+
     //! creates a QgsPointDisplacementRenderer from an existing renderer.
     //! @note added in 2.5
     //! @returns a new renderer if the conversion was possible, otherwise 0.
@@ -236,19 +253,50 @@ class CORE_EXPORT QgsPointDisplacementRenderer: public QgsFeatureRendererV2
     bool mDrawLabels;
     /** Maximum scale denominator for label display. Negative number means no scale limitation*/
     double mMaxLabelScaleDenominator;
+    /** Groups with more points are drawn as aggregated clusters. 0 means no clustering*/
+    int mClusterThreshold;
 
     typedef QMap<QgsFeatureId, QPair< QgsFeature, QgsSymbolV2* > > DisplacementGroup;
+
+    /** Position and extent of a displacement group*/
+    struct GroupInfo
+    {
+      QgsFeatureId seedId;
+      QgsPoint seed;
+      double sumX;
+      double sumY;
+      int count;
+    };
+
+    typedef QPair<qint64, qint64> GridCell;
+
     /** Groups of features that have the same position*/
     QList<DisplacementGroup> mDisplacementGroups;
-    /** Mapping from feature ID to its group index*/
-    QMap<QgsFeatureId, int> mGroupIndex;
-    /** Spatial index for fast lookup of close points*/
-    QgsSpatialIndex* mSpatialIndex;
+    /** Seed position and point count for each entry of mDisplacementGroups*/
+    QVector<GroupInfo> mGroupInfos;
+    /** Mapping from seed feature ID to its group index*/
+    QHash<QgsFeatureId, int> mSeedGroups;
+    /** Hash grid with cells of the search distance, holding the indexes of the groups seeded in each cell*/
+    QHash<GridCell, QList<int> > mGroupGrid;
+    /** Search distance in layer units, set in startRender()*/
+    double mSearchDistance;
+    /** Size of the grid cells in layer units*/
+    double mGridCellSize;
+    /** Group assignments shared between clones of this renderer*/
+    QSharedPointer<QgsPointDisplacementGroupCache> mGroupCache;
+    /** Snapshot of the cached assignments (feature ID to seed feature ID) taken in startRender()*/
+    QHash<QgsFeatureId, QgsFeatureId> mCachedSeeds;
+    /** Assignments made during the current render, merged into the cache in stopRender()*/
+    QHash<QgsFeatureId, QgsFeatureId> mNewSeeds;
     /** Keeps track which features are selected */
     QSet<QgsFeatureId> mSelectedFeatures;
 
-    /** Creates a search rectangle with specified distance tolerance */
-    QgsRectangle searchRect( const QgsPoint& p, double distance ) const;
+    /** Returns the grid cell containing a point */
+    GridCell gridCell( const QgsPoint& p ) const;
+    /** Returns the index of the first group whose seed is within the search distance of a point, or -1 */
+    int findGroup( const QgsPoint& p ) const;
+    /** Returns true if two points are within the search distance of each other */
+    bool withinSearchDistance( const QgsPoint& p1, const QgsPoint& p2 ) const;
     /** This is a debugging function to check the entries in the displacement groups*/
     void printInfoDisplacementGroups();
 
@@ -261,7 +309,8 @@ class CORE_EXPORT QgsPointDisplacementRenderer: public QgsFeatureRendererV2
 
     //helper functions
     void calculateSymbolAndLabelPositions( QgsSymbolV2RenderContext &symbolContext, QPointF centerPoint, int nPosition, double symbolDiagonal, QList<QPointF>& symbolPositions, QList<QPointF>& labelShifts , double &circleRadius ) const;
-    void drawGroup( const DisplacementGroup& group, QgsRenderContext& context );
+    void drawGroup( const DisplacementGroup& group, const GroupInfo& info, QgsRenderContext& context );
+    void drawCluster( const QgsFeature& feature, QPointF centerPoint, int count, QgsSymbolV2RenderContext& context, bool selected );
     void drawCircle( double radiusPainterUnits, QgsSymbolV2RenderContext& context, QPointF centerPoint, int nSymbols );
     void drawSymbols( const QgsFeatureList& features, QgsRenderContext& context, const QList< QgsMarkerSymbolV2* >& symbolList, const QList<QPointF>& symbolPositions, bool selected = false );
     void drawLabels( QPointF centerPoint, QgsSymbolV2RenderContext& context, const QList<QPointF>& labelShifts, const QStringList& labelList );
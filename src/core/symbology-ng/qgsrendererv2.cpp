@@ -24,6 +24,7 @@
 #include "qgsrendererv2registry.h"
 
 #include "qgsrendercontext.h"
+#include "qgsrenderprofiler.h"
 #include "qgsclipper.h"
 #include "qgsgeometry.h"
 #include "qgsgeometrycollectionv2.h"
@@ -160,7 +161,11 @@ bool QgsFeatureRendererV2::filterNeedsGeometry() const
 
 bool QgsFeatureRendererV2::renderFeature( QgsFeature& feature, QgsRenderContext& context, int layer, bool selected, bool drawVertexMarker )
 {
-  QgsSymbolV2* symbol = symbolForFeature( feature, context );
+  QgsSymbolV2* symbol = nullptr;
+  {
+    QgsRenderProfilerScope profile( context, QgsRenderProfiler::ExpressionEvaluation );
+    symbol = symbolForFeature( feature, context );
+  }
   if ( !symbol )
     return false;
 
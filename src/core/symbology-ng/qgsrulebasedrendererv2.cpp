@@ -18,6 +18,7 @@
 #include "qgsexpression.h"
 #include "qgssymbollayerv2utils.h"
 #include "qgsrendercontext.h"
+#include "qgsrenderprofiler.h"
 #include "qgsvectorlayer.h"
 #include "qgslogger.h"
 #include "qgsogcutils.h"
@@ -842,7 +843,8 @@ bool QgsRuleBasedRendererV2::renderFeature( QgsFeature& feature,
   int flags = ( selected ? FeatIsSelected : 0 ) | ( drawVertexMarker ? FeatDrawMarkers : 0 );
   mCurrentFeatures.append( FeatureToRender( feature, flags ) );
 
-  // check each active rule
+  // check each active rule. Matching features are only queued here, they are drawn in stopRender()
+  QgsRenderProfilerScope profile( context, QgsRenderProfiler::ExpressionEvaluation );
   return mRootRule->renderFeature( mCurrentFeatures.last(), context, mRenderQueue ) == Rule::Rendered;
 }
 
@@ -23,6 +23,7 @@
 
 #include "qgslogger.h"
 #include "qgsrendercontext.h" // for bigSymbolPreview
+#include "qgsrenderprofiler.h"
 
 #include "qgsproject.h"
 #include "qgsstylev2.h"
@@ -107,8 +108,16 @@ QgsSymbolV2::QgsSymbolV2( SymbolType type, const QgsSymbolLayerV2List& layers )
   }
 }
 
+//! Names the symbol layer in a profiled symbol layer rendering stage
+static void setProfiledSymbolLayer( QgsRenderProfilerScope& profile, QgsSymbolV2* symbol, QgsSymbolLayerV2* layer )
+{
+  if ( profile.isActive() )
+    profile.setDetail( QString( "%1 %2" ).arg( layer->layerType() ).arg( symbol->symbolLayers().indexOf( layer ) + 1 ) );
+}
+
 QgsConstWkbPtr QgsSymbolV2::_getPoint( QPointF& pt, QgsRenderContext& context, QgsConstWkbPtr& wkbPtr )
 {
+  QgsRenderProfilerScope profile( context, QgsRenderProfiler::CoordinateTransform );
   QgsWKBTypes::Type type = wkbPtr.readHeader();
   wkbPtr >> pt.rx() >> pt.ry();
   wkbPtr += ( QgsWKBTypes::coordDimensions( type ) - 2 ) * sizeof( double );
@@ -126,6 +135,7 @@ QgsConstWkbPtr QgsSymbolV2::_getPoint( QPointF& pt, QgsRenderContext& context, Q
 
 QgsConstWkbPtr QgsSymbolV2::_getLineString( QPolygonF& pts, QgsRenderContext& context, QgsConstWkbPtr& wkbPtr, bool clipToExtent )
 {
+  QgsRenderProfilerScope profile( context, QgsRenderProfiler::Simplification );
   QgsWKBTypes::Type wkbType = wkbPtr.readHeader();
   unsigned int nPoints;
   wkbPtr >> nPoints;
@@ -159,6 +169,8 @@ QgsConstWkbPtr QgsSymbolV2::_getLineString( QPolygonF& pts, QgsRenderContext& co
     nPoints = pts.size();
   }
 
+  profile.setStage( QgsRenderProfiler::CoordinateTransform );
+
   //transform the QPolygonF to screen coordinates
   if ( ct )
   {
@@ -206,6 +218,7 @@ QgsConstWkbPtr QgsSymbolV2::_getPolygon( QPolygonF &pts, QList<QPolygonF> &holes
       return QgsConstWkbPtr( nullptr, 0 );
     }
 
+    QgsRenderProfilerScope profile( context, QgsRenderProfiler::Simplification );
     QPolygonF poly;
     wkbPtr -= sizeof( unsigned int );
     wkbPtr >> poly;
@@ -221,6 +234,8 @@ QgsConstWkbPtr QgsSymbolV2::_getPolygon( QPolygonF &pts, QList<QPolygonF> &holes
       QgsClipper::trimPolygon( poly, clipRect );
     }
 
+    profile.setStage( QgsRenderProfiler::CoordinateTransform );
+
     //transform the QPolygonF to screen coordinates
     if ( ct )
     {
@@ -661,6 +676,9 @@ void QgsSymbolV2::renderUsingLayer( QgsSymbolLayerV2* layer, QgsSymbolV2RenderCo
 {
   Q_ASSERT( layer->type() == Hybrid );
 
+  QgsRenderProfilerScope profile( context.renderContext(), QgsRenderProfiler::SymbolLayerRendering );
+  setProfiledSymbolLayer( profile, this, layer );
+
   QgsGeometryGeneratorSymbolLayerV2* generatorLayer = static_cast<QgsGeometryGeneratorSymbolLayerV2*>( layer );
 
   QgsPaintEffect* effect = generatorLayer->paintEffect();
@@ -1501,6 +1519,9 @@ void QgsMarkerSymbolV2::renderPointUsingLayer( QgsMarkerSymbolLayerV2* layer, QP
 {
   static QPointF nullPoint( 0, 0 );
 
+  QgsRenderProfilerScope profile( context.renderContext(), QgsRenderProfiler::SymbolLayerRendering );
+  setProfiledSymbolLayer( profile, this, layer );
+
   QgsPaintEffect* effect = layer->paintEffect();
   if ( effect && effect->enabled() )
   {
@@ -1768,6 +1789,9 @@ void QgsLineSymbolV2::renderPolyline( const QPolygonF& points, const QgsFeature*
 
 void QgsLineSymbolV2::renderPolylineUsingLayer( QgsLineSymbolLayerV2 *layer, const QPolygonF &points, QgsSymbolV2RenderContext &context )
 {
+  QgsRenderProfilerScope profile( context.renderContext(), QgsRenderProfiler::SymbolLayerRendering );
+  setProfiledSymbolLayer( profile, this, layer );
+
   QgsPaintEffect* effect = layer->paintEffect();
   if ( effect && effect->enabled() )
   {
@@ -1839,6 +1863,9 @@ void QgsFillSymbolV2::renderPolygonUsingLayer( QgsSymbolLayerV2* layer, const QP
 {
   QgsSymbolV2::SymbolType layertype = layer->type();
 
+  QgsRenderProfilerScope profile( context.renderContext(), QgsRenderProfiler::SymbolLayerRendering );
+  setProfiledSymbolLayer( profile, this, layer );
+
   QgsPaintEffect* effect = layer->paintEffect();
   if ( effect && effect->enabled() )
   {
@@ -60,6 +60,7 @@ email                : sherman at mrcc.com
 #include "qgsmessageviewer.h"
 #include "qgspallabeling.h"
 #include "qgsproject.h"
+#include "qgsrenderprofiler.h"
 #include "qgsrubberband.h"
 #include "qgsvectorlayer.h"
 #include "qgscursors.h"
@@ -209,6 +210,7 @@ QgsMapCanvas::QgsMapCanvas( QWidget * parent, const char *name )
     , mUseParallelRendering( false )
     , mDrawRenderingStats( false )
     , mCache( nullptr )
+    , mRenderProfiler( nullptr )
     , mResizeTimer( nullptr )
     , mPreviewEffect( nullptr )
     , mSnappingUtils( nullptr )
@@ -642,6 +644,16 @@ bool QgsMapCanvas::isParallelRenderingEnabled() const
   return mUseParallelRendering;
 }
 
+void QgsMapCanvas::setRenderProfiler( QgsRenderProfiler* profiler )
+{
+  mRenderProfiler = profiler;
+}
+
+QgsRenderProfiler* QgsMapCanvas::renderProfiler() const
+{
+  return mRenderProfiler;
+}
+
 void QgsMapCanvas::setMapUpdateInterval( int timeMiliseconds )
 {
   mMapUpdateTimer.setInterval( timeMiliseconds );
@@ -724,6 +736,10 @@ void QgsMapCanvas::refreshMap()
   connect( mJob, SIGNAL( finished() ), SLOT( rendererJobFinished() ) );
   mJob->setCache( mCache );
 
+  if ( mRenderProfiler )
+    mRenderProfiler->clear();
+  mJob->setProfiler( mRenderProfiler );
+
   QStringList layersForGeometryCache;
   Q_FOREACH ( const QString& id, mSettings.layers() )
   {
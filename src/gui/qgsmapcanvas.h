@@ -60,6 +60,7 @@ class QgsLabelingResults;
 class QgsMapRenderer;
 class QgsMapRendererCache;
 class QgsMapRendererQImageJob;
+class QgsRenderProfiler;
 class QgsMapSettings;
 class QgsMapCanvasMap;
 class QgsMapOverviewCanvas;
@@ -175,6 +176,18 @@ class GUI_EXPORT QgsMapCanvas : public QGraphicsView
     //! @note added in 2.4
     bool isParallelRenderingEnabled() const;
 
+    /** Sets a profiler which collects the time spent in the stages of rendering the canvas.
+     * The profiler is cleared whenever a new render job starts. Set to null to disable profiling.
+     * Ownership is not transferred.
+     * @note added in 2.18
+     */
+    void setRenderProfiler( QgsRenderProfiler* profiler );
+
+    /** Returns the profiler attached to canvas renders, or null if rendering is not profiled.
+     * @note added in 2.18
+     */
+    QgsRenderProfiler* renderProfiler() const;
+
     //! Set how often map preview should be updated while it is being rendered (in milliseconds)
     //! @note added in 2.4
     void setMapUpdateInterval( int timeMilliseconds );
@@ -773,6 +786,9 @@ class GUI_EXPORT QgsMapCanvas : public QGraphicsView
     //! Optionally use cache with rendered map layers for the current map settings
     QgsMapRendererCache* mCache;
 
+    //! Optional profiler for render jobs, not owned
+    QgsRenderProfiler* mRenderProfiler;
+
     QTimer *mResizeTimer;
 
     QgsPreviewEffect* mPreviewEffect;
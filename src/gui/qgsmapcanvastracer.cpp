@@ -35,7 +35,7 @@ QgsMapCanvasTracer::QgsMapCanvasTracer( QgsMapCanvas* canvas, QgsMessageBar* mes
   // when things change we just invalidate the graph - and set up new parameters again only when necessary
   connect( canvas, SIGNAL( destinationCrsChanged() ), this, SLOT( invalidateGraph() ) );
   connect( canvas, SIGNAL( layersChanged() ), this, SLOT( invalidateGraph() ) );
-  connect( canvas, SIGNAL( extentsChanged() ), this, SLOT( invalidateGraph() ) );
+  connect( canvas, SIGNAL( extentsChanged() ), this, SLOT( onExtentsChanged() ) );
   connect( canvas, SIGNAL( currentLayerChanged( QgsMapLayer* ) ), this, SLOT( onCurrentLayerChanged() ) );
   connect( canvas->snappingUtils(), SIGNAL( configChanged() ), this, SLOT( invalidateGraph() ) );
 
@@ -128,6 +128,15 @@ void QgsMapCanvasTracer::configure()
   setLayers( layers );
 }
 
+void QgsMapCanvasTracer::onExtentsChanged()
+{
+  invalidateGraph();
+
+  // start building the newly visible parts of the graph while the user is not tracing yet
+  if ( mActionEnableTracing && mActionEnableTracing->isChecked() )
+    prepareGraph();
+}
+
 void QgsMapCanvasTracer::onCurrentLayerChanged()
 {
   // no need to bother if we are not snapping
@@ -64,6 +64,7 @@ class GUI_EXPORT QgsMapCanvasTracer : public QgsTracer
     virtual void configure();
 
   private slots:
+    void onExtentsChanged();
     void onCurrentLayerChanged();
 
   private:
@@ -117,6 +117,7 @@ QgsPointDisplacementRendererWidget::QgsPointDisplacementRendererWidget( QgsVecto
   mDistanceUnitWidget->setMapUnitScale( mRenderer->toleranceMapUnitScale() );
 
   mPlacementComboBox->setCurrentIndex( mPlacementComboBox->findData( mRenderer->placement() ) );
+  mClusterThresholdSpinBox->setValue( mRenderer->clusterThreshold() );
 
   //scale dependent labelling
   mMaxScaleDenominatorEdit->setText( QString::number( mRenderer->maxLabelScaleDenominator() ) );
@@ -317,6 +318,15 @@ void QgsPointDisplacementRendererWidget::on_mDistanceUnitWidget_changed()
   }
 }
 
+void QgsPointDisplacementRendererWidget::on_mClusterThresholdSpinBox_valueChanged( int threshold )
+{
+  if ( mRenderer )
+  {
+    mRenderer->setClusterThreshold( threshold );
+    emit widgetChanged();
+  }
+}
+
 void QgsPointDisplacementRendererWidget::on_mScaleDependentLabelsCheckBox_stateChanged( int state )
 {
   if ( state == Qt::Unchecked )
@@ -361,6 +371,7 @@ void QgsPointDisplacementRendererWidget::blockAllSignals( bool block )
   mDistanceSpinBox->blockSignals( block );
   mDistanceUnitWidget->blockSignals( block );
   mPlacementComboBox->blockSignals( block );
+  mClusterThresholdSpinBox->blockSignals( block );
 }
 
 void QgsPointDisplacementRendererWidget::on_mCenterSymbolPushButton_clicked()
@@ -16,6 +16,7 @@
 #include "qgsgeometryengine.h"
 #include "qgsgeometrygapcheck.h"
 #include "qgsgeometrycollectionv2.h"
+#include "qgsgeometryunionengine.h"
 #include "../utils/qgsfeaturepool.h"
 
 
@@ -41,13 +42,10 @@ void QgsGeometryGapCheck::collectErrors( QList<QgsGeometryCheckError*>& errors,
     return;
   }
 
-  QgsGeometryEngine* geomEngine = QgsGeomUtils::createGeomEngine( nullptr, QgsGeometryCheckPrecision::tolerance() );
-
   // Create union of geometry
   QString errMsg;
-  QgsAbstractGeometryV2* unionGeom = geomEngine->combine( geomList, &errMsg );
+  QgsAbstractGeometryV2* unionGeom = QgsGeometryUnionEngine::unionGeometries( geomList, QgsGeometryCheckPrecision::tolerance(), &errMsg );
   qDeleteAll( geomList );
-  delete geomEngine;
   if ( !unionGeom )
   {
     messages.append( tr( "Gap check: %1" ).arg( errMsg ) );
@@ -55,7 +53,7 @@ void QgsGeometryGapCheck::collectErrors( QList<QgsGeometryCheckError*>& errors,
   }
 
   // Get envelope of union
-  geomEngine = QgsGeomUtils::createGeomEngine( unionGeom, QgsGeometryCheckPrecision::tolerance() );
+  QgsGeometryEngine* geomEngine = QgsGeomUtils::createGeomEngine( unionGeom, QgsGeometryCheckPrecision::tolerance() );
   QgsAbstractGeometryV2* envelope = geomEngine->envelope( &errMsg );
   delete geomEngine;
   if ( !envelope )
@@ -56,7 +56,39 @@ QFuture<void> QgsGeometryChecker::execute( int *totalSteps )
     }
   }
 
-  QFuture<void> future = QtConcurrent::map( mChecks, RunCheckWrapper( this ) );
+  // Feature checks process every feature independently, so they are run concurrently on
+  // spatially coherent chunks of features, which are prefetched from the layer in one request.
+  // Layer checks need all features at once.
+  mJobs.clear();
+  mChunkIds.clear();
+  mChunkExtents.clear();
+  CheckJob featureJob;
+  Q_FOREACH ( QgsGeometryCheck* check, mChecks )
+  {
+    if ( check->getCheckType() <= QgsGeometryCheck::FeatureCheck )
+    {
+      featureJob.checks.append( check );
+    }
+    else
+    {
+      CheckJob layerJob;
+      layerJob.checks.append( check );
+      layerJob.chunk = -1;
+      mJobs.append( layerJob );
+    }
+  }
+  if ( !featureJob.checks.isEmpty() )
+  {
+    Q_FOREACH ( const QgsFeaturePool::Chunk& chunk, mFeaturePool->getChunks( mFeaturePool->getFeatureIds() ) )
+    {
+      featureJob.chunk = mChunkIds.size();
+      mChunkIds.append( chunk.ids );
+      mChunkExtents.append( chunk.extent );
+      mJobs.append( featureJob );
+    }
+  }
+
+  QFuture<void> future = QtConcurrent::map( mJobs, RunCheckWrapper( this ) );
 
   QFutureWatcher<void>* watcher = new QFutureWatcher<void>();
   watcher->setFuture( future );
@@ -237,12 +269,20 @@ bool QgsGeometryChecker::fixError( QgsGeometryCheckError* error, int method )
   return true;
 }
 
-void QgsGeometryChecker::runCheck( const QgsGeometryCheck* check )
+void QgsGeometryChecker::runCheckJob( const CheckJob& job )
 {
   // Run checks
   QList<QgsGeometryCheckError*> errors;
   QStringList messages;
-  check->collectErrors( errors, messages, &mProgressCounter );
+  if ( job.chunk >= 0 )
+  {
+    mFeaturePool->prefetch( mChunkExtents.at( job.chunk ) );
+  }
+  Q_FOREACH ( const QgsGeometryCheck* check, job.checks )
+  {
+    // An empty id set means all features
+    check->collectErrors( errors, messages, &mProgressCounter, job.chunk >= 0 ? mChunkIds.at( job.chunk ) : QgsFeatureIds() );
+  }
   mErrorListMutex.lock();
   mCheckErrors.append( errors );
   mMessages.append( messages );
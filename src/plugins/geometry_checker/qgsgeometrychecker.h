@@ -21,6 +21,7 @@
 #include <QList>
 #include <QMutex>
 #include <QStringList>
+#include "qgsrectangle.h"
 
 typedef qint64 QgsFeatureId;
 typedef QSet<QgsFeatureId> QgsFeatureIds;
@@ -50,16 +51,27 @@ class QgsGeometryChecker : public QObject
     void progressValue( int value );
 
   private:
+    // Checks run on one chunk of features, or on the whole layer if chunk is -1
+    struct CheckJob
+    {
+      QList<const QgsGeometryCheck*> checks;
+      int chunk;
+    };
+
     class RunCheckWrapper
     {
       public:
+        typedef void result_type;
         explicit RunCheckWrapper( QgsGeometryChecker* instance ) : mInstance( instance ) {}
-        void operator()( const QgsGeometryCheck* check ) { mInstance->runCheck( check ); }
+        void operator()( const CheckJob& job ) { mInstance->runCheckJob( job ); }
       private:
         QgsGeometryChecker* mInstance;
     };
 
     QList<QgsGeometryCheck*> mChecks;
+    QList<QgsFeatureIds> mChunkIds;
+    QList<QgsRectangle> mChunkExtents;
+    QList<CheckJob> mJobs;
     QgsFeaturePool* mFeaturePool;
     QList<QgsGeometryCheckError*> mCheckErrors;
     QStringList mMessages;
@@ -67,7 +79,7 @@ class QgsGeometryChecker : public QObject
     int mMergeAttributeIndex;
     QAtomicInt mProgressCounter;
 
-    void runCheck( const QgsGeometryCheck* check );
+    void runCheckJob( const CheckJob& job );
 
   private slots:
     void emitProgressValue();
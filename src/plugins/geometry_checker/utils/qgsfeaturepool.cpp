@@ -22,11 +22,12 @@
 #include "qgsgeomutils.h"
 
 #include <QMutexLocker>
+#include <QThread>
 #include <qmath.h>
 #include <limits>
 
 QgsFeaturePool::QgsFeaturePool( QgsVectorLayer *layer, bool selectedOnly )
-    : mFeatureCache( sCacheSize )
+    : mCacheCapacity( qMax( sCacheSize, 4 * QThread::idealThreadCount() * sChunkSize ) )
     , mLayer( layer )
     , mSelectedOnly( selectedOnly )
 {
@@ -50,31 +51,160 @@ QgsFeaturePool::QgsFeaturePool( QgsVectorLayer *layer, bool selectedOnly )
   }
 }
 
+QgsFeaturePool::~QgsFeaturePool()
+{
+  qDeleteAll( mFeatureCache );
+}
+
 bool QgsFeaturePool::get( QgsFeatureId id , QgsFeature& feature )
 {
-  QMutexLocker lock( &mLayerMutex );
-  QgsFeature* pfeature = mFeatureCache.object( id );
-  if ( pfeature )
   {
-    //feature was cached
-    feature = *pfeature;
+    QReadLocker lock( &mCacheLock );
+    QgsFeature* pfeature = mFeatureCache.value( id );
+    if ( pfeature )
+    {
+      //feature was cached
+      feature = *pfeature;
+      return true;
+    }
   }
 
   // Feature not in cache, retrieve from layer
-  pfeature = new QgsFeature();
-  // TODO: avoid always querying all attributes (attribute values are needed when merging by attribute)
-  if ( !mLayer->getFeatures( QgsFeatureRequest( id ) ).nextFeature( *pfeature ) )
+  QgsFeature* pfeature = new QgsFeature();
   {
-    delete pfeature;
-    return false;
+    QMutexLocker lock( &mLayerMutex );
+    // TODO: avoid always querying all attributes (attribute values are needed when merging by attribute)
+    if ( !mLayer->getFeatures( QgsFeatureRequest( id ) ).nextFeature( *pfeature ) )
+    {
+      delete pfeature;
+      return false;
+    }
   }
   //make a copy of pfeature into feature parameter
   feature = QgsFeature( *pfeature );
   //ownership of pfeature is transferred to cache
-  mFeatureCache.insert( id, pfeature );
+  QWriteLocker lock( &mCacheLock );
+  insertCached( pfeature );
   return true;
 }
 
+void QgsFeaturePool::prefetch( const QgsRectangle& rect )
+{
+  if ( rect.isNull() )
+  {
+    return;
+  }
+
+  // Fetch all features of the area with one request instead of one request per feature
+  QList<QgsFeature*> features;
+  {
+    QMutexLocker lock( &mLayerMutex );
+    QgsFeatureIterator it = mLayer->getFeatures( QgsFeatureRequest( rect ) );
+    QgsFeature feature;
+    while ( it.nextFeature( feature ) )
+    {
+      features.append( new QgsFeature( feature ) );
+    }
+  }
+
+  QWriteLocker lock( &mCacheLock );
+  Q_FOREACH ( QgsFeature* feature, features )
+  {
+    insertCached( feature );
+  }
+}
+
+QList<QgsFeaturePool::Chunk> QgsFeaturePool::getChunks( const QgsFeatureIds& ids )
+{
+  QList<Chunk> chunks;
+  QgsFeatureIds remaining = ids;
+
+  QgsRectangle extent;
+  {
+    QMutexLocker lock( &mLayerMutex );
+    extent = mLayer->extent();
+  }
+  if ( !extent.isEmpty() )
+  {
+    // Avoid losing features on the border of the extent
+    extent.grow( 1E-6 * qMax( extent.width(), extent.height() ) );
+    collectChunks( extent, remaining, chunks, 0 );
+  }
+
+  // Features which are not in the index (e.g. without geometry)
+  Chunk chunk;
+  Q_FOREACH ( QgsFeatureId id, remaining )
+  {
+    chunk.ids.insert( id );
+    if ( chunk.ids.size() == sChunkSize )
+    {
+      chunks.append( chunk );
+      chunk.ids.clear();
+    }
+  }
+  if ( !chunk.ids.isEmpty() )
+  {
+    chunks.append( chunk );
+  }
+  return chunks;
+}
+
+void QgsFeaturePool::collectChunks( const QgsRectangle& cell, QgsFeatureIds& remaining, QList<Chunk>& chunks, int depth )
+{
+  // Quadtree subdivision until a cell holds at most sChunkSize features. Features intersecting
+  // several cells go to the first one.
+  QgsFeatureIds cellIds = getIntersects( cell ).intersect( remaining );
+  if ( cellIds.isEmpty() )
+  {
+    return;
+  }
+  if ( cellIds.size() > sChunkSize && depth < 16 )
+  {
+    double xMid = 0.5 * ( cell.xMinimum() + cell.xMaximum() );
+    double yMid = 0.5 * ( cell.yMinimum() + cell.yMaximum() );
+    collectChunks( QgsRectangle( cell.xMinimum(), cell.yMinimum(), xMid, yMid ), remaining, chunks, depth + 1 );
+    collectChunks( QgsRectangle( xMid, cell.yMinimum(), cell.xMaximum(), yMid ), remaining, chunks, depth + 1 );
+    collectChunks( QgsRectangle( xMid, yMid, cell.xMaximum(), cell.yMaximum() ), remaining, chunks, depth + 1 );
+    collectChunks( QgsRectangle( cell.xMinimum(), yMid, xMid, cell.yMaximum() ), remaining, chunks, depth + 1 );
+    return;
+  }
+  remaining.subtract( cellIds );
+  Chunk chunk;
+  chunk.extent = cell;
+  chunk.ids = cellIds;
+  chunks.append( chunk );
+}
+
+void QgsFeaturePool::insertCached( QgsFeature* feature )
+{
+  QgsFeature*& entry = mFeatureCache[feature->id()];
+  if ( entry )
+  {
+    delete entry;
+  }
+  else
+  {
+    mCacheOrder.enqueue( feature->id() );
+  }
+  entry = feature;
+
+  while ( mFeatureCache.size() > mCacheCapacity && !mCacheOrder.isEmpty() )
+  {
+    delete mFeatureCache.take( mCacheOrder.dequeue() );
+  }
+}
+
+void QgsFeaturePool::removeCached( QgsFeatureId id )
+{
+  QgsFeature* feature = mFeatureCache.take( id );
+  if ( feature )
+  {
+    delete feature;
+    // a stale entry would evict the feature early once it is cached again
+    mCacheOrder.removeOne( id );
+  }
+}
+
 void QgsFeaturePool::addFeature( QgsFeature& feature )
 {
   QgsFeatureList features;
@@ -105,8 +235,10 @@ void QgsFeaturePool::updateFeature( QgsFeature& feature )
     attribMap.insert( i, feature.attributes().at( i ) );
   }
   changedAttributesMap.insert( feature.id(), attribMap );
+  mCacheLock.lockForWrite();
+  removeCached( feature.id() ); // Remove to force reload on next get()
+  mCacheLock.unlock();
   mLayerMutex.lock();
-  mFeatureCache.remove( feature.id() ); // Remove to force reload on next get()
   mLayer->dataProvider()->changeGeometryValues( geometryMap );
   mLayer->dataProvider()->changeAttributeValues( changedAttributesMap );
   mLayerMutex.unlock();
@@ -121,8 +253,10 @@ void QgsFeaturePool::deleteFeature( QgsFeature& feature )
   mIndexMutex.lock();
   mIndex.deleteFeature( feature );
   mIndexMutex.unlock();
+  mCacheLock.lockForWrite();
+  removeCached( feature.id() );
+  mCacheLock.unlock();
   mLayerMutex.lock();
-  mFeatureCache.remove( feature.id() );
   mLayer->dataProvider()->deleteFeatures( QgsFeatureIds() << feature.id() );
   mLayerMutex.unlock();
 }
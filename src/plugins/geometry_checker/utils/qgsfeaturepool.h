@@ -17,10 +17,12 @@
 #ifndef QGS_FEATUREPOOL_H
 #define QGS_FEATUREPOOL_H
 
-#include <QCache>
+#include <QHash>
 #include <QLinkedList>
 #include <QMap>
 #include <QMutex>
+#include <QQueue>
+#include <QReadWriteLock>
 #include "qgsfeature.h"
 #include "qgsspatialindex.h"
 #include "qgsgeomutils.h"
@@ -30,8 +32,18 @@ class QgsVectorLayer;
 class QgsFeaturePool
 {
   public:
+    //! Spatially coherent group of features, processed together by the checks
+    struct Chunk
+    {
+      QgsRectangle extent; // Area to prefetch, null if the features have no common extent
+      QgsFeatureIds ids;
+    };
+
     QgsFeaturePool( QgsVectorLayer* layer, bool selectedOnly = false );
+    ~QgsFeaturePool();
     bool get( QgsFeatureId id, QgsFeature& feature );
+    void prefetch( const QgsRectangle& rect );
+    QList<Chunk> getChunks( const QgsFeatureIds& ids );
     void addFeature( QgsFeature &feature );
     void updateFeature( QgsFeature &feature );
     void deleteFeature( QgsFeature &feature );
@@ -53,8 +65,13 @@ class QgsFeaturePool
     };
 
     static const int sCacheSize = 1000;
+    static const int sChunkSize = 512;
 
-    QCache<QgsFeatureId, QgsFeature> mFeatureCache;
+    // Cached features, evicted in insertion order so that lookups only need a read lock
+    QHash<QgsFeatureId, QgsFeature*> mFeatureCache;
+    QQueue<QgsFeatureId> mCacheOrder;
+    int mCacheCapacity;
+    QReadWriteLock mCacheLock;
     QgsVectorLayer* mLayer;
     QgsFeatureIds mFeatureIds;
     QMutex mLayerMutex;
@@ -62,6 +79,9 @@ class QgsFeaturePool
     QgsSpatialIndex mIndex;
     bool mSelectedOnly;
 
+    void insertCached( QgsFeature* feature );
+    void removeCached( QgsFeatureId id );
+    void collectChunks( const QgsRectangle& cell, QgsFeatureIds& remaining, QList<Chunk>& chunks, int depth );
     bool getTouchingWithSharedEdge( QgsFeature &feature, QgsFeatureId &touchingId, const double& ( *comparator )( const double&, const double& ), double init );
 };
 
@@ -39,15 +39,19 @@ QgsGeometrySnapper::QgsGeometrySnapper( QgsVectorLayer *adjustLayer, QgsVectorLa
     mFeatures = mAdjustLayer->allFeatureIds();
   }
 
-  // Build spatial index
+  // Build the reference index once, the workers then share it without locking
   QgsFeature feature;
   QgsFeatureRequest req;
   req.setSubsetOfAttributes( QgsAttributeList() );
   QgsFeatureIterator it = mReferenceLayer->getFeatures( req );
   while ( it.nextFeature( feature ) )
   {
-    mIndex.insertFeature( feature );
+    if ( feature.constGeometry() && feature.constGeometry()->geometry() )
+    {
+      mReferenceIndex.addGeometry( feature.constGeometry()->geometry() );
+    }
   }
+  mReferenceIndex.build();
 }
 
 QFuture<void> QgsGeometrySnapper::processFeatures()
@@ -75,31 +79,6 @@ void QgsGeometrySnapper::processFeature( QgsFeatureId id )
   double snapTolerance = mSnapToleranceMapUnits / layerToMapUnits;
 
 
-  // Get potential reference features and construct snap index
-  QList<QgsAbstractGeometryV2*> refGeometries;
-  mIndexMutex.lock();
-  QList<QgsFeatureId> refFeatureIds = mIndex.intersects( feature.geometry()->boundingBox() );
-  mIndexMutex.unlock();
-  Q_FOREACH ( QgsFeatureId refId, refFeatureIds )
-  {
-    QgsFeature refFeature;
-    if ( getFeature( mReferenceLayer, mReferenceLayerMutex, refId, refFeature ) )
-    {
-      refGeometries.append( refFeature.geometry()->geometry()->clone() );
-    }
-    else
-    {
-      mErrorMutex.lock();
-      mErrors.append( tr( "Failed to read feature %1 of input layer." ).arg( refId ) );
-      mErrorMutex.unlock();
-    }
-  }
-  QgsSnapIndex refSnapIndex( center, 10 * snapTolerance );
-  Q_FOREACH ( const QgsAbstractGeometryV2* geom, refGeometries )
-  {
-    refSnapIndex.addGeometry( geom );
-  }
-
   // Snap geometries
   QgsAbstractGeometryV2* subjGeom = feature.geometry()->geometry();
   QList < QList< QList<PointFlag> > > subjPointFlags;
@@ -116,27 +95,19 @@ void QgsGeometrySnapper::processFeature( QgsFeatureId id )
       for ( int iVert = 0, nVerts = polyLineSize( subjGeom, iPart, iRing ); iVert < nVerts; ++iVert )
       {
 
-        QgsSnapIndex::PointSnapItem* snapPoint = nullptr;
-        QgsSnapIndex::SegmentSnapItem* snapSegment = nullptr;
         QgsVertexId vidx( iPart, iRing, iVert );
         QgsPointV2 p = subjGeom->vertexAt( vidx );
-        if ( !refSnapIndex.getSnapItem( p, snapTolerance, &snapPoint, &snapSegment ) )
+        QgsPointV2 snapPoint;
+        QgsSnapIndex::SnapType snapType;
+        if ( !mReferenceIndex.getSnapPoint( p, snapTolerance, snapPoint, snapType ) )
         {
           subjPointFlags[iPart][iRing].append( Unsnapped );
         }
         else
         {
-          // Prefer snapping to point
-          if ( snapPoint )
-          {
-            subjGeom->moveVertex( vidx, snapPoint->getSnapPoint( p ) );
-            subjPointFlags[iPart][iRing].append( SnappedToRefNode );
-          }
-          else if ( snapSegment )
-          {
-            subjGeom->moveVertex( vidx, snapSegment->getSnapPoint( p ) );
-            subjPointFlags[iPart][iRing].append( SnappedToRefSegment );
-          }
+          // Snapping to point is preferred by the index
+          subjGeom->moveVertex( vidx, snapPoint );
+          subjPointFlags[iPart][iRing].append( snapType == QgsSnapIndex::SnapPoint ? SnappedToRefNode : SnappedToRefSegment );
         }
       }
     }
@@ -151,50 +122,42 @@ void QgsGeometrySnapper::processFeature( QgsFeatureId id )
   origSubjSnapIndex->addGeometry( origSubjGeom );
 
   // Pass 2: add missing vertices to subject geometry
-  Q_FOREACH ( const QgsAbstractGeometryV2* refGeom, refGeometries )
+  QgsRectangle refRect = subjGeom->boundingBox();
+  refRect.grow( snapTolerance );
+  Q_FOREACH ( int refVertex, mReferenceIndex.getVertices( refRect ) )
   {
-    for ( int iPart = 0, nParts = refGeom->partCount(); iPart < nParts; ++iPart )
+    QgsSnapIndex::PointSnapItem* snapPoint = nullptr;
+    QgsSnapIndex::SegmentSnapItem* snapSegment = nullptr;
+    QgsPointV2 point = mReferenceIndex.vertex( refVertex );
+    if ( subjSnapIndex->getSnapItem( point, snapTolerance, &snapPoint, &snapSegment ) )
     {
-      for ( int iRing = 0, nRings = refGeom->ringCount( iPart ); iRing < nRings; ++iRing )
+      // Snap to segment, unless a subject point was already snapped to the reference point
+      if ( snapPoint && QgsGeometryUtils::sqrDistance2D( snapPoint->getSnapPoint( point ), point ) < 1E-16 )
+      {
+        continue;
+      }
+      else if ( snapSegment )
       {
-        for ( int iVert = 0, nVerts = polyLineSize( refGeom, iPart, iRing ); iVert < nVerts; ++iVert )
+        // Look if there is a closer reference segment, if so, ignore this point
+        QgsPointV2 pProj = snapSegment->getSnapPoint( point );
+        QgsPointV2 closest = mReferenceIndex.getClosestSnapToPoint( point, pProj );
+        if ( QgsGeometryUtils::sqrDistance2D( pProj, point ) > QgsGeometryUtils::sqrDistance2D( pProj, closest ) )
         {
+          continue;
+        }
 
-          QgsSnapIndex::PointSnapItem* snapPoint = nullptr;
-          QgsSnapIndex::SegmentSnapItem* snapSegment = nullptr;
-          QgsPointV2 point = refGeom->vertexAt( QgsVertexId( iPart, iRing, iVert ) );
-          if ( subjSnapIndex->getSnapItem( point, snapTolerance, &snapPoint, &snapSegment ) )
-          {
-            // Snap to segment, unless a subject point was already snapped to the reference point
-            if ( snapPoint && QgsGeometryUtils::sqrDistance2D( snapPoint->getSnapPoint( point ), point ) < 1E-16 )
-            {
-              continue;
-            }
-            else if ( snapSegment )
-            {
-              // Look if there is a closer reference segment, if so, ignore this point
-              QgsPointV2 pProj = snapSegment->getSnapPoint( point );
-              QgsPointV2 closest = refSnapIndex.getClosestSnapToPoint( point, pProj );
-              if ( QgsGeometryUtils::sqrDistance2D( pProj, point ) > QgsGeometryUtils::sqrDistance2D( pProj, closest ) )
-              {
-                continue;
-              }
-
-              // If we are too far away from the original geometry, do nothing
-              if ( !origSubjSnapIndex->getSnapItem( point, snapTolerance ) )
-              {
-                continue;
-              }
-
-              const QgsSnapIndex::CoordIdx* idx = snapSegment->idxFrom;
-              subjGeom->insertVertex( QgsVertexId( idx->vidx.part, idx->vidx.ring, idx->vidx.vertex + 1 ), point );
-              subjPointFlags[idx->vidx.part][idx->vidx.ring].insert( idx->vidx.vertex + 1, SnappedToRefNode );
-              delete subjSnapIndex;
-              subjSnapIndex = new QgsSnapIndex( center, 10 * snapTolerance );
-              subjSnapIndex->addGeometry( subjGeom );
-            }
-          }
+        // If we are too far away from the original geometry, do nothing
+        if ( !origSubjSnapIndex->getSnapItem( point, snapTolerance ) )
+        {
+          continue;
         }
+
+        const QgsSnapIndex::CoordIdx* idx = snapSegment->idxFrom;
+        subjGeom->insertVertex( QgsVertexId( idx->vidx.part, idx->vidx.ring, idx->vidx.vertex + 1 ), point );
+        subjPointFlags[idx->vidx.part][idx->vidx.ring].insert( idx->vidx.vertex + 1, SnappedToRefNode );
+        delete subjSnapIndex;
+        subjSnapIndex = new QgsSnapIndex( center, 10 * snapTolerance );
+        subjSnapIndex->addGeometry( subjGeom );
       }
     }
   }
@@ -231,7 +194,6 @@ void QgsGeometrySnapper::processFeature( QgsFeatureId id )
   feature.setGeometry( new QgsGeometry( feature.geometry()->geometry()->clone() ) ); // force refresh
   QgsGeometryMap geometryMap;
   geometryMap.insert( id, *feature.geometry() );
-  qDeleteAll( refGeometries );
   mAdjustLayerMutex.lock();
   mAdjustLayer->dataProvider()->changeGeometryValues( geometryMap );
   mAdjustLayerMutex.unlock();
@@ -20,7 +20,8 @@
 #include <QMutex>
 #include <QFuture>
 #include <QStringList>
-#include "qgsspatialindex.h"
+#include "qgsfeature.h"
+#include "qgssnapindex.h"
 
 class QgsMapSettings;
 class QgsVectorLayer;
@@ -54,12 +55,10 @@ class QgsGeometrySnapper : public QObject
     double mSnapToleranceMapUnits;
     const QgsMapSettings* mMapSettings;
     QgsFeatureIds mFeatures;
-    QgsSpatialIndex mIndex;
+    QgsPackedSnapIndex mReferenceIndex;
     QStringList mErrors;
     QMutex mErrorMutex;
-    QMutex mIndexMutex;
     QMutex mAdjustLayerMutex;
-    QMutex mReferenceLayerMutex;
 
     void processFeature( QgsFeatureId id );
     bool getFeature( QgsVectorLayer* layer, QMutex& mutex, QgsFeatureId id, QgsFeature& feature );
@@ -18,6 +18,7 @@
 #include "qgsgeometryutils.h"
 #include <qmath.h>
 #include <limits>
+#include <algorithm>
 
 QgsSnapIndex::PointSnapItem::PointSnapItem( const QgsSnapIndex::CoordIdx* _idx )
     : SnapItem( QgsSnapIndex::SnapPoint )
@@ -44,54 +45,12 @@ QgsPointV2 QgsSnapIndex::SegmentSnapItem::getSnapPoint( const QgsPointV2 &p ) co
 
 bool QgsSnapIndex::SegmentSnapItem::getIntersection( const QgsPointV2 &p1, const QgsPointV2 &p2, QgsPointV2& inter ) const
 {
-  const QgsPointV2& q1 = idxFrom->point(), & q2 = idxTo->point();
-  QgsVector v( p2.x() - p1.x(), p2.y() - p1.y() );
-  QgsVector w( q2.x() - q1.x(), q2.y() - q1.y() );
-  double vl = v.length();
-  double wl = w.length();
-
-  if ( qFuzzyIsNull( vl ) || qFuzzyIsNull( wl ) )
-  {
-    return false;
-  }
-  v = v / vl;
-  w = w / wl;
-
-  double d = v.y() * w.x() - v.x() * w.y();
-
-  if ( d == 0 )
-    return false;
-
-  double dx = q1.x() - p1.x();
-  double dy = q1.y() - p1.y();
-  double k = ( dy * w.x() - dx * w.y() ) / d;
-
-  inter = QgsPointV2( p1.x() + v.x() * k, p1.y() + v.y() * k );
-
-  double lambdav = QgsVector( inter.x() - p1.x(), inter.y() - p1.y() ) *  v;
-  if ( lambdav < 0. + 1E-8 || lambdav > vl - 1E-8 )
-    return false;
-
-  double lambdaw = QgsVector( inter.x() - q1.x(), inter.y() - q1.y() ) * w;
-  if ( lambdaw < 0. + 1E-8 || lambdaw >= wl - 1E-8 )
-    return false;
-
-  return true;
+  return QgsSnapIndex::segmentIntersection( p1, p2, idxFrom->point(), idxTo->point(), inter );
 }
 
 bool QgsSnapIndex::SegmentSnapItem::getProjection( const QgsPointV2 &p, QgsPointV2 &pProj )
 {
-  const QgsPointV2& s1 = idxFrom->point();
-  const QgsPointV2& s2 = idxTo->point();
-  double nx = s2.y() - s1.y();
-  double ny = -( s2.x() - s1.x() );
-  double t = ( p.x() * ny - p.y() * nx - s1.x() * ny + s1.y() * nx ) / (( s2.x() - s1.x() ) * ny - ( s2.y() - s1.y() ) * nx );
-  if ( t < 0. || t > 1. )
-  {
-    return false;
-  }
-  pProj = QgsPointV2( s1.x() + ( s2.x() - s1.x() ) * t, s1.y() + ( s2.y() - s1.y() ) * t );
-  return true;
+  return QgsSnapIndex::segmentProjection( p, idxFrom->point(), idxTo->point(), pProj );
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -432,3 +391,329 @@ QgsSnapIndex::SnapItem* QgsSnapIndex::getSnapItem( const QgsPointV2& pos, double
   if ( pSnapSegment ) *pSnapSegment = snapSegment;
   return minDistPoint < minDistSegment ? static_cast<QgsSnapIndex::SnapItem*>( snapPoint ) : static_cast<QgsSnapIndex::SnapItem*>( snapSegment );
 }
+
+bool QgsSnapIndex::segmentIntersection( const QgsPointV2& p1, const QgsPointV2& p2, const QgsPointV2& q1, const QgsPointV2& q2, QgsPointV2& inter )
+{
+  QgsVector v( p2.x() - p1.x(), p2.y() - p1.y() );
+  QgsVector w( q2.x() - q1.x(), q2.y() - q1.y() );
+  double vl = v.length();
+  double wl = w.length();
+
+  if ( qFuzzyIsNull( vl ) || qFuzzyIsNull( wl ) )
+  {
+    return false;
+  }
+  v = v / vl;
+  w = w / wl;
+
+  double d = v.y() * w.x() - v.x() * w.y();
+
+  if ( d == 0 )
+    return false;
+
+  double dx = q1.x() - p1.x();
+  double dy = q1.y() - p1.y();
+  double k = ( dy * w.x() - dx * w.y() ) / d;
+
+  inter = QgsPointV2( p1.x() + v.x() * k, p1.y() + v.y() * k );
+
+  double lambdav = QgsVector( inter.x() - p1.x(), inter.y() - p1.y() ) *  v;
+  if ( lambdav < 0. + 1E-8 || lambdav > vl - 1E-8 )
+    return false;
+
+  double lambdaw = QgsVector( inter.x() - q1.x(), inter.y() - q1.y() ) * w;
+  if ( lambdaw < 0. + 1E-8 || lambdaw >= wl - 1E-8 )
+    return false;
+
+  return true;
+}
+
+bool QgsSnapIndex::segmentProjection( const QgsPointV2& p, const QgsPointV2& s1, const QgsPointV2& s2, QgsPointV2& pProj )
+{
+  double nx = s2.y() - s1.y();
+  double ny = -( s2.x() - s1.x() );
+  double t = ( p.x() * ny - p.y() * nx - s1.x() * ny + s1.y() * nx ) / (( s2.x() - s1.x() ) * ny - ( s2.y() - s1.y() ) * nx );
+  if ( t < 0. || t > 1. )
+  {
+    return false;
+  }
+  pProj = QgsPointV2( s1.x() + ( s2.x() - s1.x() ) * t, s1.y() + ( s2.y() - s1.y() ) * t );
+  return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+struct SegmentCenterXLessThan
+{
+  explicit SegmentCenterXLessThan( const QVector<double>& centers ) : mCenters( centers ) {}
+  bool operator()( int a, int b ) const { return mCenters[2 * a] < mCenters[2 * b]; }
+  const QVector<double>& mCenters;
+};
+
+struct SegmentCenterYLessThan
+{
+  explicit SegmentCenterYLessThan( const QVector<double>& centers ) : mCenters( centers ) {}
+  bool operator()( int a, int b ) const { return mCenters[2 * a + 1] < mCenters[2 * b + 1]; }
+  const QVector<double>& mCenters;
+};
+
+QgsPackedSnapIndex::QgsPackedSnapIndex()
+{
+}
+
+void QgsPackedSnapIndex::addGeometry( const QgsAbstractGeometryV2* geom )
+{
+  for ( int iPart = 0, nParts = geom->partCount(); iPart < nParts; ++iPart )
+  {
+    for ( int iRing = 0, nRings = geom->ringCount( iPart ); iRing < nRings; ++iRing )
+    {
+      int nVerts = geom->vertexCount( iPart, iRing );
+      if ( nVerts < 2 )
+      {
+        continue;
+      }
+
+      // Closed rings store their first vertex only once
+      QgsPointV2 front = geom->vertexAt( QgsVertexId( iPart, iRing, 0 ) );
+      QgsPointV2 back = geom->vertexAt( QgsVertexId( iPart, iRing, nVerts - 1 ) );
+      bool closed = front == back;
+      int nStored = closed ? nVerts - 1 : nVerts;
+
+      int first = mX.size();
+      for ( int iVert = 0; iVert < nStored; ++iVert )
+      {
+        QgsPointV2 p = geom->vertexAt( QgsVertexId( iPart, iRing, iVert ) );
+        mX.append( p.x() );
+        mY.append( p.y() );
+      }
+      for ( int iVert = 0; iVert < nVerts - 1; ++iVert )
+      {
+        mSegmentFrom.append( first + iVert );
+        mSegmentTo.append( first + ( iVert + 1 ) % nStored );
+      }
+    }
+  }
+}
+
+QgsPackedSnapIndex::Box QgsPackedSnapIndex::segmentBox( int segment ) const
+{
+  int from = mSegmentFrom[segment];
+  int to = mSegmentTo[segment];
+  Box box = { qMin( mX[from], mX[to] ), qMin( mY[from], mY[to] ), qMax( mX[from], mX[to] ), qMax( mY[from], mY[to] ) };
+  return box;
+}
+
+void QgsPackedSnapIndex::build()
+{
+  mLevels.clear();
+  int nSegments = mSegmentFrom.size();
+  if ( nSegments == 0 )
+  {
+    return;
+  }
+
+  // Sort-Tile-Recursive packing: sort the segments by x into vertical slices, and each slice by y
+  QVector<double> centers( 2 * nSegments );
+  for ( int i = 0; i < nSegments; ++i )
+  {
+    Box box = segmentBox( i );
+    centers[2 * i] = 0.5 * ( box.xMin + box.xMax );
+    centers[2 * i + 1] = 0.5 * ( box.yMin + box.yMax );
+  }
+  QVector<int> order( nSegments );
+  for ( int i = 0; i < nSegments; ++i )
+  {
+    order[i] = i;
+  }
+  std::sort( order.begin(), order.end(), SegmentCenterXLessThan( centers ) );
+
+  int nLeaves = ( nSegments + sNodeCapacity - 1 ) / sNodeCapacity;
+  int nSlices = qCeil( qSqrt( nLeaves ) );
+  int sliceSize = nSlices * sNodeCapacity;
+  for ( int start = 0; start < nSegments; start += sliceSize )
+  {
+    std::sort( order.begin() + start, order.begin() + qMin( start + sliceSize, nSegments ), SegmentCenterYLessThan( centers ) );
+  }
+
+  QVector<int> segmentFrom( nSegments );
+  QVector<int> segmentTo( nSegments );
+  for ( int i = 0; i < nSegments; ++i )
+  {
+    segmentFrom[i] = mSegmentFrom[order[i]];
+    segmentTo[i] = mSegmentTo[order[i]];
+  }
+  mSegmentFrom = segmentFrom;
+  mSegmentTo = segmentTo;
+
+  QVector<Box> boxes( nSegments );
+  for ( int i = 0; i < nSegments; ++i )
+  {
+    boxes[i] = segmentBox( i );
+  }
+  mLevels.append( boxes );
+
+  // Group the boxes of each level into the nodes of the next level, up to a single root
+  while ( mLevels.last().size() > 1 )
+  {
+    const QVector<Box>& children = mLevels.last();
+    QVector<Box> nodes;
+    nodes.reserve(( children.size() + sNodeCapacity - 1 ) / sNodeCapacity );
+    for ( int start = 0; start < children.size(); start += sNodeCapacity )
+    {
+      Box node = children[start];
+      for ( int i = start + 1, end = qMin( start + sNodeCapacity, children.size() ); i < end; ++i )
+      {
+        node.xMin = qMin( node.xMin, children[i].xMin );
+        node.yMin = qMin( node.yMin, children[i].yMin );
+        node.xMax = qMax( node.xMax, children[i].xMax );
+        node.yMax = qMax( node.yMax, children[i].yMax );
+      }
+      nodes.append( node );
+    }
+    mLevels.append( nodes );
+  }
+}
+
+void QgsPackedSnapIndex::getSegments( const Box& box, QVector<int>& segments ) const
+{
+  if ( mLevels.isEmpty() )
+  {
+    return;
+  }
+  getSegments( mLevels.size() - 1, 0, box, segments );
+}
+
+void QgsPackedSnapIndex::getSegments( int level, int node, const Box& box, QVector<int>& segments ) const
+{
+  if ( !mLevels[level][node].intersects( box ) )
+  {
+    return;
+  }
+  if ( level == 0 )
+  {
+    segments.append( node );
+    return;
+  }
+  for ( int child = node * sNodeCapacity, end = qMin( child + sNodeCapacity, mLevels[level - 1].size() ); child < end; ++child )
+  {
+    getSegments( level - 1, child, box, segments );
+  }
+}
+
+QVector<int> QgsPackedSnapIndex::getVertices( const QgsRectangle& rect ) const
+{
+  Box box = { rect.xMinimum(), rect.yMinimum(), rect.xMaximum(), rect.yMaximum() };
+  QVector<int> segments;
+  getSegments( box, segments );
+
+  QVector<int> vertices;
+  vertices.reserve( 2 * segments.size() );
+  Q_FOREACH ( int segment, segments )
+  {
+    vertices.append( mSegmentFrom[segment] );
+    vertices.append( mSegmentTo[segment] );
+  }
+  std::sort( vertices.begin(), vertices.end() );
+  vertices.erase( std::unique( vertices.begin(), vertices.end() ), vertices.end() );
+
+  // Keep the vertices within the rectangle, in the order they were added
+  QVector<int> result;
+  result.reserve( vertices.size() );
+  Q_FOREACH ( int vertex, vertices )
+  {
+    if ( mX[vertex] >= box.xMin && mX[vertex] <= box.xMax && mY[vertex] >= box.yMin && mY[vertex] <= box.yMax )
+    {
+      result.append( vertex );
+    }
+  }
+  return result;
+}
+
+QgsPointV2 QgsPackedSnapIndex::getClosestSnapToPoint( const QgsPointV2& p, const QgsPointV2& q ) const
+{
+  // Look for intersections on segment from the target point to the point opposite to the point reference point
+  // p2 =  p1 + 2 * (q - p1)
+  QgsPointV2 p2( 2 * q.x() - p.x(), 2 * q.y() - p.y() );
+
+  Box box = { qMin( p.x(), p2.x() ), qMin( p.y(), p2.y() ), qMax( p.x(), p2.x() ), qMax( p.y(), p2.y() ) };
+  QVector<int> segments;
+  getSegments( box, segments );
+
+  double dMin = std::numeric_limits<double>::max();
+  QgsPointV2 pMin = p;
+  Q_FOREACH ( int segment, segments )
+  {
+    QgsPointV2 inter;
+    if ( QgsSnapIndex::segmentIntersection( p, p2, vertex( mSegmentFrom[segment] ), vertex( mSegmentTo[segment] ), inter ) )
+    {
+      double dist = QgsGeometryUtils::sqrDistance2D( q, inter );
+      if ( dist < dMin )
+      {
+        dMin = dist;
+        pMin = inter;
+      }
+    }
+  }
+
+  return pMin;
+}
+
+bool QgsPackedSnapIndex::getSnapPoint( const QgsPointV2& pos, double tol, QgsPointV2& snapPoint, QgsSnapIndex::SnapType& snapType ) const
+{
+  Box box = { pos.x() - tol, pos.y() - tol, pos.x() + tol, pos.y() + tol };
+  QVector<int> segments;
+  getSegments( box, segments );
+
+  double minDistSegment = std::numeric_limits<double>::max();
+  double minDistPoint = std::numeric_limits<double>::max();
+  int snapSegment = -1;
+  int snapVertex = -1;
+
+  Q_FOREACH ( int segment, segments )
+  {
+    int from = mSegmentFrom[segment];
+    int to = mSegmentTo[segment];
+    QgsPointV2 pFrom = vertex( from );
+    QgsPointV2 pTo = vertex( to );
+
+    double distFrom = QgsGeometryUtils::sqrDistance2D( pFrom, pos );
+    if ( distFrom < minDistPoint )
+    {
+      minDistPoint = distFrom;
+      snapVertex = from;
+    }
+    double distTo = QgsGeometryUtils::sqrDistance2D( pTo, pos );
+    if ( distTo < minDistPoint )
+    {
+      minDistPoint = distTo;
+      snapVertex = to;
+    }
+
+    QgsPointV2 pProj;
+    if ( !QgsSnapIndex::segmentProjection( pos, pFrom, pTo, pProj ) )
+    {
+      continue;
+    }
+    double dist = QgsGeometryUtils::sqrDistance2D( pProj, pos );
+    if ( dist < minDistSegment )
+    {
+      minDistSegment = dist;
+      snapSegment = segment;
+    }
+  }
+
+  // Prefer snapping to vertices
+  if ( snapVertex >= 0 && minDistPoint < tol * tol )
+  {
+    snapPoint = vertex( snapVertex );
+    snapType = QgsSnapIndex::SnapPoint;
+    return true;
+  }
+  if ( snapSegment >= 0 && minDistSegment < tol * tol )
+  {
+    snapPoint = QgsGeometryUtils::projPointOnSegment( pos, vertex( mSegmentFrom[snapSegment] ), vertex( mSegmentTo[snapSegment] ) );
+    snapType = QgsSnapIndex::SnapSegment;
+    return true;
+  }
+  return false;
+}
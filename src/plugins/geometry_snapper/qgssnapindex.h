@@ -19,6 +19,9 @@
 
 #include "qgspointv2.h"
 #include "qgsabstractgeometryv2.h"
+#include "qgsrectangle.h"
+
+#include <QVector>
 
 class QgsSnapIndex
 {
@@ -73,6 +76,9 @@ class QgsSnapIndex
     QgsPointV2 getClosestSnapToPoint( const QgsPointV2& p, const QgsPointV2& q );
     SnapItem *getSnapItem( const QgsPointV2& pos, double tol, PointSnapItem **pSnapPoint = nullptr, SegmentSnapItem **pSnapSegment = nullptr ) const;
 
+    static bool segmentIntersection( const QgsPointV2& p1, const QgsPointV2& p2, const QgsPointV2& q1, const QgsPointV2& q2, QgsPointV2& inter );
+    static bool segmentProjection( const QgsPointV2& p, const QgsPointV2& s1, const QgsPointV2& s2, QgsPointV2& pProj );
+
   private:
     typedef QList<SnapItem*> Cell;
     typedef QPair<QgsPointV2, QgsPointV2> Segment;
@@ -107,4 +113,46 @@ class QgsSnapIndex
     QgsSnapIndex& operator=( const QgsSnapIndex& rh );
 };
 
+/**
+ * Read-only snap index of the reference geometries. The vertices are stored in flat
+ * coordinate arrays and the segments are packed into an STR tree by build(), after
+ * which the index can be queried concurrently without locking.
+ */
+class QgsPackedSnapIndex
+{
+  public:
+    QgsPackedSnapIndex();
+    void addGeometry( const QgsAbstractGeometryV2* geom );
+    void build();
+
+    int vertexCount() const { return mX.size(); }
+    QgsPointV2 vertex( int idx ) const { return QgsPointV2( mX[idx], mY[idx] ); }
+    QVector<int> getVertices( const QgsRectangle& rect ) const;
+    QgsPointV2 getClosestSnapToPoint( const QgsPointV2& p, const QgsPointV2& q ) const;
+    bool getSnapPoint( const QgsPointV2& pos, double tol, QgsPointV2& snapPoint, QgsSnapIndex::SnapType& snapType ) const;
+
+  private:
+    struct Box
+    {
+      double xMin, yMin, xMax, yMax;
+      bool intersects( const Box& other ) const
+      {
+        return xMin <= other.xMax && other.xMin <= xMax && yMin <= other.yMax && other.yMin <= yMax;
+      }
+    };
+
+    static const int sNodeCapacity = 16;
+
+    QVector<double> mX;
+    QVector<double> mY;
+    QVector<int> mSegmentFrom;
+    QVector<int> mSegmentTo;
+    // Level 0 holds the segment boxes in tree order, each higher level the boxes of the nodes grouping sNodeCapacity boxes of the level below
+    QVector< QVector<Box> > mLevels;
+
+    Box segmentBox( int segment ) const;
+    void getSegments( const Box& box, QVector<int>& segments ) const;
+    void getSegments( int level, int node, const Box& box, QVector<int>& segments ) const;
+};
+
 #endif // QGSSNAPINDEX_H
@@ -21,7 +21,6 @@
 #include "qgsvectordataprovider.h"
 #include "qgsfeature.h"
 #include "qgsgeometrycoordinatetransform.h"
-#include "qgsgeometryengine.h"
 #include "qgsspatialquery.h"
 
 QgsSpatialQuery::QgsSpatialQuery( MngProgressBar *pb )
@@ -36,6 +35,7 @@ QgsSpatialQuery::QgsSpatialQuery( MngProgressBar *pb )
 QgsSpatialQuery::~QgsSpatialQuery()
 {
   delete mReaderFeaturesTarget;
+  qDeleteAll( mGeometriesReference );
 
 } // QgsSpatialQuery::~QgsSpatialQuery()
 
@@ -187,6 +187,9 @@ bool QgsSpatialQuery::hasValidGeometry( QgsFeature &feature )
 
 void QgsSpatialQuery::setSpatialIndexReference( QgsFeatureIds &qsetIndexInvalidReference )
 {
+  qDeleteAll( mGeometriesReference );
+  mGeometriesReference.clear();
+
   QgsReaderFeatures * readerFeaturesReference = new QgsReaderFeatures( mLayerReference, mUseReferenceSelection );
   QgsFeature feature;
   int step = 1;
@@ -201,6 +204,7 @@ void QgsSpatialQuery::setSpatialIndexReference( QgsFeatureIds &qsetIndexInvalidR
     }
 
     mIndexReference.insertFeature( feature );
+    mGeometriesReference.insert( feature.id(), new QgsGeometry( *feature.constGeometry() ) );
   }
   delete readerFeaturesReference;
 
@@ -208,32 +212,32 @@ void QgsSpatialQuery::setSpatialIndexReference( QgsFeatureIds &qsetIndexInvalidR
 
 void QgsSpatialQuery::execQuery( QgsFeatureIds &qsetIndexResult, QgsFeatureIds &qsetIndexInvalidTarget, int relation )
 {
-  bool ( QgsGeometryEngine::* operation )( const QgsAbstractGeometryV2&, QString* ) const;
+  QgsGeometryPredicateEngine::Predicate predicate;
   switch ( relation )
   {
     case Disjoint:
-      operation = &QgsGeometryEngine::disjoint;
+      predicate = QgsGeometryPredicateEngine::Disjoint;
       break;
     case Equals:
-      operation = &QgsGeometryEngine::isEqual;
+      predicate = QgsGeometryPredicateEngine::Equals;
       break;
     case Touches:
-      operation = &QgsGeometryEngine::touches;
+      predicate = QgsGeometryPredicateEngine::Touches;
       break;
     case Overlaps:
-      operation = &QgsGeometryEngine::overlaps;
+      predicate = QgsGeometryPredicateEngine::Overlaps;
       break;
     case Within:
-      operation = &QgsGeometryEngine::within;
+      predicate = QgsGeometryPredicateEngine::Within;
       break;
     case Contains:
-      operation = &QgsGeometryEngine::contains;
+      predicate = QgsGeometryPredicateEngine::Contains;
       break;
     case Crosses:
-      operation = &QgsGeometryEngine::crosses;
+      predicate = QgsGeometryPredicateEngine::Crosses;
       break;
     case Intersects:
-      operation = &QgsGeometryEngine::intersects;
+      predicate = QgsGeometryPredicateEngine::Intersects;
       break;
     default:
       qWarning( "undefined operation" );
@@ -245,11 +249,14 @@ void QgsSpatialQuery::execQuery( QgsFeatureIds &qsetIndexResult, QgsFeatureIds &
   coordinateTransform->setCoordinateTransform( mLayerTarget, mLayerReference );
 
   // Set function for populate result
-  void ( QgsSpatialQuery::* funcPopulateIndexResult )( QgsFeatureIds&, QgsFeatureId, QgsGeometry *, bool ( QgsGeometryEngine::* )( const QgsAbstractGeometryV2&, QString* ) const );
+  void ( QgsSpatialQuery::* funcPopulateIndexResult )( QgsFeatureIds&, QgsFeatureId, QgsGeometry *, QgsGeometryPredicateEngine::Predicate );
   funcPopulateIndexResult = ( relation == Disjoint )
                             ? &QgsSpatialQuery::populateIndexResultDisjoint
                             : &QgsSpatialQuery::populateIndexResult;
 
+  // every reference geometry is converted to GEOS once and reused for all the targets
+  mPredicateEngine.setMaxCachedGeometries( mGeometriesReference.size() );
+
   QgsFeature featureTarget;
   QgsGeometry * geomTarget;
   int step = 1;
@@ -266,77 +273,48 @@ void QgsSpatialQuery::execQuery( QgsFeatureIds &qsetIndexResult, QgsFeatureIds &
     geomTarget = featureTarget.geometry();
     coordinateTransform->transform( geomTarget );
 
-    ( this->*funcPopulateIndexResult )( qsetIndexResult, featureTarget.id(), geomTarget, operation );
+    ( this->*funcPopulateIndexResult )( qsetIndexResult, featureTarget.id(), geomTarget, predicate );
   }
   delete coordinateTransform;
+  mPredicateEngine.clearCache();
 
 } // QSet<int> QgsSpatialQuery::execQuery( QSet<int> & qsetIndexResult, int relation)
 
-void QgsSpatialQuery::populateIndexResult(
-  QgsFeatureIds &qsetIndexResult, QgsFeatureId idTarget, QgsGeometry * geomTarget,
-  bool ( QgsGeometryEngine::* op )( const QgsAbstractGeometryV2&, QString* ) const )
+QgsFeatureIds QgsSpatialQuery::evaluateReference( QgsGeometry *geomTarget, QgsGeometryPredicateEngine::Predicate predicate )
 {
-  QgsFeatureIds listIdReference = mIndexReference.intersects( geomTarget->boundingBox() ).toSet();
+  QList<QgsFeatureId> listIdReference = mIndexReference.intersects( geomTarget->boundingBox() );
   if ( listIdReference.isEmpty() )
   {
-    return;
+    return QgsFeatureIds();
   }
 
-  //prepare geometry
-  QgsGeometryEngine* geomEngine = geomTarget->createGeometryEngine( geomTarget->geometry() );
-  geomEngine->prepareGeometry();
-
-  QgsFeature featureReference;
-  const QgsGeometry * geomReference;
-  QgsFeatureIterator listIt = mLayerReference->getFeatures( QgsFeatureRequest().setFilterFids( listIdReference ) );
-
-  while ( listIt.nextFeature( featureReference ) )
+  QHash<QgsFeatureId, QgsGeometry*> candidates;
+  Q_FOREACH ( QgsFeatureId id, listIdReference )
   {
-    geomReference = featureReference.constGeometry();
-
-    if (( geomEngine->*op )( *( geomReference->geometry() ), 0 ) )
-    {
-      qsetIndexResult.insert( idTarget );
-      break;
-    }
+    candidates.insert( id, mGeometriesReference.value( id ) );
   }
 
-  delete geomEngine;
-} // void QgsSpatialQuery::populateIndexResult(...
+  //prepare geometry
+  mPredicateEngine.setReferenceGeometry( geomTarget );
+  return mPredicateEngine.evaluate( predicate, candidates );
+} // QgsFeatureIds QgsSpatialQuery::evaluateReference(...
 
-void QgsSpatialQuery::populateIndexResultDisjoint(
+void QgsSpatialQuery::populateIndexResult(
   QgsFeatureIds &qsetIndexResult, QgsFeatureId idTarget, QgsGeometry * geomTarget,
-  bool ( QgsGeometryEngine::* op )( const QgsAbstractGeometryV2&, QString* ) const )
+  QgsGeometryPredicateEngine::Predicate predicate )
 {
-  QgsFeatureIds listIdReference = mIndexReference.intersects( geomTarget->boundingBox() ).toSet();
-  if ( listIdReference.isEmpty() )
+  if ( !evaluateReference( geomTarget, predicate ).isEmpty() )
   {
     qsetIndexResult.insert( idTarget );
-    return;
   }
+} // void QgsSpatialQuery::populateIndexResult(...
 
-  //prepare geometry
-  QgsGeometryEngine* geomEngine = geomTarget->createGeometryEngine( geomTarget->geometry() );
-  geomEngine->prepareGeometry();
-
-  QgsFeature featureReference;
-  const QgsGeometry * geomReference;
-  QgsFeatureIterator listIt = mLayerReference->getFeatures( QgsFeatureRequest().setFilterFids( listIdReference ) );
-
-  bool addIndex = true;
-  while ( listIt.nextFeature( featureReference ) )
-  {
-    geomReference = featureReference.constGeometry();
-    if (( geomEngine->*op )( *( geomReference->geometry() ), 0 ) )
-    {
-      addIndex = false;
-      break;
-    }
-  }
-  if ( addIndex )
+void QgsSpatialQuery::populateIndexResultDisjoint(
+  QgsFeatureIds &qsetIndexResult, QgsFeatureId idTarget, QgsGeometry * geomTarget,
+  QgsGeometryPredicateEngine::Predicate predicate )
+{
+  if ( evaluateReference( geomTarget, predicate ).isEmpty() )
   {
     qsetIndexResult.insert( idTarget );
   }
-  delete geomEngine;
 } // void QgsSpatialQuery::populateIndexResultDisjoint( ...
-
@@ -20,12 +20,11 @@
 
 #include <qgsvectorlayer.h>
 #include <qgsspatialindex.h>
+#include <qgsgeometrypredicateengine.h>
 
 #include "qgsmngprogressbar.h"
 #include "qgsreaderfeatures.h"
 
-class QgsGeometryEngine;
-
 /**
 * \brief Enum with the topologic relations
 * \enum Topologic Relations
@@ -134,20 +133,28 @@ class QgsSpatialQuery
      * \param qsetIndexResult    Reference to QSet contains the result query
      * \param idTarget           Id of the feature Target
      * \param geomTarget         Geometry the feature Target
-     * \param operation          Pointer to function of GEOS operation
+     * \param predicate          Predicate evaluated against the reference features
      */
     void populateIndexResult(
       QgsFeatureIds &qsetIndexResult, QgsFeatureId idTarget, QgsGeometry *geomTarget,
-      bool ( QgsGeometryEngine::* operation )( const QgsAbstractGeometryV2&, QString* ) const );
+      QgsGeometryPredicateEngine::Predicate predicate );
     /**
      * \brief Populate index Result Disjoint
      * \param qsetIndexResult    Reference to QSet contains the result query
      * \param idTarget           Id of the feature Target
      * \param geomTarget         Geometry the feature Target
-     * \param operation          Pointer to function of GEOS operation
+     * \param predicate          Predicate evaluated against the reference features
      */
     void populateIndexResultDisjoint( QgsFeatureIds &qsetIndexResult, QgsFeatureId idTarget, QgsGeometry *geomTarget,
-                                      bool ( QgsGeometryEngine::*operation )( const QgsAbstractGeometryV2&, QString* ) const );
+                                      QgsGeometryPredicateEngine::Predicate predicate );
+
+    /**
+     * \brief Evaluate predicate of the target geometry against the reference features in its bounding box
+     * \param geomTarget         Geometry the feature Target
+     * \param predicate          Predicate evaluated against the reference features
+     * \return ids of the reference features which satisfy the predicate
+     */
+    QgsFeatureIds evaluateReference( QgsGeometry *geomTarget, QgsGeometryPredicateEngine::Predicate predicate );
 
     MngProgressBar *mPb;
     bool mUseReferenceSelection;
@@ -157,6 +164,8 @@ class QgsSpatialQuery
     QgsVectorLayer * mLayerTarget;
     QgsVectorLayer * mLayerReference;
     QgsSpatialIndex  mIndexReference;
+    QHash<QgsFeatureId, QgsGeometry*> mGeometriesReference;
+    QgsGeometryPredicateEngine mPredicateEngine;
 
     QgsSpatialQuery( const QgsSpatialQuery& rh );
     QgsSpatialQuery& operator=( const QgsSpatialQuery& rh );
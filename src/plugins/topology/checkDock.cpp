@@ -144,6 +144,9 @@ void checkDock::deleteErrors()
   mErrorList.clear();
   mErrorListModel->resetModel();
 
+  mTestErrors.clear();
+  mValidatedTests.clear();
+
   qDeleteAll( mRbErrorMarkers );
   mRbErrorMarkers.clear();
 }
@@ -165,6 +168,9 @@ void checkDock::parseErrorListByLayer( const QString& layerId )
       ++it;
   }
 
+  mTestErrors.clear();
+  mValidatedTests.clear();
+
   mErrorListModel->resetModel();
   mComment->setText( tr( "No errors were found" ) );
 }
@@ -185,6 +191,9 @@ void checkDock::parseErrorListByFeature( int featureId )
       ++it;
   }
 
+  mTestErrors.clear();
+  mValidatedTests.clear();
+
   mComment->setText( tr( "No errors were found" ) );
   mErrorListModel->resetModel();
 }
@@ -310,6 +319,8 @@ void checkDock::fix()
   {
     mErrorList.removeAt( row );
     mErrorListModel->resetModel();
+    mTestErrors.clear();
+    mValidatedTests.clear();
     //parseErrorListByFeature();
     mComment->setText( tr( "%1 errors were found" ).arg( mErrorList.count() ) );
     qgsInterface->mapCanvas()->refresh();
@@ -320,6 +331,10 @@ void checkDock::fix()
 
 void checkDock::runTests( ValidateType type )
 {
+  QList<TopologyTestRun> tests;
+  QStringList testKeys;
+  int progressMaximum = 0;
+
   for ( int i = 0; i < mTestTable->rowCount(); ++i )
   {
     QString testName = mTestTable->item( i, 0 )->text();
@@ -331,7 +346,7 @@ void checkDock::runTests( ValidateType type )
     if ( !(( QgsVectorLayer* )mLayerRegistry->mapLayers().contains( layer1Str ) ) )
     {
       QgsMessageLog::logMessage( tr( "Layer %1 not found in registry." ).arg( layer1Str ), tr( "Topology plugin" ) );
-      return;
+      continue;
     }
 
     QgsVectorLayer* layer1 = ( QgsVectorLayer* )mLayerRegistry->mapLayer( layer1Str );
@@ -340,19 +355,41 @@ void checkDock::runTests( ValidateType type )
     if (( QgsVectorLayer* )mLayerRegistry->mapLayers().contains( layer2Str ) )
       layer2 = ( QgsVectorLayer* )mLayerRegistry->mapLayer( layer2Str );
 
-    QProgressDialog progress( testName, tr( "Abort" ), 0, layer1->featureCount(), this );
-    progress.setWindowModality( Qt::WindowModal );
+    tests << TopologyTestRun( testName, layer1, layer2, toleranceStr.toDouble() );
+    testKeys << ( QStringList() << testName << layer1Str << layer2Str << toleranceStr ).join( "|" );
+    progressMaximum += layer1->featureCount();
+  }
 
-    connect( &progress, SIGNAL( canceled() ), mTest, SLOT( setTestCancelled() ) );
-    connect( mTest, SIGNAL( progress( int ) ), &progress, SLOT( setValue( int ) ) );
-    // run the test
+  // errors of the last validation of the same tests are only updated
+  bool incremental = type == ValidateAll && !mValidatedTests.isEmpty() && mValidatedTests == testKeys;
+  if ( !incremental )
+  {
+    qDeleteAll( mErrorList );
+    mTestErrors.clear();
+  }
+  mErrorList.clear();
+  mErrorListModel->resetModel();
+
+  QProgressDialog progress( tr( "Running topology tests" ), tr( "Abort" ), 0, progressMaximum, this );
+  progress.setWindowModality( Qt::WindowModal );
 
-    ErrorList errors = mTest->runTest( testName, layer1, layer2, type, toleranceStr.toDouble() );
+  connect( &progress, SIGNAL( canceled() ), mTest, SLOT( setTestCancelled() ) );
+  connect( mTest, SIGNAL( progress( int ) ), &progress, SLOT( setValue( int ) ) );
 
-    QList<TopolError*>::Iterator it;
+  // run the tests
+  mTestErrors = mTest->runTests( tests, type, incremental ? &mTestErrors : nullptr );
+  mValidatedTests = type == ValidateAll && !progress.wasCanceled() ? testKeys : QStringList();
+
+  disconnect( &progress, SIGNAL( canceled() ), mTest, SLOT( setTestCancelled() ) );
+  disconnect( mTest, SIGNAL( progress( int ) ), &progress, SLOT( setValue( int ) ) );
+
+  for ( int i = 0; i < mTestErrors.count(); ++i )
+  {
+    const ErrorList& errors = mTestErrors.at( i );
+    QList<TopolError*>::ConstIterator it;
 
     QgsRubberBand* rb = nullptr;
-    for ( it = errors.begin(); it != errors.end(); ++it )
+    for ( it = errors.constBegin(); it != errors.constEnd(); ++it )
     {
       TopolError* te = *it;
       te->conflict();
@@ -368,12 +405,10 @@ void checkDock::runTests( ValidateType type )
       }
       rb->setColor( "red" );
       rb->setWidth( 4 );
-      rb->setToGeometry( te->conflict(), layer1 );
+      rb->setToGeometry( te->conflict(), tests.at( i ).layer1 );
       rb->show();
       mRbErrorMarkers << rb;
     }
-    disconnect( &progress, SIGNAL( canceled() ), mTest, SLOT( setTestCancelled() ) );
-    disconnect( mTest, SIGNAL( progress( int ) ), &progress, SLOT( setValue( int ) ) );
     mErrorList << errors;
   }
   mToggleRubberband->setChecked( true );
@@ -382,8 +417,6 @@ void checkDock::runTests( ValidateType type )
 
 void checkDock::validate( ValidateType type )
 {
-  mErrorList.clear();
-
   qDeleteAll( mRbErrorMarkers );
   mRbErrorMarkers.clear();
 
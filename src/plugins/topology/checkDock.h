@@ -111,6 +111,11 @@ class checkDock : public QgsDockWidget, private Ui::checkDock
     ErrorList mErrorList;
     DockModel* mErrorListModel;
 
+    //! errors found by each test of the last validation of whole layers
+    QList<ErrorList> mTestErrors;
+    //! tests of the last validation of whole layers, empty if it cannot be continued incrementally
+    QStringList mValidatedTests;
+
     QgisInterface* qgsInterface;
 
     //pointer to topology tests table
@@ -21,19 +21,40 @@
 #include <qgsmaplayer.h>
 #include <qgsmapcanvas.h>
 #include <qgsgeometry.h>
+#include <qgsgeometryunionengine.h>
 #include <qgsfeature.h>
 #include <qgsspatialindex.h>
 #include <qgisinterface.h>
 #include <qgslogger.h>
 #include <qgsmessagelog.h>
+#include <qgsmaplayerregistry.h>
 #include <cmath>
 #include <set>
 #include <map>
 
+#include <QEventLoop>
+#include <QFutureWatcher>
+#include <QMutex>
+#include <QtConcurrentMap>
+
+// the tests run in parallel and share the indexes of the layer stores
+static QMutex sIndexMutex;
+
+static QList<QgsFeatureId> intersectingIds( const QgsSpatialIndex* index, const QgsRectangle& rect )
+{
+  QMutexLocker locker( &sIndexMutex );
+  return index->intersects( rect );
+}
+
 topolTest::topolTest( QgisInterface* qgsIface )
 {
   theQgsInterface = qgsIface;
   mTestCancelled = false;
+  mValidateAllFeatures = true;
+  mGeometryType1 = QGis::UnknownGeometry;
+  mGeometryType2 = QGis::UnknownGeometry;
+
+  connect( QgsMapLayerRegistry::instance(), SIGNAL( layersWillBeRemoved( QStringList ) ), this, SLOT( layersRemoved( QStringList ) ) );
 
   // one layer tests
   mTopologyRuleMap.insert( tr( "must not have invalid geometries" ),
@@ -49,7 +70,8 @@ topolTest::topolTest( QgisInterface* qgsIface )
   mTopologyRuleMap.insert( tr( "must not have dangles" ),
                            TopologyRule( &topolTest::checkDanglingLines,
                                          false, false, false,
-                                         QList<QGis::GeometryType>() << QGis::Line ) );
+                                         QList<QGis::GeometryType>() << QGis::Line,
+                                         QList<QGis::GeometryType>(), false ) );
 
   mTopologyRuleMap.insert( tr( "must not have duplicates" ),
                            TopologyRule( &topolTest::checkDuplicates,
@@ -59,7 +81,8 @@ topolTest::topolTest( QgisInterface* qgsIface )
   mTopologyRuleMap.insert( tr( "must not have pseudos" ),
                            TopologyRule( &topolTest::checkPseudos,
                                          false, false, false,
-                                         QList<QGis::GeometryType>() << QGis::Line ) );
+                                         QList<QGis::GeometryType>() << QGis::Line,
+                                         QList<QGis::GeometryType>(), false ) );
 
   mTopologyRuleMap.insert( tr( "must not overlap" ),
                            TopologyRule( &topolTest::checkOverlaps,
@@ -69,7 +92,8 @@ topolTest::topolTest( QgisInterface* qgsIface )
   mTopologyRuleMap.insert( tr( "must not have gaps" ),
                            TopologyRule( &topolTest::checkGaps,
                                          false, false, false,
-                                         QList<QGis::GeometryType>() << QGis::Polygon ) );
+                                         QList<QGis::GeometryType>() << QGis::Polygon,
+                                         QList<QGis::GeometryType>(), false ) );
 
   mTopologyRuleMap.insert( tr( "must not have multi-part geometries" ),
                            TopologyRule( &topolTest::checkMultipart,
@@ -122,14 +146,14 @@ topolTest::topolTest( QgisInterface* qgsIface )
 
 topolTest::~topolTest()
 {
-  QMap<QString, QgsSpatialIndex*>::const_iterator lit = mLayerIndexes.constBegin();
-  for ( ; lit != mLayerIndexes.constEnd(); ++lit )
-    delete *lit;
 }
 
 void topolTest::setTestCancelled()
 {
   mTestCancelled = true;
+
+  Q_FOREACH ( topolTest* worker, mWorkers )
+    worker->setTestCancelled();
 }
 
 bool topolTest::testCancelled()
@@ -177,14 +201,14 @@ ErrorList topolTest::checkCloseFeature( double tolerance, QgsVectorLayer* layer1
     QgsRectangle frame( bb.xMinimum() - tolerance, bb.yMinimum() - tolerance, bb.xMaximum() + tolerance, bb.yMaximum() + tolerance );
 
     QList<QgsFeatureId> crossingIds;
-    crossingIds = index->intersects( frame );
+    crossingIds = intersectingIds( index, frame );
 
     QList<QgsFeatureId>::Iterator cit = crossingIds.begin();
     QList<QgsFeatureId>::ConstIterator crossingIdsEnd = crossingIds.end();
 
     for ( ; cit != crossingIdsEnd; ++cit )
     {
-      QgsFeature& f = mFeatureMap2[*cit].feature;
+      QgsFeature f = mFeatureMap2.value( *cit ).feature;
       QgsGeometry* g2 = f.geometry();
 
       // skip itself, when invoked with the same layer
@@ -229,13 +253,14 @@ ErrorList topolTest::checkCloseFeature( double tolerance, QgsVectorLayer* layer1
 ErrorList topolTest::checkDanglingLines( double tolerance, QgsVectorLayer* layer1, QgsVectorLayer* layer2, bool isExtent )
 {
   Q_UNUSED( tolerance );
+  Q_UNUSED( layer1 );
   Q_UNUSED( layer2 );
 
   int i = 0;
   ErrorList errorList;
   QgsFeature f;
 
-  if ( layer1->geometryType() != QGis::Line )
+  if ( mGeometryType1 != QGis::Line )
   {
     return errorList;
   }
@@ -295,7 +320,7 @@ ErrorList topolTest::checkDanglingLines( double tolerance, QgsVectorLayer* layer
     }
   }
 
-  QgsGeometry* canvasExtentPoly = QgsGeometry::fromWkt( theQgsInterface->mapCanvas()->extent().asWktPolygon() );
+  QgsGeometry* canvasExtentPoly = QgsGeometry::fromWkt( mCanvasExtent.asWktPolygon() );
 
 
   for ( std::multimap<QgsPoint, QgsFeatureId, PointComparer>::iterator pointIt = endVerticesMap.begin(), end = endVerticesMap.end(); pointIt != end; pointIt = endVerticesMap.upper_bound( pointIt->first ) )
@@ -320,13 +345,7 @@ ErrorList topolTest::checkDanglingLines( double tolerance, QgsVectorLayer* layer
       }
 
       QgsRectangle bBox = conflictGeom->boundingBox();
-      QgsFeature feat;
-
-      FeatureLayer ftrLayer1;
-      //need to fetch attributes?? being safe side by fetching..
-      layer1->getFeatures( QgsFeatureRequest().setFilterFid( k ) ).nextFeature( feat );
-      ftrLayer1.feature = feat;
-      ftrLayer1.layer = layer1;
+      FeatureLayer ftrLayer1 = mFeatureMap1.value( k );
 
       QList<FeatureLayer> errorFtrLayers;
       errorFtrLayers << ftrLayer1 << ftrLayer1;
@@ -343,6 +362,7 @@ ErrorList topolTest::checkDanglingLines( double tolerance, QgsVectorLayer* layer
 ErrorList topolTest::checkDuplicates( double tolerance, QgsVectorLayer *layer1, QgsVectorLayer *layer2, bool isExtent )
 {
   Q_UNUSED( tolerance );
+  Q_UNUSED( layer1 );
   Q_UNUSED( layer2 );
   //TODO: multilines - check all separate pieces
   int i = 0;
@@ -350,9 +370,9 @@ ErrorList topolTest::checkDuplicates( double tolerance, QgsVectorLayer *layer1,
 
   QList<QgsFeatureId> duplicateIds;
 
-  QgsSpatialIndex* index = mLayerIndexes[layer1->id()];
+  QgsSpatialIndex* index = mLayerIndexes[mLayerId1];
 
-  QgsGeometry* canvasExtentPoly = QgsGeometry::fromWkt( theQgsInterface->mapCanvas()->extent().asWktPolygon() );
+  QgsGeometry* canvasExtentPoly = QgsGeometry::fromWkt( mCanvasExtent.asWktPolygon() );
 
   QMap<QgsFeatureId, FeatureLayer>::const_iterator it;
   for ( it = mFeatureMap2.constBegin(); it != mFeatureMap2.constEnd(); ++it )
@@ -368,6 +388,9 @@ ErrorList topolTest::checkDuplicates( double tolerance, QgsVectorLayer *layer1,
       continue;
     }
 
+    if ( !validateFeature( currentId ) )
+      continue;
+
     if ( testCancelled() )
       break;
 
@@ -375,7 +398,7 @@ ErrorList topolTest::checkDuplicates( double tolerance, QgsVectorLayer *layer1,
     QgsRectangle bb = g1->boundingBox();
 
     QList<QgsFeatureId> crossingIds;
-    crossingIds = index->intersects( bb );
+    crossingIds = intersectingIds( index, bb );
 
     QList<QgsFeatureId>::Iterator cit = crossingIds.begin();
     QList<QgsFeatureId>::ConstIterator crossingIdsEnd = crossingIds.end();
@@ -386,10 +409,11 @@ ErrorList topolTest::checkDuplicates( double tolerance, QgsVectorLayer *layer1,
     {
       duplicate = false;
       // skip itself
-      if ( mFeatureMap2[*cit].feature.id() == it->feature.id() )
+      QgsFeature f2 = mFeatureMap2.value( *cit ).feature;
+      if ( f2.id() == it->feature.id() )
         continue;
 
-      const QgsGeometry* g2 = mFeatureMap2[*cit].feature.constGeometry();
+      const QgsGeometry* g2 = f2.constGeometry();
       if ( !g2 )
       {
         QgsMessageLog::logMessage( tr( "Invalid second geometry in duplicate geometry test." ), tr( "Topology plugin" ) );
@@ -405,7 +429,7 @@ ErrorList topolTest::checkDuplicates( double tolerance, QgsVectorLayer *layer1,
       if ( g1->equals( g2 ) )
       {
         duplicate = true;
-        duplicateIds.append( mFeatureMap2[*cit].feature.id() );
+        duplicateIds.append( f2.id() );
       }
 
       if ( duplicate )
@@ -443,6 +467,7 @@ ErrorList topolTest::checkDuplicates( double tolerance, QgsVectorLayer *layer1,
 ErrorList topolTest::checkOverlaps( double tolerance, QgsVectorLayer *layer1, QgsVectorLayer *layer2, bool isExtent )
 {
   Q_UNUSED( tolerance );
+  Q_UNUSED( layer1 );
   Q_UNUSED( layer2 );
   int i = 0;
   ErrorList errorList;
@@ -450,14 +475,14 @@ ErrorList topolTest::checkOverlaps( double tolerance, QgsVectorLayer *layer1, Qg
   // could be enabled for lines and points too
   // so duplicate rule may be removed?
 
-  if ( layer1->geometryType() != QGis::Polygon )
+  if ( mGeometryType1 != QGis::Polygon )
   {
     return errorList;
   }
 
   QList<QgsFeatureId> *duplicateIds = new QList<QgsFeatureId>();
 
-  QgsSpatialIndex* index = mLayerIndexes[layer1->id()];
+  QgsSpatialIndex* index = mLayerIndexes[mLayerId1];
   if ( !index )
   {
     qDebug() << "no index present";
@@ -479,6 +504,9 @@ ErrorList topolTest::checkOverlaps( double tolerance, QgsVectorLayer *layer1, Qg
       continue;
     }
 
+    if ( !validateFeature( currentId ) )
+      continue;
+
     if ( testCancelled() )
       break;
 
@@ -493,23 +521,24 @@ ErrorList topolTest::checkOverlaps( double tolerance, QgsVectorLayer *layer1, Qg
     QgsRectangle bb = g1->boundingBox();
 
     QList<QgsFeatureId> crossingIds;
-    crossingIds = index->intersects( bb );
+    crossingIds = intersectingIds( index, bb );
 
     QList<QgsFeatureId>::Iterator cit = crossingIds.begin();
     QList<QgsFeatureId>::ConstIterator crossingIdsEnd = crossingIds.end();
 
     bool duplicate = false;
 
-    QgsGeometry* canvasExtentPoly = QgsGeometry::fromWkt( theQgsInterface->mapCanvas()->extent().asWktPolygon() );
+    QgsGeometry* canvasExtentPoly = QgsGeometry::fromWkt( mCanvasExtent.asWktPolygon() );
 
     for ( ; cit != crossingIdsEnd; ++cit )
     {
       duplicate = false;
       // skip itself
-      if ( mFeatureMap2[*cit].feature.id() == it->feature.id() )
+      QgsFeature f2 = mFeatureMap2.value( *cit ).feature;
+      if ( f2.id() == it->feature.id() )
         continue;
 
-      const QgsGeometry* g2 = mFeatureMap2[*cit].feature.constGeometry();
+      const QgsGeometry* g2 = f2.constGeometry();
       if ( !g2 )
       {
         QgsMessageLog::logMessage( tr( "Invalid second geometry in overlaps test." ), tr( "Topology plugin" ) );
@@ -533,7 +562,7 @@ ErrorList topolTest::checkOverlaps( double tolerance, QgsVectorLayer *layer1, Qg
       if ( g1->overlaps( g2 ) )
       {
         duplicate = true;
-        duplicateIds->append( mFeatureMap2[*cit].feature.id() );
+        duplicateIds->append( f2.id() );
       }
 
       if ( duplicate )
@@ -575,12 +604,11 @@ ErrorList topolTest::checkGaps( double tolerance, QgsVectorLayer *layer1, QgsVec
 
   int i = 0;
   ErrorList errorList;
-  GEOSContextHandle_t geosctxt = QgsGeometry::getGEOSHandler();
 
   // could be enabled for lines and points too
   // so duplicate rule may be removed?
 
-  if ( layer1->geometryType() != QGis::Polygon )
+  if ( mGeometryType1 != QGis::Polygon )
   {
     return errorList;
   }
@@ -588,7 +616,7 @@ ErrorList topolTest::checkGaps( double tolerance, QgsVectorLayer *layer1, QgsVec
   QList<FeatureLayer>::iterator it;
   QgsGeometry* g1;
 
-  QList<GEOSGeometry*> geomList;
+  QList<QgsAbstractGeometryV2*> geomList;
 
   qDebug() << mFeatureList1.count() << " features in list!";
   for ( it = mFeatureList1.begin(); it != mFeatureList1.end(); ++it )
@@ -607,12 +635,7 @@ ErrorList topolTest::checkGaps( double tolerance, QgsVectorLayer *layer1, QgsVec
 
     g1 = it->feature.geometry();
 
-    if ( !g1 )
-    {
-      continue;
-    }
-
-    if ( !g1->asGeos() )
+    if ( !g1 || !g1->geometry() )
     {
       continue;
     }
@@ -623,52 +646,25 @@ ErrorList topolTest::checkGaps( double tolerance, QgsVectorLayer *layer1, QgsVec
       continue;
     }
 
-    if ( g1->isMultipart() )
-    {
-      QgsMultiPolygon polys = g1->asMultiPolygon();
-      for ( int m = 0; m < polys.count(); m++ )
-      {
-        QgsPolygon polygon = polys[m];
-
-        QgsGeometry* polyGeom = QgsGeometry::fromPolygon( polygon );
-
-        geomList.push_back( GEOSGeom_clone_r( geosctxt, polyGeom->asGeos() ) );
-        delete polyGeom;
-      }
-
-    }
-    else
-    {
-      geomList.push_back( GEOSGeom_clone_r( geosctxt, g1->asGeos() ) );
-    }
-  }
-
-  GEOSGeometry** geomArray = new GEOSGeometry*[geomList.size()];
-  for ( int i = 0; i < geomList.size(); ++i )
-  {
-    //qDebug() << "filling geometry array-" << i;
-    geomArray[i] = geomList.at( i );
+    geomList << g1->geometry();
   }
 
-  qDebug() << "creating geometry collection-";
-
   if ( geomList.isEmpty() )
   {
     //qDebug() << "geometry list is empty!";
-    delete [] geomArray;
     return errorList;
   }
 
-  GEOSGeometry* collection = nullptr;
-  collection = GEOSGeom_createCollection_r( geosctxt, GEOS_MULTIPOLYGON, geomArray, geomList.size() );
-
-
   qDebug() << "performing cascaded union..might take time..-";
-  GEOSGeometry* unionGeom = GEOSUnionCascaded_r( geosctxt, collection );
-  //delete[] geomArray;
+  QString errorMsg;
+  QgsAbstractGeometryV2* unionGeom = QgsGeometryUnionEngine::unionGeometries( geomList, 0.0, &errorMsg );
+  if ( !unionGeom )
+  {
+    qDebug() << "union failed-" << errorMsg;
+    return errorList;
+  }
 
-  QgsGeometry test;
-  test.fromGeos( unionGeom );
+  QgsGeometry test( unionGeom );
 
 
   //qDebug() << "wktmerged - " << test.exportToWkt();
@@ -693,7 +689,7 @@ ErrorList topolTest::checkGaps( double tolerance, QgsVectorLayer *layer1, QgsVec
   QList<QgsGeometry*> geomColl = diffGeoms->asGeometryCollection();
   delete diffGeoms;
 
-  QgsGeometry* canvasExtentPoly = QgsGeometry::fromWkt( theQgsInterface->mapCanvas()->extent().asWktPolygon() );
+  QgsGeometry* canvasExtentPoly = QgsGeometry::fromWkt( mCanvasExtent.asWktPolygon() );
 
   for ( int i = 1; i < geomColl.count() ; ++i )
   {
@@ -725,13 +721,14 @@ ErrorList topolTest::checkGaps( double tolerance, QgsVectorLayer *layer1, QgsVec
 ErrorList topolTest::checkPseudos( double tolerance, QgsVectorLayer *layer1, QgsVectorLayer *layer2, bool isExtent )
 {
   Q_UNUSED( tolerance );
+  Q_UNUSED( layer1 );
   Q_UNUSED( layer2 );
 
   int i = 0;
   ErrorList errorList;
   QgsFeature f;
 
-  if ( layer1->geometryType() != QGis::Line )
+  if ( mGeometryType1 != QGis::Line )
   {
     return errorList;
   }
@@ -792,7 +789,7 @@ ErrorList topolTest::checkPseudos( double tolerance, QgsVectorLayer *layer1, Qgs
   }
 
 
-  QgsGeometry* canvasExtentPoly = QgsGeometry::fromWkt( theQgsInterface->mapCanvas()->extent().asWktPolygon() );
+  QgsGeometry* canvasExtentPoly = QgsGeometry::fromWkt( mCanvasExtent.asWktPolygon() );
 
 
   for ( std::multimap<QgsPoint, QgsFeatureId, PointComparer>::iterator pointIt = endVerticesMap.begin(), end = endVerticesMap.end(); pointIt != end; pointIt = endVerticesMap.upper_bound( pointIt->first ) )
@@ -816,13 +813,7 @@ ErrorList topolTest::checkPseudos( double tolerance, QgsVectorLayer *layer1, Qgs
       }
 
       QgsRectangle bBox = conflictGeom->boundingBox();
-      QgsFeature feat;
-
-      FeatureLayer ftrLayer1;
-      //need to fetch attributes?? being safe side by fetching..
-      layer1->getFeatures( QgsFeatureRequest().setFilterFid( k ) ).nextFeature( feat );
-      ftrLayer1.feature = feat;
-      ftrLayer1.layer = layer1;
+      FeatureLayer ftrLayer1 = mFeatureMap1.value( k );
 
       QList<FeatureLayer> errorFtrLayers;
       errorFtrLayers << ftrLayer1 << ftrLayer1;
@@ -885,22 +876,24 @@ ErrorList topolTest::checkValid( double tolerance, QgsVectorLayer* layer1, QgsVe
 ErrorList topolTest::checkPointCoveredBySegment( double tolerance, QgsVectorLayer* layer1, QgsVectorLayer* layer2, bool isExtent )
 {
   Q_UNUSED( tolerance );
+  Q_UNUSED( layer1 );
+  Q_UNUSED( layer2 );
 
   int i = 0;
 
   ErrorList errorList;
 
-  if ( layer1->geometryType() != QGis::Point )
+  if ( mGeometryType1 != QGis::Point )
   {
     return errorList;
   }
-  if ( layer2->geometryType() == QGis::Point )
+  if ( mGeometryType2 == QGis::Point )
   {
     return errorList;
   }
 
-  QgsSpatialIndex* index = mLayerIndexes[layer2->id()];
-  QgsGeometry* canvasExtentPoly = QgsGeometry::fromWkt( theQgsInterface->mapCanvas()->extent().asWktPolygon() );
+  QgsSpatialIndex* index = mLayerIndexes[mLayerId2];
+  QgsGeometry* canvasExtentPoly = QgsGeometry::fromWkt( mCanvasExtent.asWktPolygon() );
 
 
   QList<FeatureLayer>::Iterator it;
@@ -916,7 +909,7 @@ ErrorList topolTest::checkPointCoveredBySegment( double tolerance, QgsVectorLaye
     QgsRectangle bb = g1->boundingBox();
 
     QList<QgsFeatureId> crossingIds;
-    crossingIds = index->intersects( bb );
+    crossingIds = intersectingIds( index, bb );
 
     QList<QgsFeatureId>::Iterator cit = crossingIds.begin();
     QList<QgsFeatureId>::ConstIterator crossingIdsEnd = crossingIds.end();
@@ -925,7 +918,7 @@ ErrorList topolTest::checkPointCoveredBySegment( double tolerance, QgsVectorLaye
 
     for ( ; cit != crossingIdsEnd; ++cit )
     {
-      QgsFeature& f = mFeatureMap2[*cit].feature;
+      QgsFeature f = mFeatureMap2.value( *cit ).feature;
       const QgsGeometry* g2 = f.constGeometry();
 
       if ( !g2 )
@@ -1130,9 +1123,9 @@ ErrorList topolTest::checkOverlapWithLayer( double tolerance, QgsVectorLayer* la
   ErrorList errorList;
 
   bool skipItself = layer1 == layer2;
-  QgsSpatialIndex* index = mLayerIndexes[layer2->id()];
+  QgsSpatialIndex* index = mLayerIndexes[mLayerId2];
 
-  QgsGeometry* canvasExtentPoly = QgsGeometry::fromWkt( theQgsInterface->mapCanvas()->extent().asWktPolygon() );
+  QgsGeometry* canvasExtentPoly = QgsGeometry::fromWkt( mCanvasExtent.asWktPolygon() );
 
 
   QList<FeatureLayer>::iterator it;
@@ -1148,13 +1141,13 @@ ErrorList topolTest::checkOverlapWithLayer( double tolerance, QgsVectorLayer* la
     QgsRectangle bb = g1->boundingBox();
 
     QList<QgsFeatureId> crossingIds;
-    crossingIds = index->intersects( bb );
+    crossingIds = intersectingIds( index, bb );
 
     QList<QgsFeatureId>::Iterator cit = crossingIds.begin();
     QList<QgsFeatureId>::ConstIterator crossingIdsEnd = crossingIds.end();
     for ( ; cit != crossingIdsEnd; ++cit )
     {
-      QgsFeature& f = mFeatureMap2[*cit].feature;
+      QgsFeature f = mFeatureMap2.value( *cit ).feature;
       const QgsGeometry* g2 = f.constGeometry();
 
       // skip itself, when invoked with the same layer
@@ -1214,23 +1207,25 @@ ErrorList topolTest::checkOverlapWithLayer( double tolerance, QgsVectorLayer* la
 ErrorList topolTest::checkPointCoveredByLineEnds( double tolerance, QgsVectorLayer *layer1, QgsVectorLayer *layer2, bool isExtent )
 {
   Q_UNUSED( tolerance );
+  Q_UNUSED( layer1 );
+  Q_UNUSED( layer2 );
 
   int i = 0;
   ErrorList errorList;
 
 
-  if ( layer1->geometryType() != QGis::Point )
+  if ( mGeometryType1 != QGis::Point )
   {
     return errorList;
   }
 
-  if ( layer2->geometryType() != QGis::Line )
+  if ( mGeometryType2 != QGis::Line )
   {
     return errorList;
   }
 
-  QgsSpatialIndex* index = mLayerIndexes[layer2->id()];
-  QgsGeometry* canvasExtentPoly = QgsGeometry::fromWkt( theQgsInterface->mapCanvas()->extent().asWktPolygon() );
+  QgsSpatialIndex* index = mLayerIndexes[mLayerId2];
+  QgsGeometry* canvasExtentPoly = QgsGeometry::fromWkt( mCanvasExtent.asWktPolygon() );
 
 
   QList<FeatureLayer>::Iterator it;
@@ -1243,13 +1238,13 @@ ErrorList topolTest::checkPointCoveredByLineEnds( double tolerance, QgsVectorLay
     QgsGeometry* g1 = it->feature.geometry();
     QgsRectangle bb = g1->boundingBox();
     QList<QgsFeatureId> crossingIds;
-    crossingIds = index->intersects( bb );
+    crossingIds = intersectingIds( index, bb );
     QList<QgsFeatureId>::Iterator cit = crossingIds.begin();
     QList<QgsFeatureId>::ConstIterator crossingIdsEnd = crossingIds.end();
     bool touched = false;
     for ( ; cit != crossingIdsEnd; ++cit )
     {
-      QgsFeature& f = mFeatureMap2[*cit].feature;
+      QgsFeature f = mFeatureMap2.value( *cit ).feature;
       const QgsGeometry* g2 = f.constGeometry();
       if ( !g2 || !g2->asGeos() )
       {
@@ -1295,24 +1290,26 @@ ErrorList topolTest::checkPointCoveredByLineEnds( double tolerance, QgsVectorLay
 ErrorList topolTest::checkyLineEndsCoveredByPoints( double tolerance, QgsVectorLayer *layer1, QgsVectorLayer *layer2, bool isExtent )
 {
   Q_UNUSED( tolerance );
+  Q_UNUSED( layer1 );
+  Q_UNUSED( layer2 );
 
   int i = 0;
   ErrorList errorList;
 
 
-  if ( layer1->geometryType() != QGis::Line )
+  if ( mGeometryType1 != QGis::Line )
   {
     return errorList;
   }
 
-  if ( layer2->geometryType() != QGis::Point )
+  if ( mGeometryType2 != QGis::Point )
   {
     return errorList;
   }
 
-  QgsSpatialIndex* index = mLayerIndexes[layer2->id()];
+  QgsSpatialIndex* index = mLayerIndexes[mLayerId2];
 
-  QgsGeometry* canvasExtentPoly = QgsGeometry::fromWkt( theQgsInterface->mapCanvas()->extent().asWktPolygon() );
+  QgsGeometry* canvasExtentPoly = QgsGeometry::fromWkt( mCanvasExtent.asWktPolygon() );
 
   QList<FeatureLayer>::Iterator it;
   for ( it = mFeatureList1.begin(); it != mFeatureList1.end(); ++it )
@@ -1329,7 +1326,7 @@ ErrorList topolTest::checkyLineEndsCoveredByPoints( double tolerance, QgsVectorL
 
     QgsRectangle bb = g1->boundingBox();
     QList<QgsFeatureId> crossingIds;
-    crossingIds = index->intersects( bb );
+    crossingIds = intersectingIds( index, bb );
     QList<QgsFeatureId>::Iterator cit = crossingIds.begin();
     QList<QgsFeatureId>::ConstIterator crossingIdsEnd = crossingIds.end();
     bool touched = false;
@@ -1339,7 +1336,7 @@ ErrorList topolTest::checkyLineEndsCoveredByPoints( double tolerance, QgsVectorL
 
     for ( ; cit != crossingIdsEnd; ++cit )
     {
-      QgsFeature& f = mFeatureMap2[*cit].feature;
+      QgsFeature f = mFeatureMap2.value( *cit ).feature;
       const QgsGeometry* g2 = f.constGeometry();
       if ( !g2 || !g2->asGeos() )
       {
@@ -1398,23 +1395,25 @@ ErrorList topolTest::checkyLineEndsCoveredByPoints( double tolerance, QgsVectorL
 ErrorList topolTest::checkPointInPolygon( double tolerance, QgsVectorLayer *layer1, QgsVectorLayer *layer2, bool isExtent )
 {
   Q_UNUSED( tolerance );
+  Q_UNUSED( layer1 );
+  Q_UNUSED( layer2 );
 
   int i = 0;
   ErrorList errorList;
 
-  if ( layer1->geometryType() != QGis::Point )
+  if ( mGeometryType1 != QGis::Point )
   {
     return errorList;
   }
 
-  if ( layer2->geometryType() != QGis::Polygon )
+  if ( mGeometryType2 != QGis::Polygon )
   {
     return errorList;
   }
 
-  QgsSpatialIndex* index = mLayerIndexes[layer2->id()];
+  QgsSpatialIndex* index = mLayerIndexes[mLayerId2];
 
-  QgsGeometry* canvasExtentPoly = QgsGeometry::fromWkt( theQgsInterface->mapCanvas()->extent().asWktPolygon() );
+  QgsGeometry* canvasExtentPoly = QgsGeometry::fromWkt( mCanvasExtent.asWktPolygon() );
 
   QList<FeatureLayer>::Iterator it;
   for ( it = mFeatureList1.begin(); it != mFeatureList1.end(); ++it )
@@ -1426,13 +1425,13 @@ ErrorList topolTest::checkPointInPolygon( double tolerance, QgsVectorLayer *laye
     QgsGeometry* g1 = it->feature.geometry();
     QgsRectangle bb = g1->boundingBox();
     QList<QgsFeatureId> crossingIds;
-    crossingIds = index->intersects( bb );
+    crossingIds = intersectingIds( index, bb );
     QList<QgsFeatureId>::Iterator cit = crossingIds.begin();
     QList<QgsFeatureId>::ConstIterator crossingIdsEnd = crossingIds.end();
     bool touched = false;
     for ( ; cit != crossingIdsEnd; ++cit )
     {
-      QgsFeature& f = mFeatureMap2[*cit].feature;
+      QgsFeature f = mFeatureMap2.value( *cit ).feature;
       const QgsGeometry* g2 = f.constGeometry();
       if ( !g2 || !g2->asGeos() )
       {
@@ -1476,21 +1475,23 @@ ErrorList topolTest::checkPolygonContainsPoint( double tolerance, QgsVectorLayer
 {
   Q_UNUSED( tolerance );
   Q_UNUSED( isExtent );
+  Q_UNUSED( layer1 );
+  Q_UNUSED( layer2 );
 
   int i = 0;
   ErrorList errorList;
 
-  if ( layer1->geometryType() != QGis::Polygon )
+  if ( mGeometryType1 != QGis::Polygon )
   {
     return errorList;
   }
 
-  if ( layer2->geometryType() != QGis::Point )
+  if ( mGeometryType2 != QGis::Point )
   {
     return errorList;
   }
 
-  QgsSpatialIndex* index = mLayerIndexes[layer2->id()];
+  QgsSpatialIndex* index = mLayerIndexes[mLayerId2];
 
   QList<FeatureLayer>::Iterator it;
   for ( it = mFeatureList1.begin(); it != mFeatureList1.end(); ++it )
@@ -1502,13 +1503,13 @@ ErrorList topolTest::checkPolygonContainsPoint( double tolerance, QgsVectorLayer
     QgsGeometry* g1 = it->feature.geometry();
     QgsRectangle bb = g1->boundingBox();
     QList<QgsFeatureId> crossingIds;
-    crossingIds = index->intersects( bb );
+    crossingIds = intersectingIds( index, bb );
     QList<QgsFeatureId>::Iterator cit = crossingIds.begin();
     QList<QgsFeatureId>::ConstIterator crossingIdsEnd = crossingIds.end();
     bool touched = false;
     for ( ; cit != crossingIdsEnd; ++cit )
     {
-      QgsFeature& f = mFeatureMap2[*cit].feature;
+      QgsFeature f = mFeatureMap2.value( *cit ).feature;
       const QgsGeometry* g2 = f.constGeometry();
       if ( !g2 || !g2->asGeos() )
       {
@@ -1537,8 +1538,8 @@ ErrorList topolTest::checkPolygonContainsPoint( double tolerance, QgsVectorLayer
 ErrorList topolTest::checkMultipart( double tolerance, QgsVectorLayer *layer1, QgsVectorLayer *layer2, bool isExtent )
 {
   Q_UNUSED( tolerance );
-  Q_UNUSED( layer2 );
   Q_UNUSED( layer1 );
+  Q_UNUSED( layer2 );
   Q_UNUSED( isExtent );
 
   int i = 0;
@@ -1571,190 +1572,434 @@ ErrorList topolTest::checkMultipart( double tolerance, QgsVectorLayer *layer1, Q
   return errorList;
 }
 
-void topolTest::fillFeatureMap( QgsVectorLayer* layer, const QgsRectangle& extent )
+
+/**
+  iterates over the features of a layer store, used to bulk load the store index
+  */
+class TopolStoreIterator : public QgsAbstractFeatureIterator
 {
-  QgsFeatureIterator fit;
-  if ( extent.isEmpty() )
-  {
-    fit = layer->getFeatures( QgsFeatureRequest().setSubsetOfAttributes( QgsAttributeList() ) );
-  }
-  else
-  {
-    fit = layer->getFeatures( QgsFeatureRequest()
-                              .setFilterRect( extent )
-                              .setFlags( QgsFeatureRequest::ExactIntersect )
-                              .setSubsetOfAttributes( QgsAttributeList() ) );
-  }
+  public:
+    explicit TopolStoreIterator( const QMap<QgsFeatureId, FeatureLayer>& features )
+        : QgsAbstractFeatureIterator( QgsFeatureRequest() )
+        , mFeatures( features )
+        , mIt( mFeatures.constBegin() )
+    {}
+
+    bool rewind() override
+    {
+      mIt = mFeatures.constBegin();
+      return true;
+    }
 
-  QgsFeature f;
+    bool close() override
+    {
+      mClosed = true;
+      return true;
+    }
 
-  while ( fit.nextFeature( f ) )
-  {
-    if ( f.constGeometry() )
+  protected:
+    bool fetchFeature( QgsFeature& f ) override
     {
-      mFeatureMap2[f.id()] = FeatureLayer( layer, f );
+      if ( mClosed || mIt == mFeatures.constEnd() )
+        return false;
+
+      f = mIt->feature;
+      ++mIt;
+      return true;
     }
-  }
+
+  private:
+    QMap<QgsFeatureId, FeatureLayer> mFeatures;
+    QMap<QgsFeatureId, FeatureLayer>::const_iterator mIt;
+};
+
+void topolTest::addToStore( TopolLayerStore* store, QgsVectorLayer* layer, const QgsFeature& f )
+{
+  if ( !f.constGeometry() )
+    return;
+
+  // the GEOS geometry is cached on first use, which must not happen concurrently
+  f.constGeometry()->asGeos();
+  store->features.insert( f.id(), FeatureLayer( layer, f ) );
 }
 
-void topolTest::fillFeatureList( QgsVectorLayer* layer, const QgsRectangle& extent )
+void topolTest::buildStoreIndex( TopolLayerStore* store )
 {
-  QgsFeatureIterator fit;
-  if ( extent.isEmpty() )
-  {
-    fit = layer->getFeatures( QgsFeatureRequest().setSubsetOfAttributes( QgsAttributeList() ) );
-  }
+  delete store->index;
+  if ( store->features.isEmpty() )
+    store->index = new QgsSpatialIndex();
   else
+    store->index = new QgsSpatialIndex( QgsFeatureIterator( new TopolStoreIterator( store->features ) ) );
+}
+
+QSharedPointer<TopolLayerStore> topolTest::layerStore( QgsVectorLayer* layer )
+{
+  QSharedPointer<TopolLayerStore> store = mLayerStores.value( layer->id() );
+  if ( !store )
   {
-    fit = layer->getFeatures( QgsFeatureRequest()
-                              .setFilterRect( extent )
-                              .setFlags( QgsFeatureRequest::ExactIntersect )
-                              .setSubsetOfAttributes( QgsAttributeList() ) );
+    store = QSharedPointer<TopolLayerStore>( new TopolLayerStore() );
+    mLayerStores.insert( layer->id(), store );
+
+    connect( layer, SIGNAL( featureAdded( QgsFeatureId ) ), this, SLOT( featureEdited( QgsFeatureId ) ) );
+    connect( layer, SIGNAL( featureDeleted( QgsFeatureId ) ), this, SLOT( featureEdited( QgsFeatureId ) ) );
+    connect( layer, SIGNAL( geometryChanged( QgsFeatureId, QgsGeometry& ) ), this, SLOT( geometryEdited( QgsFeatureId, QgsGeometry& ) ) );
+    connect( layer, SIGNAL( editingStopped() ), this, SLOT( layerReset() ) );
+    connect( layer, SIGNAL( dataChanged() ), this, SLOT( layerReset() ) );
   }
 
-  QgsFeature f;
+  store->reloaded = false;
+  store->changedIds.clear();
+  store->changedAreas.clear();
 
-  while ( fit.nextFeature( f ) )
+  if ( store->stale )
   {
-    if ( f.constGeometry() )
+    store->features.clear();
+    store->editedIds.clear();
+
+    QgsFeatureIterator fit = layer->getFeatures( QgsFeatureRequest().setSubsetOfAttributes( QgsAttributeList() ) );
+    QgsFeature f;
+    while ( fit.nextFeature( f ) )
     {
-      mFeatureList1 << FeatureLayer( layer, f );
+      addToStore( store.data(), layer, f );
     }
+
+    buildStoreIndex( store.data() );
+    store->stale = false;
+    store->reloaded = true;
   }
+  else if ( !store->editedIds.isEmpty() )
+  {
+    // only read again the features edited since the last refresh
+    Q_FOREACH ( QgsFeatureId fid, store->editedIds )
+    {
+      QMap<QgsFeatureId, FeatureLayer>::iterator it = store->features.find( fid );
+      if ( it == store->features.end() )
+        continue;
+
+      store->changedAreas << it->feature.constGeometry()->boundingBox();
+      store->index->deleteFeature( it->feature );
+      store->features.erase( it );
+    }
+
+    QgsFeatureIterator fit = layer->getFeatures( QgsFeatureRequest()
+                             .setFilterFids( store->editedIds )
+                             .setSubsetOfAttributes( QgsAttributeList() ) );
+    QgsFeature f;
+    while ( fit.nextFeature( f ) )
+    {
+      if ( !f.constGeometry() )
+        continue;
+
+      addToStore( store.data(), layer, f );
+      store->changedAreas << f.constGeometry()->boundingBox();
+      store->index->insertFeature( f );
+    }
 
+    store->changedIds = store->editedIds;
+    store->editedIds.clear();
+  }
+
+  return store;
 }
 
-QgsSpatialIndex* topolTest::createIndex( QgsVectorLayer* layer, const QgsRectangle& extent )
+QSharedPointer<TopolLayerStore> topolTest::extentStore( QgsVectorLayer* layer, const QgsRectangle& extent )
 {
-  QgsSpatialIndex* index = new QgsSpatialIndex();
+  QSharedPointer<TopolLayerStore> store( new TopolLayerStore() );
 
-  QgsFeatureIterator fit;
-  if ( extent.isEmpty() )
+  QSharedPointer<TopolLayerStore> layerData = mLayerStores.value( layer->id() );
+  if ( layerData && !layerData->stale )
   {
-    fit = layer->getFeatures( QgsFeatureRequest().setSubsetOfAttributes( QgsAttributeList() ) );
+    layerData = layerStore( layer );
+
+    Q_FOREACH ( QgsFeatureId fid, intersectingIds( layerData->index, extent ) )
+    {
+      QMap<QgsFeatureId, FeatureLayer>::const_iterator it = layerData->features.constFind( fid );
+      if ( it != layerData->features.constEnd() && it->feature.constGeometry()->intersects( extent ) )
+        store->features.insert( fid, *it );
+    }
   }
   else
   {
-    fit = layer->getFeatures( QgsFeatureRequest()
-                              .setFilterRect( extent )
-                              .setFlags( QgsFeatureRequest::ExactIntersect )
-                              .setSubsetOfAttributes( QgsAttributeList() ) );
+    QgsFeatureIterator fit = layer->getFeatures( QgsFeatureRequest()
+                             .setFilterRect( extent )
+                             .setFlags( QgsFeatureRequest::ExactIntersect )
+                             .setSubsetOfAttributes( QgsAttributeList() ) );
+    QgsFeature f;
+    while ( fit.nextFeature( f ) )
+    {
+      addToStore( store.data(), layer, f );
+    }
   }
 
+  buildStoreIndex( store.data() );
+  store->stale = false;
+  return store;
+}
 
-  int i = 0;
-  QgsFeature f;
-  while ( fit.nextFeature( f ) )
-  {
-    if ( !( ++i % 100 ) )
-      emit progress( i );
+void topolTest::featureEdited( QgsFeatureId fid )
+{
+  QgsVectorLayer* layer = qobject_cast<QgsVectorLayer*>( sender() );
+  if ( !layer )
+    return;
 
-    if ( testCancelled() )
-    {
-      delete index;
-      return nullptr;
-    }
+  QSharedPointer<TopolLayerStore> store = mLayerStores.value( layer->id() );
+  if ( store )
+    store->editedIds.insert( fid );
+}
+
+void topolTest::geometryEdited( QgsFeatureId fid, QgsGeometry& geom )
+{
+  Q_UNUSED( geom );
+  featureEdited( fid );
+}
+
+void topolTest::layerReset()
+{
+  // committed features get new ids, read the whole layer again
+  QgsVectorLayer* layer = qobject_cast<QgsVectorLayer*>( sender() );
+  if ( !layer )
+    return;
+
+  QSharedPointer<TopolLayerStore> store = mLayerStores.value( layer->id() );
+  if ( store )
+    store->stale = true;
+}
 
-    if ( f.constGeometry() )
+void topolTest::layersRemoved( const QStringList& layerIds )
+{
+  // tests running meanwhile hold their own reference to the stores they read
+  bool running = false;
+  Q_FOREACH ( const QString& layerId, layerIds )
+  {
+    mLayerStores.remove( layerId );
+
+    if ( mRunningLayerIds.contains( layerId ) )
     {
-      index->insertFeature( f );
-      mFeatureMap2[f.id()] = FeatureLayer( layer, f );
+      mRemovedLayerIds.insert( layerId );
+      running = true;
     }
   }
 
-  return index;
+  // the errors found by the running tests would refer to the removed layer
+  if ( running )
+    setTestCancelled();
 }
 
-ErrorList topolTest::runTest( const QString& testName, QgsVectorLayer* layer1, QgsVectorLayer* layer2, ValidateType type, double tolerance )
+void topolTest::workerProgress( int value )
 {
-  QgsDebugMsg( QString( "Running test %1" ).arg( testName ) );
-  ErrorList errors;
+  mWorkerProgress[sender()] = value;
 
-  if ( !layer1 )
+  int total = 0;
+  Q_FOREACH ( int workerValue, mWorkerProgress )
   {
-    QgsMessageLog::logMessage( tr( "First layer not found in registry." ), tr( "Topology plugin" ) );
-    return errors;
+    total += workerValue;
   }
+  emit progress( total );
+}
+
+struct TopolTestJob
+{
+  topolTest* test;
+  testFunction f;
+  QgsVectorLayer* layer1;
+  QgsVectorLayer* layer2;
+  double tolerance;
+  bool isExtent;
+  int index;
+  ErrorList errors;
+};
+
+static void runTestJob( TopolTestJob& job )
+{
+  job.errors = ( job.test->*( job.f ) )( job.tolerance, job.layer1, job.layer2, job.isExtent );
+}
 
-  if ( !layer2 && mTopologyRuleMap[testName].useSecondLayer )
+ErrorList topolTest::runTest( const QString& testName, QgsVectorLayer* layer1, QgsVectorLayer* layer2, ValidateType type, double tolerance )
+{
+  return runTests( QList<TopologyTestRun>() << TopologyTestRun( testName, layer1, layer2, tolerance ), type ).value( 0 );
+}
+
+QList<ErrorList> topolTest::runTests( const QList<TopologyTestRun>& tests, ValidateType type, const QList<ErrorList>* previousErrors )
+{
+  QList<ErrorList> results;
+  mTestCancelled = false;
+
+  bool isExtent = type == ValidateExtent;
+  QgsRectangle canvasExtent = theQgsInterface->mapCanvas()->extent();
+
+  // read every layer only once, the tests share its features and index
+  QMap<QString, QSharedPointer<TopolLayerStore> > stores;
+  Q_FOREACH ( const TopologyTestRun& test, tests )
   {
-    QgsMessageLog::logMessage( tr( "Second layer not found in registry." ), tr( "Topology plugin" ) );
-    return errors;
+    QList<QgsVectorLayer*> layers;
+    layers << test.layer1;
+    if ( mTopologyRuleMap.value( test.testName ).useSecondLayer )
+      layers << test.layer2;
+
+    Q_FOREACH ( QgsVectorLayer* layer, layers )
+    {
+      if ( !layer || stores.contains( layer->id() ) )
+        continue;
+
+      if ( isExtent )
+      {
+        stores.insert( layer->id(), extentStore( layer, canvasExtent ) );
+      }
+      else
+      {
+        stores.insert( layer->id(), layerStore( layer ) );
+      }
+    }
   }
 
-  mFeatureList1.clear();
-  mFeatureMap2.clear();
+  QList<TopolTestJob> jobs;
+  for ( int i = 0; i < tests.count(); ++i )
+  {
+    const TopologyTestRun& test = tests.at( i );
+    ErrorList previous = previousErrors ? previousErrors->value( i ) : ErrorList();
+    results << ErrorList();
 
-  //checking if new features are not
-  //being recognised due to indexing not being upto date
+    QgsDebugMsg( QString( "Running test %1" ).arg( test.testName ) );
 
-  mLayerIndexes.clear();
+    TopologyRule rule = mTopologyRuleMap.value( test.testName );
+    if ( !test.layer1 )
+    {
+      QgsMessageLog::logMessage( tr( "First layer not found in registry." ), tr( "Topology plugin" ) );
+      qDeleteAll( previous );
+      continue;
+    }
 
-  if ( mTopologyRuleMap[testName].useSecondLayer )
-  {
-    // validate all features or current extent
-    QgsRectangle extent;
-    if ( type == ValidateExtent )
+    if ( !test.layer2 && rule.useSecondLayer )
     {
-      extent = theQgsInterface->mapCanvas()->extent();
+      QgsMessageLog::logMessage( tr( "Second layer not found in registry." ), tr( "Topology plugin" ) );
+      qDeleteAll( previous );
+      continue;
     }
-    else
+
+    if ( !rule.f )
     {
-      extent = QgsRectangle();
+      qDeleteAll( previous );
+      continue;
     }
 
-    fillFeatureList( layer1, extent );
-    //fillFeatureMap( layer1, extent );
+    QSharedPointer<TopolLayerStore> store1 = stores.value( test.layer1->id() );
+    QSharedPointer<TopolLayerStore> store2 = rule.useSecondLayer ? stores.value( test.layer2->id() ) : QSharedPointer<TopolLayerStore>();
 
-    if ( !mLayerIndexes.contains( layer2->id() ) )
+    topolTest* worker = new topolTest( theQgsInterface );
+    worker->mCanvasExtent = canvasExtent;
+    // the layers must not be used by the test, which runs in another thread
+    worker->mLayerId1 = test.layer1->id();
+    worker->mGeometryType1 = test.layer1->geometryType();
+    if ( test.layer2 )
     {
-      mLayerIndexes[layer2->id()] = createIndex( layer2, extent );
+      worker->mLayerId2 = test.layer2->id();
+      worker->mGeometryType2 = test.layer2->geometryType();
     }
-  }
-  else
-  {
-    // validate all features or current extent
-    QgsRectangle extent;
-    if ( type == ValidateExtent )
+    mRunningLayerIds << worker->mLayerId1 << worker->mLayerId2;
+    worker->mFeatureMap1 = store1->features;
+
+    // tests iterating the feature map look up candidates in the same map
+    bool iteratesMap = !rule.useSecondLayer && rule.useSpatialIndex;
+    if ( rule.useSecondLayer )
+    {
+      worker->mFeatureMap2 = store2->features;
+      worker->mLayerIndexes.insert( worker->mLayerId2, store2->index );
+    }
+    else if ( iteratesMap )
+    {
+      worker->mFeatureMap2 = store1->features;
+      worker->mLayerIndexes.insert( worker->mLayerId1, store1->index );
+    }
+
+    // tests of local rules only validate again the features near the edits
+    bool incremental = previousErrors && type == ValidateAll && rule.localRule
+                       && !store1->reloaded && ( !store2 || !store2->reloaded );
+    if ( incremental )
     {
-      extent = theQgsInterface->mapCanvas()->extent();
-      if ( mTopologyRuleMap[testName].useSpatialIndex )
+      QgsFeatureIds affectedIds = store1->changedIds;
+      QList<QgsRectangle> areas = store1->changedAreas;
+      if ( store2 && store2 != store1 )
+        areas << store2->changedAreas;
+
+      Q_FOREACH ( const QgsRectangle& area, areas )
       {
-        mLayerIndexes[layer1->id()] = createIndex( layer1, theQgsInterface->mapCanvas()->extent() );
+        affectedIds.unite( intersectingIds( store1->index, area ).toSet() );
       }
-      else
+
+      Q_FOREACH ( TopolError* error, previous )
       {
-        fillFeatureList( layer1, extent );
+        if ( affectedIds.contains( error->featurePairs().first().feature.id() ) )
+          delete error;
+        else
+          results[i] << error;
       }
-    }
-    else
-    {
-      if ( mTopologyRuleMap[testName].useSpatialIndex )
-      {
-        if ( !mLayerIndexes.contains( layer1->id() ) )
-        {
 
-          mLayerIndexes[layer1->id()] = createIndex( layer1, QgsRectangle() );
-        }
+      if ( iteratesMap )
+      {
+        worker->mValidateIds = affectedIds;
+        worker->mValidateAllFeatures = false;
       }
       else
       {
-        fillFeatureList( layer1, QgsRectangle() );
+        Q_FOREACH ( QgsFeatureId fid, affectedIds )
+        {
+          QMap<QgsFeatureId, FeatureLayer>::const_iterator it = store1->features.constFind( fid );
+          if ( it != store1->features.constEnd() )
+            worker->mFeatureList1 << *it;
+        }
       }
     }
+    else
+    {
+      qDeleteAll( previous );
+      if ( !iteratesMap )
+        worker->mFeatureList1 = store1->features.values();
+    }
 
+    connect( worker, SIGNAL( progress( int ) ), this, SLOT( workerProgress( int ) ) );
+    mWorkers << worker;
+
+    TopolTestJob job;
+    job.test = worker;
+    job.f = rule.f;
+    job.layer1 = test.layer1;
+    job.layer2 = test.layer2;
+    job.tolerance = test.tolerance;
+    job.isExtent = isExtent;
+    job.index = i;
+    jobs << job;
   }
 
-  //call test routine
-  bool isValidatingExtent;
-  if ( type == ValidateExtent )
+  // run the tests in parallel while the progress dialog stays responsive
+  if ( !jobs.isEmpty() )
   {
-    isValidatingExtent = true;
+    mWorkerProgress.clear();
+
+    QFutureWatcher<void> watcher;
+    QEventLoop loop;
+    connect( &watcher, SIGNAL( finished() ), &loop, SLOT( quit() ) );
+    watcher.setFuture( QtConcurrent::map( jobs, runTestJob ) );
+    loop.exec();
   }
-  else
+
+  Q_FOREACH ( const TopolTestJob& job, jobs )
   {
-    isValidatingExtent = false;
+    if ( mRemovedLayerIds.contains( job.test->mLayerId1 ) || mRemovedLayerIds.contains( job.test->mLayerId2 ) )
+    {
+      // a layer of the test was removed while it ran
+      qDeleteAll( job.errors );
+      qDeleteAll( results[job.index] );
+      results[job.index].clear();
+      continue;
+    }
+
+    results[job.index] << job.errors;
   }
 
-  return ( this->*( mTopologyRuleMap[testName].f ) )( tolerance, layer1, layer2, isValidatingExtent );
+  qDeleteAll( mWorkers );
+  mWorkers.clear();
+  mRunningLayerIds.clear();
+  mRemovedLayerIds.clear();
+
+  return results;
 }
@@ -19,6 +19,7 @@
 #define TOPOLTEST_H
 
 #include <QObject>
+#include <QSharedPointer>
 
 #include <qgsvectorlayer.h>
 #include <qgsgeometry.h>
@@ -41,6 +42,7 @@ class TopologyRule
     bool useSecondLayer;
     bool useTolerance;
     bool useSpatialIndex;
+    bool localRule;
     QList<QGis::GeometryType> layer1SupportedTypes;
     QList<QGis::GeometryType> layer2SupportedTypes;
 
@@ -58,23 +60,83 @@ class TopologyRule
     /**
      * Constructor
      * initializes the test to use both layers and not to use the tolerance
+     * localRule0 tells whether the errors of a feature only depend on the features
+     * intersecting its bounding box, which allows incremental validation
      */
     explicit TopologyRule( testFunction f0 = nullptr,
                            bool useSecondLayer0 = true,
                            bool useTolerance0 = false,
                            bool useSpatialIndex0 = false,
                            const QList<QGis::GeometryType>& layer1SupportedTypes0 = QList<QGis::GeometryType>(),
-                           const QList<QGis::GeometryType>& layer2SupportedTypes0 = QList<QGis::GeometryType>()
+                           const QList<QGis::GeometryType>& layer2SupportedTypes0 = QList<QGis::GeometryType>(),
+                           bool localRule0 = true
                          )
         : f( f0 )
         , useSecondLayer( useSecondLayer0 )
         , useTolerance( useTolerance0 )
         , useSpatialIndex( useSpatialIndex0 )
+        , localRule( localRule0 )
         , layer1SupportedTypes( layer1SupportedTypes0 )
         , layer2SupportedTypes( layer2SupportedTypes0 )
     {}
 };
 
+/**
+  configured test, as passed to topolTest::runTests
+  */
+class TopologyTestRun
+{
+  public:
+    QString testName;
+    QgsVectorLayer* layer1;
+    QgsVectorLayer* layer2;
+    double tolerance;
+
+    explicit TopologyTestRun( const QString& testName0 = QString(),
+                              QgsVectorLayer* layer10 = nullptr,
+                              QgsVectorLayer* layer20 = nullptr,
+                              double tolerance0 = 0.0 )
+        : testName( testName0 )
+        , layer1( layer10 )
+        , layer2( layer20 )
+        , tolerance( tolerance0 )
+    {}
+};
+
+/**
+  features and spatial index of a layer, shared by all tests and kept between runs
+  */
+class TopolLayerStore
+{
+  public:
+    TopolLayerStore()
+        : index( nullptr )
+        , stale( true )
+        , reloaded( false )
+    {}
+
+    ~TopolLayerStore() { delete index; }
+
+    //! features with a geometry
+    QMap<QgsFeatureId, FeatureLayer> features;
+    //! index of the features
+    QgsSpatialIndex* index;
+    //! features added, deleted or changed since the last refresh
+    QgsFeatureIds editedIds;
+    //! the store has to be reloaded from the layer
+    bool stale;
+    //! the last refresh reloaded the store from the layer
+    bool reloaded;
+    //! features updated by the last refresh
+    QgsFeatureIds changedIds;
+    //! old and new bounding boxes of the features updated by the last refresh
+    QList<QgsRectangle> changedAreas;
+
+  private:
+    TopolLayerStore( const TopolLayerStore& rh );
+    TopolLayerStore& operator=( const TopolLayerStore& rh );
+};
+
 /**
   helper class to pass as comparator to map,set etc..
   */
@@ -120,6 +182,21 @@ class topolTest: public QObject
      */
     ErrorList runTest( const QString& testName, QgsVectorLayer* layer1, QgsVectorLayer* layer2, ValidateType type, double tolerance );
 
+    /**
+     * Runs several tests at once and returns the errors found by each test
+     * Every layer is read only once into a store which is shared by all tests
+     * and kept up to date with the edits of the layer, and the tests are run in parallel.
+     * @param tests tests to run
+     * @param type type what features to validate
+     * @param previousErrors if not null, errors found by the last validation of the whole
+     * layers with the same tests. Tests of local rules then only validate the features
+     * edited since and their neighbours, the errors of the other features are kept.
+     * Errors which are not kept are deleted.
+     * If a layer of a test is removed while the tests run, the tests are cancelled
+     * and the errors of the tests using the layer are deleted.
+     */
+    QList<ErrorList> runTests( const QList<TopologyTestRun>& tests, ValidateType type, const QList<ErrorList>* previousErrors = nullptr );
+
     /**
      * Checks for intersections of the two layers
      * @param tolerance not used
@@ -256,35 +333,71 @@ class topolTest: public QObject
      */
     void setTestCancelled();
 
+  private slots:
+    void featureEdited( QgsFeatureId fid );
+    void geometryEdited( QgsFeatureId fid, QgsGeometry& geom );
+    void layerReset();
+    void layersRemoved( const QStringList& layerIds );
+    void workerProgress( int value );
+
   private:
+    //! indexes used by the tests, owned by the layer stores
     QMap<QString, QgsSpatialIndex*> mLayerIndexes;
     QMap<QString, TopologyRule> mTopologyRuleMap;
 
     QList<FeatureLayer> mFeatureList1;
+    QMap<QgsFeatureId, FeatureLayer> mFeatureMap1;
     QMap<QgsFeatureId, FeatureLayer> mFeatureMap2;
+    //! features of the map to validate if mValidateAllFeatures is false
+    QgsFeatureIds mValidateIds;
+    bool mValidateAllFeatures;
+    QgsRectangle mCanvasExtent;
+
+    //! stores are shared with the running tests, which keep them alive if a layer is removed meanwhile
+    QMap<QString, QSharedPointer<TopolLayerStore> > mLayerStores;
+    QList<topolTest*> mWorkers;
+    QMap<QObject*, int> mWorkerProgress;
+    //! layers of the running tests, and those of them removed while the tests run
+    QSet<QString> mRunningLayerIds;
+    QSet<QString> mRemovedLayerIds;
+
+    //! ids and geometry types of the layers of a worker's test, read before it runs in another thread
+    QString mLayerId1;
+    QString mLayerId2;
+    QGis::GeometryType mGeometryType1;
+    QGis::GeometryType mGeometryType2;
 
     QgisInterface* theQgsInterface;
     bool mTestCancelled;
 
     /**
-     * Builds spatial index for the layer
+     * Returns the store of the layer, loads it or updates it with the edits of the layer
      * @param layer pointer to the layer
      */
-    QgsSpatialIndex* createIndex( QgsVectorLayer* layer, const QgsRectangle& extent );
+    QSharedPointer<TopolLayerStore> layerStore( QgsVectorLayer* layer );
 
     /**
-     * Fills the feature list with features from the layer
+     * Returns a new store with the features of the layer within the extent
+     * Features are taken from the layer store if it is loaded, otherwise they are read from the layer
      * @param layer pointer to the layer
-     * @param extent of the layer to add features
+     * @param extent extent to validate
      */
-    void fillFeatureList( QgsVectorLayer* layer, const QgsRectangle& extent );
+    QSharedPointer<TopolLayerStore> extentStore( QgsVectorLayer* layer, const QgsRectangle& extent );
 
     /**
-     * Fills the feature map with features from the layer
-     * @param layer pointer to the layer
-     * @param extent of the layer to create index
+     * Adds a feature to a store
+     */
+    static void addToStore( TopolLayerStore* store, QgsVectorLayer* layer, const QgsFeature& f );
+
+    /**
+     * Builds the index of the store in a single pass
+     */
+    static void buildStoreIndex( TopolLayerStore* store );
+
+    /**
+     * Returns true if the feature is to be validated
      */
-    void fillFeatureMap( QgsVectorLayer* layer, const QgsRectangle& extent );
+    bool validateFeature( QgsFeatureId fid ) const { return mValidateAllFeatures || mValidateIds.contains( fid ); }
 
     /**
      * Returns true if the test was cancelled
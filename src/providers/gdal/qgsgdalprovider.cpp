@@ -43,7 +43,11 @@
 #include <QDir>
 #include <QFileInfo>
 #include <QFile>
+#include <QCache>
+#include <QCryptographicHash>
+#include <QDateTime>
 #include <QHash>
+#include <QMutex>
 #include <QTime>
 #include <QTextDocument>
 #include <QDebug>
@@ -59,10 +63,23 @@
 static QString PROVIDER_KEY = "gdal";
 static QString PROVIDER_DESCRIPTION = "GDAL provider";
 
+// Metadata domain of the statistics and histograms computed by QGIS, kept in the PAM file of the dataset
+static const char* STATISTICS_METADATA_DOMAIN = "QGIS_STATISTICS";
+
 struct QgsGdalProgress
 {
+  QgsGdalProgress()
+      : type( QgsRaster::ProgressHistogram )
+      , provider( nullptr )
+      , feedback( nullptr )
+      , lastComplete( -1.0 )
+  {}
+
   int type;
   QgsGdalProvider *provider;
+  QgsFeedback *feedback;
+  // kept per operation, several operations may run in different threads
+  double lastComplete;
 };
 //
 // global callback function
@@ -71,10 +88,9 @@ int CPL_STDCALL progressCallback( double dfComplete,
                                   const char * pszMessage,
                                   void * pProgressArg )
 {
-  static double dfLastComplete = -1.0;
-
   QgsGdalProgress *prog = static_cast<QgsGdalProgress *>( pProgressArg );
   QgsGdalProvider *mypProvider = prog->provider;
+  double& dfLastComplete = prog->lastComplete;
 
   if ( dfLastComplete > dfComplete )
   {
@@ -89,11 +105,145 @@ int CPL_STDCALL progressCallback( double dfComplete,
     mypProvider->emitProgress( prog->type, dfComplete * 100, QString( pszMessage ) );
     mypProvider->emitProgressUpdate( dfComplete * 100 );
   }
+  if ( prog->feedback && floor( dfLastComplete*100 ) != floor( dfComplete*100 ) )
+  {
+    prog->feedback->setProgress( dfComplete * 100 );
+  }
   dfLastComplete = dfComplete;
 
-  return true;
+  // returning false makes GDAL stop the operation
+  return !prog->feedback || !prog->feedback->isCancelled();
 }
 
+///@cond PRIVATE
+
+//! Identifies a block of a band or of one of its overviews
+struct QgsGdalBlockKey
+{
+  QgsGdalBlockKey( int theBand, int theLevel, int theXBlock, int theYBlock )
+      : cache( 0 )
+      , band( theBand )
+      , level( theLevel )
+      , xBlock( theXBlock )
+      , yBlock( theYBlock )
+  {}
+
+  bool operator==( const QgsGdalBlockKey& other ) const
+  {
+    return cache == other.cache && band == other.band && level == other.level && xBlock == other.xBlock && yBlock == other.yBlock;
+  }
+
+  //! Identifies the dataset, set by the block cache
+  int cache;
+  int band;
+  //! Overview index, -1 for full resolution
+  int level;
+  int xBlock;
+  int yBlock;
+};
+
+inline uint qHash( const QgsGdalBlockKey& key )
+{
+  return ( static_cast< uint >( key.cache ) << 29 ) ^ ( static_cast< uint >( key.band ) << 27 ) ^ ( static_cast< uint >( key.level + 1 ) << 22 )
+         ^ ( static_cast< uint >( key.xBlock ) << 11 ) ^ static_cast< uint >( key.yBlock );
+}
+
+/** Least recently used decoded blocks of a dataset, shared by a provider and its clones which
+ * read the same dataset in different threads, e.g. the parts of a raster iterator or several
+ * map render jobs. Blocks are kept in the data type the provider reads the band with.
+ * The blocks of all datasets are stored in one cache, so that they share one memory budget.
+ */
+class QgsGdalBlockCache
+{
+  public:
+    //! Capacity in bytes of the blocks of all datasets
+    static const int CAPACITY = 256 * 1024 * 1024;
+
+    QgsGdalBlockCache()
+    {
+      QMutexLocker locker( &sMutex );
+      mId = ++sLastId;
+    }
+
+    ~QgsGdalBlockCache()
+    {
+      clear();
+    }
+
+    //! Returns a block, or a null byte array if the block is not cached
+    QByteArray block( const QgsGdalBlockKey& key )
+    {
+      QMutexLocker locker( &sMutex );
+      QByteArray* data = sBlocks.object( cacheKey( key ) );
+      if ( !data )
+      {
+        ++mStatistics.cacheMisses;
+        return QByteArray();
+      }
+      ++mStatistics.cacheHits;
+      return *data;
+    }
+
+    void insert( const QgsGdalBlockKey& key, const QByteArray& data )
+    {
+      QMutexLocker locker( &sMutex );
+      sBlocks.insert( cacheKey( key ), new QByteArray( data ), data.size() );
+    }
+
+    //! Counts a read request sent to GDAL
+    void addRead( qint64 bytes )
+    {
+      QMutexLocker locker( &sMutex );
+      ++mStatistics.readCount;
+      mStatistics.bytesRead += bytes;
+    }
+
+    //! Counts a request read from the memory mapped file
+    void addMappedRead()
+    {
+      QMutexLocker locker( &sMutex );
+      ++mStatistics.mappedReads;
+    }
+
+    //! Removes all blocks of the dataset, e.g. when the dataset or its overviews are modified
+    void clear()
+    {
+      QMutexLocker locker( &sMutex );
+      Q_FOREACH ( const QgsGdalBlockKey& key, sBlocks.keys() )
+      {
+        if ( key.cache == mId )
+          sBlocks.remove( key );
+      }
+    }
+
+    QgsGdalProvider::BlockReadStatistics statistics() const
+    {
+      QMutexLocker locker( &sMutex );
+      return mStatistics;
+    }
+
+  private:
+    static QMutex sMutex;
+    static QCache<QgsGdalBlockKey, QByteArray> sBlocks;
+    static int sLastId;
+
+    int mId;
+    QgsGdalProvider::BlockReadStatistics mStatistics;
+
+    QgsGdalBlockKey cacheKey( const QgsGdalBlockKey& key ) const
+    {
+      QgsGdalBlockKey result( key );
+      result.cache = mId;
+      return result;
+    }
+};
+
+QMutex QgsGdalBlockCache::sMutex;
+QCache<QgsGdalBlockKey, QByteArray> QgsGdalBlockCache::sBlocks( QgsGdalBlockCache::CAPACITY );
+int QgsGdalBlockCache::sLastId = 0;
+
+///@endcond
+
 QgsGdalProvider::QgsGdalProvider( const QString &uri, QgsError error )
     : QgsRasterDataProvider( uri )
     , mUpdate( false )
@@ -106,6 +256,7 @@ QgsGdalProvider::QgsGdalProvider( const QString &uri, QgsError error )
     , mGdalBaseDataset( nullptr )
     , mGdalDataset( nullptr )
     , mStatisticsAreReliable( false )
+    , mStatisticsSaved( false )
 {
   mGeoTransform[0] =  0;
   mGeoTransform[1] =  1;
@@ -129,6 +280,7 @@ QgsGdalProvider::QgsGdalProvider( const QString &uri, bool update )
     , mGdalBaseDataset( nullptr )
     , mGdalDataset( nullptr )
     , mStatisticsAreReliable( false )
+    , mStatisticsSaved( false )
 {
   mGeoTransform[0] =  0;
   mGeoTransform[1] =  1;
@@ -187,12 +339,17 @@ QgsGdalProvider::QgsGdalProvider( const QString &uri, bool update )
 
   QgsDebugMsg( "GdalDataset opened" );
   initBaseDataset();
+
+  mBlockCache = QSharedPointer<QgsGdalBlockCache>( new QgsGdalBlockCache() );
 }
 
 QgsGdalProvider* QgsGdalProvider::clone() const
 {
   QgsGdalProvider * provider = new QgsGdalProvider( dataSourceUri() );
   provider->copyBaseSettings( *this );
+  // clones read the same data, e.g. in parallel render jobs
+  if ( provider->mBlockCache && mBlockCache )
+    provider->mBlockCache = mBlockCache;
   return provider;
 }
 
@@ -239,6 +396,7 @@ bool QgsGdalProvider::crsFromWkt( const char *wkt )
 
 QgsGdalProvider::~QgsGdalProvider()
 {
+  releaseMappedBands();
   if ( mGdalBaseDataset )
   {
     GDALDereferenceDataset( mGdalBaseDataset );
@@ -251,8 +409,9 @@ QgsGdalProvider::~QgsGdalProvider()
 
     GDALClose( mGdalDataset );
 
-    // If GDAL created a PAM file right now by using estimated metadata, delete it right away
-    if ( !mStatisticsAreReliable && !pamFileAlreadyExists && QFileInfo( pamFile ).exists() )
+    // If GDAL created a PAM file right now by using estimated metadata, delete it right away,
+    // unless it holds the statistics saved by QGIS
+    if ( !mStatisticsAreReliable && !mStatisticsSaved && !pamFileAlreadyExists && QFileInfo( pamFile ).exists() )
       QFile( pamFile ).remove();
   }
 }
@@ -267,6 +426,7 @@ void QgsGdalProvider::closeDataset()
   }
   mValid = false;
 
+  releaseMappedBands();
   GDALDereferenceDataset( mGdalBaseDataset );
   mGdalBaseDataset = nullptr;
 
@@ -364,6 +524,19 @@ QString QgsGdalProvider::metadata()
     }
   }
 
+  BlockReadStatistics readStatistics = blockReadStatistics();
+  myMetadata += "<p class=\"glossy\">";
+  myMetadata += tr( "Reads" );
+  myMetadata += "</p>\n";
+  myMetadata += "<p>";
+  myMetadata += tr( "Cached blocks used: %1 Blocks read: %2 Read requests: %3 Bytes read: %4 Mapped file reads: %5" )
+                .arg( readStatistics.cacheHits )
+                .arg( readStatistics.cacheMisses )
+                .arg( readStatistics.readCount )
+                .arg( readStatistics.bytesRead )
+                .arg( readStatistics.mappedReads );
+  myMetadata += "</p>\n";
+
   if ( GDALGetGeoTransform( mGdalDataset, mGeoTransform ) != CE_None )
   {
     // if the raster does not have a valid transform we need to use
@@ -621,54 +794,91 @@ void QgsGdalProvider::readBlock( int theBandNo, QgsRectangle  const & theExtent,
 
   double tmpXMin = mExtent.xMinimum() + srcLeft * srcXRes;
   double tmpYMax = mExtent.yMaximum() + srcTop * srcYRes;
-  QgsDebugMsg( QString( "tmpXMin = %1 tmpYMax = %2 tmpWidth = %3 tmpHeight = %4" ).arg( tmpXMin ).arg( tmpYMax ).arg( tmpWidth ).arg( tmpHeight ) );
+  double tmpXRes = srcWidth * srcXRes / tmpWidth;
+  double tmpYRes = srcHeight * srcYRes / tmpHeight; // negative
+  char *tmpBlock = nullptr;
+  const char *tmpData = nullptr;
+  qint64 tmpLineSpace = 0;
+
+  // An uncompressed band mapped to memory is resampled directly from the pages of the file,
+  // unless GDAL would rather read an overview, see readCachedWindow()
+  double factor = qMin( static_cast< double >( srcWidth ) / tmpWidth, static_cast< double >( srcHeight ) / tmpHeight );
+  qint64 mappedLineSpace = 0;
+  const char *mappedData = mappedBandData( theBandNo, mappedLineSpace );
+  if ( mappedData && ( factor < 2.0 / 1.2 || gdalGetOverviewCount( GDALGetRasterBand( mGdalDataset, theBandNo ) ) == 0 ) )
+  {
+    tmpData = mappedData;
+    tmpLineSpace = mappedLineSpace;
+    tmpWidth = xSize();
+    tmpHeight = ySize();
+    tmpXMin = mExtent.xMinimum();
+    tmpYMax = mExtent.yMaximum();
+    tmpXRes = srcXRes;
+    tmpYRes = srcYRes;
+    if ( mBlockCache )
+      mBlockCache->addMappedRead();
+  }
+  // Read whole blocks of the best overview through the block cache, so that the blocks
+  // shared by adjacent requests are read and decoded only once
+  else if ( !readCachedWindow( theBandNo, srcLeft, srcTop, srcWidth, srcHeight, tmpWidth, tmpHeight, feedback,
+                               tmpBlock, tmpWidth, tmpHeight, tmpXMin, tmpYMax, tmpXRes, tmpYRes ) )
+  {
+    QgsDebugMsg( QString( "tmpXMin = %1 tmpYMax = %2 tmpWidth = %3 tmpHeight = %4" ).arg( tmpXMin ).arg( tmpYMax ).arg( tmpWidth ).arg( tmpHeight ) );
+
+    // Allocate temporary block
+    tmpBlock = ( char * )qgsMalloc( dataSize * tmpWidth * tmpHeight );
+    if ( ! tmpBlock )
+    {
+      QgsDebugMsg( QString( "Couldn't allocate temporary buffer of %1 bytes" ).arg( dataSize * tmpWidth * tmpHeight ) );
+      return;
+    }
+    GDALRasterBandH gdalBand = GDALGetRasterBand( mGdalDataset, theBandNo );
+    GDALDataType type = ( GDALDataType )mGdalDataType.at( theBandNo - 1 );
+    CPLErrorReset();
 
-  // Allocate temporary block
-  char *tmpBlock = ( char * )qgsMalloc( dataSize * tmpWidth * tmpHeight );
-  if ( ! tmpBlock )
-  {
-    QgsDebugMsg( QString( "Couldn't allocate temporary buffer of %1 bytes" ).arg( dataSize * tmpWidth * tmpHeight ) );
-    return;
-  }
-  GDALRasterBandH gdalBand = GDALGetRasterBand( mGdalDataset, theBandNo );
-  GDALDataType type = ( GDALDataType )mGdalDataType.at( theBandNo - 1 );
-  CPLErrorReset();
+    CPLErr err = gdalRasterIO( gdalBand, GF_Read,
+                               srcLeft, srcTop, srcWidth, srcHeight,
+                               ( void * )tmpBlock,
+                               tmpWidth, tmpHeight, type,
+                               0, 0, feedback );
 
-  CPLErr err = gdalRasterIO( gdalBand, GF_Read,
-                             srcLeft, srcTop, srcWidth, srcHeight,
-                             ( void * )tmpBlock,
-                             tmpWidth, tmpHeight, type,
-                             0, 0, feedback );
+    if ( err != CPLE_None )
+    {
+      QgsLogger::warning( "RasterIO error: " + QString::fromUtf8( CPLGetLastErrorMsg() ) );
+      qgsFree( tmpBlock );
+      return;
+    }
+    if ( mBlockCache )
+      mBlockCache->addRead( static_cast< qint64 >( dataSize ) * tmpWidth * tmpHeight );
+  }
 
-  if ( err != CPLE_None )
+  if ( tmpBlock )
   {
-    QgsLogger::warning( "RasterIO error: " + QString::fromUtf8( CPLGetLastErrorMsg() ) );
-    qgsFree( tmpBlock );
-    return;
+    tmpData = tmpBlock;
+    tmpLineSpace = static_cast< qint64 >( dataSize ) * tmpWidth;
   }
 
-  double tmpXRes = srcWidth * srcXRes / tmpWidth;
-  double tmpYRes = srcHeight * srcYRes / tmpHeight; // negative
-
   double y = myRasterExtent.yMaximum() - 0.5 * yRes;
   for ( int row = 0; row < height; row++ )
   {
     int tmpRow = static_cast<int>( floor( -1. * ( tmpYMax - y ) / tmpYRes ) );
+    // the pages after the last row of a mapped file must not be touched
+    tmpRow = qBound( 0, tmpRow, tmpHeight - 1 );
 
-    char *srcRowBlock = tmpBlock + dataSize * tmpRow * tmpWidth;
+    const char *srcRowBlock = tmpData + tmpLineSpace * tmpRow;
     char *dstRowBlock = ( char * )theBlock + dataSize * ( top + row ) * thePixelWidth;
 
     double x = ( myRasterExtent.xMinimum() + 0.5 * xRes - tmpXMin ) / tmpXRes; // cell center
     double increment = xRes / tmpXRes;
 
     char* dst = dstRowBlock + dataSize * left;
-    char* src = srcRowBlock;
+    const char* src = srcRowBlock;
     int tmpCol = 0;
     int lastCol = 0;
     for ( int col = 0; col < width; ++col )
     {
       // floor() is quite slow! Use just cast to int.
-      tmpCol = static_cast<int>( x );
+      tmpCol = qMin( static_cast<int>( x ), tmpWidth - 1 );
       if ( tmpCol > lastCol )
       {
         src += ( tmpCol - lastCol ) * dataSize;
@@ -685,6 +895,280 @@ void QgsGdalProvider::readBlock( int theBandNo, QgsRectangle  const & theExtent,
   return;
 }
 
+bool QgsGdalProvider::readCachedWindow( int theBandNo, int srcLeft, int srcTop, int srcWidth, int srcHeight,
+                                        int bufferWidth, int bufferHeight, QgsRasterBlockFeedback* feedback,
+                                        char*& buffer, int& width, int& height, double& xMin, double& yMax, double& xRes, double& yRes )
+{
+  if ( !mBlockCache )
+    return false;
+
+  GDALRasterBandH gdalBand = GDALGetRasterBand( mGdalDataset, theBandNo );
+  if ( !gdalBand )
+    return false;
+
+  // Choose the overview like GDAL does for a RasterIO request: the coarsest one whose
+  // resolution is not much coarser than the requested one
+  double factor = qMin( static_cast< double >( srcWidth ) / bufferWidth, static_cast< double >( srcHeight ) / bufferHeight );
+  int level = -1;
+  GDALRasterBandH levelBand = gdalBand;
+  if ( factor > 1.0 )
+  {
+    double levelFactor = 1.0;
+    int overviewCount = gdalGetOverviewCount( gdalBand );
+    for ( int i = 0; i < overviewCount; i++ )
+    {
+      GDALRasterBandH overview = GDALGetOverview( gdalBand, i );
+      if ( !overview || GDALGetRasterBandXSize( overview ) <= 0 )
+        continue;
+
+      double overviewFactor = static_cast< double >( xSize() ) / GDALGetRasterBandXSize( overview );
+      if ( overviewFactor > levelFactor && overviewFactor < factor * 1.2 )
+      {
+        levelFactor = overviewFactor;
+        level = i;
+        levelBand = overview;
+      }
+    }
+  }
+
+  int levelWidth = GDALGetRasterBandXSize( levelBand );
+  int levelHeight = GDALGetRasterBandYSize( levelBand );
+  double scaleX = static_cast< double >( levelWidth ) / xSize();
+  double scaleY = static_cast< double >( levelHeight ) / ySize();
+
+  // window in the pixels of the chosen level
+  int left = static_cast< int >( floor( srcLeft * scaleX ) );
+  int top = static_cast< int >( floor( srcTop * scaleY ) );
+  int right = qMin( levelWidth, static_cast< int >( ceil(( srcLeft + srcWidth ) * scaleX ) ) );
+  int bottom = qMin( levelHeight, static_cast< int >( ceil(( srcTop + srcHeight ) * scaleY ) ) );
+  int windowWidth = right - left;
+  int windowHeight = bottom - top;
+  if ( windowWidth <= 0 || windowHeight <= 0 )
+    return false;
+
+  // Without an overview close to the requested resolution GDAL reads less data by subsampling
+  if ( static_cast< qint64 >( windowWidth ) * windowHeight > 4 * static_cast< qint64 >( bufferWidth ) * bufferHeight )
+    return false;
+
+  int blockXSize = 0;
+  int blockYSize = 0;
+  GDALGetBlockSize( levelBand, &blockXSize, &blockYSize );
+  if ( blockXSize <= 0 || blockYSize <= 0 )
+    return false;
+
+  int dataSize = dataTypeSize( theBandNo );
+  GDALDataType type = ( GDALDataType )mGdalDataType.at( theBandNo - 1 );
+
+  int firstXBlock = left / blockXSize;
+  int firstYBlock = top / blockYSize;
+  int xBlockCount = ( right - 1 ) / blockXSize - firstXBlock + 1;
+  int yBlockCount = ( bottom - 1 ) / blockYSize - firstYBlock + 1;
+
+  // Whole blocks may be much larger than the window, e.g. strips of the full raster width or a
+  // single block for the whole raster. Windows whose blocks would push a large part of the
+  // cache shared by all datasets out are read by GDAL directly
+  qint64 blocksBytes = static_cast< qint64 >( dataSize ) * qMin( levelWidth, xBlockCount * blockXSize ) * qMin( levelHeight, yBlockCount * blockYSize );
+  if ( blocksBytes > QgsGdalBlockCache::CAPACITY / 4 )
+    return false;
+
+  QVector<QByteArray> blocks( xBlockCount * yBlockCount );
+  for ( int y = 0; y < yBlockCount; y++ )
+  {
+    for ( int x = 0; x < xBlockCount; x++ )
+    {
+      blocks[y * xBlockCount + x] = mBlockCache->block( QgsGdalBlockKey( theBandNo, level, firstXBlock + x, firstYBlock + y ) );
+    }
+  }
+
+  // Coalesce the missing blocks into rectangles: runs of adjacent blocks in a row, merged
+  // with the run of the previous row if it spans the same columns
+  QList<QRect> reads;
+  QList<QRect> previousRuns;
+  for ( int y = 0; y < yBlockCount; y++ )
+  {
+    QList<QRect> runs;
+    int x = 0;
+    while ( x < xBlockCount )
+    {
+      if ( !blocks.at( y * xBlockCount + x ).isNull() )
+      {
+        x++;
+        continue;
+      }
+      int runStart = x;
+      while ( x < xBlockCount && blocks.at( y * xBlockCount + x ).isNull() )
+        x++;
+
+      QRect run( runStart, y, x - runStart, 1 );
+      for ( int i = 0; i < previousRuns.count(); i++ )
+      {
+        if ( previousRuns.at( i ).left() == run.left() && previousRuns.at( i ).width() == run.width() )
+        {
+          run.setTop( previousRuns.takeAt( i ).top() );
+          break;
+        }
+      }
+      runs << run;
+    }
+    reads << previousRuns;
+    previousRuns = runs;
+  }
+  reads << previousRuns;
+
+  Q_FOREACH ( const QRect& read, reads )
+  {
+    int readLeft = ( firstXBlock + read.left() ) * blockXSize;
+    int readTop = ( firstYBlock + read.top() ) * blockYSize;
+    int readWidth = qMin( levelWidth, ( firstXBlock + read.right() + 1 ) * blockXSize ) - readLeft;
+    int readHeight = qMin( levelHeight, ( firstYBlock + read.bottom() + 1 ) * blockYSize ) - readTop;
+
+    QByteArray data;
+    data.resize( dataSize * readWidth * readHeight );
+    CPLErrorReset();
+    CPLErr err = gdalRasterIO( levelBand, GF_Read, readLeft, readTop, readWidth, readHeight,
+                               data.data(), readWidth, readHeight, type, 0, 0, feedback );
+    if ( err != CPLE_None )
+    {
+      QgsLogger::warning( "RasterIO error: " + QString::fromUtf8( CPLGetLastErrorMsg() ) );
+      return false;
+    }
+    mBlockCache->addRead( data.size() );
+
+    // split into blocks, blocks at the right and bottom edges of the level may be partial
+    for ( int y = read.top(); y <= read.bottom(); y++ )
+    {
+      int blockTop = ( firstYBlock + y ) * blockYSize - readTop;
+      int blockHeight = qMin( blockYSize, readHeight - blockTop );
+      for ( int x = read.left(); x <= read.right(); x++ )
+      {
+        int blockLeft = ( firstXBlock + x ) * blockXSize - readLeft;
+        int blockWidth = qMin( blockXSize, readWidth - blockLeft );
+
+        QByteArray block;
+        block.resize( dataSize * blockWidth * blockHeight );
+        for ( int row = 0; row < blockHeight; row++ )
+        {
+          memcpy( block.data() + dataSize * row * blockWidth,
+                  data.constData() + dataSize * (( blockTop + row ) * readWidth + blockLeft ),
+                  dataSize * blockWidth );
+        }
+        mBlockCache->insert( QgsGdalBlockKey( theBandNo, level, firstXBlock + x, firstYBlock + y ), block );
+        blocks[y * xBlockCount + x] = block;
+      }
+    }
+  }
+
+  buffer = ( char * )qgsMalloc( dataSize * windowWidth * windowHeight );
+  if ( !buffer )
+  {
+    QgsDebugMsg( QString( "Couldn't allocate temporary buffer of %1 bytes" ).arg( dataSize * windowWidth * windowHeight ) );
+    return false;
+  }
+
+  // copy the parts of the blocks covered by the window
+  for ( int y = 0; y < yBlockCount; y++ )
+  {
+    int blockTop = ( firstYBlock + y ) * blockYSize;
+    int blockHeight = qMin( blockYSize, levelHeight - blockTop );
+    int rowStart = qMax( top, blockTop );
+    int rowEnd = qMin( bottom, blockTop + blockHeight );
+    for ( int x = 0; x < xBlockCount; x++ )
+    {
+      int blockLeft = ( firstXBlock + x ) * blockXSize;
+      int blockWidth = qMin( blockXSize, levelWidth - blockLeft );
+      int colStart = qMax( left, blockLeft );
+      int colEnd = qMin( right, blockLeft + blockWidth );
+      const char* blockData = blocks.at( y * xBlockCount + x ).constData();
+      for ( int row = rowStart; row < rowEnd; row++ )
+      {
+        memcpy( buffer + dataSize * (( row - top ) * windowWidth + colStart - left ),
+                blockData + dataSize * (( row - blockTop ) * blockWidth + colStart - blockLeft ),
+                dataSize * ( colEnd - colStart ) );
+      }
+    }
+  }
+
+  width = windowWidth;
+  height = windowHeight;
+  xRes = mGeoTransform[1] / scaleX;
+  yRes = mGeoTransform[5] / scaleY;
+  xMin = mExtent.xMinimum() + left * xRes;
+  yMax = mExtent.yMaximum() + top * yRes;
+  return true;
+}
+
+QgsGdalProvider::BlockReadStatistics QgsGdalProvider::blockReadStatistics() const
+{
+  return mBlockCache ? mBlockCache->statistics() : BlockReadStatistics();
+}
+
+const char* QgsGdalProvider::mappedBandData( int theBandNo, qint64& lineSpace )
+{
+#if defined(GDAL_COMPUTE_VERSION) && GDAL_VERSION_NUM >= GDAL_COMPUTE_VERSION(1,11,0)
+  if ( theBandNo < 1 || theBandNo > mGdalDataType.size() )
+    return nullptr;
+
+  if ( mMappedBands.size() != mGdalDataType.size() )
+    mMappedBands.resize( mGdalDataType.size() );
+
+  MappedBand& mapped = mMappedBands[theBandNo - 1];
+  if ( !mapped.checked )
+  {
+    mapped.checked = true;
+
+    GDALRasterBandH gdalBand = GDALGetRasterBand( mGdalDataset, theBandNo );
+    // data written to a dataset opened for update may still be in the GDAL cache only
+    if ( gdalBand && GDALGetAccess( mGdalDataset ) == GA_ReadOnly
+         && GDALGetRasterDataType( gdalBand ) == mGdalDataType.at( theBandNo - 1 )
+         && CPLIsVirtualMemFileMapAvailable() )
+    {
+      int pixelSpace = 0;
+      GIntBig bandLineSpace = 0;
+      // without the default implementation, which reads through the GDAL cache, only the
+      // bands of uncompressed files with a contiguous layout (e.g. GeoTIFF strips, ENVI, BIL)
+      // are mapped
+      char **options = CSLSetNameValue( nullptr, "USE_DEFAULT_IMPLEMENTATION", "NO" );
+      CPLVirtualMem *memory = GDALGetVirtualMemAuto( gdalBand, GF_Read, &pixelSpace, &bandLineSpace, options );
+      CSLDestroy( options );
+
+      if ( memory && pixelSpace == dataTypeSize( theBandNo ) && bandLineSpace > 0 )
+      {
+        QgsDebugMsgLevel( QString( "Band %1 mapped to memory, line space %2" ).arg( theBandNo ).arg( bandLineSpace ), 2 );
+        mapped.memory = memory;
+        mapped.lineSpace = bandLineSpace;
+      }
+      else if ( memory )
+      {
+        CPLVirtualMemFree( memory );
+      }
+    }
+  }
+
+  if ( !mapped.memory )
+    return nullptr;
+
+  lineSpace = mapped.lineSpace;
+  return static_cast< const char* >( CPLVirtualMemGetAddr( mapped.memory ) );
+#else
+  Q_UNUSED( theBandNo );
+  Q_UNUSED( lineSpace );
+  return nullptr;
+#endif
+}
+
+void QgsGdalProvider::releaseMappedBands()
+{
+#if defined(GDAL_COMPUTE_VERSION) && GDAL_VERSION_NUM >= GDAL_COMPUTE_VERSION(1,11,0)
+  for ( int i = 0; i < mMappedBands.size(); i++ )
+  {
+    if ( mMappedBands.at( i ).memory )
+      CPLVirtualMemFree( mMappedBands.at( i ).memory );
+  }
+#endif
+  // the bands of a reopened dataset are mapped again on first use
+  mMappedBands.clear();
+}
+
 //void * QgsGdalProvider::readBlock( int bandNo, QgsRectangle  const & extent, int width, int height )
 //{
 //  return 0;
@@ -1295,6 +1779,13 @@ bool QgsGdalProvider::hasHistogram( int theBandNo,
   QgsRasterHistogram myHistogram;
   initHistogram( myHistogram, theBandNo, theBinCount, theMinimum, theMaximum, theExtent, theSampleSize, theIncludeOutOfRange );
 
+  // Then check if computed before and saved with the dataset
+  if ( readSavedHistogram( myHistogram ) )
+  {
+    mHistograms.append( myHistogram );
+    return true;
+  }
+
   // If not cached, check if supported by GDAL
   if ( myHistogram.extent != extent() )
   {
@@ -1392,17 +1883,28 @@ QgsRasterHistogram QgsGdalProvider::histogram( int theBandNo,
     }
   }
 
+  if ( readSavedHistogram( myHistogram ) )
+  {
+    QgsDebugMsg( "Using saved histogram." );
+    mHistograms.append( myHistogram );
+    return myHistogram;
+  }
+
   if (( srcHasNoDataValue( theBandNo ) && !useSrcNoDataValue( theBandNo ) ) ||
       !userNoDataValues( theBandNo ).isEmpty() )
   {
     QgsDebugMsg( "Custom no data values, using generic histogram." );
-    return QgsRasterDataProvider::histogram( theBandNo, theBinCount, theMinimum, theMaximum, theExtent, theSampleSize, theIncludeOutOfRange );
+    myHistogram = QgsRasterDataProvider::histogram( theBandNo, theBinCount, theMinimum, theMaximum, theExtent, theSampleSize, theIncludeOutOfRange );
+    saveHistogram( myHistogram );
+    return myHistogram;
   }
 
   if ( myHistogram.extent != extent() )
   {
     QgsDebugMsg( "Not full extent, using generic histogram." );
-    return QgsRasterDataProvider::histogram( theBandNo, theBinCount, theMinimum, theMaximum, theExtent, theSampleSize, theIncludeOutOfRange );
+    myHistogram = QgsRasterDataProvider::histogram( theBandNo, theBinCount, theMinimum, theMaximum, theExtent, theSampleSize, theIncludeOutOfRange );
+    saveHistogram( myHistogram );
+    return myHistogram;
   }
 
   QgsDebugMsg( "Computing GDAL histogram" );
@@ -1530,6 +2032,7 @@ QgsRasterHistogram QgsGdalProvider::histogram( int theBandNo,
   QgsDebugMsg( ">>>>> Histogram vector now contains " + QString::number( myHistogram.histogramVector.size() ) + " elements" );
 
   mHistograms.append( myHistogram );
+  saveHistogram( myHistogram );
   return myHistogram;
 }
 
@@ -1541,11 +2044,12 @@ QgsRasterHistogram QgsGdalProvider::histogram( int theBandNo,
  * it will default to nearest neighbor resampling.
  *
  * @param theTryInternalFlag - Try to make the pyramids internal if supported (e.g. geotiff). If not supported it will revert to creating external .ovr file anyway.
+ * @param feedback - Receives the progress, if cancelled the overviews created so far are removed unless the dataset had overviews before.
  * @return null string on success, otherwise a string specifying error
  */
 QString QgsGdalProvider::buildPyramids( const QList<QgsRasterPyramid> & theRasterPyramidList,
                                         const QString & theResamplingMethod, QgsRaster::RasterPyramidsFormat theFormat,
-                                        const QStringList & theConfigOptions )
+                                        const QStringList & theConfigOptions, QgsFeedback* feedback )
 {
   //TODO: Consider making theRasterPyramidList modifyable by this method to indicate if the pyramid exists after build attempt
   //without requiring the user to rebuild the pyramid list to get the updated infomation
@@ -1600,6 +2104,7 @@ QString QgsGdalProvider::buildPyramids( const QList<QgsRasterPyramid> & theRaste
     if ( GDALGetAccess( mGdalDataset ) == GA_ReadOnly )
     {
       QgsDebugMsg( "re-opening the dataset in read/write mode" );
+      releaseMappedBands();
       GDALClose( mGdalDataset );
       //mGdalBaseDataset = GDALOpen( QFile::encodeName( dataSourceUri() ).constData(), GA_Update );
 
@@ -1616,13 +2121,31 @@ QString QgsGdalProvider::buildPyramids( const QList<QgsRasterPyramid> & theRaste
     }
   }
 
+  // remember the overviews present before, to be able to remove the new ones if cancelled
+  GDALRasterBandH myFirstBand = GDALGetRasterBand( mGdalBaseDataset, 1 );
+  bool myHadOverviews = myFirstBand && GDALGetOverviewCount( myFirstBand ) > 0;
+  QString myOverviewFile;
+  if ( theFormat == QgsRaster::PyramidsGTiff )
+  {
+    myOverviewFile = dataSourceUri() + ".ovr";
+  }
+  else if ( theFormat == QgsRaster::PyramidsErdas )
+  {
+    QFileInfo myFileInfo( dataSourceUri() );
+    myOverviewFile = myFileInfo.absolutePath() + '/' + myFileInfo.completeBaseName() + ".aux";
+  }
+  bool myOverviewFileExisted = !myOverviewFile.isEmpty() && QFileInfo( myOverviewFile ).exists();
+
+  // configuration options are set for the current thread only, pyramids of several
+  // datasets may be built at the same time in different threads
+
   // are we using Erdas Imagine external overviews?
   QgsStringMap myConfigOptionsOld;
-  myConfigOptionsOld[ "USE_RRD" ] = CPLGetConfigOption( "USE_RRD", "NO" );
+  myConfigOptionsOld[ "USE_RRD" ] = CPLGetConfigOption( "USE_RRD", nullptr );
   if ( theFormat == QgsRaster::PyramidsErdas )
-    CPLSetConfigOption( "USE_RRD", "YES" );
+    CPLSetThreadLocalConfigOption( "USE_RRD", "YES" );
   else
-    CPLSetConfigOption( "USE_RRD", "NO" );
+    CPLSetThreadLocalConfigOption( "USE_RRD", "NO" );
 
   // add any driver-specific configuration options, save values to be restored later
   if ( theFormat != QgsRaster::PyramidsErdas && ! theConfigOptions.isEmpty() )
@@ -1637,7 +2160,7 @@ QString QgsGdalProvider::buildPyramids( const QList<QgsRasterPyramid> & theRaste
         // save previous value
         myConfigOptionsOld[ opt[0] ] = QString( CPLGetConfigOption( key.data(), nullptr ) );
         // set temp. value
-        CPLSetConfigOption( key.data(), value.data() );
+        CPLSetThreadLocalConfigOption( key.data(), value.data() );
         QgsDebugMsg( QString( "set option %1=%2" ).arg( key.data(), value.data() ) );
       }
       else
@@ -1697,6 +2220,7 @@ QString QgsGdalProvider::buildPyramids( const QList<QgsRasterPyramid> & theRaste
     QgsGdalProgress myProg;
     myProg.type = QgsRaster::ProgressPyramids;
     myProg.provider = this;
+    myProg.feedback = feedback;
     myError = GDALBuildOverviews( mGdalBaseDataset, theMethod,
                                   myOverviewLevelsVector.size(), myOverviewLevelsVector.data(),
                                   0, nullptr,
@@ -1704,10 +2228,26 @@ QString QgsGdalProvider::buildPyramids( const QList<QgsRasterPyramid> & theRaste
 
     if ( myError == CE_Failure || CPLGetLastErrorNo() == CPLE_NotSupported )
     {
-      QgsDebugMsg( QString( "Building pyramids failed using resampling method [%1]" ).arg( theMethod ) );
+      bool myCanceled = feedback && feedback->isCancelled();
+      if ( myCanceled )
+      {
+        QgsDebugMsg( "Building pyramids canceled" );
+        // remove the levels built so far, passing no levels clears the overviews
+        if ( !myHadOverviews )
+          GDALBuildOverviews( mGdalBaseDataset, theMethod, 0, nullptr, 0, nullptr, nullptr, nullptr );
+      }
+      else
+      {
+        QgsDebugMsg( QString( "Building pyramids failed using resampling method [%1]" ).arg( theMethod ) );
+      }
       //something bad happenend
       //QString myString = QString (CPLGetLastError());
+      releaseMappedBands();
       GDALClose( mGdalBaseDataset );
+      if ( myCanceled && !myOverviewFileExisted && !myOverviewFile.isEmpty() && QFileInfo( myOverviewFile ).exists() )
+      {
+        QFile::remove( myOverviewFile );
+      }
       mGdalBaseDataset = gdalOpen( TO8F( dataSourceUri() ), mUpdate ? GA_Update : GA_ReadOnly );
       //Since we are not a virtual warped dataset, mGdalDataSet and mGdalBaseDataset are supposed to be the same
       mGdalDataset = mGdalBaseDataset;
@@ -1715,22 +2255,19 @@ QString QgsGdalProvider::buildPyramids( const QList<QgsRasterPyramid> & theRaste
       //emit drawingProgress( 0, 0 );
 
       // restore former configOptions
-      for ( QgsStringMap::const_iterator it = myConfigOptionsOld.begin();
-            it != myConfigOptionsOld.end(); ++it )
-      {
-        QByteArray key = it.key().toLocal8Bit();
-        QByteArray value = it.value().toLocal8Bit();
-        CPLSetConfigOption( key.data(), value.data() );
-      }
+      restoreConfigOptions( myConfigOptionsOld );
 
       // TODO print exact error message
-      return "FAILED_NOT_SUPPORTED";
+      return myCanceled ? "ERROR_CANCELED" : "FAILED_NOT_SUPPORTED";
     }
     else
     {
       QgsDebugMsg( "Building pyramids finished OK" );
       //make sure the raster knows it has pyramids
       mHasPyramids = true;
+      // cached blocks are identified by overview index, which may have changed
+      if ( mBlockCache )
+        mBlockCache->clear();
     }
   }
   catch ( CPLErr )
@@ -1739,13 +2276,7 @@ QString QgsGdalProvider::buildPyramids( const QList<QgsRasterPyramid> & theRaste
   }
 
   // restore former configOptions
-  for ( QgsStringMap::const_iterator it = myConfigOptionsOld.begin();
-        it != myConfigOptionsOld.end(); ++it )
-  {
-    QByteArray key = it.key().toLocal8Bit();
-    QByteArray value = it.value().toLocal8Bit();
-    CPLSetConfigOption( key.data(), value.data() );
-  }
+  restoreConfigOptions( myConfigOptionsOld );
 
   QgsDebugMsg( "Pyramid overviews built" );
 
@@ -1762,6 +2293,7 @@ QString QgsGdalProvider::buildPyramids( const QList<QgsRasterPyramid> & theRaste
   {
     QgsDebugMsg( "Reopening dataset ..." );
     //close the gdal dataset and reopen it in read only mode
+    releaseMappedBands();
     GDALClose( mGdalBaseDataset );
     mGdalBaseDataset = gdalOpen( TO8F( dataSourceUri() ), mUpdate ? GA_Update : GA_ReadOnly );
     //Since we are not a virtual warped dataset, mGdalDataSet and mGdalBaseDataset are supposed to be the same
@@ -1772,6 +2304,52 @@ QString QgsGdalProvider::buildPyramids( const QList<QgsRasterPyramid> & theRaste
   return nullptr; // returning null on success
 }
 
+void QgsGdalProvider::restoreConfigOptions( const QgsStringMap& theConfigOptions )
+{
+  for ( QgsStringMap::const_iterator it = theConfigOptions.constBegin();
+        it != theConfigOptions.constEnd(); ++it )
+  {
+    QByteArray key = it.key().toLocal8Bit();
+    if ( it.value().isNull() )
+    {
+      // the option was not set, remove the value set for the thread
+      CPLSetThreadLocalConfigOption( key.data(), nullptr );
+    }
+    else
+    {
+      QByteArray value = it.value().toLocal8Bit();
+      CPLSetThreadLocalConfigOption( key.data(), value.data() );
+    }
+  }
+}
+
+void QgsGdalProvider::reloadData()
+{
+  // a warped dataset is created from the base dataset, it can not be reopened alone
+  if ( !mGdalBaseDataset || mGdalDataset != mGdalBaseDataset )
+    return;
+
+  // reopen the dataset so that GDAL finds overviews created by another dataset handle
+  GDALDatasetH myGdalDataset = gdalOpen( TO8F( dataSourceUri() ), mUpdate ? GA_Update : GA_ReadOnly );
+  if ( !myGdalDataset )
+  {
+    QgsDebugMsg( "Cannot reopen dataset " + dataSourceUri() );
+    return;
+  }
+
+  releaseMappedBands();
+  GDALDereferenceDataset( mGdalBaseDataset );
+  GDALClose( mGdalDataset );
+  if ( mBlockCache )
+    mBlockCache->clear();
+  mGdalBaseDataset = myGdalDataset;
+  mGdalDataset = mGdalBaseDataset;
+  GDALReferenceDataset( mGdalDataset );
+
+  GDALRasterBandH myGDALBand = GDALGetRasterBand( mGdalDataset, 1 );
+  mHasPyramids = myGDALBand && gdalGetOverviewCount( myGDALBand ) > 0;
+}
+
 #if 0
 QList<QgsRasterPyramid> QgsGdalProvider::buildPyramidList()
 {
@@ -2299,6 +2877,13 @@ bool QgsGdalProvider::hasStatistics( int theBandNo,
   QgsRasterBandStats myRasterBandStats;
   initStatistics( myRasterBandStats, theBandNo, theStats, theExtent, theSampleSize );
 
+  // Then check if computed before and saved with the dataset
+  if ( readSavedStatistics( myRasterBandStats ) )
+  {
+    mStatistics.append( myRasterBandStats );
+    return true;
+  }
+
   if (( srcHasNoDataValue( theBandNo ) && !useSrcNoDataValue( theBandNo ) ) ||
       !userNoDataValues( theBandNo ).isEmpty() )
   {
@@ -2391,13 +2976,22 @@ QgsRasterBandStats QgsGdalProvider::bandStatistics( int theBandNo, int theStats,
     }
   }
 
+  if ( readSavedStatistics( myRasterBandStats ) )
+  {
+    QgsDebugMsg( "Using saved statistics." );
+    mStatistics.append( myRasterBandStats );
+    return myRasterBandStats;
+  }
+
   // We cannot use GDAL stats if user disabled src no data value or set
   // custom  no data values
   if (( srcHasNoDataValue( theBandNo ) && !useSrcNoDataValue( theBandNo ) ) ||
       !userNoDataValues( theBandNo ).isEmpty() )
   {
     QgsDebugMsg( "Custom no data values, using generic statistics." );
-    return QgsRasterDataProvider::bandStatistics( theBandNo, theStats, theExtent, theSampleSize );
+    myRasterBandStats = QgsRasterDataProvider::bandStatistics( theBandNo, theStats, theExtent, theSampleSize );
+    saveStatistics( myRasterBandStats );
+    return myRasterBandStats;
   }
 
   int supportedStats = QgsRasterBandStats::Min | QgsRasterBandStats::Max
@@ -2410,7 +3004,9 @@ QgsRasterBandStats QgsGdalProvider::bandStatistics( int theBandNo, int theStats,
        ( theStats & ( ~supportedStats ) ) )
   {
     QgsDebugMsg( "Statistics not supported by provider, using generic statistics." );
-    return QgsRasterDataProvider::bandStatistics( theBandNo, theStats, theExtent, theSampleSize );
+    myRasterBandStats = QgsRasterDataProvider::bandStatistics( theBandNo, theStats, theExtent, theSampleSize );
+    saveStatistics( myRasterBandStats );
+    return myRasterBandStats;
   }
 
   QgsDebugMsg( "Using GDAL statistics." );
@@ -2526,6 +3122,142 @@ QgsRasterBandStats QgsGdalProvider::bandStatistics( int theBandNo, int theStats,
 
 } // QgsGdalProvider::bandStatistics
 
+QString QgsGdalProvider::savedStatisticsItemName( const QString& type, int theBandNo, const QgsRectangle& theExtent, int theWidth, int theHeight, const QString& parameters )
+{
+  // statistics depend on the region, resolution and no data values, and are outdated if the file is modified
+  QStringList key;
+  key << QString::number( theBandNo )
+  << QString::number( theExtent.xMinimum(), 'g', 17 )
+  << QString::number( theExtent.yMinimum(), 'g', 17 )
+  << QString::number( theExtent.xMaximum(), 'g', 17 )
+  << QString::number( theExtent.yMaximum(), 'g', 17 )
+  << QString::number( theWidth )
+  << QString::number( theHeight )
+  << QString::number( useSrcNoDataValue( theBandNo ) );
+  Q_FOREACH ( const QgsRasterRange& range, userNoDataValues( theBandNo ) )
+  {
+    key << QString::number( range.min(), 'g', 17 ) + ':' + QString::number( range.max(), 'g', 17 );
+  }
+  QFileInfo fileInfo( dataSourceUri() );
+  if ( fileInfo.exists() )
+  {
+    key << QString::number( fileInfo.size() ) << fileInfo.lastModified().toString( Qt::ISODate );
+  }
+  key << parameters;
+
+  QByteArray hash = QCryptographicHash::hash( key.join( "|" ).toUtf8(), QCryptographicHash::Md5 ).toHex();
+  return type + '_' + QString::fromLatin1( hash );
+}
+
+bool QgsGdalProvider::readSavedStatistics( QgsRasterBandStats& theStats )
+{
+  GDALRasterBandH myGdalBand = GDALGetRasterBand( mGdalDataset, theStats.bandNumber );
+  if ( !myGdalBand )
+    return false;
+
+  QString name = savedStatisticsItemName( "STATISTICS", theStats.bandNumber, theStats.extent, theStats.width, theStats.height, QString() );
+  const char* value = GDALGetMetadataItem( myGdalBand, TO8F( name ), STATISTICS_METADATA_DOMAIN );
+  if ( !value )
+    return false;
+
+  QStringList values = QString::fromLatin1( value ).split( ',' );
+  if ( values.size() != 9 )
+    return false;
+
+  int statsGathered = values.at( 0 ).toInt();
+  if ( theStats.statsGathered != ( statsGathered & theStats.statsGathered ) )
+    return false;
+
+  theStats.statsGathered = statsGathered;
+  theStats.elementCount = values.at( 1 ).toULongLong();
+  theStats.minimumValue = values.at( 2 ).toDouble();
+  theStats.maximumValue = values.at( 3 ).toDouble();
+  theStats.range = values.at( 4 ).toDouble();
+  theStats.mean = values.at( 5 ).toDouble();
+  theStats.stdDev = values.at( 6 ).toDouble();
+  theStats.sum = values.at( 7 ).toDouble();
+  theStats.sumOfSquares = values.at( 8 ).toDouble();
+  return true;
+}
+
+void QgsGdalProvider::saveStatistics( const QgsRasterBandStats& theStats )
+{
+  GDALRasterBandH myGdalBand = GDALGetRasterBand( mGdalDataset, theStats.bandNumber );
+  if ( !myGdalBand || theStats.elementCount == 0 )
+    return;
+
+  QStringList values;
+  values << QString::number( theStats.statsGathered )
+  << QString::number( theStats.elementCount )
+  << QString::number( theStats.minimumValue, 'g', 17 )
+  << QString::number( theStats.maximumValue, 'g', 17 )
+  << QString::number( theStats.range, 'g', 17 )
+  << QString::number( theStats.mean, 'g', 17 )
+  << QString::number( theStats.stdDev, 'g', 17 )
+  << QString::number( theStats.sum, 'g', 17 )
+  << QString::number( theStats.sumOfSquares, 'g', 17 );
+
+  // GDAL writes the item to the PAM file (.aux.xml) of the dataset when it is closed
+  QString name = savedStatisticsItemName( "STATISTICS", theStats.bandNumber, theStats.extent, theStats.width, theStats.height, QString() );
+  if ( GDALSetMetadataItem( myGdalBand, TO8F( name ), values.join( "," ).toLatin1().constData(), STATISTICS_METADATA_DOMAIN ) == CE_None )
+  {
+    mStatisticsSaved = true;
+  }
+}
+
+bool QgsGdalProvider::readSavedHistogram( QgsRasterHistogram& theHistogram )
+{
+  GDALRasterBandH myGdalBand = GDALGetRasterBand( mGdalDataset, theHistogram.bandNumber );
+  if ( !myGdalBand )
+    return false;
+
+  QString name = savedStatisticsItemName( "HISTOGRAM", theHistogram.bandNumber, theHistogram.extent, theHistogram.width, theHistogram.height, histogramParameters( theHistogram ) );
+  const char* value = GDALGetMetadataItem( myGdalBand, TO8F( name ), STATISTICS_METADATA_DOMAIN );
+  if ( !value )
+    return false;
+
+  QStringList values = QString::fromLatin1( value ).split( ',' );
+  if ( values.size() != theHistogram.binCount + 1 )
+    return false;
+
+  theHistogram.nonNullCount = values.at( 0 ).toInt();
+  theHistogram.histogramVector.resize( theHistogram.binCount );
+  for ( int i = 0; i < theHistogram.binCount; i++ )
+  {
+    theHistogram.histogramVector[i] = values.at( i + 1 ).toInt();
+  }
+  theHistogram.valid = true;
+  return true;
+}
+
+void QgsGdalProvider::saveHistogram( const QgsRasterHistogram& theHistogram )
+{
+  GDALRasterBandH myGdalBand = GDALGetRasterBand( mGdalDataset, theHistogram.bandNumber );
+  if ( !myGdalBand || !theHistogram.valid || theHistogram.histogramVector.size() != theHistogram.binCount )
+    return;
+
+  QStringList values;
+  values << QString::number( theHistogram.nonNullCount );
+  Q_FOREACH ( int count, theHistogram.histogramVector )
+  {
+    values << QString::number( count );
+  }
+
+  QString name = savedStatisticsItemName( "HISTOGRAM", theHistogram.bandNumber, theHistogram.extent, theHistogram.width, theHistogram.height, histogramParameters( theHistogram ) );
+  if ( GDALSetMetadataItem( myGdalBand, TO8F( name ), values.join( "," ).toLatin1().constData(), STATISTICS_METADATA_DOMAIN ) == CE_None )
+  {
+    mStatisticsSaved = true;
+  }
+}
+
+QString QgsGdalProvider::histogramParameters( const QgsRasterHistogram& theHistogram )
+{
+  return QString( "%1|%2|%3|%4" ).arg( theHistogram.binCount )
+         .arg( theHistogram.minimum, 0, 'g', 17 )
+         .arg( theHistogram.maximum, 0, 'g', 17 )
+         .arg( theHistogram.includeOutOfRange );
+}
+
 void QgsGdalProvider::initBaseDataset()
 {
 #if 0
@@ -2843,6 +3575,8 @@ bool QgsGdalProvider::write( void* data, int band, int width, int height, int xO
   {
     return false;
   }
+  if ( mBlockCache )
+    mBlockCache->clear();
   return gdalRasterIO( rasterBand, GF_Write, xOffset, yOffset, width, height, data, width, height, GDALGetRasterDataType( rasterBand ), 0, 0 ) == CE_None;
 }
 
@@ -2872,6 +3606,7 @@ bool QgsGdalProvider::remove()
   if ( mGdalDataset )
   {
     GDALDriverH driver = GDALGetDatasetDriver( mGdalDataset );
+    releaseMappedBands();
     GDALClose( mGdalDataset );
     mGdalDataset = nullptr;
 
@@ -31,6 +31,7 @@
 #include <QStringList>
 #include <QDomElement>
 #include <QMap>
+#include <QSharedPointer>
 #include <QVector>
 
 class QgsRasterPyramid;
@@ -44,6 +45,8 @@ int CPL_STDCALL progressCallback( double dfComplete,
 
 
 class QgsCoordinateTransform;
+class QgsGdalBlockCache;
+struct CPLVirtualMem;
 
 /**
 
@@ -224,9 +227,13 @@ class QgsGdalProvider : public QgsRasterDataProvider, QgsGdalProviderBase
     QString buildPyramids( const QList<QgsRasterPyramid> & theRasterPyramidList,
                            const QString & theResamplingMethod = "NEAREST",
                            QgsRaster::RasterPyramidsFormat theFormat = QgsRaster::PyramidsGTiff,
-                           const QStringList & theCreateOptions = QStringList() ) override;
+                           const QStringList & theCreateOptions = QStringList(),
+                           QgsFeedback* feedback = nullptr ) override;
     QList<QgsRasterPyramid> buildPyramidList( QList<int> overviewList = QList<int>() ) override;
 
+    /** Reopens the dataset, e.g. to use overviews built by another provider of the same file */
+    void reloadData() override;
+
     /** \brief Close data set and release related data */
     void closeDataset();
 
@@ -248,6 +255,26 @@ class QgsGdalProvider : public QgsRasterDataProvider, QgsGdalProviderBase
     QString validatePyramidsConfigOptions( QgsRaster::RasterPyramidsFormat pyramidsFormat,
                                            const QStringList & theConfigOptions, const QString & fileFormat ) override;
 
+    /** Statistics of the reads of a provider and its clones, which share a cache of decoded blocks */
+    struct BlockReadStatistics
+    {
+      BlockReadStatistics() : cacheHits( 0 ), cacheMisses( 0 ), readCount( 0 ), bytesRead( 0 ), mappedReads( 0 ) {}
+
+      //! Number of blocks found in the cache
+      qint64 cacheHits;
+      //! Number of blocks read from the dataset
+      qint64 cacheMisses;
+      //! Number of read requests sent to GDAL, adjacent blocks are read with one request
+      qint64 readCount;
+      //! Number of bytes of decoded data read from the dataset
+      qint64 bytesRead;
+      //! Number of requests read directly from the memory mapped file, without GDAL
+      qint64 mappedReads;
+    };
+
+    //! Returns the statistics of the block reads of the provider and its clones
+    BlockReadStatistics blockReadStatistics() const;
+
   private:
     // update mode
     bool mUpdate;
@@ -258,6 +285,64 @@ class QgsGdalProvider : public QgsRasterDataProvider, QgsGdalProviderBase
     /** Do some initialization on the dataset (e.g. handling of south-up datasets)*/
     void initBaseDataset();
 
+    /** Returns the name of the dataset metadata item keeping statistics or a histogram
+     * of a band computed for a region, resolution and the current no data values */
+    QString savedStatisticsItemName( const QString& type, int theBandNo, const QgsRectangle& theExtent, int theWidth, int theHeight, const QString& parameters );
+
+    /** Reads statistics saved with the dataset by saveStatistics(), returns false if not found */
+    bool readSavedStatistics( QgsRasterBandStats& theStats );
+
+    /** Saves statistics in the metadata of the dataset, GDAL writes them to the PAM file */
+    void saveStatistics( const QgsRasterBandStats& theStats );
+
+    /** Reads a histogram saved with the dataset by saveHistogram(), returns false if not found */
+    bool readSavedHistogram( QgsRasterHistogram& theHistogram );
+
+    /** Saves a histogram in the metadata of the dataset, GDAL writes it to the PAM file */
+    void saveHistogram( const QgsRasterHistogram& theHistogram );
+
+    /** Returns the parameters of a histogram which identify it in addition to its region */
+    static QString histogramParameters( const QgsRasterHistogram& theHistogram );
+
+    /** Sets configuration options saved before changing them for the current thread,
+     * null values remove the options set for the thread */
+    static void restoreConfigOptions( const QgsStringMap& theConfigOptions );
+
+    /** Reads a source window through the block cache. The window is read from the overview
+     * closest to the requested resolution, extended to whole blocks of the overview.
+     * Returns false if the window should rather be read by GDAL directly, e.g. if no
+     * suitable overview exists, in that case the output arguments are not set.
+     * @param theBandNo band number
+     * @param srcLeft left column of the window at full resolution
+     * @param srcTop top row of the window at full resolution
+     * @param srcWidth width of the window at full resolution
+     * @param srcHeight height of the window at full resolution
+     * @param bufferWidth width of the buffer GDAL would read the window to
+     * @param bufferHeight height of the buffer GDAL would read the window to
+     * @param feedback optional feedback
+     * @param buffer returns the window data allocated with qgsMalloc()
+     * @param width returns the width of the returned window
+     * @param height returns the height of the returned window
+     * @param xMin returns the left edge of the returned window in map units
+     * @param yMax returns the top edge of the returned window in map units
+     * @param xRes returns the horizontal pixel size of the returned window
+     * @param yRes returns the vertical pixel size of the returned window, negative
+     */
+    bool readCachedWindow( int theBandNo, int srcLeft, int srcTop, int srcWidth, int srcHeight,
+                           int bufferWidth, int bufferHeight, QgsRasterBlockFeedback* feedback,
+                           char*& buffer, int& width, int& height, double& xMin, double& yMax, double& xRes, double& yRes );
+
+    /** Returns the first pixel of a band of an uncompressed dataset mapped to memory, or nullptr
+     * if the band can not be mapped, e.g. because it is compressed, tiled, not in the native byte
+     * order or read with another data type. The band is mapped on first use.
+     * @param theBandNo band number
+     * @param lineSpace returns the number of bytes between the starts of two rows
+     */
+    const char* mappedBandData( int theBandNo, qint64& lineSpace );
+
+    /** Unmaps the mapped bands, must be called before the dataset is closed or modified */
+    void releaseMappedBands();
+
     /**
      * Flag indicating if the layer data source is a valid layer
      */
@@ -303,6 +388,28 @@ class QgsGdalProvider : public QgsRasterDataProvider, QgsGdalProviderBase
     QStringList mSubLayers;
 
     bool mStatisticsAreReliable;
+
+    /** Whether statistics or histograms were saved to the PAM file of the dataset */
+    bool mStatisticsSaved;
+
+    /** Decoded blocks of the dataset, shared with the clones of the provider */
+    QSharedPointer<QgsGdalBlockCache> mBlockCache;
+
+    //! A band of the dataset mapped to memory
+    struct MappedBand
+    {
+      MappedBand() : memory( nullptr ), checked( false ), lineSpace( 0 ) {}
+
+      //! Mapping, nullptr if the band can not be mapped
+      CPLVirtualMem* memory;
+      //! True if mapping the band was tried
+      bool checked;
+      qint64 lineSpace;
+    };
+
+    /** Bands mapped to memory, indexed from 0. Every provider maps the bands of its own
+     * dataset handle, the pages of the file are shared by the system. */
+    QVector<MappedBand> mMappedBands;
 };
 
 #endif
@@ -16,6 +16,7 @@
 #include "qgsmemoryprovider.h"
 
 #include "qgsgeometry.h"
+#include "qgsgeometrypredicateengine.h"
 #include "qgslogger.h"
 #include "qgsspatialindex.h"
 #include "qgsmessagelog.h"
@@ -24,7 +25,7 @@
 
 QgsMemoryFeatureIterator::QgsMemoryFeatureIterator( QgsMemoryFeatureSource* source, bool ownSource, const QgsFeatureRequest& request )
     : QgsAbstractFeatureIteratorFromSource<QgsMemoryFeatureSource>( source, ownSource, request )
-    , mSelectRectGeom( nullptr )
+    , mSelectRectEngine( nullptr )
     , mSubsetExpression( nullptr )
 {
   if ( !mSource->mSubsetString.isEmpty() )
@@ -35,7 +36,8 @@ QgsMemoryFeatureIterator::QgsMemoryFeatureIterator( QgsMemoryFeatureSource* sour
 
   if ( !mRequest.filterRect().isNull() && mRequest.flags() & QgsFeatureRequest::ExactIntersect )
   {
-    mSelectRectGeom = QgsGeometry::fromRect( request.filterRect() );
+    QScopedPointer< QgsGeometry > rectGeom( QgsGeometry::fromRect( request.filterRect() ) );
+    mSelectRectEngine = new QgsGeometryPredicateEngine( rectGeom.data() );
   }
 
   // if there's spatial index, use it!
@@ -93,7 +95,8 @@ bool QgsMemoryFeatureIterator::nextFeatureUsingList( QgsFeature& feature )
     if ( !mRequest.filterRect().isNull() && mRequest.flags() & QgsFeatureRequest::ExactIntersect )
     {
       // do exact check in case we're doing intersection
-      if ( mSource->mFeatures.value( *mFeatureIdListIterator ).constGeometry() && mSource->mFeatures.value( *mFeatureIdListIterator ).constGeometry()->intersects( mSelectRectGeom ) )
+      const QgsGeometry* geometry = mSource->mFeatures.constFind( *mFeatureIdListIterator ).value().constGeometry();
+      if ( geometry && mSelectRectEngine->evaluate( QgsGeometryPredicateEngine::Intersects, geometry ) )
         hasFeature = true;
     }
     else
@@ -145,7 +148,7 @@ bool QgsMemoryFeatureIterator::nextFeatureTraverseAll( QgsFeature& feature )
       if ( mRequest.flags() & QgsFeatureRequest::ExactIntersect )
       {
         // using exact test when checking for intersection
-        if ( mSelectIterator->constGeometry() && mSelectIterator->constGeometry()->intersects( mSelectRectGeom ) )
+        if ( mSelectIterator->constGeometry() && mSelectRectEngine->evaluate( QgsGeometryPredicateEngine::Intersects, mSelectIterator->constGeometry() ) )
           hasFeature = true;
       }
       else
@@ -203,8 +206,8 @@ bool QgsMemoryFeatureIterator::close()
 
   iteratorClosed();
 
-  delete mSelectRectGeom;
-  mSelectRectGeom = nullptr;
+  delete mSelectRectEngine;
+  mSelectRectEngine = nullptr;
 
   mClosed = true;
   return true;
@@ -23,6 +23,7 @@ class QgsMemoryProvider;
 typedef QMap<QgsFeatureId, QgsFeature> QgsFeatureMap;
 
 class QgsSpatialIndex;
+class QgsGeometryPredicateEngine;
 
 
 class QgsMemoryFeatureSource : public QgsAbstractFeatureSource
@@ -65,7 +66,7 @@ class QgsMemoryFeatureIterator : public QgsAbstractFeatureIteratorFromSource<Qgs
     bool nextFeatureUsingList( QgsFeature& feature );
     bool nextFeatureTraverseAll( QgsFeature& feature );
 
-    QgsGeometry* mSelectRectGeom;
+    QgsGeometryPredicateEngine* mSelectRectEngine;
     QgsFeatureMap::const_iterator mSelectIterator;
     bool mUsingFeatureIdList;
     QList<QgsFeatureId> mFeatureIdList;
@@ -1571,6 +1571,115 @@ void QgsPostgresProvider::uniqueValues( int index, QList<QVariant> &uniqueValues
   }
 }
 
+QHash<QString, QVariant> QgsPostgresProvider::groupedAggregate( QgsAggregateCalculator::Aggregate aggregate, int index,
+    const QgsAttributeList& groupByIndexes, const QgsAggregateCalculator::AggregateParameters& parameters,
+    QgsExpressionContext* context, bool& ok )
+{
+  Q_UNUSED( context );
+  ok = false;
+
+  QHash<QString, QVariant> results;
+
+  // the filter is a QGIS expression, leave filtered aggregates to QGIS
+  if ( !parameters.filter.isEmpty() )
+    return results;
+
+  // only the aggregates with a direct SQL equivalent
+  QString function;
+  switch ( aggregate )
+  {
+    case QgsAggregateCalculator::Count:
+      function = "count(%1)";
+      break;
+    case QgsAggregateCalculator::Sum:
+      function = "coalesce(sum(%1),0)";
+      break;
+    case QgsAggregateCalculator::Min:
+      function = "min(%1)";
+      break;
+    case QgsAggregateCalculator::Max:
+      function = "max(%1)";
+      break;
+    case QgsAggregateCalculator::Mean:
+      function = "avg(%1)";
+      break;
+    case QgsAggregateCalculator::StDev:
+      function = "stddev_pop(%1)";
+      break;
+    case QgsAggregateCalculator::StDevSample:
+      function = "stddev_samp(%1)";
+      break;
+    default:
+      return results;
+  }
+
+  try
+  {
+    const QgsField &fld = field( index );
+    switch ( fld.type() )
+    {
+      case QVariant::Int:
+      case QVariant::LongLong:
+      case QVariant::Double:
+        break;
+
+      default:
+        // string and date aggregates have different semantics in QGIS
+        return results;
+    }
+
+    QStringList groupColumns;
+    QList<QVariant::Type> groupTypes;
+    Q_FOREACH ( int groupIndex, groupByIndexes )
+    {
+      const QgsField &groupField = field( groupIndex );
+      groupColumns << quotedIdentifier( groupField.name() );
+      groupTypes << groupField.type();
+    }
+
+    QString sql = QString( "SELECT %1,%2 FROM %3" )
+                  .arg( groupColumns.join( "," ),
+                        function.arg( quotedIdentifier( fld.name() ) ),
+                        mQuery );
+
+    if ( !mSqlWhereClause.isEmpty() )
+    {
+      sql += QString( " WHERE %1" ).arg( mSqlWhereClause );
+    }
+
+    sql += QString( " GROUP BY %1" ).arg( groupColumns.join( "," ) );
+
+    QgsPostgresResult res( connectionRO()->PQexec( sql ) );
+    if ( res.PQresultStatus() != PGRES_TUPLES_OK )
+      return results;
+
+    int valueColumn = groupColumns.count();
+    QVariantList keyValues;
+    for ( int row = 0; row < res.PQntuples(); row++ )
+    {
+      keyValues.clear();
+      for ( int i = 0; i < valueColumn; i++ )
+      {
+        keyValues << ( res.PQgetisnull( row, i ) ? QVariant() : convertValue( groupTypes.at( i ), res.PQgetvalue( row, i ) ) );
+      }
+
+      // QGIS calculates numeric aggregates as doubles
+      QVariant value;
+      if ( !res.PQgetisnull( row, valueColumn ) )
+        value = res.PQgetvalue( row, valueColumn ).toDouble();
+
+      results.insert( QgsAggregateCalculator::groupKey( keyValues ), value );
+    }
+  }
+  catch ( PGFieldNotFound )
+  {
+    return QHash<QString, QVariant>();
+  }
+
+  ok = true;
+  return results;
+}
+
 void QgsPostgresProvider::enumValues( int index, QStringList& enumList )
 {
   enumList.clear();
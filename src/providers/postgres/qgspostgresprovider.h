@@ -175,6 +175,15 @@ class QgsPostgresProvider : public QgsVectorDataProvider
      *  @param values reference to the list of unique values */
     virtual void uniqueValues( int index, QList<QVariant> &uniqueValues, int limit = -1 ) override;
 
+    /** Calculates a numeric aggregate for every group with a GROUP BY query
+     */
+    virtual QHash<QString, QVariant> groupedAggregate( QgsAggregateCalculator::Aggregate aggregate,
+        int index,
+        const QgsAttributeList& groupByIndexes,
+        const QgsAggregateCalculator::AggregateParameters& parameters,
+        QgsExpressionContext* context,
+        bool& ok ) override;
+
     /** Returns the possible enum values of an attribute. Returns an empty stringlist if a provider does not support enum types
       or if the given attribute is not an enum type.
      * @param index the index of the attribute